@@ -4,41 +4,285 @@
  * For a copy, see <https://opensource.org/licenses/MIT>.
  */
 
+#include <Combiner/ChunkedCombiner.h>
 #include <Combiner/Combiner.h>
-#include <File/FileSourceAnnexB.h>
+#include <Combiner/Pipeline.h>
+#include <Combiner/Settings.h>
+#include <Combiner/TileRearranger.h>
+#include <Daemon/ControlRequestHandler.h>
+#include <Daemon/ControlSocket.h>
+#include <Daemon/JobManager.h>
+#include <HEVC/NalIndexHEVC.h>
+#include <Network/RTPReplaySender.h>
+#include <common/JSONObject.h>
+#include <common/Logger.h>
+#include <common/PipelineStatistics.h>
+#include <common/Tracer.h>
 
 #include <filesystem>
 #include <iostream>
+#include <memory>
 
 void printHelp()
 {
   std::cout << "BitstreamCombiner. Combine multiple HEVC input bitstreams into one\n";
   std::cout << "that are laid out side by side or in a grid using Tiles.\n";
   std::cout << "Usage:\n";
-  std::cout << "  BitstreamCombiner InputFile1.hevc InputFile2.hevc OutputFile.hevc\n";
+  std::cout << "  BitstreamCombiner [Options] InputFile1.hevc InputFile2.hevc OutputFile.hevc\n";
+  std::cout << "  BitstreamCombiner --extract-tiles <region> InputFile.hevc OutputFile.hevc\n";
+  std::cout << "  BitstreamCombiner --relayout <layout> InputFile.hevc OutputFile.hevc\n";
+  std::cout << "  BitstreamCombiner --write-index InputFile1.hevc [InputFile2.hevc ...]\n";
+  std::cout << "  BitstreamCombiner --replay-rtp <host:port> InputFile.hevc\n";
+  std::cout << "  BitstreamCombiner --daemon <socket> [--workers <number>]\n";
+  std::cout << "  BitstreamCombiner --control <socket> start [Options] Inputs... Output\n";
+  std::cout << "  BitstreamCombiner --control <socket> stop <job> | status [job] | shutdown\n";
+  std::cout << "  BitstreamCombiner --control <socket> switch <job> <input> <InputFile>\n";
+  std::cout << "Inputs can be raw (Annex B) HEVC files, MP4 files with an hvc1/hev1 track,\n";
+  std::cout << "MPEG-2 transport streams with an HEVC stream or rtp://<host:port> to receive\n";
+  std::cout << "HEVC over RTP/UDP on a local address (the stream ends if no packets arrive\n";
+  std::cout << "for 2 seconds).\n";
+  std::cout << "Outputs ending in .mp4, .m4v or .cmfv are written as fragmented MP4 (CMAF),\n";
+  std::cout << "outputs ending in .ts as MPEG-2 transport stream. An output rtp://<host:port>\n";
+  std::cout << "sends the stream in real time as RTP over UDP to the address.\n";
+  std::cout << "Inputs and outputs ending in .hvcl are length prefixed: each NAL unit is\n";
+  std::cout << "preceded by its size (4 bytes, big endian) instead of a start code.\n";
+  std::cout << "Options:\n";
+  std::cout << "  --log-level <debug|info|warning|error>  Default info. On the debug level,\n";
+  std::cout << "                                          every NAL unit is logged.\n";
+  std::cout << "  --stats <file>                          Write counters and timers of all\n";
+  std::cout << "                                          stages as JSON to the file.\n";
+  std::cout << "  --stats-interval <seconds>              Also update the statistics file\n";
+  std::cout << "                                          periodically while running.\n";
+  std::cout << "  --trace <file>                          Record the pipeline stages as Chrome\n";
+  std::cout << "                                          trace events (Perfetto or\n";
+  std::cout << "                                          chrome://tracing) to the file.\n";
+  std::cout << "  --start <position>                      Start at the nearest IRAP before the\n";
+  std::cout << "                                          position: poc:<POC>, irap:<index> or\n";
+  std::cout << "                                          time:<seconds> (VUI timing). POCs\n";
+  std::cout << "                                          repeat after every IDR. The first\n";
+  std::cout << "                                          picture with the POC is used, or the\n";
+  std::cout << "                                          first one from an IRAP on with\n";
+  std::cout << "                                          poc:<POC>@irap:<index>.\n";
+  std::cout << "  --end <position>                        Stop before the picture at the\n";
+  std::cout << "                                          position.\n";
+  std::cout << "  --threads <number>                      Split the inputs into chunks at IRAP\n";
+  std::cout << "                                          pictures and combine the chunks in\n";
+  std::cout << "                                          parallel. Default 1 (sequential).\n";
+  std::cout << "  --fragment-frames <number>              CMAF output: Start a new fragment\n";
+  std::cout << "                                          every number of frames instead of at\n";
+  std::cout << "                                          every IRAP picture.\n";
+  std::cout << "  --pcr-interval <milliseconds>           TS output: Maximum time between two\n";
+  std::cout << "                                          PCRs. Default 40.\n";
+  std::cout << "  --mux-rate <bits per second>            TS output: Write with a constant bit\n";
+  std::cout << "                                          rate (filled up with null packets).\n";
+  std::cout << "  --segment-seconds <seconds>             Raw (Annex B) output: Start a new\n";
+  std::cout << "                                          segment file at the first IRAP after\n";
+  std::cout << "                                          the duration. The segments are listed\n";
+  std::cout << "                                          in a playlist <output>.m3u8.\n";
+  std::cout << "  --segment-gops <number>                 Like --segment-seconds but start a\n";
+  std::cout << "                                          new segment every number of GOPs.\n";
+  std::cout << "  --kernel-copy                           Raw (Annex B) output: Let the kernel\n";
+  std::cout << "                                          copy the slice data from the input\n";
+  std::cout << "                                          files (copy_file_range/splice) so\n";
+  std::cout << "                                          that it is not written from memory.\n";
+  std::cout << "  --also-output <file>                    Write the same stream to another\n";
+  std::cout << "                                          output at the same time (can be\n";
+  std::cout << "                                          repeated). If it falls behind, it\n";
+  std::cout << "                                          skips to the next IRAP picture.\n";
+  std::cout << "  --skip-tiles <milliseconds>             Keep combining if an input delivers\n";
+  std::cout << "                                          nothing for this time, ends or gets\n";
+  std::cout << "                                          out of step. Its tile repeats its\n";
+  std::cout << "                                          last picture (gray at IRAP pictures)\n";
+  std::cout << "                                          until it resumes at an IDR picture.\n";
+  std::cout << "  --slate <file>                          With --skip-tiles: A single picture\n";
+  std::cout << "                                          bitstream that is shown in the tile\n";
+  std::cout << "                                          of an input that did not start yet.\n";
+  std::cout << "                                          Can be repeated for other tile sizes.\n";
+  std::cout << "  --max-temporal-id <0-6>                 Drop the temporal sub-layers above\n";
+  std::cout << "                                          the TemporalId from all inputs (e.g.\n";
+  std::cout << "                                          0 to get 25 of 50 fps with 2 layers).\n";
+  std::cout << "  --extract-tiles <column,row[,w,h]>      Extract the tile (or the w x h tiles\n";
+  std::cout << "                                          from it on) of a tiled input into a\n";
+  std::cout << "                                          stream of its own. Columns and rows\n";
+  std::cout << "                                          are counted from 0. Every tile must\n";
+  std::cout << "                                          start with a slice segment.\n";
+  std::cout << "  --relayout <columns>x<rows>[:order]     Lay out all tiles of a tiled input in\n";
+  std::cout << "                                          a new grid (e.g. 2x2 as 4x1). The\n";
+  std::cout << "                                          order lists the tile (in raster scan)\n";
+  std::cout << "                                          for every new position (e.g. 2x2:\n";
+  std::cout << "                                          3,2,1,0). Nothing is re-encoded.\n";
+  std::cout << "  --write-index                           Scan the inputs once and write a NAL\n";
+  std::cout << "                                          index (<input>.nalidx) next to them.\n";
+  std::cout << "                                          An up to date index is used to read\n";
+  std::cout << "                                          the input without start code scanning.\n";
+  std::cout << "  --daemon <socket>                       Run as a daemon that is controlled\n";
+  std::cout << "                                          with JSON requests (one per line) on\n";
+  std::cout << "                                          the Unix domain socket. Jobs run on\n";
+  std::cout << "                                          a pool of worker threads.\n";
+  std::cout << "  --workers <number>                      Daemon: Number of jobs that run at\n";
+  std::cout << "                                          the same time. Default 2.\n";
+  std::cout << "  --control <socket> <command>            Send a command to a daemon and print\n";
+  std::cout << "                                          the response. start takes the same\n";
+  std::cout << "                                          arguments as a combination except\n";
+  std::cout << "                                          --log-level, --stats and --trace.\n";
+  std::cout << "                                          status includes the statistics. switch\n";
+  std::cout << "                                          replaces an input (counted from 0)\n";
+  std::cout << "                                          of a running job at the next\n";
+  std::cout << "                                          compatible IDR picture.\n";
+  std::cout << "  --replay-rtp <host:port>                Send the raw (Annex B) input in real\n";
+  std::cout << "                                          time as RTP to the address (e.g. to\n";
+  std::cout << "                                          feed an rtp:// input for testing).\n";
 }
-struct Settings
+int writeIndexFiles(const std::vector<std::filesystem::path> &inputFiles)
 {
-  std::vector<std::filesystem::path>   inputFiles;
-  std::optional<std::filesystem::path> outputFile;
-};
+  for (const auto &file : inputFiles)
+  {
+    if (!combiner::isAnnexBFile(file))
+    {
+      std::cerr << "A NAL index can only be written for raw (Annex B) inputs " << file << "\n";
+      return 1;
+    }
+    try
+    {
+      const auto index = combiner::parser::hevc::createNalIndex(file);
+      index.writeSidecar(file);
+      combiner::logger().info("Wrote index with " + std::to_string(index.entries.size()) +
+                              " NAL units to " +
+                              combiner::NalIndex::getSidecarPath(file).string());
+    }
+    catch (const std::exception &e)
+    {
+      combiner::logger().flush();
+      std::cerr << "Error writing index for " << file << ": " << e.what() << '\n';
+      return 1;
+    }
+  }
+  return 0;
+}
+
+int runDaemon(const combiner::Settings &settings)
+{
+  try
+  {
+    combiner::JobManager            jobManager(settings.nrWorkers);
+    combiner::ControlServer         server(*settings.daemonSocket);
+    combiner::ControlRequestHandler handler(jobManager, [&server]() { server.stop(); });
+    combiner::logger().info("Waiting for requests on " + settings.daemonSocket->string() +
+                            " with " + std::to_string(settings.nrWorkers) + " workers");
+    server.run([&handler](const std::string &request) { return handler.handleRequest(request); });
+  }
+  catch (const std::exception &e)
+  {
+    combiner::logger().flush();
+    std::cerr << "Error running the daemon: " << e.what() << '\n';
+    return 1;
+  }
+  combiner::logger().info("Daemon stopped");
+  return 0;
+}
 
-Settings parseCommandLineArguments(int argc, char const *argv[])
+// Send the command to the daemon and print the response. Returns 0 if the daemon accepted it.
+int runControlClient(const combiner::Settings &settings)
 {
-  Settings settings;
-  for (int i = 1; i < argc; ++i)
-    settings.inputFiles.push_back(std::filesystem::path(argv[i]));
-  if (!settings.inputFiles.empty())
+  const auto &command = settings.controlCommand;
+  const auto &name    = command.front();
+
+  combiner::JSONObject request;
+  try
+  {
+    request.setString("command", name);
+    if (name == "start")
+      request.setStringArray("arguments", {command.begin() + 1, command.end()});
+    else if ((name == "stop" && command.size() == 2) || (name == "status" && command.size() <= 2))
+    {
+      if (command.size() == 2)
+        request.setNumber("job", static_cast<double>(std::stoull(command.at(1))));
+    }
+    else if (name == "switch" && command.size() == 4)
+      request.setNumber("job", static_cast<double>(std::stoull(command.at(1))))
+          .setNumber("input", static_cast<double>(std::stoull(command.at(2))))
+          .setString("file", command.at(3));
+    else if (name != "shutdown" || command.size() != 1)
+      throw std::invalid_argument("Invalid command for the daemon");
+  }
+  catch (const std::exception &e)
+  {
+    std::cout << e.what() << "\n\n";
+    printHelp();
+    return 1;
+  }
+
+  std::string response;
+  try
   {
-    settings.outputFile = settings.inputFiles.back();
-    settings.inputFiles.pop_back();
+    response = combiner::sendControlRequest(*settings.controlSocket, request.toString());
   }
-  return settings;
+  catch (const std::exception &e)
+  {
+    std::cerr << e.what() << '\n';
+    return 1;
+  }
+  std::cout << response << '\n';
+  return response.rfind("{\"ok\": true", 0) == 0 ? 0 : 1;
 }
 
 int main(int argc, char const *argv[])
 {
-  const auto settings = parseCommandLineArguments(argc, argv);
+  combiner::Settings settings;
+  try
+  {
+    settings = combiner::parseCommandLineArguments(argc, argv);
+  }
+  catch (const std::exception &e)
+  {
+    std::cout << e.what() << "\n\n";
+    printHelp();
+    return 1;
+  }
+
+  if (settings.controlSocket)
+    return runControlClient(settings);
+
+  combiner::logger().setLevel(settings.logLevel.value_or(combiner::LogLevel::Info));
+  if (settings.traceFile)
+    combiner::tracer().enable();
+
+  if (settings.daemonSocket)
+    return runDaemon(settings);
+
+  if (settings.writeIndex)
+  {
+    if (settings.inputFiles.empty())
+    {
+      std::cout << "No input files provided.\n\n";
+      printHelp();
+      return 1;
+    }
+    return writeIndexFiles(settings.inputFiles);
+  }
+
+  if (settings.replayRTPDestination)
+  {
+    if (settings.inputFiles.size() != 1 || !combiner::isAnnexBFile(settings.inputFiles.front()))
+    {
+      std::cout << "--replay-rtp needs exactly one raw (Annex B) input file.\n\n";
+      printHelp();
+      return 1;
+    }
+    try
+    {
+      combiner::replayAnnexBFileAsRTP(
+          settings.inputFiles.front(), *settings.replayRTPDestination, true);
+    }
+    catch (const std::exception &e)
+    {
+      combiner::logger().flush();
+      std::cerr << "Error sending " << settings.inputFiles.front() << " as RTP: " << e.what()
+                << '\n';
+      return 1;
+    }
+    return 0;
+  }
 
   if (settings.inputFiles.empty() || !settings.outputFile)
   {
@@ -47,6 +291,13 @@ int main(int argc, char const *argv[])
     return 1;
   }
 
+  if (settings.tileArrangement && settings.inputFiles.size() != 1)
+  {
+    std::cout << "--extract-tiles and --relayout need exactly one input file.\n\n";
+    printHelp();
+    return 1;
+  }
+
   if (settings.inputFiles.size() != 1 && settings.inputFiles.size() != 2 &&
       settings.inputFiles.size() != 4)
   {
@@ -55,28 +306,119 @@ int main(int argc, char const *argv[])
     return 1;
   }
 
-  std::vector<combiner::FileSourceAnnexB> fileSources;
   for (const auto &file : settings.inputFiles)
   {
     const auto fileStatus = std::filesystem::status(file);
-    if (fileStatus.type() == std::filesystem::file_type::not_found)
+    if (!combiner::isRTPInput(file) && fileStatus.type() == std::filesystem::file_type::not_found)
     {
       std::cout << "Unable to find input file " << file << "\n";
       return 1;
     }
-    fileSources.emplace_back(file);
+    if (settings.nrThreads > 1 && !combiner::isAnnexBFile(file))
+    {
+      std::cout << "--threads is only supported for raw (Annex B) inputs.\n";
+      return 1;
+    }
   }
 
-  combiner::FileSinkAnnexB outputFile(settings.outputFile.value());
+  // The chunked combiner opens the inputs for each chunk itself
+  std::vector<std::unique_ptr<combiner::NalUnitSource>> fileSources;
+  if (settings.nrThreads == 1)
+  {
+    for (const auto &file : settings.inputFiles)
+    {
+      try
+      {
+        fileSources.push_back(combiner::openInputFile(file, settings.readRange));
+      }
+      catch (const std::exception &e)
+      {
+        combiner::logger().flush();
+        std::cerr << "Error opening input file " << file << ": " << e.what() << '\n';
+        return 1;
+      }
+    }
+  }
 
+  std::vector<combiner::Slate> slates;
   try
   {
-    combiner::Combiner combiner(std::move(fileSources), std::move(outputFile));
+    slates = combiner::loadSlates(settings.slateFiles);
   }
   catch (const std::exception &e)
   {
+    combiner::logger().flush();
+    std::cerr << "Error reading slate: " << e.what() << '\n';
+    return 1;
+  }
+
+  std::unique_ptr<combiner::PipelineStatistics> statistics;
+  if (settings.statisticsFile)
+    statistics = std::make_unique<combiner::PipelineStatistics>(
+        settings.inputFiles.size(), 1 + settings.additionalOutputFiles.size());
+
+  std::unique_ptr<combiner::NalUnitSink> outputFile;
+  try
+  {
+    outputFile = combiner::openOutputs(settings, statistics.get());
+  }
+  catch (const std::exception &e)
+  {
+    std::cerr << "Error opening output file " << *settings.outputFile << ": " << e.what() << '\n';
+    return 1;
+  }
+
+  std::unique_ptr<combiner::StatisticsFileWriter> statisticsWriter;
+  if (statistics)
+    statisticsWriter = std::make_unique<combiner::StatisticsFileWriter>(
+        *statistics, *settings.statisticsFile, settings.statisticsInterval);
+
+  try
+  {
+    if (settings.tileArrangement)
+    {
+      combiner::TileRearranger rearranger(std::move(fileSources.front()),
+                                          *outputFile,
+                                          *settings.tileArrangement,
+                                          statistics.get());
+    }
+    else if (settings.nrThreads > 1)
+    {
+      combiner::ChunkedCombiner combiner(settings.inputFiles,
+                                         *outputFile,
+                                         settings.nrThreads,
+                                         statistics.get(),
+                                         settings.highestTemporalId);
+    }
+    else
+    {
+      combiner::Combiner combiner(std::move(fileSources),
+                                  *outputFile,
+                                  statistics.get(),
+                                  nullptr,
+                                  settings.skipTileTimeout,
+                                  std::move(slates),
+                                  settings.highestTemporalId);
+    }
+    outputFile->finish();
+  }
+  catch (const std::exception &e)
+  {
+    combiner::logger().flush();
     std::cerr << "Error during combination: " << e.what() << '\n';
   }
 
+  if (settings.traceFile)
+  {
+    try
+    {
+      combiner::tracer().writeJSON(*settings.traceFile);
+    }
+    catch (const std::exception &e)
+    {
+      std::cerr << "Error writing trace: " << e.what() << '\n';
+    }
+  }
+
   return 0;
 }
@@ -0,0 +1,199 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include "ChunkedCombiner.h"
+
+#include "Combiner.h"
+
+#include <File/FileSourceAnnexB.h>
+#include <File/MemorySink.h>
+#include <HEVC/NalIndexHEVC.h>
+#include <HEVC/ReadPlanHEVC.h>
+#include <common/Logger.h>
+#include <common/Tracer.h>
+
+#include <thread>
+
+namespace combiner
+{
+
+namespace
+{
+
+std::shared_ptr<const NalIndex> loadOrCreateIndex(const std::filesystem::path &inputFile)
+{
+  if (auto index = NalIndex::loadIfUpToDate(inputFile))
+  {
+    logger().info("Using NAL index " + NalIndex::getSidecarPath(inputFile).string());
+    return std::make_shared<const NalIndex>(std::move(*index));
+  }
+
+  logger().info("Scanning " + inputFile.string() + " for IRAP pictures");
+  return std::make_shared<const NalIndex>(
+      parser::hevc::createNalIndex(inputFile, parser::hevc::SliceParsingMode::NalUnitHeaderOnly));
+}
+
+} // namespace
+
+ChunkedCombiner::ChunkedCombiner(const std::vector<std::filesystem::path> &inputFiles,
+                                 NalUnitSink                              &output,
+                                 const unsigned                            nrThreads,
+                                 PipelineStatistics                       *statistics,
+                                 std::optional<unsigned>                   highestTemporalId,
+                                 const std::atomic<bool>                  *stopRequested)
+    : output(output), statistics(statistics), highestTemporalId(highestTemporalId),
+      stopRequested(stopRequested)
+{
+  for (const auto &filePath : inputFiles)
+  {
+    Input input;
+    input.filePath          = filePath;
+    input.index             = loadOrCreateIndex(filePath);
+    input.chunkStartEntries = parser::hevc::findIRAPAccessUnits(*input.index);
+    if (input.chunkStartEntries.empty())
+      throw std::runtime_error("No IRAP pictures found in " + filePath.string());
+
+    // Everything before the first IRAP goes into the first chunk
+    input.chunkStartEntries.front() = 0;
+    this->inputs.push_back(std::move(input));
+  }
+
+  this->nrChunks = this->inputs.front().chunkStartEntries.size();
+  for (const auto &input : this->inputs)
+    if (input.chunkStartEntries.size() != this->nrChunks)
+      throw std::runtime_error(
+          "All inputs must have the same number of IRAP pictures to be combined in chunks");
+
+  this->combineChunks(std::max(nrThreads, 1u));
+}
+
+void ChunkedCombiner::combineChunks(const unsigned nrThreads)
+{
+  logger().info("Combining " + std::to_string(this->nrChunks) + " chunks on " +
+                std::to_string(nrThreads) + " threads");
+
+  // Limit how many combined chunks wait in memory to be written
+  this->maxChunksInFlight = 2 * static_cast<size_t>(nrThreads);
+
+  std::vector<std::thread> workerThreads;
+  for (unsigned i = 0; i < nrThreads; ++i)
+    workerThreads.emplace_back(&ChunkedCombiner::runWorkerThread, this);
+
+  const auto stopWorkerThreads = [this, &workerThreads]() {
+    {
+      std::lock_guard<std::mutex> lock(this->mutex);
+      this->abort = true;
+    }
+    this->chunkCondition.notify_all();
+    for (auto &thread : workerThreads)
+      thread.join();
+  };
+
+  try
+  {
+    this->writeChunksInOrder();
+  }
+  catch (...)
+  {
+    stopWorkerThreads();
+    throw;
+  }
+  stopWorkerThreads();
+}
+
+void ChunkedCombiner::runWorkerThread()
+{
+  while (true)
+  {
+    size_t chunkIndex{};
+    {
+      std::unique_lock<std::mutex> lock(this->mutex);
+      this->chunkCondition.wait(lock, [this]() {
+        return this->abort || this->nextChunkToCombine >= this->nrChunks ||
+               this->nextChunkToCombine < this->nextChunkToWrite + this->maxChunksInFlight;
+      });
+      if (this->abort || this->nextChunkToCombine >= this->nrChunks)
+        return;
+      chunkIndex = this->nextChunkToCombine++;
+    }
+
+    ChunkResult result;
+    try
+    {
+      result.nalUnits = this->combineChunk(chunkIndex);
+    }
+    catch (...)
+    {
+      result.error = std::current_exception();
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(this->mutex);
+      this->finishedChunks[chunkIndex] = std::move(result);
+    }
+    this->chunkCondition.notify_all();
+  }
+}
+
+std::vector<ByteVector> ChunkedCombiner::combineChunk(const size_t chunkIndex)
+{
+  ScopedTraceEvent traceEvent("combine chunk");
+
+  std::vector<std::unique_ptr<NalUnitSource>> fileSources;
+  for (const auto &input : this->inputs)
+  {
+    const auto startEntry = input.chunkStartEntries.at(chunkIndex);
+    const auto endEntry   = (chunkIndex + 1 < this->nrChunks)
+                                ? std::optional<size_t>(input.chunkStartEntries.at(chunkIndex + 1))
+                                : std::nullopt;
+
+    auto fileSource = std::make_unique<FileSourceAnnexB>(input.filePath, input.index);
+    fileSource->setReadPlan(parser::hevc::createReadPlanForEntries(
+        input.filePath, *input.index, startEntry, endEntry));
+    fileSources.push_back(std::move(fileSource));
+  }
+
+  MemorySink chunkOutput;
+  Combiner   combiner(std::move(fileSources),
+                    chunkOutput,
+                    this->statistics,
+                    nullptr,
+                    {},
+                    {},
+                    this->highestTemporalId,
+                    this->stopRequested);
+  return std::move(chunkOutput.getNalUnits());
+}
+
+void ChunkedCombiner::writeChunksInOrder()
+{
+  for (size_t chunkIndex = 0; chunkIndex < this->nrChunks; ++chunkIndex)
+  {
+    ChunkResult result;
+    {
+      std::unique_lock<std::mutex> lock(this->mutex);
+      this->chunkCondition.wait(
+          lock, [this, chunkIndex]() { return this->finishedChunks.count(chunkIndex) > 0; });
+      result = std::move(this->finishedChunks.at(chunkIndex));
+      this->finishedChunks.erase(chunkIndex);
+      this->nextChunkToWrite = chunkIndex + 1;
+    }
+    this->chunkCondition.notify_all();
+
+    // The chunk may have ended early
+    if (this->stopRequested != nullptr && *this->stopRequested)
+    {
+      logger().info("Stopped before chunk " + std::to_string(chunkIndex));
+      return;
+    }
+    if (result.error)
+      std::rethrow_exception(result.error);
+    for (const auto &nalUnit : result.nalUnits)
+      this->output.writeNALUnit(nalUnit);
+  }
+}
+
+} // namespace combiner
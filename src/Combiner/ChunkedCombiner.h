@@ -0,0 +1,78 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+
+#include <File/NalIndex.h>
+#include <File/NalUnitSink.h>
+#include <common/PipelineStatistics.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+namespace combiner
+{
+
+/* Splits all inputs at common IRAP pictures into chunks (one chunk per IRAP period). The chunks
+ * are combined independently on multiple threads, each with its own parsers and parameter sets,
+ * and are written to the output in order.
+ * A NAL index of each input is needed to find the chunks. If there is no up to date sidecar
+ * index, the NAL unit headers of the input are scanned once first.
+ * Once a stop is requested, no more chunks are written.
+ */
+class ChunkedCombiner
+{
+public:
+  ChunkedCombiner(const std::vector<std::filesystem::path> &inputFiles,
+                  NalUnitSink                              &output,
+                  const unsigned                            nrThreads,
+                  PipelineStatistics                       *statistics        = nullptr,
+                  std::optional<unsigned>                   highestTemporalId = {},
+                  const std::atomic<bool>                  *stopRequested     = nullptr);
+
+private:
+  struct Input
+  {
+    std::filesystem::path           filePath;
+    std::shared_ptr<const NalIndex> index;
+    std::vector<size_t>             chunkStartEntries;
+  };
+
+  struct ChunkResult
+  {
+    std::vector<ByteVector> nalUnits;
+    std::exception_ptr      error;
+  };
+
+  void                    combineChunks(const unsigned nrThreads);
+  void                    runWorkerThread();
+  std::vector<ByteVector> combineChunk(const size_t chunkIndex);
+  void                    writeChunksInOrder();
+
+  std::vector<Input>      inputs;
+  NalUnitSink            &output;
+  PipelineStatistics     *statistics{};
+  std::optional<unsigned> highestTemporalId{};
+  const std::atomic<bool> *stopRequested{};
+  size_t                  nrChunks{};
+  size_t                  maxChunksInFlight{};
+
+  std::mutex                    mutex;
+  std::condition_variable       chunkCondition;
+  size_t                        nextChunkToCombine{};
+  size_t                        nextChunkToWrite{};
+  bool                          abort{};
+  std::map<size_t, ChunkResult> finishedChunks;
+};
+
+} // namespace combiner
@@ -6,13 +6,17 @@
 
 #include "Combiner.h"
 
+#include <File/ReadAheadSource.h>
+#include <File/StoppableSource.h>
 #include <HEVC/NalUnitHEVC.h>
+#include <HEVC/SkipSlice.h>
+#include <common/Logger.h>
+#include <common/Tracer.h>
 #include <common/SubByteWriter.h>
 
+#include "FrameRateAdaptation.h"
 #include "ParameterSetsModifiers.h"
 
-#include <iostream>
-
 namespace combiner
 {
 
@@ -22,6 +26,8 @@ using NalUnitVector = std::vector<NalUnitHEVC>;
 namespace
 {
 
+constexpr auto PROGRESS_SUMMARY_INTERVAL = std::chrono::seconds(5);
+
 bool anyNalUnitsEmpty(const NalUnitVector &nals)
 {
   return std::any_of(
@@ -33,15 +39,123 @@ uint64_t roundToCTUSize(uint64_t size, uint64_t CtbSizeY)
   return (size + CtbSizeY - 1) / CtbSizeY;
 }
 
+// The first slice of an IRAP picture that can not have RASL pictures which reference earlier ones
+bool isSwitchPoint(const NalUnitHEVC &nal)
+{
+  const auto type = nal.header.nal_unit_type;
+  const auto isIRAPWithoutRASL =
+      (type == NalType::IDR_W_RADL || type == NalType::IDR_N_LP || type == NalType::BLA_W_RADL ||
+       type == NalType::BLA_N_LP);
+  return isIRAPWithoutRASL && (nal.rawData.at(2) & 0x80) != 0;
+}
+
+// All NAL units up to the next switch point are dropped. Empty if the input ends before it.
+std::optional<NalUnitHEVC> readUpToSwitchPoint(ParserAnnexBHEVC &parser)
+{
+  while (true)
+  {
+    auto nal = parser.parseNextNalFromFile();
+    if (nal.rawData.empty())
+      return {};
+    if (isSwitchPoint(nal))
+      return nal;
+  }
+}
+
+std::optional<int> getPOC(const NalUnitHEVC &nal)
+{
+  if (const auto slice = dynamic_cast<slice_segment_layer_rbsp *>(nal.rbsp.get()))
+    return slice->sliceSegmentHeader.PicOrderCntVal;
+  return {};
+}
+
+// The slices of these pictures can not be skipped. They must be intra coded.
+bool isIntraPicture(const NalUnitHEVC &nal)
+{
+  const auto slice = dynamic_cast<slice_segment_layer_rbsp *>(nal.rbsp.get());
+  return nal.header.isIRAP() || slice->sliceSegmentHeader.slice_type == SliceType::I;
+}
+
+// Two inputs are in step if they have the same NAL unit type and (for slices) the same POC
+bool isInStep(const NalUnitHEVC &nal, const NalUnitHEVC &referenceNal)
+{
+  return nal.header.nal_unit_type == referenceNal.header.nal_unit_type &&
+         getPOC(nal) == getPOC(referenceNal);
+}
+
+void checkForCompatibleSwitch(const NalUnitHEVC         &currentNal,
+                              const NalUnitHEVC         &replacementNal,
+                              const ActiveParameterSets &currentParameterSets,
+                              const ActiveParameterSets &replacementParameterSets)
+{
+  const auto currentType     = currentNal.header.nal_unit_type;
+  const auto replacementType = replacementNal.header.nal_unit_type;
+  if (replacementType != currentType)
+    throw std::runtime_error("The replacement has a " + NalTypeMapper.getName(replacementType) +
+                             " instead of a " + NalTypeMapper.getName(currentType) + " slice.");
+
+  // With only the NAL unit header parsed (one input), the slices are passed through unchanged
+  const auto currentSlice     = dynamic_cast<slice_segment_layer_rbsp *>(currentNal.rbsp.get());
+  const auto replacementSlice = dynamic_cast<slice_segment_layer_rbsp *>(replacementNal.rbsp.get());
+  if (currentSlice != nullptr && replacementSlice != nullptr)
+  {
+    const auto currentPOC     = currentSlice->sliceSegmentHeader.PicOrderCntVal;
+    const auto replacementPOC = replacementSlice->sliceSegmentHeader.PicOrderCntVal;
+    if (replacementPOC != currentPOC)
+      throw std::runtime_error("The POC " + std::to_string(replacementPOC) +
+                               " of the replacement does not match the POC " +
+                               std::to_string(currentPOC));
+  }
+
+  checkForCompatibleReplacement(currentParameterSets, replacementParameterSets);
+}
+
+// A switch point of the replacement with the same type but a higher POC can still match a later
+// IRAP picture of the current input.
+bool isAheadOf(const NalUnitHEVC &replacementNal, const NalUnitHEVC &currentNal)
+{
+  const auto replacementPOC = getPOC(replacementNal);
+  const auto currentPOC     = getPOC(currentNal);
+  return replacementNal.header.nal_unit_type == currentNal.header.nal_unit_type &&
+         replacementPOC && currentPOC && *replacementPOC > *currentPOC;
+}
+
 } // namespace
 
 using namespace parser::hevc;
 
-Combiner::Combiner(std::vector<FileSourceAnnexB> &&inputFiles, FileSinkAnnexB &&outputFile)
-    : outputFile(std::move(outputFile))
+Combiner::Combiner(std::vector<std::unique_ptr<NalUnitSource>> &&inputs,
+                   NalUnitSink                                 &output,
+                   PipelineStatistics                          *statistics,
+                   InputSwitcher                               *inputSwitcher,
+                   std::optional<std::chrono::milliseconds>     skipTileTimeout,
+                   std::vector<Slate>                           slates,
+                   std::optional<unsigned>                      highestTemporalId,
+                   const std::atomic<bool>                     *stopRequested)
+    : skipTileTimeout(skipTileTimeout), slates(std::move(slates)),
+      highestTemporalId(highestTemporalId), inputSwitcher(inputSwitcher),
+      stopRequested(stopRequested), output(output), statistics(statistics)
 {
-  for (auto &file : inputFiles)
-    this->parsers.emplace_back(std::move(file));
+  // Slices are only rewritten if the layout or the POCs change. With one input, they are passed
+  // through unless the POCs are divided after removing sub-layers.
+  const auto passThroughSlices = (inputs.size() == 1 && !highestTemporalId);
+  this->sliceParsingMode       = passThroughSlices ? SliceParsingMode::NalUnitHeaderOnly
+                                                   : SliceParsingMode::SliceSegmentHeader;
+  for (auto &input : inputs)
+    this->parsers.emplace_back(this->makeStoppable(std::move(input)), this->sliceParsingMode);
+  this->inputStates.assign(this->parsers.size(), InputState::Starting);
+
+  for (size_t i = 0; i < this->parsers.size(); ++i)
+  {
+    this->parsers.at(i).setTraceInput(i);
+    this->parsers.at(i).setHighestTemporalId(this->highestTemporalId);
+  }
+
+  if (this->statistics != nullptr)
+  {
+    for (size_t i = 0; i < this->parsers.size(); ++i)
+      this->parsers.at(i).setStatistics(&this->statistics->getInput(i));
+  }
 
   this->combineFiles();
 }
@@ -52,33 +166,66 @@ void Combiner::combineFiles()
   {
     NalUnitVector nalPerFile;
 
-    for (auto &parser : this->parsers)
-      nalPerFile.push_back(parser.parseNextNalFromFile());
+    // The inputs are read in lockstep. Once the NAL unit of an input was read, it waits until the
+    // NAL units of all other inputs of the step were read.
+    const auto measureWait = (this->statistics != nullptr || tracer().isEnabled());
+    std::vector<std::chrono::steady_clock::time_point> readEndPerInput;
+    for (size_t i = 0; i < this->parsers.size(); ++i)
+    {
+      {
+        ScopedTimer      timer(getCounter(this->getInputStatistics(i), &InputStatistics::readTime));
+        ScopedTraceEvent traceEvent("read", {i});
+        nalPerFile.push_back(this->readNextNalUnit(i));
+      }
+      if (measureWait)
+        readEndPerInput.push_back(std::chrono::steady_clock::now());
+    }
+    if (measureWait)
+      this->addLockstepWaitTimes(readEndPerInput);
 
-    if (anyNalUnitsEmpty(nalPerFile))
+    const auto referenceIndex = this->findReferenceInput(nalPerFile);
+    if (!referenceIndex)
+    {
+      this->logProgressSummary(true);
       return;
+    }
+
+    if (this->skipTileTimeout)
+      this->detachInputsOutOfStep(nalPerFile, *referenceIndex);
+
+    const auto &referenceNal = nalPerFile.at(*referenceIndex);
+    if (isSwitchPoint(referenceNal))
+    {
+      if (this->inputSwitcher != nullptr)
+        this->switchInputs(nalPerFile, referenceNal);
+      if (this->skipTileTimeout)
+        this->attachStalledInputs(nalPerFile, *referenceIndex);
+    }
+
+    if (this->skipTileTimeout)
+      this->fillInDetachedInputs(nalPerFile, *referenceIndex);
 
-    const auto firstNalType = nalPerFile.at(0).header.nal_unit_type;
+    // The timing of the output follows the reference input
+    const auto timestamps = this->parsers.at(*referenceIndex).getTimestampsOfLastNalUnit();
+    if (timestamps.PTS || timestamps.DTS)
+      this->output.setTimestampsOfNextNALUnits(timestamps);
+
+    const auto firstNalType = referenceNal.header.nal_unit_type;
     for (const auto &nal : nalPerFile)
     {
-      if (nal.header.nal_unit_type != firstNalType)
+      // Without skip tiles, all inputs were read. With them, detached inputs were filled in.
+      if (!nal.rawData.empty() && nal.header.nal_unit_type != firstNalType)
         throw std::runtime_error("Nal type of all files must be identical");
     }
 
-    const auto &firstNal = nalPerFile.at(0);
+    const auto &firstNal = referenceNal;
+    if (firstNalType != NalType::SPS_NUT)
+      this->writeWaitingVPS(nullptr);
+
     if (firstNalType == NalType::VPS_NUT)
     {
-      const auto vps = dynamic_cast<video_parameter_set_rbsp *>(firstNal.rbsp.get());
-
-      parser::SubByteWriter writer;
-      firstNal.header.write(writer);
-      vps->write(writer);
-      const auto data = writer.finishWritingAndGetData();
-      this->outputFile.writeNALUnit(data);
-
-      this->activeWritingParameterSets.vpsMap[vps->vps_video_parameter_set_id] = *vps;
-
-      std::cout << "Pass through VPS from file 0.\n";
+      const auto vps   = dynamic_cast<video_parameter_set_rbsp *>(firstNal.rbsp.get());
+      this->waitingVPS = WaitingVPS{firstNal.header, *vps, *referenceIndex};
     }
     else if (firstNalType == NalType::SPS_NUT)
     {
@@ -88,18 +235,26 @@ void Combiner::combineFiles()
         this->frameSizePerInput[i] = sps->getFrameSize();
       }
 
-      const auto newSPS = generateSPSWithNewFrameSize(nalPerFile);
+      const auto spsPerInput = this->getSPSPerInput(nalPerFile);
+      this->updateDecimationFactors(spsPerInput);
+
+      auto newSPS = generateSPSWithNewFrameSize(nalPerFile);
+      if (!this->decimationFactors.empty())
+        adaptSPSToDecimation(newSPS, spsPerInput, this->decimationFactors);
+      else if (this->highestTemporalId)
+        removeSubLayersAbove(newSPS, *this->highestTemporalId);
+      this->writeWaitingVPS(&newSPS);
 
       parser::SubByteWriter writer;
       firstNal.header.write(writer);
       newSPS.write(writer);
       const auto data = writer.finishWritingAndGetData();
-      this->outputFile.writeNALUnit(data);
+      this->output.writeNALUnit(data);
 
       this->activeWritingParameterSets.spsMap[newSPS.sps_seq_parameter_set_id] = newSPS;
       this->CtbSizeY                                                           = newSPS.CtbSizeY;
 
-      std::cout << "SPS -> New frame size " << newSPS.getFrameSize().toString() << "\n";
+      logger().info("SPS -> New frame size " + newSPS.getFrameSize().toString());
     }
     else if (firstNalType == NalType::PPS_NUT)
     {
@@ -109,25 +264,612 @@ void Combiner::combineFiles()
       firstNal.header.write(writer);
       newPPS.write(writer);
       const auto data = writer.finishWritingAndGetData();
-      this->outputFile.writeNALUnit(data);
+      this->output.writeNALUnit(data);
 
       this->activeWritingParameterSets.ppsMap[newPPS.pps_pic_parameter_set_id] = newPPS;
 
-      std::cout << "PPS -> Enabled tiles\n";
+      logger().info("PPS -> Enabled tiles");
+    }
+    else if (firstNal.header.isSlice() && nalPerFile.size() == 1 &&
+             this->decimationFactors.empty())
+    {
+      this->output.writeNALUnitWithNewHeader(
+          {}, firstNal.rawData, 0, this->getFileRangeOfNalUnit(firstNal, 0));
+      addToCounter(getCounter(this->getInputStatistics(0), &InputStatistics::bytesWritten),
+                   firstNal.rawData.size() + 4);
+
+      const auto firstSliceSegmentInPicFlag = (firstNal.rawData.at(2) & 0x80) != 0;
+      if (firstSliceSegmentInPicFlag)
+        this->countPicture({});
+      if (logger().isEnabled(LogLevel::Debug))
+        logger().debug("Pass through " + NalTypeMapper.getName(firstNalType) + " slice.");
     }
-    else if (nalPerFile.at(0).header.isSlice())
+    else if (firstNal.header.isSlice())
     {
-      checkForMathingSlices(nalPerFile);
+      // The skip slices can have another slice type. All other slices were checked to be in step.
+      if (!this->skipTileTimeout)
+        checkForMathingSlices(nalPerFile);
+      if (!this->decimationFactors.empty())
+        unifyReferencePictureSets(nalPerFile);
       this->writeOutSlices(nalPerFile);
 
-      const auto firstSlice = dynamic_cast<slice_segment_layer_rbsp *>(nalPerFile.at(0).rbsp.get());
-      std::cout << "Combined POC " << firstSlice->sliceSegmentHeader.PicOrderCntVal << "\n";
+      // Only a single input can have more than one slice segment per picture
+      const auto slice = dynamic_cast<slice_segment_layer_rbsp *>(firstNal.rbsp.get());
+      if (slice->sliceSegmentHeader.first_slice_segment_in_pic_flag)
+      {
+        const auto POC = slice->sliceSegmentHeader.PicOrderCntVal;
+        this->countPicture(POC);
+        if (logger().isEnabled(LogLevel::Debug))
+          logger().debug("Combined POC " + std::to_string(POC));
+      }
+    }
+    else
+    {
+      this->output.writeNALUnit(firstNal.rawData);
+      this->countPassThroughNal(firstNal.header);
+      if (logger().isEnabled(LogLevel::Debug))
+        logger().debug("Pass through " + NalTypeMapper.getName(firstNalType) + " NAL.");
+    }
+
+    this->logProgressSummary(false);
+  }
+}
+
+void Combiner::countPicture(const std::optional<int> POC)
+{
+  auto &summary = this->progressSummary;
+  ++summary.nrPictures;
+  if (POC)
+  {
+    if (!summary.firstPOC)
+      summary.firstPOC = POC;
+    summary.lastPOC = POC;
+  }
+}
+
+void Combiner::countPassThroughNal(const nal_unit_header &header)
+{
+  ++this->progressSummary.nrPassThroughNalsPerType.at(header.nalUnitTypeID);
+}
+
+void Combiner::logProgressSummary(const bool force)
+{
+  auto      &summary = this->progressSummary;
+  const auto now     = std::chrono::steady_clock::now();
+  if (!force && now - summary.lastLogTime < PROGRESS_SUMMARY_INTERVAL)
+    return;
+
+  std::string message = "Wrote " + std::to_string(summary.nrPictures) + " pictures";
+  if (summary.firstPOC && summary.lastPOC)
+    message += " (POC " + std::to_string(*summary.firstPOC) + " to " +
+               std::to_string(*summary.lastPOC) + ")";
+  message += ".";
+
+  std::string passThroughCounts;
+  for (size_t nalUnitTypeID = 0; nalUnitTypeID < summary.nrPassThroughNalsPerType.size();
+       ++nalUnitTypeID)
+  {
+    const auto count = summary.nrPassThroughNalsPerType.at(nalUnitTypeID);
+    if (count == 0)
+      continue;
+    if (!passThroughCounts.empty())
+      passThroughCounts += ", ";
+    const auto nalType = NalTypeMapper.at(nalUnitTypeID);
+    passThroughCounts += std::to_string(count) + " " + NalTypeMapper.getName(nalType.value());
+  }
+  if (!passThroughCounts.empty())
+    message += " Passed through " + passThroughCounts + ".";
+
+  logger().info(message);
+  summary = {};
+}
+
+NalUnitHEVC Combiner::readNextNalUnit(const size_t inputIndex)
+{
+  auto &state  = this->inputStates.at(inputIndex);
+  auto &parser = this->parsers.at(inputIndex);
+  if (this->isDetached(inputIndex))
+    return {};
+
+  // Without slates, the start of all inputs is waited for
+  const auto canBeDetached =
+      (state == InputState::Attached || (state == InputState::Starting && !this->slates.empty()));
+  if (this->skipTileTimeout && canBeDetached && !parser.waitForNalUnit(*this->skipTileTimeout))
+  {
+    if (state == InputState::Starting)
+    {
+      logger().warning("Input " + std::to_string(inputIndex) + " did not start. Showing a slate.");
+      state = InputState::Slate;
+    }
+    else
+    {
+      logger().warning("Input " + std::to_string(inputIndex) + " stalled. Inserting skip tiles.");
+      state = InputState::Stalled;
+    }
+    return {};
+  }
+
+  auto nal = parser.parseNextNalFromFile();
+  while (!nal.rawData.empty() && !this->adaptFrameRate(nal, parser, inputIndex))
+    nal = parser.parseNextNalFromFile();
+  if (nal.rawData.empty())
+  {
+    if (this->skipTileTimeout)
+      logger().warning("Input " + std::to_string(inputIndex) + " ended. Inserting skip tiles.");
+    state = InputState::Ended;
+  }
+  else if (state == InputState::Starting && nal.header.isSlice())
+    state = InputState::Attached;
+  return nal;
+}
+
+std::optional<size_t> Combiner::findReferenceInput(NalUnitVector &nalPerFile)
+{
+  if (!this->skipTileTimeout)
+  {
+    if (anyNalUnitsEmpty(nalPerFile))
+      return {};
+    return 0;
+  }
+
+  for (size_t i = 0; i < nalPerFile.size(); ++i)
+    if (!nalPerFile.at(i).rawData.empty())
+      return i;
+
+  // No combined picture can be written without a slice header to derive the skip slices from
+  for (size_t i = 0; i < nalPerFile.size(); ++i)
+  {
+    if (this->inputStates.at(i) != InputState::Stalled)
+      continue;
+
+    logger().info("All inputs are detached. Waiting for input " + std::to_string(i) +
+                  " to resume at an IRAP picture.");
+    auto nal = this->readUpToAdaptedSwitchPoint(this->parsers.at(i), i);
+    if (!nal)
+    {
+      this->inputStates.at(i) = InputState::Ended;
+      continue;
+    }
+
+    this->inputStates.at(i) = InputState::Attached;
+    nalPerFile.at(i)        = std::move(*nal);
+    return i;
+  }
+
+  // Nothing was combined yet (or all other inputs ended)
+  for (size_t i = 0; i < nalPerFile.size(); ++i)
+  {
+    if (this->inputStates.at(i) != InputState::Slate)
+      continue;
+
+    logger().info("No input has started. Waiting for input " + std::to_string(i) + ".");
+    auto &parser = this->parsers.at(i);
+    auto  nal    = parser.parseNextNalFromFile();
+    while (!nal.rawData.empty() && !this->adaptFrameRate(nal, parser, i))
+      nal = parser.parseNextNalFromFile();
+    if (nal.rawData.empty())
+    {
+      this->inputStates.at(i) = InputState::Ended;
+      continue;
+    }
+
+    this->inputStates.at(i) = nal.header.isSlice() ? InputState::Attached : InputState::Starting;
+    nalPerFile.at(i)        = std::move(nal);
+    return i;
+  }
+  return {};
+}
+
+void Combiner::detachInputsOutOfStep(NalUnitVector &nalPerFile, const size_t referenceIndex)
+{
+  const auto &referenceNal = nalPerFile.at(referenceIndex);
+  for (size_t i = 0; i < nalPerFile.size(); ++i)
+  {
+    auto &nal = nalPerFile.at(i);
+    if (nal.rawData.empty() || isInStep(nal, referenceNal))
+      continue;
+
+    logger().warning("Input " + std::to_string(i) + " is out of step with input " +
+                     std::to_string(referenceIndex) + ". Inserting skip tiles.");
+    this->inputStates.at(i) = InputState::Stalled;
+    nal                     = {};
+  }
+}
+
+void Combiner::attachStalledInputs(NalUnitVector &nalPerFile, const size_t referenceIndex)
+{
+  const auto &referenceNal = nalPerFile.at(referenceIndex);
+  for (size_t i = 0; i < nalPerFile.size(); ++i)
+  {
+    auto &state  = this->inputStates.at(i);
+    auto &parser = this->parsers.at(i);
+    if (state != InputState::Stalled && state != InputState::Slate)
+      continue;
+
+    // Only what was received so far is read. Everything up to the next switch point is dropped.
+    while (parser.waitForNalUnit(std::chrono::milliseconds(0)))
+    {
+      auto nal = parser.parseNextNalFromFile();
+      if (nal.rawData.empty())
+      {
+        state = InputState::Ended;
+        break;
+      }
+      if (!isSwitchPoint(nal))
+        continue;
+
+      if (!this->adaptFrameRate(nal, parser, i))
+        continue;
+      if (!isInStep(nal, referenceNal))
+        break;
+
+      // The parameter sets were combined with the ones of the slate
+      if (state == InputState::Slate)
+      {
+        try
+        {
+          checkForCompatibleReplacement(
+              this->parsers.at(referenceIndex).getActiveParameterSets(),
+              parser.getActiveParameterSets());
+        }
+        catch (const std::exception &e)
+        {
+          logger().warning("Input " + std::to_string(i) +
+                           " can not replace its slate at this IRAP picture. " + e.what());
+          break;
+        }
+      }
+
+      logger().info("Input " + std::to_string(i) +
+                    (state == InputState::Slate ? " started." : " resumed."));
+      state            = InputState::Attached;
+      nalPerFile.at(i) = std::move(nal);
+      break;
+    }
+  }
+}
+
+void Combiner::fillInDetachedInputs(NalUnitVector &nalPerFile, const size_t referenceIndex)
+{
+  const auto &referenceNal = nalPerFile.at(referenceIndex);
+  const auto  nalType      = referenceNal.header.nal_unit_type;
+
+  // Only the reference input writes the other non slice NAL units
+  if (nalType != NalType::SPS_NUT && nalType != NalType::PPS_NUT && !referenceNal.header.isSlice())
+    return;
+
+  for (size_t i = 0; i < nalPerFile.size(); ++i)
+  {
+    if (!this->isDetached(i))
+      continue;
+
+    // The parameter sets are needed to combine the parameter sets of all inputs
+    const Slate *slate = nullptr;
+    if (this->inputStates.at(i) == InputState::Slate)
+      slate = &this->getSlate(referenceNal, referenceIndex);
+    const auto &parameterSets = (slate != nullptr) ? slate->getActiveParameterSets()
+                                                   : this->parsers.at(i).getActiveParameterSets();
+    auto       &nal           = nalPerFile.at(i);
+    if (nalType == NalType::SPS_NUT)
+    {
+      const auto sps = dynamic_cast<seq_parameter_set_rbsp *>(referenceNal.rbsp.get());
+      const auto id  = sps->sps_seq_parameter_set_id;
+      if (parameterSets.spsMap.count(id) == 0)
+        throw std::runtime_error("Detached input " + std::to_string(i) + " has no SPS with ID " +
+                                 std::to_string(id));
+      nal.header = referenceNal.header;
+      nal.rbsp   = std::make_unique<seq_parameter_set_rbsp>(parameterSets.spsMap.at(id));
+    }
+    else if (nalType == NalType::PPS_NUT)
+    {
+      const auto pps = dynamic_cast<pic_parameter_set_rbsp *>(referenceNal.rbsp.get());
+      const auto id  = pps->pps_pic_parameter_set_id;
+      if (parameterSets.ppsMap.count(id) == 0)
+        throw std::runtime_error("Detached input " + std::to_string(i) + " has no PPS with ID " +
+                                 std::to_string(id));
+      nal.header = referenceNal.header;
+      nal.rbsp   = std::make_unique<pic_parameter_set_rbsp>(parameterSets.ppsMap.at(id));
+
+      if (slate != nullptr)
+      {
+        try
+        {
+          checkForCompatibleReplacement(
+              this->parsers.at(referenceIndex).getActiveParameterSets(), parameterSets);
+        }
+        catch (const std::exception &e)
+        {
+          throw std::runtime_error("The slate for input " + std::to_string(i) +
+                                   " can not be combined with input " +
+                                   std::to_string(referenceIndex) + ". " + e.what());
+        }
+      }
     }
+    else if (referenceNal.header.isSlice())
+    {
+      // The slate is only sent again where the picture can not be skipped
+      if (slate != nullptr && isIntraPicture(referenceNal))
+      {
+        nal = generateSlateSlice(slate->getSlice(), referenceNal);
+        addToCounter(getCounter(this->getInputStatistics(i), &InputStatistics::nrSlateSlices), 1);
+      }
+      else
+      {
+        nal = generateSkipSlice(referenceNal, parameterSets);
+        addToCounter(getCounter(this->getInputStatistics(i), &InputStatistics::nrSkipSlices), 1);
+      }
+    }
+  }
+}
+
+bool Combiner::isDetached(const size_t inputIndex) const
+{
+  const auto state = this->inputStates.at(inputIndex);
+  return state == InputState::Slate || state == InputState::Stalled || state == InputState::Ended;
+}
+
+std::vector<const seq_parameter_set_rbsp *>
+Combiner::getSPSPerInput(const NalUnitVector &nalPerFile) const
+{
+  std::vector<const seq_parameter_set_rbsp *> spsPerInput;
+  for (size_t i = 0; i < nalPerFile.size(); ++i)
+  {
+    // A slate has no frame rate. Its input is adapted once it has its own SPS.
+    if (this->inputStates.at(i) == InputState::Slate)
+      spsPerInput.push_back(nullptr);
     else
+      spsPerInput.push_back(dynamic_cast<seq_parameter_set_rbsp *>(nalPerFile.at(i).rbsp.get()));
+  }
+  return spsPerInput;
+}
+
+void Combiner::updateDecimationFactors(
+    const std::vector<const seq_parameter_set_rbsp *> &spsPerInput)
+{
+  std::vector<unsigned> newDecimationFactors;
+  try
+  {
+    newDecimationFactors             = getDecimationFactors(spsPerInput, this->highestTemporalId);
+    this->frameRateAdaptationWarning = {};
+  }
+  catch (const std::exception &e)
+  {
+    // The SPS is repeated at every IRAP picture. Only warn once.
+    const std::string warning = e.what();
+    if (warning != this->frameRateAdaptationWarning)
+      logger().warning("The frame rates of the inputs are not adapted. " + warning);
+    this->frameRateAdaptationWarning = warning;
+  }
+
+  if (newDecimationFactors == this->decimationFactors)
+    return;
+  this->decimationFactors = newDecimationFactors;
+
+  for (size_t i = 0; i < spsPerInput.size(); ++i)
+  {
+    const auto factor = this->decimationFactors.empty() ? 1u : this->decimationFactors.at(i);
+    if (factor == 1)
+    {
+      this->parsers.at(i).setHighestTemporalId(this->highestTemporalId);
+      continue;
+    }
+
+    const auto highestTemporalId = getHighestKeptTemporalId(*spsPerInput.at(i), factor);
+    this->parsers.at(i).setHighestTemporalId(highestTemporalId);
+    logger().info("Input " + std::to_string(i) + " has " + std::to_string(factor) +
+                  " times the lowest frame rate. Dropping its temporal sub-layers above " +
+                  std::to_string(highestTemporalId) + ".");
+  }
+}
+
+void Combiner::writeWaitingVPS(const seq_parameter_set_rbsp *nextSPS)
+{
+  if (!this->waitingVPS)
+    return;
+  auto &vps = this->waitingVPS->vps;
+
+  if (!this->decimationFactors.empty())
+  {
+    // A repeated VPS is followed by the SPS that was already written
+    if (nextSPS == nullptr)
     {
-      this->outputFile.writeNALUnit(firstNal.rawData);
-      std::cout << "Pass through " << NalTypeMapper.getName(firstNalType) << " NAL.\n";
+      const auto &spsMap = this->activeWritingParameterSets.spsMap;
+      const auto  sps    = std::find_if(
+          spsMap.begin(),
+          spsMap.end(),
+          [&vps](const auto &entry)
+          { return entry.second.sps_video_parameter_set_id == vps.vps_video_parameter_set_id; });
+      if (sps != spsMap.end())
+        nextSPS = &sps->second;
     }
+    if (nextSPS == nullptr)
+      throw std::logic_error("The frame rates are adapted without a combined SPS");
+    adaptVPSToDecimation(vps, *nextSPS);
+  }
+  else if (this->highestTemporalId)
+    removeSubLayersAbove(vps, *this->highestTemporalId);
+
+  parser::SubByteWriter writer;
+  this->waitingVPS->header.write(writer);
+  vps.write(writer);
+  const auto data = writer.finishWritingAndGetData();
+  this->output.writeNALUnit(data);
+
+  this->activeWritingParameterSets.vpsMap[vps.vps_video_parameter_set_id] = vps;
+
+  logger().info("Pass through VPS from file " + std::to_string(this->waitingVPS->inputIndex) + ".");
+  this->waitingVPS.reset();
+}
+
+bool Combiner::adaptFrameRate(NalUnitHEVC            &nal,
+                              const ParserAnnexBHEVC &parser,
+                              const size_t            inputIndex) const
+{
+  if (this->decimationFactors.empty() || !nal.header.isSlice())
+    return true;
+
+  const auto &parameterSets = parser.getActiveParameterSets();
+  const auto  slice         = dynamic_cast<slice_segment_layer_rbsp *>(nal.rbsp.get());
+  const auto &pps = parameterSets.ppsMap.at(slice->sliceSegmentHeader.slice_pic_parameter_set_id);
+  const auto &sps = parameterSets.spsMap.at(pps.pps_seq_parameter_set_id);
+  return adaptSliceToDecimation(nal, this->decimationFactors.at(inputIndex), sps);
+}
+
+std::optional<NalUnitHEVC> Combiner::readUpToAdaptedSwitchPoint(ParserAnnexBHEVC &parser,
+                                                                 const size_t      inputIndex) const
+{
+  while (true)
+  {
+    auto nal = readUpToSwitchPoint(parser);
+    if (!nal || this->adaptFrameRate(*nal, parser, inputIndex))
+      return nal;
+  }
+}
+
+std::optional<NalUnitHEVC>
+Combiner::readAvailableUpToAdaptedSwitchPoint(ParserAnnexBHEVC &parser,
+                                              const size_t      inputIndex) const
+{
+  while (parser.waitForNalUnit(std::chrono::milliseconds(0)))
+  {
+    auto nal = parser.parseNextNalFromFile();
+    if (nal.rawData.empty())
+      return nal;
+    if (isSwitchPoint(nal) && this->adaptFrameRate(nal, parser, inputIndex))
+      return nal;
+  }
+  return {};
+}
+
+const Slate &Combiner::getSlate(const NalUnitHEVC &referenceNal, const size_t referenceIndex) const
+{
+  // The frame sizes of the inputs are known after their SPS
+  auto tileSize = this->frameSizePerInput.at(referenceIndex);
+  if (referenceNal.header.nal_unit_type == NalType::SPS_NUT)
+    tileSize = dynamic_cast<seq_parameter_set_rbsp *>(referenceNal.rbsp.get())->getFrameSize();
+
+  const auto slate = findSlateWithFrameSize(this->slates, tileSize);
+  if (slate == nullptr)
+    throw std::runtime_error("There is no slate with the tile size " + tileSize.toString());
+  return *slate;
+}
+
+void Combiner::switchInputs(NalUnitVector &nalPerFile, const NalUnitHEVC &referenceNal)
+{
+  for (size_t i = 0; i < this->parsers.size(); ++i)
+  {
+    if (auto source = this->inputSwitcher->takeReplacement(i))
+    {
+      logger().info("Switching input " + std::to_string(i) +
+                    " at the next compatible IRAP picture");
+      // The replacement is read ahead so that waiting for its switch point never stalls the other
+      // inputs
+      ParserAnnexBHEVC parser(
+          this->makeStoppable(std::make_unique<ReadAheadSource>(std::move(source))),
+          this->sliceParsingMode);
+      parser.setHighestTemporalId(this->parsers.at(i).getHighestTemporalId());
+      this->replacements.erase(i);
+      this->replacements.emplace(i, Replacement{std::move(parser)});
+    }
+  }
+
+  auto replacement = this->replacements.begin();
+  while (replacement != this->replacements.end())
+  {
+    const auto inputIndex  = replacement->first;
+    auto      &parser      = replacement->second.parser;
+    auto      &switchPoint = replacement->second.switchPoint;
+
+    auto ended      = false;
+    auto compatible = false;
+    while (!compatible)
+    {
+      if (!switchPoint)
+      {
+        switchPoint = this->readAvailableUpToAdaptedSwitchPoint(parser, inputIndex);
+        if (!switchPoint)
+          break;
+        if (switchPoint->rawData.empty())
+        {
+          ended = true;
+          break;
+        }
+      }
+
+      try
+      {
+        checkForCompatibleSwitch(referenceNal,
+                                 *switchPoint,
+                                 this->parsers.at(inputIndex).getActiveParameterSets(),
+                                 parser.getActiveParameterSets());
+        compatible = true;
+      }
+      catch (const std::exception &e)
+      {
+        logger().warning("Not switching input " + std::to_string(inputIndex) +
+                         " at this IRAP picture. " + e.what());
+        if (isAheadOf(*switchPoint, referenceNal))
+          break;
+        switchPoint.reset();
+      }
+    }
+
+    if (ended)
+    {
+      logger().warning("The replacement for input " + std::to_string(inputIndex) +
+                       " ended before it could be switched to");
+      replacement = this->replacements.erase(replacement);
+      continue;
+    }
+    if (!compatible)
+    {
+      ++replacement;
+      continue;
+    }
+
+    parser.setTraceInput(inputIndex);
+    if (const auto inputStatistics = this->getInputStatistics(inputIndex))
+    {
+      parser.setStatistics(inputStatistics);
+      addToCounter(&inputStatistics->nrSwitches, 1);
+    }
+    this->parsers.at(inputIndex)     = std::move(parser);
+    this->inputStates.at(inputIndex) = InputState::Attached;
+    nalPerFile.at(inputIndex)        = std::move(*switchPoint);
+    replacement                      = this->replacements.erase(replacement);
+
+    logger().info("Switched input " + std::to_string(inputIndex) + " to its replacement");
+  }
+}
+
+std::unique_ptr<NalUnitSource>
+Combiner::makeStoppable(std::unique_ptr<NalUnitSource> &&source) const
+{
+  if (this->stopRequested == nullptr)
+    return std::move(source);
+  return std::make_unique<StoppableSource>(std::move(source), *this->stopRequested);
+}
+
+InputStatistics *Combiner::getInputStatistics(const size_t inputIndex) const
+{
+  if (this->statistics == nullptr)
+    return nullptr;
+  return &this->statistics->getInput(inputIndex);
+}
+
+void Combiner::addLockstepWaitTimes(
+    const std::vector<std::chrono::steady_clock::time_point> &readEndPerInput)
+{
+  const auto stepEnd = readEndPerInput.back();
+  for (size_t i = 0; i < readEndPerInput.size(); ++i)
+  {
+    const auto readEnd = readEndPerInput.at(i);
+    addToCounter(getCounter(this->getInputStatistics(i), &InputStatistics::lockstepWaitTime),
+                 static_cast<uint64_t>(
+                     std::chrono::duration_cast<std::chrono::nanoseconds>(stepEnd - readEnd)
+                         .count()));
+    if (tracer().isEnabled())
+      tracer().addEvent("lockstep wait", readEnd, stepEnd, {i});
   }
 }
 
@@ -138,24 +880,65 @@ void Combiner::writeOutSlices(const NalUnitVector &nalUnits)
 
   for (size_t i = 0; i < nalUnits.size(); ++i)
   {
-    const auto &nal         = nalUnits.at(i);
-    const auto  slice       = dynamic_cast<slice_segment_layer_rbsp *>(nal.rbsp.get());
-    auto        sliceHeader = slice->sliceSegmentHeader;
+    const auto inputStatistics = this->getInputStatistics(i);
 
-    sliceHeader.first_slice_segment_in_pic_flag = (i == 0);
+    const auto &nal   = nalUnits.at(i);
+    const auto  slice = dynamic_cast<slice_segment_layer_rbsp *>(nal.rbsp.get());
+
+    ByteVector header;
+    {
+      ScopedTimer      timer(getCounter(inputStatistics, &InputStatistics::headerRewriteTime));
+      ScopedTraceEvent traceEvent("rewrite", {i});
+      traceEvent.setPOC(slice->sliceSegmentHeader.PicOrderCntVal);
+      header = this->rewriteSliceHeader(nal, i);
+    }
+
+    // The slice data after the header is written unchanged
+    const auto nrBytesInHeader = slice->sliceSegmentHeader.nrBytesInHeader;
+    this->output.writeNALUnitWithNewHeader(
+        header, nal.rawData, nrBytesInHeader, this->getFileRangeOfNalUnit(nal, i));
+    addToCounter(getCounter(inputStatistics, &InputStatistics::bytesWritten),
+                 header.size() + nal.rawData.size() - nrBytesInHeader + 4);
+  }
+}
+
+std::optional<FileRange> Combiner::getFileRangeOfNalUnit(const NalUnitHEVC &nal,
+                                                         const size_t       inputIndex) const
+{
+  // The slices of detached inputs are generated
+  if (this->isDetached(inputIndex))
+    return {};
+
+  const auto &parser   = this->parsers.at(inputIndex);
+  const auto  filePath = parser.getFileOfLastNalUnit();
+  if (filePath == nullptr)
+    return {};
+  return FileRange{filePath, parser.getFileOffsetOfLastNalUnit(), nal.rawData.size()};
+}
+
+ByteVector Combiner::rewriteSliceHeader(const NalUnitHEVC &nal, const size_t inputIndex) const
+{
+  const auto slice       = dynamic_cast<slice_segment_layer_rbsp *>(nal.rbsp.get());
+  auto       sliceHeader = slice->sliceSegmentHeader;
+
+  // A single input keeps the layout. Its slice segments are only rewritten with new POCs.
+  if (this->parsers.size() > 1)
+  {
+    sliceHeader.first_slice_segment_in_pic_flag = (inputIndex == 0);
 
     sliceHeader.slice_segment_address = 0;
-    const auto isOneOfRightInputs     = (i == 1 || i == 3);
+    const auto isOneOfRightInputs     = (inputIndex == 1 || inputIndex == 3);
     if (isOneOfRightInputs)
     {
       const auto leftInputWidthInCTU =
           roundToCTUSize(this->frameSizePerInput[0].width, this->CtbSizeY);
       sliceHeader.slice_segment_address += leftInputWidthInCTU;
     }
-    const auto isOneOfLowerInputs = (i == 2 || i == 3);
+    const auto isOneOfLowerInputs = (inputIndex == 2 || inputIndex == 3);
     if (isOneOfLowerInputs)
     {
-      const auto fullWidth = this->frameSizePerInput[0].width + this->frameSizePerInput[1].width;
+      const auto fullWidth =
+          this->frameSizePerInput[0].width + this->frameSizePerInput[1].width;
       const auto fullWidthInCTU = roundToCTUSize(fullWidth, this->CtbSizeY);
       const auto upperRowHeightInCTU =
           roundToCTUSize(this->frameSizePerInput[0].height, this->CtbSizeY);
@@ -163,18 +946,12 @@ void Combiner::writeOutSlices(const NalUnitVector &nalUnits)
       const auto offsetToThirdInputInCTU = fullWidthInCTU * upperRowHeightInCTU;
       sliceHeader.slice_segment_address += offsetToThirdInputInCTU;
     }
-
-    parser::SubByteWriter writer;
-    nal.header.write(writer);
-    sliceHeader.write(writer, nal.header, this->activeWritingParameterSets);
-    auto data = writer.finishWritingAndGetData();
-
-    data.insert(data.end(),
-                nal.rawData.begin() + slice->sliceSegmentHeader.nrBytesInHeader,
-                nal.rawData.end());
-
-    this->outputFile.writeNALUnit(data);
   }
+
+  parser::SubByteWriter writer;
+  nal.header.write(writer);
+  sliceHeader.write(writer, nal.header, this->activeWritingParameterSets);
+  return writer.finishWritingAndGetData();
 }
 
 } // namespace combiner
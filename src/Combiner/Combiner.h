@@ -6,37 +6,191 @@
 
 #pragma once
 
-#include <File/FileSinkAnnexB.h>
-#include <File/FileSourceAnnexB.h>
+#include <File/NalUnitSink.h>
+#include <File/NalUnitSource.h>
 #include <HEVC/NalUnitHEVC.h>
 #include <HEVC/ParserAnnexBHEVC.h>
 #include <HEVC/commonMaps.h>
+#include <common/PipelineStatistics.h>
 
+#include "InputSwitcher.h"
+#include "Slate.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
 #include <vector>
 
 namespace combiner
 {
 
+/* Combines the inputs in lockstep into one bitstream.
+ * With an input switcher, the source of an input can be replaced while combining. A replacement
+ * is read ahead on its own thread. Whenever the inputs reach an IDR/BLA picture (without RASL
+ * pictures), the replacement is compared at its next such picture if it has read up to it. The
+ * switch happens once the NAL unit type and POC match the other inputs and its parameter sets are
+ * compatible with the combined ones. A switch point of the replacement with the same type but a
+ * higher POC is kept for the next IDR/BLA picture of the inputs. Otherwise the replacement reads on
+ * to its next switch point. Until the switch, the current source of the input is used.
+ * With a skip tile timeout, an input that delivers no NAL unit within the timeout (after its first
+ * slice), that ends or that gets out of step with the other inputs is detached instead of ending
+ * the combination. Its tile is filled with generated slices that repeat its last picture (or show
+ * a gray picture at IRAP pictures) until it is attached again at the next IDR/BLA picture of the
+ * combined stream that it has a matching picture for. The combination ends when all inputs ended.
+ * With slates, an input that delivers nothing within the timeout before its first slice is not
+ * waited for. Its tile shows the slate for the tile size (repeated with skip slices) until its
+ * first IDR/BLA picture that matches the combined stream. If no input has started, the first one
+ * is waited for.
+ * Inputs with a higher frame rate (from the VUI timing) are decimated to the frame rate of the
+ * slowest input by dropping their highest temporal sub-layers (see FrameRateAdaptation.h).
+ * With a highest TemporalId, the sub-layers above it are removed from all inputs (sub-bitstream
+ * extraction) before the frame rates are compared. The POCs are then divided like for a
+ * decimation, even with a single input, so that they keep stepping by one per picture.
+ * With a stop flag, all inputs (and replacements) end once a stop is requested, even while they
+ * are waited for. The combination then ends like at the end of the inputs.
+ */
 class Combiner
 {
 public:
-  Combiner(std::vector<FileSourceAnnexB> &&inputFiles, FileSinkAnnexB &&outputFile);
+  // If statistics are given, the counters and timers of all stages are updated while combining.
+  Combiner(std::vector<std::unique_ptr<NalUnitSource>> &&inputs,
+           NalUnitSink                                 &output,
+           PipelineStatistics                          *statistics        = nullptr,
+           InputSwitcher                               *inputSwitcher     = nullptr,
+           std::optional<std::chrono::milliseconds>     skipTileTimeout   = {},
+           std::vector<Slate>                           slates            = {},
+           std::optional<unsigned>                      highestTemporalId = {},
+           const std::atomic<bool>                     *stopRequested     = nullptr);
 
 private:
+  using NalUnitVector = std::vector<parser::hevc::NalUnitHEVC>;
+
   void combineFiles();
-  void writeOutSlices(const std::vector<parser::hevc::NalUnitHEVC> &nalUnits);
+  void switchInputs(NalUnitVector &nalPerFile, const parser::hevc::NalUnitHEVC &referenceNal);
+
+  // Read the next NAL unit of an attached input. Empty if the input is (or just got) detached.
+  parser::hevc::NalUnitHEVC readNextNalUnit(const size_t inputIndex);
+
+  // The first input that has a NAL unit. All other inputs must follow it. If all inputs are
+  // detached, this waits for the next switch point of the first one that has not ended. Empty
+  // at the end of the combination.
+  std::optional<size_t> findReferenceInput(NalUnitVector &nalPerFile);
+
+  void detachInputsOutOfStep(NalUnitVector &nalPerFile, const size_t referenceIndex);
+  void attachStalledInputs(NalUnitVector &nalPerFile, const size_t referenceIndex);
+  // Generate the parameter sets and slices of the detached inputs from the reference NAL unit
+  void fillInDetachedInputs(NalUnitVector &nalPerFile, const size_t referenceIndex);
+  bool isDetached(const size_t inputIndex) const;
+
+  // The SPS of every input for the frame rate adaptation (nullptr for inputs showing a slate)
+  std::vector<const parser::hevc::seq_parameter_set_rbsp *>
+  getSPSPerInput(const NalUnitVector &nalPerFile) const;
+  void updateDecimationFactors(
+      const std::vector<const parser::hevc::seq_parameter_set_rbsp *> &spsPerInput);
+  // The VPS is written right before the next SPS (or other NAL unit). The sub-layers and the
+  // timing that it keeps depend on the frame rate adaptation, which is only known with the SPS.
+  void writeWaitingVPS(const parser::hevc::seq_parameter_set_rbsp *nextSPS);
+  // Adapt a slice that was just read by the parser of the input to the combined frame rate.
+  // Returns false if the slice must be dropped.
+  bool adaptFrameRate(parser::hevc::NalUnitHEVC            &nal,
+                      const parser::hevc::ParserAnnexBHEVC &parser,
+                      const size_t                          inputIndex) const;
+  // Like readUpToSwitchPoint, but switch points that the frame rate adaptation drops are skipped
+  std::optional<parser::hevc::NalUnitHEVC>
+  readUpToAdaptedSwitchPoint(parser::hevc::ParserAnnexBHEVC &parser, const size_t inputIndex) const;
+  // Like readUpToAdaptedSwitchPoint, but only the NAL units that the source already has ready are
+  // parsed. Empty if there is no switch point yet. At the end of the input, the NAL unit is empty.
+  std::optional<parser::hevc::NalUnitHEVC>
+  readAvailableUpToAdaptedSwitchPoint(parser::hevc::ParserAnnexBHEVC &parser,
+                                      const size_t                    inputIndex) const;
+  // The slate for the tile size of the reference input
+  const Slate &getSlate(const parser::hevc::NalUnitHEVC &referenceNal,
+                        const size_t                     referenceIndex) const;
+
+  void       writeOutSlices(const NalUnitVector &nalUnits);
+  ByteVector rewriteSliceHeader(const parser::hevc::NalUnitHEVC &nal,
+                                const size_t                     inputIndex) const;
+
+  // Where the NAL unit that was read last from the input is in its file (if it is a copy of it)
+  std::optional<FileRange> getFileRangeOfNalUnit(const parser::hevc::NalUnitHEVC &nal,
+                                                 const size_t                     inputIndex) const;
+
+  // Per picture and pass through messages are only logged on the debug level. On the info level,
+  // they are aggregated into a periodic summary.
+  struct ProgressSummary
+  {
+    size_t                                nrPictures{};
+    std::optional<int>                    firstPOC{};
+    std::optional<int>                    lastPOC{};
+    std::array<size_t, 64>                nrPassThroughNalsPerType{};
+    std::chrono::steady_clock::time_point lastLogTime{std::chrono::steady_clock::now()};
+  };
+  void countPicture(const std::optional<int> POC);
+  void countPassThroughNal(const parser::hevc::nal_unit_header &header);
+  void logProgressSummary(const bool force);
+
+  std::unique_ptr<NalUnitSource> makeStoppable(std::unique_ptr<NalUnitSource> &&source) const;
+  InputStatistics               *getInputStatistics(const size_t inputIndex) const;
+  // The time from reading the NAL unit of each input until the last input of the step was read
+  void
+  addLockstepWaitTimes(const std::vector<std::chrono::steady_clock::time_point> &readEndPerInput);
 
   std::map<int, parser::hevc::NalUnitHEVC> vpsPerFile;
   std::map<int, parser::hevc::NalUnitHEVC> spsPerFile;
   std::map<int, parser::hevc::NalUnitHEVC> ppsPerFile;
 
+  enum class InputState
+  {
+    // Waiting for the first slice. Inputs are not detached while they are starting.
+    Starting,
+    // Did not start within the skip tile timeout. Its tile shows the slate.
+    Slate,
+    Attached,
+    Stalled,
+    Ended
+  };
+
   std::vector<parser::hevc::ParserAnnexBHEVC> parsers;
+  std::vector<InputState>                     inputStates;
+  parser::hevc::SliceParsingMode              sliceParsingMode{};
+  std::optional<std::chrono::milliseconds>    skipTileTimeout{};
+  std::vector<Slate>                          slates;
+  std::optional<unsigned>                     highestTemporalId{};
+
+  struct Replacement
+  {
+    parser::hevc::ParserAnnexBHEVC parser;
+    // The switch point that the replacement waits at until it matches the other inputs
+    std::optional<parser::hevc::NalUnitHEVC> switchPoint{};
+  };
+
+  InputSwitcher                *inputSwitcher{};
+  std::map<size_t, Replacement> replacements;
+  const std::atomic<bool>      *stopRequested{};
 
   std::array<FrameSize, 4> frameSizePerInput{};
 
-  FileSinkAnnexB                    outputFile;
+  struct WaitingVPS
+  {
+    parser::hevc::nal_unit_header          header;
+    parser::hevc::video_parameter_set_rbsp vps;
+    size_t                                 inputIndex{};
+  };
+  std::optional<WaitingVPS> waitingVPS;
+
+  // Per input. Empty if the frame rates of the inputs are not adapted.
+  std::vector<unsigned> decimationFactors;
+  std::string           frameRateAdaptationWarning;
+
+  NalUnitSink                      &output;
   parser::hevc::ActiveParameterSets activeWritingParameterSets{};
   uint64_t                          CtbSizeY{};
+  ProgressSummary                   progressSummary{};
+  PipelineStatistics               *statistics{};
 };
 
 } // namespace combiner
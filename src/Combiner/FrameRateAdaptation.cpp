@@ -0,0 +1,364 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include "FrameRateAdaptation.h"
+
+#include <HEVC/slice_segment_layer_rbsp.h>
+
+#include <algorithm>
+#include <map>
+#include <optional>
+#include <stdexcept>
+
+namespace combiner
+{
+
+using namespace parser::hevc;
+
+namespace
+{
+
+bool hasTimingInfo(const seq_parameter_set_rbsp &sps)
+{
+  const auto &vui = sps.vuiParameters;
+  return sps.vui_parameters_present_flag && vui.vui_timing_info_present_flag &&
+         vui.vui_num_units_in_tick > 0 && vui.vui_time_scale > 0;
+}
+
+struct FrameRate
+{
+  uint64_t numerator{};
+  uint64_t denominator{};
+};
+
+// The frame rate is vui_time_scale / vui_num_units_in_tick. Every sub-layer that is removed above
+// the highest TemporalId halves it.
+FrameRate getFrameRate(const seq_parameter_set_rbsp &sps,
+                       const std::optional<unsigned> highestTemporalId = {})
+{
+  const auto maxSubLayersMinus1 = sps.sps_max_sub_layers_minus1;
+  const auto nrRemovedSubLayers =
+      (highestTemporalId && *highestTemporalId < maxSubLayersMinus1)
+          ? maxSubLayersMinus1 - *highestTemporalId
+          : 0;
+  return {sps.vuiParameters.vui_time_scale,
+          sps.vuiParameters.vui_num_units_in_tick << nrRemovedSubLayers};
+}
+
+bool isLower(const FrameRate &frameRate, const FrameRate &otherFrameRate)
+{
+  return frameRate.numerator * otherFrameRate.denominator <
+         otherFrameRate.numerator * frameRate.denominator;
+}
+
+unsigned log2OfPowerOfTwo(unsigned value)
+{
+  unsigned log2 = 0;
+  while (value > 1)
+  {
+    value >>= 1;
+    ++log2;
+  }
+  return log2;
+}
+
+// IDR slices have no reference picture set
+bool isIDR(const NalUnitHEVC &nal)
+{
+  const auto type = nal.header.nal_unit_type;
+  return type == NalType::IDR_W_RADL || type == NalType::IDR_N_LP;
+}
+
+slice_segment_header &getSliceHeader(NalUnitHEVC &nal)
+{
+  const auto slice = dynamic_cast<slice_segment_layer_rbsp *>(nal.rbsp.get());
+  if (slice == nullptr)
+    throw std::logic_error("The NAL unit has no parsed slice header");
+  return slice->sliceSegmentHeader;
+}
+
+// The POC deltas of the short term reference pictures with the flag if they are used by the
+// current picture
+using ReferencePictures = std::map<int, bool>;
+
+ReferencePictures getReferencePictures(const st_ref_pic_set &rps)
+{
+  ReferencePictures referencePictures;
+  for (size_t i = 0; i < rps.deltaPocS0.size(); ++i)
+    referencePictures[rps.deltaPocS0.at(i)] = rps.usedByCurrPicS0.at(i);
+  for (size_t i = 0; i < rps.deltaPocS1.size(); ++i)
+    referencePictures[rps.deltaPocS1.at(i)] = rps.usedByCurrPicS1.at(i);
+  return referencePictures;
+}
+
+st_ref_pic_set toReferencePictureSet(const ReferencePictures &referencePictures)
+{
+  std::vector<int>  deltaPocS0;
+  std::vector<bool> usedByCurrPicS0;
+  std::vector<int>  deltaPocS1;
+  std::vector<bool> usedByCurrPicS1;
+
+  // The negative deltas are ordered from the closest picture on
+  for (auto it = referencePictures.rbegin(); it != referencePictures.rend(); ++it)
+  {
+    if (it->first < 0)
+    {
+      deltaPocS0.push_back(it->first);
+      usedByCurrPicS0.push_back(it->second);
+    }
+  }
+  for (const auto &[deltaPoc, used] : referencePictures)
+  {
+    if (deltaPoc > 0)
+    {
+      deltaPocS1.push_back(deltaPoc);
+      usedByCurrPicS1.push_back(used);
+    }
+  }
+  return st_ref_pic_set::fromDeltaPocs(deltaPocS0, usedByCurrPicS0, deltaPocS1, usedByCurrPicS1);
+}
+
+ReferencePictures getUsedReferencePictures(const ReferencePictures &referencePictures)
+{
+  ReferencePictures usedReferencePictures;
+  for (const auto &[deltaPoc, used] : referencePictures)
+    if (used)
+      usedReferencePictures[deltaPoc] = true;
+  return usedReferencePictures;
+}
+
+uint64_t getValueOfSubLayer(const std::vector<uint64_t> &values,
+                            const bool                   subLayerOrderingInfoPresent,
+                            const unsigned               temporalId)
+{
+  // Without the ordering info, only the values of the highest sub-layer are present
+  return subLayerOrderingInfoPresent ? values.at(temporalId) : values.at(0);
+}
+
+} // namespace
+
+std::vector<unsigned>
+getDecimationFactors(const std::vector<const seq_parameter_set_rbsp *> &spsPerInput,
+                     const std::optional<unsigned>                      highestTemporalId)
+{
+  std::optional<FrameRate> lowestFrameRate;
+  for (const auto sps : spsPerInput)
+  {
+    if (sps == nullptr)
+      continue;
+    if (!hasTimingInfo(*sps))
+      return {};
+    const auto frameRate = getFrameRate(*sps, highestTemporalId);
+    if (!lowestFrameRate || isLower(frameRate, *lowestFrameRate))
+      lowestFrameRate = frameRate;
+  }
+  if (!lowestFrameRate)
+    return {};
+
+  std::vector<unsigned> decimationFactors;
+  for (size_t i = 0; i < spsPerInput.size(); ++i)
+  {
+    const auto sps = spsPerInput.at(i);
+    if (sps == nullptr)
+    {
+      decimationFactors.push_back(1);
+      continue;
+    }
+
+    // Relative to the full frame rate of the input. This also scales the POCs of the inputs
+    // that only lose the sub-layers above the highest TemporalId.
+    const auto frameRate   = getFrameRate(*sps);
+    const auto numerator   = frameRate.numerator * lowestFrameRate->denominator;
+    const auto denominator = frameRate.denominator * lowestFrameRate->numerator;
+    const auto factor      = numerator / denominator;
+    if (numerator % denominator != 0 || (factor & (factor - 1)) != 0)
+      throw std::runtime_error("The frame rate of input " + std::to_string(i) +
+                               " is not a power of two multiple of the lowest frame rate.");
+    if (log2OfPowerOfTwo(static_cast<unsigned>(factor)) > sps->sps_max_sub_layers_minus1)
+      throw std::runtime_error("Input " + std::to_string(i) +
+                               " does not have enough temporal sub-layers to drop to decimate it "
+                               "by a factor of " +
+                               std::to_string(factor) + ".");
+    decimationFactors.push_back(static_cast<unsigned>(factor));
+  }
+
+  // The POCs are also divided if all inputs lose the same number of sub-layers. Otherwise the POCs
+  // of the combined stream would step by the factor while its timing gives one picture per tick.
+  const auto noAdaptation =
+      std::all_of(decimationFactors.begin(),
+                  decimationFactors.end(),
+                  [](const unsigned factor) { return factor == 1; });
+  if (noAdaptation)
+    return {};
+  return decimationFactors;
+}
+
+unsigned getHighestKeptTemporalId(const seq_parameter_set_rbsp &sps,
+                                  const unsigned                decimationFactor)
+{
+  return static_cast<unsigned>(sps.sps_max_sub_layers_minus1) -
+         log2OfPowerOfTwo(decimationFactor);
+}
+
+bool adaptSliceToDecimation(NalUnitHEVC                  &nal,
+                            const unsigned                decimationFactor,
+                            const seq_parameter_set_rbsp &sps)
+{
+  auto      &header = getSliceHeader(nal);
+  const auto factor = static_cast<int>(decimationFactor);
+
+  if (header.PicOrderCntVal % factor != 0)
+    return false;
+  if (factor > 1 && header.num_long_term_sps + header.num_long_term_pics > 0)
+    throw std::runtime_error("Pictures with long term reference pictures can not be decimated.");
+
+  const auto MaxPicOrderCntLsb   = 1 << (sps.log2_max_pic_order_cnt_lsb_minus4 + 4);
+  header.PicOrderCntVal          = header.PicOrderCntVal / factor;
+  const auto picOrderCntLsb      = header.PicOrderCntVal & (MaxPicOrderCntLsb - 1);
+  header.slice_pic_order_cnt_lsb = static_cast<uint64_t>(picOrderCntLsb);
+  header.PicOrderCntMsb          = header.PicOrderCntVal - picOrderCntLsb;
+
+  if (!isIDR(nal))
+  {
+    // Reference pictures in the dropped sub-layers can only be kept for later pictures in these
+    ReferencePictures referencePictures;
+    for (const auto &[deltaPoc, used] : getReferencePictures(header.stRefPicSet))
+    {
+      if (deltaPoc % factor == 0)
+        referencePictures[deltaPoc / factor] = used;
+      else if (used)
+        throw std::runtime_error("The picture with POC " +
+                                 std::to_string(header.PicOrderCntVal * factor) +
+                                 " references a picture in a dropped sub-layer.");
+    }
+    header.short_term_ref_pic_set_sps_flag = false;
+    header.short_term_ref_pic_set_idx      = 0;
+    header.stRefPicSet                     = toReferencePictureSet(referencePictures);
+  }
+
+  // TSA and STSA pictures are not allowed in the lowest sub-layer. They become trailing pictures
+  // (with the same sub-layer reference property).
+  const auto type = nal.header.nal_unit_type;
+  if (type == NalType::TSA_N || type == NalType::STSA_N)
+  {
+    nal.header.nal_unit_type = NalType::TRAIL_N;
+    nal.header.nalUnitTypeID = 0;
+  }
+  else if (type == NalType::TSA_R || type == NalType::STSA_R)
+  {
+    nal.header.nal_unit_type = NalType::TRAIL_R;
+    nal.header.nalUnitTypeID = 1;
+  }
+  nal.header.nuh_temporal_id_plus1 = 1;
+  return true;
+}
+
+void unifyReferencePictureSets(NalUnitVector &slices)
+{
+  if (slices.empty() || isIDR(slices.front()))
+    return;
+
+  const auto &referenceHeader         = getSliceHeader(slices.front());
+  const auto  referencePictures       = getReferencePictures(referenceHeader.stRefPicSet);
+  const auto  usedReferencePictures   = getUsedReferencePictures(referencePictures);
+  auto        mergedReferencePictures = referencePictures;
+  for (size_t i = 1; i < slices.size(); ++i)
+  {
+    const auto &header   = getSliceHeader(slices.at(i));
+    const auto  pictures = getReferencePictures(header.stRefPicSet);
+    if (getUsedReferencePictures(pictures) != usedReferencePictures)
+      throw std::runtime_error("The picture with POC " +
+                               std::to_string(referenceHeader.PicOrderCntVal) + " of input " +
+                               std::to_string(i) +
+                               " references other pictures than the one of the first input.");
+    mergedReferencePictures.insert(pictures.begin(), pictures.end());
+  }
+
+  const auto rps = toReferencePictureSet(mergedReferencePictures);
+  for (auto &slice : slices)
+  {
+    auto &header                           = getSliceHeader(slice);
+    header.short_term_ref_pic_set_sps_flag = false;
+    header.short_term_ref_pic_set_idx      = 0;
+    header.stRefPicSet                     = rps;
+  }
+}
+
+void adaptSPSToDecimation(seq_parameter_set_rbsp                            &sps,
+                          const std::vector<const seq_parameter_set_rbsp *> &spsPerInput,
+                          const std::vector<unsigned>                       &decimationFactors)
+{
+  uint64_t                      maxDecPicBufferingMinus1 = 0;
+  uint64_t                      maxNumReorderPics        = 0;
+  uint64_t                      maxLatencyIncreasePlus1  = 0;
+  std::optional<size_t>         timingInput;
+  for (size_t i = 0; i < spsPerInput.size(); ++i)
+  {
+    const auto inputSPS = spsPerInput.at(i);
+    if (inputSPS == nullptr)
+      continue;
+
+    const auto factor     = decimationFactors.at(i);
+    const auto temporalId = getHighestKeptTemporalId(*inputSPS, factor);
+    const auto present    = inputSPS->sps_sub_layer_ordering_info_present_flag;
+    maxDecPicBufferingMinus1 = std::max(
+        maxDecPicBufferingMinus1,
+        getValueOfSubLayer(inputSPS->sps_max_dec_pic_buffering_minus1, present, temporalId));
+    maxNumReorderPics = std::max(
+        maxNumReorderPics,
+        getValueOfSubLayer(inputSPS->sps_max_num_reorder_pics, present, temporalId));
+    maxLatencyIncreasePlus1 = std::max(
+        maxLatencyIncreasePlus1,
+        getValueOfSubLayer(inputSPS->sps_max_latency_increase_plus1, present, temporalId));
+    if (!timingInput)
+      timingInput = i;
+  }
+
+  sps.sps_max_sub_layers_minus1                = 0;
+  sps.sps_temporal_id_nesting_flag             = true;
+  sps.sps_sub_layer_ordering_info_present_flag = false;
+  sps.sps_max_dec_pic_buffering_minus1         = {maxDecPicBufferingMinus1};
+  sps.sps_max_num_reorder_pics                 = {maxNumReorderPics};
+  sps.sps_max_latency_increase_plus1           = {maxLatencyIncreasePlus1};
+
+  // The HRD parameters are per sub-layer and do not describe the combined stream
+  auto &vui                           = sps.vuiParameters;
+  vui.vui_hrd_parameters_present_flag = false;
+
+  // The decimated clock tick of any input is the clock tick of the combined stream. A POC
+  // difference of one (after dividing the POCs) still takes the same number of ticks.
+  if (timingInput)
+  {
+    const auto &inputVUI                    = spsPerInput.at(*timingInput)->vuiParameters;
+    const auto  factor                      = decimationFactors.at(*timingInput);
+    vui.vui_timing_info_present_flag        = inputVUI.vui_timing_info_present_flag;
+    vui.vui_num_units_in_tick               = inputVUI.vui_num_units_in_tick * factor;
+    vui.vui_time_scale                      = inputVUI.vui_time_scale;
+    vui.vui_poc_proportional_to_timing_flag = inputVUI.vui_poc_proportional_to_timing_flag;
+    vui.vui_num_ticks_poc_diff_one_minus1   = inputVUI.vui_num_ticks_poc_diff_one_minus1;
+  }
+}
+
+void adaptVPSToDecimation(video_parameter_set_rbsp &vps, const seq_parameter_set_rbsp &combinedSPS)
+{
+  vps.vps_max_sub_layers_minus1                = 0;
+  vps.vps_temporal_id_nesting_flag             = true;
+  vps.vps_sub_layer_ordering_info_present_flag = false;
+  vps.vps_max_dec_pic_buffering_minus1[0]      = combinedSPS.sps_max_dec_pic_buffering_minus1.at(0);
+  vps.vps_max_num_reorder_pics[0]              = combinedSPS.sps_max_num_reorder_pics.at(0);
+  vps.vps_max_latency_increase_plus1[0]        = combinedSPS.sps_max_latency_increase_plus1.at(0);
+
+  const auto &vui = combinedSPS.vuiParameters;
+  vps.vps_timing_info_present_flag =
+      combinedSPS.vui_parameters_present_flag && vui.vui_timing_info_present_flag;
+  vps.vps_num_units_in_tick               = vui.vui_num_units_in_tick;
+  vps.vps_time_scale                      = vui.vui_time_scale;
+  vps.vps_poc_proportional_to_timing_flag = vui.vui_poc_proportional_to_timing_flag;
+  vps.vps_num_ticks_poc_diff_one_minus1   = vui.vui_num_ticks_poc_diff_one_minus1;
+  vps.vps_num_hrd_parameters              = 0;
+}
+
+} // namespace combiner
@@ -0,0 +1,72 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+
+#include <HEVC/NalUnitHEVC.h>
+#include <HEVC/seq_parameter_set_rbsp.h>
+#include <HEVC/video_parameter_set_rbsp.h>
+
+#include <optional>
+#include <vector>
+
+namespace combiner
+{
+
+/* Inputs with a higher frame rate than the slowest input are decimated to its frame rate. If the
+ * frame rate of an input is 2^n times the slowest one, its n highest temporal sub-layers are
+ * dropped. This assumes a dyadic temporal structure in which every sub-layer doubles the frame
+ * rate. The POCs of the remaining pictures are divided by the decimation factor so that they
+ * match the POCs of the other inputs.
+ * In the combined stream, all pictures are in the lowest sub-layer because the pictures of the
+ * inputs can be in different sub-layers. The decimation therefore only works for pictures that
+ * are coded with short term reference pictures.
+ */
+
+using NalUnitVector = std::vector<parser::hevc::NalUnitHEVC>;
+
+// The factor by which the frame rate of each input is higher than the frame rate of the slowest
+// input. The frame rates are taken from the VUI timing info. If the sub-layers above a highest
+// TemporalId are removed from all inputs, the slowest input is the one with the lowest frame rate
+// after the removal. Inputs without an SPS (nullptr) get a factor of 1. Empty if all factors are 1
+// (no adaptation needed) or if an input has no timing info.
+// Throws if the frame rates differ in a way that can not be adapted by dropping sub-layers.
+std::vector<unsigned>
+getDecimationFactors(const std::vector<const parser::hevc::seq_parameter_set_rbsp *> &spsPerInput,
+                     const std::optional<unsigned> highestTemporalId = {});
+
+// The highest TemporalId that is kept when decimating the input by the factor
+unsigned getHighestKeptTemporalId(const parser::hevc::seq_parameter_set_rbsp &sps,
+                                  const unsigned                              decimationFactor);
+
+// Divide the POC of the slice (and the POCs of its reference pictures) by the decimation factor
+// and move it to the lowest sub-layer. The reference picture set is written explicitly in the
+// slice header, since the sets in the SPS do not have the new POC distances.
+// Returns false if the POC is not a multiple of the factor. The picture must then be dropped. This
+// happens in the kept sub-layers if the number of pictures in a GOP is not a multiple of the
+// factor (e.g. a closing P picture before the next IRAP picture).
+bool adaptSliceToDecimation(parser::hevc::NalUnitHEVC                  &nal,
+                            const unsigned                              decimationFactor,
+                            const parser::hevc::seq_parameter_set_rbsp &sps);
+
+// The slices of one combined picture must have the same reference picture set. The pictures that
+// are used by the current picture must be identical. The pictures that are only kept for later
+// pictures can differ between the inputs and are merged.
+void unifyReferencePictureSets(NalUnitVector &slices);
+
+// Move the combined SPS to the lowest sub-layer with the decimated timing of the inputs. The DPB
+// sizes are the maximum of the kept sub-layers of all inputs.
+void adaptSPSToDecimation(
+    parser::hevc::seq_parameter_set_rbsp                            &sps,
+    const std::vector<const parser::hevc::seq_parameter_set_rbsp *> &spsPerInput,
+    const std::vector<unsigned>                                     &decimationFactors);
+
+// Move the VPS to the lowest sub-layer with the DPB sizes and the timing of the combined SPS. The
+// HRD parameters are removed.
+void adaptVPSToDecimation(parser::hevc::video_parameter_set_rbsp     &vps,
+                          const parser::hevc::seq_parameter_set_rbsp &combinedSPS);
+
+} // namespace combiner
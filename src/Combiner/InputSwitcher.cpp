@@ -0,0 +1,29 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include "InputSwitcher.h"
+
+namespace combiner
+{
+
+void InputSwitcher::replaceInput(const size_t inputIndex, std::unique_ptr<NalUnitSource> &&source)
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->replacements[inputIndex] = std::move(source);
+}
+
+std::unique_ptr<NalUnitSource> InputSwitcher::takeReplacement(const size_t inputIndex)
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+  auto                        replacement = this->replacements.find(inputIndex);
+  if (replacement == this->replacements.end())
+    return {};
+  auto source = std::move(replacement->second);
+  this->replacements.erase(replacement);
+  return source;
+}
+
+} // namespace combiner
@@ -0,0 +1,36 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+
+#include <File/NalUnitSource.h>
+
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace combiner
+{
+
+/* Replacement sources for the inputs of a running Combiner. Replacements can be requested from
+ * any thread. The Combiner takes them over at its next IRAP picture and switches to them as soon
+ * as they are compatible (see Combiner).
+ */
+class InputSwitcher
+{
+public:
+  // A replacement that was not taken over by the Combiner yet is discarded
+  void replaceInput(const size_t inputIndex, std::unique_ptr<NalUnitSource> &&source);
+
+  // Remove the replacement for the input (if there is one) and return it
+  std::unique_ptr<NalUnitSource> takeReplacement(const size_t inputIndex);
+
+private:
+  std::mutex                                       mutex;
+  std::map<size_t, std::unique_ptr<NalUnitSource>> replacements;
+};
+
+} // namespace combiner
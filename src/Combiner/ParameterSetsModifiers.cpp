@@ -6,11 +6,69 @@
 
 #include "ParameterSetsModifiers.h"
 
+#include <common/SubByteWriter.h>
+
+#include <algorithm>
+
 namespace combiner
 {
 
 using namespace parser::hevc;
 
+void checkIdenticalCtbSizeY(const seq_parameter_set_rbsp &sps,
+                            const seq_parameter_set_rbsp &firstSPS)
+{
+  if (sps.CtbSizeY != firstSPS.CtbSizeY)
+    throw std::runtime_error("The CtbSizeY (max CTU size) must be identical for all inputs");
+}
+
+void checkTilesNotEnabled(const pic_parameter_set_rbsp &pps)
+{
+  if (pps.tiles_enabled_flag)
+    throw std::runtime_error("Tiles already enabled in PPS. This is not allowed.");
+}
+
+// The sub-layer level of the highest remaining sub-layer (if it is signaled) becomes the level
+void useLevelOfSubLayer(profile_tier_level &profileTierLevel, const unsigned temporalId)
+{
+  if (profileTierLevel.sub_layer_level_present_flag.at(temporalId))
+    profileTierLevel.general_level_idc = profileTierLevel.sub_layer_level_idc.at(temporalId);
+}
+
+// Without the removed sub-layers, the timing info would still give the full frame rate. The clock
+// tick is scaled by the number of removed pictures so that it gives the remaining frame rate.
+void scaleClockTick(uint64_t      &numUnitsInTick,
+                    bool          &pocProportionalToTimingFlag,
+                    uint64_t      &numTicksPocDiffOneMinus1,
+                    const unsigned nrRemovedSubLayers)
+{
+  const auto factor = uint64_t(1) << nrRemovedSubLayers;
+  numUnitsInTick *= factor;
+
+  // A POC difference of one still takes the same time, which is fewer of the longer ticks
+  const auto numTicksPocDiffOne = numTicksPocDiffOneMinus1 + 1;
+  if (numTicksPocDiffOne % factor == 0)
+    numTicksPocDiffOneMinus1 = numTicksPocDiffOne / factor - 1;
+  else
+    pocProportionalToTimingFlag = false;
+}
+
+// The sizes of all but the last tile column/row in CTBs
+vector<uint64_t> getTileSizesMinus1(const std::vector<uint64_t> &boundaries)
+{
+  vector<uint64_t> sizesMinus1;
+  for (size_t i = 0; i + 2 < boundaries.size(); ++i)
+    sizesMinus1.push_back(boundaries.at(i + 1) - boundaries.at(i) - 1);
+  return sizesMinus1;
+}
+
+template <typename ParameterSet> ByteVector writeParameterSet(const ParameterSet &parameterSet)
+{
+  parser::SubByteWriter writer;
+  parameterSet.write(writer);
+  return writer.finishWritingAndGetData();
+}
+
 template <size_t N>
 std::array<seq_parameter_set_rbsp *, N> getParameterSetArrayFromNals(const NalUnitVector &nalUnits)
 {
@@ -82,11 +140,7 @@ seq_parameter_set_rbsp generateSPSWithNewFrameSize(const NalUnitVector &nalUnits
 {
   const auto firstSPS = dynamic_cast<seq_parameter_set_rbsp *>(nalUnits.at(0).rbsp.get());
   for (const auto &nal : nalUnits)
-  {
-    const auto sps = dynamic_cast<seq_parameter_set_rbsp *>(nal.rbsp.get());
-    if (sps->CtbSizeY != firstSPS->CtbSizeY)
-      throw std::runtime_error("The CtbSizeY (max CTU size) must be identical for all inputs");
-  }
+    checkIdenticalCtbSizeY(*dynamic_cast<seq_parameter_set_rbsp *>(nal.rbsp.get()), *firstSPS);
 
   if (nalUnits.size() == 1)
     return *firstSPS;
@@ -107,11 +161,7 @@ pic_parameter_set_rbsp generatePPSWithUniformTiles(const NalUnitVector &nalUnits
   const auto firstPPS = dynamic_cast<pic_parameter_set_rbsp *>(nalUnits.at(0).rbsp.get());
 
   for (const auto &nal : nalUnits)
-  {
-    const auto pps = dynamic_cast<pic_parameter_set_rbsp *>(nal.rbsp.get());
-    if (pps->tiles_enabled_flag)
-      throw std::runtime_error("Tiles already enabled in PPS. This is not allowed.");
-  }
+    checkTilesNotEnabled(*dynamic_cast<pic_parameter_set_rbsp *>(nal.rbsp.get()));
 
   if (nalUnits.size() == 1)
     return *firstPPS;
@@ -146,4 +196,182 @@ void checkForMathingSlices(const NalUnitVector &nalUnits)
   }
 }
 
-} // namespace combiner
\ No newline at end of file
+void checkForCompatibleReplacement(const ActiveParameterSets &currentParameterSets,
+                                   const ActiveParameterSets &newParameterSets)
+{
+  for (const auto &[id, newSPS] : newParameterSets.spsMap)
+  {
+    const auto currentSPS = currentParameterSets.spsMap.find(id);
+    if (currentSPS == currentParameterSets.spsMap.end())
+      throw std::runtime_error("There is no SPS with ID " + std::to_string(id) + " to replace.");
+
+    checkIdenticalCtbSizeY(newSPS, currentSPS->second);
+    if (newSPS.getFrameSize() != currentSPS->second.getFrameSize())
+      throw std::runtime_error("The frame size " + newSPS.getFrameSize().toString() +
+                               " of the replacement does not match the frame size " +
+                               currentSPS->second.getFrameSize().toString());
+
+    // The slice headers are written with the combined SPS, so everything but the VUI must match
+    auto spsWithCurrentVUI                        = newSPS;
+    spsWithCurrentVUI.vui_parameters_present_flag = currentSPS->second.vui_parameters_present_flag;
+    spsWithCurrentVUI.vuiParameters               = currentSPS->second.vuiParameters;
+    if (writeParameterSet(spsWithCurrentVUI) != writeParameterSet(currentSPS->second))
+      throw std::runtime_error("The SPS with ID " + std::to_string(id) +
+                               " of the replacement has a different coding structure.");
+  }
+
+  for (const auto &[id, newPPS] : newParameterSets.ppsMap)
+  {
+    const auto currentPPS = currentParameterSets.ppsMap.find(id);
+    if (currentPPS == currentParameterSets.ppsMap.end())
+      throw std::runtime_error("There is no PPS with ID " + std::to_string(id) + " to replace.");
+
+    checkTilesNotEnabled(newPPS);
+    if (writeParameterSet(newPPS) != writeParameterSet(currentPPS->second))
+      throw std::runtime_error("The PPS with ID " + std::to_string(id) +
+                               " of the replacement has a different coding structure.");
+  }
+}
+
+void removeSubLayersAbove(seq_parameter_set_rbsp &sps, const unsigned highestTemporalId)
+{
+  if (sps.sps_max_sub_layers_minus1 <= highestTemporalId)
+    return;
+
+  auto &vui = sps.vuiParameters;
+  if (sps.vui_parameters_present_flag && vui.vui_timing_info_present_flag)
+  {
+    scaleClockTick(vui.vui_num_units_in_tick,
+                   vui.vui_poc_proportional_to_timing_flag,
+                   vui.vui_num_ticks_poc_diff_one_minus1,
+                   sps.sps_max_sub_layers_minus1 - highestTemporalId);
+    // The HRD parameters are in units of the old clock tick
+    vui.vui_hrd_parameters_present_flag = false;
+  }
+
+  useLevelOfSubLayer(sps.profileTierLevel, highestTemporalId);
+  sps.sps_max_sub_layers_minus1 = highestTemporalId;
+  if (highestTemporalId == 0)
+    sps.sps_temporal_id_nesting_flag = true;
+
+  // Without the ordering info, the values of the highest sub-layer apply to all sub-layers
+  if (sps.sps_sub_layer_ordering_info_present_flag)
+  {
+    sps.sps_max_dec_pic_buffering_minus1.resize(highestTemporalId + 1);
+    sps.sps_max_num_reorder_pics.resize(highestTemporalId + 1);
+    sps.sps_max_latency_increase_plus1.resize(highestTemporalId + 1);
+  }
+}
+
+void removeSubLayersAbove(video_parameter_set_rbsp &vps, const unsigned highestTemporalId)
+{
+  if (vps.vps_max_sub_layers_minus1 <= highestTemporalId)
+    return;
+
+  // Without the ordering info, only the values at the index of the highest sub-layer are coded
+  if (!vps.vps_sub_layer_ordering_info_present_flag)
+  {
+    const auto highestSubLayer = vps.vps_max_sub_layers_minus1;
+    vps.vps_max_dec_pic_buffering_minus1[highestTemporalId] =
+        vps.vps_max_dec_pic_buffering_minus1[highestSubLayer];
+    vps.vps_max_num_reorder_pics[highestTemporalId] = vps.vps_max_num_reorder_pics[highestSubLayer];
+    vps.vps_max_latency_increase_plus1[highestTemporalId] =
+        vps.vps_max_latency_increase_plus1[highestSubLayer];
+  }
+
+  if (vps.vps_timing_info_present_flag)
+  {
+    scaleClockTick(vps.vps_num_units_in_tick,
+                   vps.vps_poc_proportional_to_timing_flag,
+                   vps.vps_num_ticks_poc_diff_one_minus1,
+                   vps.vps_max_sub_layers_minus1 - highestTemporalId);
+    vps.vps_num_hrd_parameters = 0;
+  }
+
+  useLevelOfSubLayer(vps.profileTierLevel, highestTemporalId);
+  vps.vps_max_sub_layers_minus1 = highestTemporalId;
+  if (highestTemporalId == 0)
+    vps.vps_temporal_id_nesting_flag = true;
+}
+
+seq_parameter_set_rbsp generateSPSForTileMapping(const seq_parameter_set_rbsp &sps,
+                                                 const TileGrid               &grid,
+                                                 const TileMapping            &mapping)
+{
+  const auto newGrid = getMappedTileGrid(grid, mapping);
+
+  auto newSPS                       = sps;
+  newSPS.pic_width_in_luma_samples  = newGrid.width;
+  newSPS.pic_height_in_luma_samples = newGrid.height;
+
+  // An edge of the conformance window is kept if all tiles at the edge come from the same edge
+  bool keepLeft = true, keepRight = true, keepTop = true, keepBottom = true;
+  for (size_t tile = 0; tile < mapping.newPositionPerTile.size(); ++tile)
+  {
+    const auto position = mapping.newPositionPerTile.at(tile);
+    if (!position)
+      continue;
+
+    const auto column    = tile % grid.nrColumns();
+    const auto row       = tile / grid.nrColumns();
+    const auto newColumn = *position % mapping.nrColumns;
+    const auto newRow    = *position / mapping.nrColumns;
+    if (newColumn == 0 && column != 0)
+      keepLeft = false;
+    if (newColumn + 1 == mapping.nrColumns && column + 1 != grid.nrColumns())
+      keepRight = false;
+    if (newRow == 0 && row != 0)
+      keepTop = false;
+    if (newRow + 1 == mapping.nrRows && row + 1 != grid.nrRows())
+      keepBottom = false;
+  }
+
+  if (!keepLeft)
+    newSPS.conf_win_left_offset = 0;
+  if (!keepRight)
+    newSPS.conf_win_right_offset = 0;
+  if (!keepTop)
+    newSPS.conf_win_top_offset = 0;
+  if (!keepBottom)
+    newSPS.conf_win_bottom_offset = 0;
+  newSPS.conformance_window_flag =
+      (newSPS.conf_win_left_offset > 0 || newSPS.conf_win_right_offset > 0 ||
+       newSPS.conf_win_top_offset > 0 || newSPS.conf_win_bottom_offset > 0);
+
+  newSPS.updateCalculatedValues();
+  return newSPS;
+}
+
+pic_parameter_set_rbsp generatePPSForTileMapping(const pic_parameter_set_rbsp &pps,
+                                                 const TileGrid               &grid,
+                                                 const TileMapping            &mapping)
+{
+  const auto newGrid = getMappedTileGrid(grid, mapping);
+
+  auto newPPS = pps;
+
+  // A picture with one tile is coded without tiles
+  newPPS.tiles_enabled_flag = (newGrid.nrColumns() > 1 || newGrid.nrRows() > 1);
+  newPPS.column_width_minus1.clear();
+  newPPS.row_height_minus1.clear();
+  if (!newPPS.tiles_enabled_flag)
+  {
+    newPPS.num_tile_columns_minus1 = 0;
+    newPPS.num_tile_rows_minus1    = 0;
+    newPPS.uniform_spacing_flag    = true;
+    return newPPS;
+  }
+
+  // The last column and row are not signaled. They get the rest of the picture.
+  newPPS.num_tile_columns_minus1 = newGrid.nrColumns() - 1;
+  newPPS.num_tile_rows_minus1    = newGrid.nrRows() - 1;
+  newPPS.uniform_spacing_flag    = false;
+  newPPS.column_width_minus1     = getTileSizesMinus1(newGrid.columnBoundaries);
+  newPPS.row_height_minus1       = getTileSizesMinus1(newGrid.rowBoundaries);
+  // The tiles have new neighbours. Filtering across their boundaries would change the samples at
+  // the edges of the tiles.
+  newPPS.loop_filter_across_tiles_enabled_flag = false;
+  return newPPS;
+}
+
+} // namespace combiner
@@ -6,10 +6,13 @@
 
 #pragma once
 
+#include <HEVC/commonMaps.h>
 #include <HEVC/seq_parameter_set_rbsp.h>
 #include <HEVC/slice_segment_layer_rbsp.h>
 #include <HEVC/video_parameter_set_rbsp.h>
 
+#include "TileGrid.h"
+
 namespace combiner
 {
 
@@ -19,4 +22,31 @@ parser::hevc::seq_parameter_set_rbsp generateSPSWithNewFrameSize(const NalUnitVe
 parser::hevc::pic_parameter_set_rbsp generatePPSWithUniformTiles(const NalUnitVector &nalUnits);
 void                                 checkForMathingSlices(const NalUnitVector &nalUnits);
 
+// Throws if the slices of an input with the new parameter sets can not be written with the
+// parameter sets that were combined from the current ones (another size or coding structure).
+void checkForCompatibleReplacement(const parser::hevc::ActiveParameterSets &currentParameterSets,
+                                   const parser::hevc::ActiveParameterSets &newParameterSets);
+
+// Sub-bitstream extraction (T-REC-H.265-201410 - 10): Remove the sub-layers above the TemporalId
+// from the parameter set. The level and the sub-layer ordering info of the highest remaining
+// sub-layer become the ones of the whole stream. The clock tick of the timing info is scaled to
+// the remaining frame rate and the HRD parameters are removed.
+void removeSubLayersAbove(parser::hevc::seq_parameter_set_rbsp &sps,
+                          const unsigned                        highestTemporalId);
+void removeSubLayersAbove(parser::hevc::video_parameter_set_rbsp &vps,
+                          const unsigned                          highestTemporalId);
+
+// The parameter sets of a stream with the tiles moved to the new grid of the mapping (and the
+// tiles without a new position removed). An edge of the conformance window is only kept if all
+// tiles at that edge of the new picture come from the same edge of the original picture. The new
+// PPS does not filter across the tile boundaries.
+parser::hevc::seq_parameter_set_rbsp
+generateSPSForTileMapping(const parser::hevc::seq_parameter_set_rbsp &sps,
+                          const TileGrid                             &grid,
+                          const TileMapping                          &mapping);
+parser::hevc::pic_parameter_set_rbsp
+generatePPSForTileMapping(const parser::hevc::pic_parameter_set_rbsp &pps,
+                          const TileGrid                             &grid,
+                          const TileMapping                          &mapping);
+
 } // namespace combiner
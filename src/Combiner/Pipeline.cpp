@@ -0,0 +1,163 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include "Pipeline.h"
+
+#include <File/FanOutSink.h>
+#include <File/FileSinkAnnexB.h>
+#include <File/FileSinkAnnexBKernelCopy.h>
+#include <File/FileSinkCMAF.h>
+#include <File/FileSinkLengthPrefixed.h>
+#include <File/FileSinkSegmentedAnnexB.h>
+#include <File/FileSinkTS.h>
+#include <File/FileSourceAnnexB.h>
+#include <File/FileSourceLengthPrefixed.h>
+#include <File/FileSourceMP4.h>
+#include <File/FileSourceTS.h>
+#include <HEVC/ReadPlanHEVC.h>
+#include <Network/RTPSinkHEVC.h>
+#include <Network/RTPSourceHEVC.h>
+#include <common/Logger.h>
+
+#include <stdexcept>
+
+namespace combiner
+{
+
+namespace
+{
+
+bool isRawOutput(const std::filesystem::path &file)
+{
+  const auto extension = file.extension().string();
+  return !NetworkAddress::fromRTPURL(file.string()) && extension != ".mp4" &&
+         extension != ".m4v" && extension != ".cmfv" && extension != ".ts" &&
+         !FileSourceLengthPrefixed::isLengthPrefixedFile(file);
+}
+
+std::unique_ptr<NalUnitSink> openOutputFile(const std::filesystem::path &file,
+                                            const Settings              &settings)
+{
+  const auto extension = file.extension().string();
+  if (const auto address = NetworkAddress::fromRTPURL(file.string()))
+    return std::make_unique<RTPSinkHEVC>(*address);
+  if (extension == ".mp4" || extension == ".m4v" || extension == ".cmfv")
+    return std::make_unique<FileSinkCMAF>(file, settings.framesPerFragment);
+  if (extension == ".ts")
+    return std::make_unique<FileSinkTS>(file, settings.pcrInterval, settings.muxRate);
+  if (FileSourceLengthPrefixed::isLengthPrefixedFile(file))
+    return std::make_unique<FileSinkLengthPrefixed>(file);
+  if (settings.segmentLength.seconds || settings.segmentLength.nrGOPs)
+    return std::make_unique<FileSinkSegmentedAnnexB>(file, settings.segmentLength);
+  if (settings.kernelCopy)
+    return std::make_unique<FileSinkAnnexBKernelCopy>(file);
+  return std::make_unique<FileSinkAnnexB>(file);
+}
+
+} // namespace
+
+bool isRTPInput(const std::filesystem::path &file)
+{
+  return NetworkAddress::fromRTPURL(file.string()).has_value();
+}
+
+bool isAnnexBFile(const std::filesystem::path &file)
+{
+  return !isRTPInput(file) && !FileSourceLengthPrefixed::isLengthPrefixedFile(file) &&
+         !FileSourceMP4::isMP4File(file) && !FileSourceTS::isTSFile(file);
+}
+
+std::unique_ptr<NalUnitSource> openInputFile(const std::filesystem::path   &file,
+                                             const parser::hevc::ReadRange &readRange)
+{
+  if (const auto address = NetworkAddress::fromRTPURL(file.string()))
+  {
+    if (readRange.start || readRange.end)
+      throw std::invalid_argument("--start and --end are not supported for RTP inputs");
+    return std::make_unique<RTPSourceHEVC>(*address);
+  }
+  if (FileSourceLengthPrefixed::isLengthPrefixedFile(file))
+  {
+    if (readRange.start || readRange.end)
+      throw std::invalid_argument("--start and --end are not supported for length prefixed inputs");
+    return std::make_unique<FileSourceLengthPrefixed>(file);
+  }
+  if (FileSourceMP4::isMP4File(file))
+  {
+    if (readRange.start || readRange.end)
+      throw std::invalid_argument("--start and --end are not supported for MP4 inputs");
+    return std::make_unique<FileSourceMP4>(file);
+  }
+  if (FileSourceTS::isTSFile(file))
+  {
+    if (readRange.start || readRange.end)
+      throw std::invalid_argument("--start and --end are not supported for transport streams");
+    return std::make_unique<FileSourceTS>(file);
+  }
+
+  std::shared_ptr<const NalIndex> index;
+  if (auto loadedIndex = NalIndex::loadIfUpToDate(file))
+  {
+    logger().info("Using NAL index " + NalIndex::getSidecarPath(file).string());
+    index = std::make_shared<const NalIndex>(std::move(*loadedIndex));
+  }
+
+  auto fileSource = std::make_unique<FileSourceAnnexB>(file, index);
+  if (readRange.start || readRange.end)
+  {
+    auto readPlan = parser::hevc::createReadPlan(file, index.get(), readRange);
+    logger().info("Reading " + file.string() + " from offset " +
+                  std::to_string(readPlan.startOffset) +
+                  (readPlan.endOffset ? " to offset " + std::to_string(*readPlan.endOffset) : ""));
+    fileSource->setReadPlan(std::move(readPlan));
+  }
+  return fileSource;
+}
+
+std::vector<Slate> loadSlates(const std::vector<std::filesystem::path> &slateFiles)
+{
+  std::vector<Slate> slates;
+  for (const auto &file : slateFiles)
+  {
+    slates.emplace_back(openInputFile(file, {}));
+    logger().info("Slate " + file.string() + " for the tile size " +
+                  slates.back().getFrameSize().toString());
+  }
+  return slates;
+}
+
+std::unique_ptr<NalUnitSink> openOutputs(const Settings &settings, PipelineStatistics *statistics)
+{
+  const auto &file = settings.outputFile.value();
+  if (settings.segmentLength.seconds || settings.segmentLength.nrGOPs)
+  {
+    if (!isRawOutput(file))
+      throw std::invalid_argument("Segments can only be written for raw (Annex B) outputs");
+  }
+  if (settings.kernelCopy && !isRawOutput(file))
+    throw std::invalid_argument("--kernel-copy is only supported for raw (Annex B) outputs");
+
+  const auto getOutputStatistics = [statistics](const size_t outputIndex) {
+    return statistics ? &statistics->getOutput(outputIndex) : nullptr;
+  };
+
+  auto output = openOutputFile(file, settings);
+  if (settings.additionalOutputFiles.empty())
+  {
+    output->setStatistics(getOutputStatistics(0));
+    return output;
+  }
+
+  auto fanOutSink = std::make_unique<FanOutSink>();
+  fanOutSink->addSink(std::move(output), FanOutSink::OverflowPolicy::Wait, getOutputStatistics(0));
+  for (size_t i = 0; i < settings.additionalOutputFiles.size(); ++i)
+    fanOutSink->addSink(openOutputFile(settings.additionalOutputFiles.at(i), settings),
+                        FanOutSink::OverflowPolicy::DropUntilIRAP,
+                        getOutputStatistics(i + 1));
+  return fanOutSink;
+}
+
+} // namespace combiner
@@ -0,0 +1,38 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+
+#include <File/NalUnitSink.h>
+#include <File/NalUnitSource.h>
+#include <common/PipelineStatistics.h>
+
+#include "Settings.h"
+#include "Slate.h"
+
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+namespace combiner
+{
+
+// The inputs and outputs of a combination (or of a daemon job) as given on the command line
+
+bool isRTPInput(const std::filesystem::path &file);
+bool isAnnexBFile(const std::filesystem::path &file);
+
+// Files, RTP URLs (rtp://...) and transport streams. The read range is only supported for raw
+// (Annex B) files. Throws if the input can not be opened.
+std::unique_ptr<NalUnitSource> openInputFile(const std::filesystem::path   &file,
+                                             const parser::hevc::ReadRange &readRange);
+std::vector<Slate>             loadSlates(const std::vector<std::filesystem::path> &slateFiles);
+
+// With additional outputs, the output is not allowed to fall behind. The additional outputs skip
+// ahead if they can not keep up. Each output counts into its own statistics (if enabled).
+std::unique_ptr<NalUnitSink> openOutputs(const Settings &settings, PipelineStatistics *statistics);
+
+} // namespace combiner
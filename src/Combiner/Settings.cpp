@@ -0,0 +1,191 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include "Settings.h"
+
+#include <stdexcept>
+
+namespace combiner
+{
+
+namespace
+{
+
+std::string getOptionValue(int argc, char const *argv[], int &i)
+{
+  const std::string option(argv[i]);
+  if (i + 1 >= argc)
+    throw std::invalid_argument("Missing value for option " + option);
+  return std::string(argv[++i]);
+}
+
+} // namespace
+
+Settings parseCommandLineArguments(int argc, char const *argv[])
+{
+  Settings settings;
+  for (int i = 1; i < argc; ++i)
+  {
+    const std::string argument(argv[i]);
+    if (argument == "--log-level")
+    {
+      const auto value = getOptionValue(argc, argv, i);
+      if (const auto level = LogLevelMapper.getValueCaseInsensitive(value))
+        settings.logLevel = *level;
+      else
+        throw std::invalid_argument("Invalid log level " + value);
+    }
+    else if (argument == "--stats")
+      settings.statisticsFile = std::filesystem::path(getOptionValue(argc, argv, i));
+    else if (argument == "--stats-interval")
+    {
+      const auto value   = getOptionValue(argc, argv, i);
+      const auto seconds = std::stod(value);
+      if (seconds <= 0)
+        throw std::invalid_argument("Invalid statistics interval " + value);
+      settings.statisticsInterval =
+          std::chrono::milliseconds(static_cast<int64_t>(seconds * 1000.0));
+    }
+    else if (argument == "--trace")
+      settings.traceFile = std::filesystem::path(getOptionValue(argc, argv, i));
+    else if (argument == "--start")
+      settings.readRange.start =
+          parser::hevc::RangePosition::fromString(getOptionValue(argc, argv, i));
+    else if (argument == "--end")
+      settings.readRange.end =
+          parser::hevc::RangePosition::fromString(getOptionValue(argc, argv, i));
+    else if (argument == "--threads")
+    {
+      const auto value  = getOptionValue(argc, argv, i);
+      const auto number = std::stoi(value);
+      if (number < 1)
+        throw std::invalid_argument("Invalid number of threads " + value);
+      settings.nrThreads = static_cast<unsigned>(number);
+    }
+    else if (argument == "--fragment-frames")
+    {
+      const auto value  = getOptionValue(argc, argv, i);
+      const auto number = std::stoi(value);
+      if (number < 1)
+        throw std::invalid_argument("Invalid number of frames per fragment " + value);
+      settings.framesPerFragment = static_cast<unsigned>(number);
+    }
+    else if (argument == "--pcr-interval")
+    {
+      const auto value  = getOptionValue(argc, argv, i);
+      const auto number = std::stoi(value);
+      if (number < 1)
+        throw std::invalid_argument("Invalid PCR interval " + value);
+      settings.pcrInterval = std::chrono::milliseconds(number);
+    }
+    else if (argument == "--mux-rate")
+    {
+      const auto value = getOptionValue(argc, argv, i);
+      const auto rate  = std::stoll(value);
+      if (rate < 1)
+        throw std::invalid_argument("Invalid mux rate " + value);
+      settings.muxRate = static_cast<uint64_t>(rate);
+    }
+    else if (argument == "--segment-seconds")
+    {
+      const auto value   = getOptionValue(argc, argv, i);
+      const auto seconds = std::stod(value);
+      if (seconds <= 0)
+        throw std::invalid_argument("Invalid segment duration " + value);
+      settings.segmentLength.seconds = seconds;
+    }
+    else if (argument == "--segment-gops")
+    {
+      const auto value  = getOptionValue(argc, argv, i);
+      const auto number = std::stoi(value);
+      if (number < 1)
+        throw std::invalid_argument("Invalid number of GOPs per segment " + value);
+      settings.segmentLength.nrGOPs = static_cast<unsigned>(number);
+    }
+    else if (argument == "--kernel-copy")
+      settings.kernelCopy = true;
+    else if (argument == "--skip-tiles")
+    {
+      const auto value  = getOptionValue(argc, argv, i);
+      const auto number = std::stoi(value);
+      if (number < 1)
+        throw std::invalid_argument("Invalid skip tile timeout " + value);
+      settings.skipTileTimeout = std::chrono::milliseconds(number);
+    }
+    else if (argument == "--slate")
+      settings.slateFiles.push_back(std::filesystem::path(getOptionValue(argc, argv, i)));
+    else if (argument == "--extract-tiles" || argument == "--relayout")
+    {
+      const auto value = getOptionValue(argc, argv, i);
+      if (settings.tileArrangement)
+        throw std::invalid_argument("--extract-tiles and --relayout can only be used once");
+      if (argument == "--extract-tiles")
+        settings.tileArrangement = TileRegion::fromString(value);
+      else
+        settings.tileArrangement = TileLayout::fromString(value);
+    }
+    else if (argument == "--max-temporal-id")
+    {
+      const auto value  = getOptionValue(argc, argv, i);
+      const auto number = std::stoi(value);
+      if (number < 0 || number > 6)
+        throw std::invalid_argument("Invalid highest TemporalId " + value);
+      settings.highestTemporalId = static_cast<unsigned>(number);
+    }
+    else if (argument == "--also-output")
+      settings.additionalOutputFiles.push_back(
+          std::filesystem::path(getOptionValue(argc, argv, i)));
+    else if (argument == "--daemon")
+      settings.daemonSocket = std::filesystem::path(getOptionValue(argc, argv, i));
+    else if (argument == "--workers")
+    {
+      const auto value  = getOptionValue(argc, argv, i);
+      const auto number = std::stoi(value);
+      if (number < 1)
+        throw std::invalid_argument("Invalid number of workers " + value);
+      settings.nrWorkers = static_cast<unsigned>(number);
+    }
+    else if (argument == "--control")
+    {
+      // Everything after the socket is the command for the daemon
+      settings.controlSocket = std::filesystem::path(getOptionValue(argc, argv, i));
+      settings.controlCommand.assign(argv + i + 1, argv + argc);
+      if (settings.controlCommand.empty())
+        throw std::invalid_argument("Missing command for the daemon");
+      break;
+    }
+    else if (argument == "--write-index")
+      settings.writeIndex = true;
+    else if (argument == "--replay-rtp")
+      settings.replayRTPDestination = NetworkAddress::fromString(getOptionValue(argc, argv, i));
+    else
+      settings.inputFiles.push_back(std::filesystem::path(argument));
+  }
+  if (settings.nrThreads > 1 && (settings.readRange.start || settings.readRange.end))
+    throw std::invalid_argument("--threads can not be used together with --start or --end");
+  if (settings.segmentLength.seconds && settings.segmentLength.nrGOPs)
+    throw std::invalid_argument("--segment-seconds can not be used together with --segment-gops");
+  if (settings.kernelCopy && (settings.segmentLength.seconds || settings.segmentLength.nrGOPs))
+    throw std::invalid_argument("--kernel-copy can not be used together with segments");
+  if (settings.nrThreads > 1 && settings.skipTileTimeout)
+    throw std::invalid_argument("--threads can not be used together with --skip-tiles");
+  if (!settings.slateFiles.empty() && !settings.skipTileTimeout)
+    throw std::invalid_argument("--slate can only be used together with --skip-tiles");
+  if (settings.tileArrangement &&
+      (settings.nrThreads > 1 || settings.skipTileTimeout || settings.highestTemporalId))
+    throw std::invalid_argument(
+        "--extract-tiles and --relayout can not be used together with --threads, --skip-tiles "
+        "or --max-temporal-id");
+  if (!settings.writeIndex && !settings.replayRTPDestination && !settings.daemonSocket &&
+      !settings.controlSocket && !settings.inputFiles.empty())
+  {
+    settings.outputFile = settings.inputFiles.back();
+    settings.inputFiles.pop_back();
+  }
+  return settings;
+}
+
+} // namespace combiner
@@ -0,0 +1,57 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+
+#include <Combiner/TileGrid.h>
+#include <File/FileSinkSegmentedAnnexB.h>
+#include <HEVC/ReadPlanHEVC.h>
+#include <Network/NetworkAddress.h>
+#include <common/Logger.h>
+
+#include <chrono>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace combiner
+{
+
+// The settings of a run of the combiner (or of a daemon job) from the command line
+struct Settings
+{
+  std::vector<std::filesystem::path>       inputFiles;
+  std::optional<std::filesystem::path>     outputFile;
+  std::vector<std::filesystem::path>       additionalOutputFiles;
+  std::optional<LogLevel>                  logLevel;
+  std::optional<std::filesystem::path>     statisticsFile;
+  std::chrono::milliseconds                statisticsInterval{};
+  std::optional<std::filesystem::path>     traceFile;
+  bool                                     writeIndex{};
+  parser::hevc::ReadRange                  readRange;
+  unsigned                                 nrThreads{1};
+  std::optional<unsigned>                  framesPerFragment;
+  std::chrono::milliseconds                pcrInterval{40};
+  std::optional<uint64_t>                  muxRate;
+  std::optional<NetworkAddress>            replayRTPDestination;
+  SegmentLength                            segmentLength;
+  bool                                     kernelCopy{};
+  std::optional<std::chrono::milliseconds> skipTileTimeout;
+  std::vector<std::filesystem::path>       slateFiles;
+  std::optional<unsigned>                  highestTemporalId;
+  std::optional<TileArrangement>           tileArrangement;
+  std::optional<std::filesystem::path>     daemonSocket;
+  unsigned                                 nrWorkers{2};
+  std::optional<std::filesystem::path>     controlSocket;
+  std::vector<std::string>                 controlCommand;
+};
+
+// Throws std::invalid_argument for invalid options or combinations of options. Without a mode
+// (index, RTP replay, daemon or control), the last file is the output.
+Settings parseCommandLineArguments(int argc, char const *argv[]);
+
+} // namespace combiner
@@ -0,0 +1,68 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include "Slate.h"
+
+#include <HEVC/ParserAnnexBHEVC.h>
+#include <HEVC/pic_parameter_set_rbsp.h>
+#include <HEVC/seq_parameter_set_rbsp.h>
+#include <HEVC/slice_segment_layer_rbsp.h>
+
+#include <stdexcept>
+
+namespace combiner
+{
+
+using namespace parser::hevc;
+
+Slate::Slate(std::unique_ptr<NalUnitSource> &&source)
+{
+  ParserAnnexBHEVC parser(std::move(source), SliceParsingMode::SliceSegmentHeader);
+  while (true)
+  {
+    auto nal = parser.parseNextNalFromFile();
+    if (nal.rawData.empty())
+      break;
+    if (!nal.header.isSlice())
+      continue;
+
+    if (this->slice.rbsp)
+      throw std::runtime_error("The slate must have one picture with one slice");
+    if (!nal.header.isIRAP())
+      throw std::runtime_error("The slate picture must be an IRAP picture");
+    this->slice = std::move(nal);
+  }
+
+  const auto slateSlice = dynamic_cast<slice_segment_layer_rbsp *>(this->slice.rbsp.get());
+  if (slateSlice == nullptr)
+    throw std::runtime_error("The slate has no slice");
+  if (slateSlice->sliceSegmentHeader.slice_type != SliceType::I)
+    throw std::runtime_error("The slate picture must be coded as an I slice");
+
+  this->activeParameterSets = parser.getActiveParameterSets();
+
+  const auto  ppsID = slateSlice->sliceSegmentHeader.slice_pic_parameter_set_id;
+  const auto &pps   = this->activeParameterSets.ppsMap.at(ppsID);
+  if (pps.tiles_enabled_flag || pps.entropy_coding_sync_enabled_flag)
+    throw std::runtime_error("The slate must not use tiles or wavefront parallel processing");
+  const auto &sps = this->activeParameterSets.spsMap.at(pps.pps_seq_parameter_set_id);
+  this->frameSize = sps.getFrameSize();
+}
+
+const ActiveParameterSets &Slate::getActiveParameterSets() const
+{
+  return this->activeParameterSets;
+}
+
+const Slate *findSlateWithFrameSize(const std::vector<Slate> &slates, const FrameSize &frameSize)
+{
+  for (const auto &slate : slates)
+    if (slate.getFrameSize() == frameSize)
+      return &slate;
+  return nullptr;
+}
+
+} // namespace combiner
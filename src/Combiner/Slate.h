@@ -0,0 +1,42 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+
+#include <File/NalUnitSource.h>
+#include <HEVC/NalUnitHEVC.h>
+#include <HEVC/commonMaps.h>
+
+#include <memory>
+#include <vector>
+
+namespace combiner
+{
+
+/* A pre-encoded bitstream with a single IRAP picture that is shown in the tile of an input that
+ * has not started yet. The picture must be coded as one I slice. Its parameter sets are used to
+ * combine the parameter sets until the input has its own ones, so they must have the coding
+ * structure of the other inputs (see checkForCompatibleReplacement).
+ */
+class Slate
+{
+public:
+  explicit Slate(std::unique_ptr<NalUnitSource> &&source);
+
+  FrameSize                                getFrameSize() const { return this->frameSize; }
+  const parser::hevc::ActiveParameterSets &getActiveParameterSets() const;
+  const parser::hevc::NalUnitHEVC         &getSlice() const { return this->slice; }
+
+private:
+  parser::hevc::ActiveParameterSets activeParameterSets{};
+  parser::hevc::NalUnitHEVC         slice{};
+  FrameSize                         frameSize{};
+};
+
+// The first slate with the frame size. Null if there is none.
+const Slate *findSlateWithFrameSize(const std::vector<Slate> &slates, const FrameSize &frameSize);
+
+} // namespace combiner
@@ -0,0 +1,322 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include "TileGrid.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace combiner
+{
+
+using namespace parser::hevc;
+
+namespace
+{
+
+// The boundaries of uniformly spaced tiles (6-3, 6-4) or of the signaled widths/heights (6-5, 6-6)
+std::vector<uint64_t> getBoundaries(const uint64_t          sizeInCtbs,
+                                    const uint64_t          nrTiles,
+                                    const bool              uniformSpacing,
+                                    const vector<uint64_t> &sizesMinus1)
+{
+  std::vector<uint64_t> boundaries{0};
+  for (uint64_t i = 0; i + 1 < nrTiles; ++i)
+  {
+    const auto size = uniformSpacing
+                          ? ((i + 1) * sizeInCtbs) / nrTiles - (i * sizeInCtbs) / nrTiles
+                          : sizesMinus1.at(i) + 1;
+    boundaries.push_back(boundaries.back() + size);
+  }
+  if (boundaries.back() >= sizeInCtbs)
+    throw std::runtime_error("The tiles do not fit into the picture");
+  boundaries.push_back(sizeInCtbs);
+  return boundaries;
+}
+
+size_t findInBoundaries(const std::vector<uint64_t> &boundaries, const uint64_t position)
+{
+  if (position >= boundaries.back())
+    throw std::logic_error("The CTB position is outside of the picture");
+  const auto next = std::upper_bound(boundaries.begin(), boundaries.end(), position);
+  return static_cast<size_t>(next - boundaries.begin()) - 1;
+}
+
+uint64_t getSizeInSamples(const std::vector<uint64_t> &boundaries,
+                          const size_t                 index,
+                          const uint64_t               CtbSizeY,
+                          const uint64_t               pictureSize)
+{
+  const auto end = std::min(boundaries.at(index + 1) * CtbSizeY, pictureSize);
+  return end - boundaries.at(index) * CtbSizeY;
+}
+
+// A list of numbers like "3,2,1,0"
+std::vector<unsigned> parseNumbers(const std::string &text, const std::string &errorMessage)
+{
+  std::vector<unsigned> values;
+  size_t                start = 0;
+  while (true)
+  {
+    const auto end       = text.find(',', start);
+    const auto valueText = text.substr(start, end - start);
+
+    size_t parsedCharacters{};
+    int    value{};
+    try
+    {
+      value = std::stoi(valueText, &parsedCharacters);
+    }
+    catch (const std::exception &)
+    {
+      parsedCharacters = 0;
+    }
+    if (parsedCharacters == 0 || parsedCharacters != valueText.size() || value < 0)
+      throw std::invalid_argument(errorMessage);
+    values.push_back(static_cast<unsigned>(value));
+
+    if (end == std::string::npos)
+      return values;
+    start = end + 1;
+  }
+}
+
+void setSizeOfNewTiles(std::optional<uint64_t> &size,
+                       const uint64_t           tileSize,
+                       const std::string       &columnOrRow)
+{
+  if (size && *size != tileSize)
+    throw std::runtime_error("The tiles in " + columnOrRow +
+                             " of the new layout do not have the same size");
+  size = tileSize;
+}
+
+// Only the last tile column/row can end within a CTB
+std::vector<uint64_t> getBoundariesOfNewTiles(const std::vector<std::optional<uint64_t>> &sizes,
+                                              const uint64_t                              CtbSizeY)
+{
+  std::vector<uint64_t> boundaries{0};
+  for (size_t i = 0; i < sizes.size(); ++i)
+  {
+    if (!sizes.at(i))
+      throw std::logic_error("There is no tile for every position of the new layout");
+    const auto size = *sizes.at(i);
+    if (i + 1 < sizes.size() && size % CtbSizeY != 0)
+      throw std::runtime_error("A tile that ends within a CTB can only be moved to the right or "
+                               "bottom edge of the picture");
+    boundaries.push_back(boundaries.back() + (size + CtbSizeY - 1) / CtbSizeY);
+  }
+  return boundaries;
+}
+
+uint64_t getSumOfSizes(const std::vector<std::optional<uint64_t>> &sizes)
+{
+  uint64_t sum = 0;
+  for (const auto &size : sizes)
+    sum += size.value_or(0);
+  return sum;
+}
+
+} // namespace
+
+size_t TileGrid::findColumn(const uint64_t ctbX) const
+{
+  return findInBoundaries(this->columnBoundaries, ctbX);
+}
+
+size_t TileGrid::findRow(const uint64_t ctbY) const
+{
+  return findInBoundaries(this->rowBoundaries, ctbY);
+}
+
+uint64_t TileGrid::getColumnWidth(const size_t column) const
+{
+  return getSizeInSamples(this->columnBoundaries, column, this->CtbSizeY, this->width);
+}
+
+uint64_t TileGrid::getRowHeight(const size_t row) const
+{
+  return getSizeInSamples(this->rowBoundaries, row, this->CtbSizeY, this->height);
+}
+
+TileGrid getTileGrid(const seq_parameter_set_rbsp &sps, const pic_parameter_set_rbsp &pps)
+{
+  TileGrid grid;
+  grid.CtbSizeY = sps.CtbSizeY;
+  grid.width    = sps.pic_width_in_luma_samples;
+  grid.height   = sps.pic_height_in_luma_samples;
+
+  if (!pps.tiles_enabled_flag)
+  {
+    grid.columnBoundaries = {0, sps.PicWidthInCtbsY};
+    grid.rowBoundaries    = {0, sps.PicHeightInCtbsY};
+    return grid;
+  }
+
+  grid.columnBoundaries = getBoundaries(sps.PicWidthInCtbsY,
+                                        pps.num_tile_columns_minus1 + 1,
+                                        pps.uniform_spacing_flag,
+                                        pps.column_width_minus1);
+  grid.rowBoundaries    = getBoundaries(sps.PicHeightInCtbsY,
+                                        pps.num_tile_rows_minus1 + 1,
+                                        pps.uniform_spacing_flag,
+                                        pps.row_height_minus1);
+  return grid;
+}
+
+TileRegion TileRegion::fromString(const std::string &text)
+{
+  const auto values = parseNumbers(text, "Invalid tile region " + text);
+  if (values.size() != 2 && values.size() != 4)
+    throw std::invalid_argument("Invalid tile region " + text);
+
+  TileRegion region;
+  region.firstColumn = values.at(0);
+  region.firstRow    = values.at(1);
+  if (values.size() == 4)
+  {
+    region.nrColumns = values.at(2);
+    region.nrRows    = values.at(3);
+  }
+  if (region.nrColumns == 0 || region.nrRows == 0)
+    throw std::invalid_argument("Invalid tile region " + text);
+  return region;
+}
+
+std::string TileRegion::toString() const
+{
+  return std::to_string(this->nrColumns) + "x" + std::to_string(this->nrRows) +
+         " tiles at column " + std::to_string(this->firstColumn) + " row " +
+         std::to_string(this->firstRow);
+}
+
+void checkRegionInGrid(const TileRegion &region, const TileGrid &grid)
+{
+  if (region.nrColumns == 0 || region.nrRows == 0 ||
+      region.firstColumn + region.nrColumns > grid.nrColumns() ||
+      region.firstRow + region.nrRows > grid.nrRows())
+    throw std::runtime_error("The region of " + region.toString() + " is not inside of the " +
+                             std::to_string(grid.nrColumns()) + "x" +
+                             std::to_string(grid.nrRows()) + " tile grid");
+}
+
+TileLayout TileLayout::fromString(const std::string &text)
+{
+  const auto errorMessage = "Invalid tile layout " + text;
+
+  const auto orderSeparator = text.find(':');
+  const auto sizeText       = text.substr(0, orderSeparator);
+  const auto sizeSeparator  = sizeText.find('x');
+  if (sizeSeparator == std::string::npos)
+    throw std::invalid_argument(errorMessage);
+
+  TileLayout layout;
+  layout.nrColumns = parseNumbers(sizeText.substr(0, sizeSeparator), errorMessage).front();
+  layout.nrRows    = parseNumbers(sizeText.substr(sizeSeparator + 1), errorMessage).front();
+
+  const auto nrTiles = layout.nrColumns * layout.nrRows;
+  if (nrTiles == 0)
+    throw std::invalid_argument(errorMessage);
+
+  if (orderSeparator == std::string::npos)
+  {
+    for (unsigned i = 0; i < nrTiles; ++i)
+      layout.tilePerPosition.push_back(i);
+    return layout;
+  }
+
+  // Every tile must be in the layout once
+  layout.tilePerPosition = parseNumbers(text.substr(orderSeparator + 1), errorMessage);
+  auto sortedTiles       = layout.tilePerPosition;
+  std::sort(sortedTiles.begin(), sortedTiles.end());
+  for (unsigned i = 0; i < sortedTiles.size(); ++i)
+    if (sortedTiles.at(i) != i)
+      throw std::invalid_argument(errorMessage);
+  if (sortedTiles.size() != nrTiles)
+    throw std::invalid_argument(errorMessage);
+  return layout;
+}
+
+std::string TileLayout::toString() const
+{
+  std::string tiles;
+  for (const auto tile : this->tilePerPosition)
+    tiles += (tiles.empty() ? "" : ",") + std::to_string(tile);
+  return std::to_string(this->nrColumns) + "x" + std::to_string(this->nrRows) +
+         " tiles (" + tiles + ")";
+}
+
+std::string toString(const TileArrangement &arrangement)
+{
+  if (const auto region = std::get_if<TileRegion>(&arrangement))
+    return "Extract " + region->toString();
+  return "Layout " + std::get<TileLayout>(arrangement).toString();
+}
+
+TileMapping getTileMapping(const TileArrangement &arrangement, const TileGrid &grid)
+{
+  const auto nrTiles = grid.nrColumns() * grid.nrRows();
+
+  TileMapping mapping;
+  mapping.newPositionPerTile.resize(nrTiles);
+  if (const auto region = std::get_if<TileRegion>(&arrangement))
+  {
+    checkRegionInGrid(*region, grid);
+    mapping.nrColumns = region->nrColumns;
+    mapping.nrRows    = region->nrRows;
+    for (unsigned row = 0; row < region->nrRows; ++row)
+    {
+      for (unsigned column = 0; column < region->nrColumns; ++column)
+      {
+        const auto tile =
+            (region->firstRow + row) * grid.nrColumns() + region->firstColumn + column;
+        mapping.newPositionPerTile.at(tile) = row * region->nrColumns + column;
+      }
+    }
+    return mapping;
+  }
+
+  const auto &layout = std::get<TileLayout>(arrangement);
+  if (layout.tilePerPosition.size() != nrTiles)
+    throw std::runtime_error("The layout of " + layout.toString() + " does not have the " +
+                             std::to_string(nrTiles) + " tiles of the stream");
+  mapping.nrColumns = layout.nrColumns;
+  mapping.nrRows    = layout.nrRows;
+  for (size_t position = 0; position < layout.tilePerPosition.size(); ++position)
+    mapping.newPositionPerTile.at(layout.tilePerPosition.at(position)) = position;
+  return mapping;
+}
+
+TileGrid getMappedTileGrid(const TileGrid &grid, const TileMapping &mapping)
+{
+  std::vector<std::optional<uint64_t>> columnWidths(mapping.nrColumns);
+  std::vector<std::optional<uint64_t>> rowHeights(mapping.nrRows);
+  for (size_t tile = 0; tile < mapping.newPositionPerTile.size(); ++tile)
+  {
+    const auto position = mapping.newPositionPerTile.at(tile);
+    if (!position)
+      continue;
+
+    const auto newColumn = *position % mapping.nrColumns;
+    const auto newRow    = *position / mapping.nrColumns;
+    setSizeOfNewTiles(columnWidths.at(newColumn),
+                      grid.getColumnWidth(tile % grid.nrColumns()),
+                      "column " + std::to_string(newColumn));
+    setSizeOfNewTiles(rowHeights.at(newRow),
+                      grid.getRowHeight(tile / grid.nrColumns()),
+                      "row " + std::to_string(newRow));
+  }
+
+  TileGrid newGrid;
+  newGrid.columnBoundaries = getBoundariesOfNewTiles(columnWidths, grid.CtbSizeY);
+  newGrid.rowBoundaries    = getBoundariesOfNewTiles(rowHeights, grid.CtbSizeY);
+  newGrid.CtbSizeY         = grid.CtbSizeY;
+  newGrid.width            = getSumOfSizes(columnWidths);
+  newGrid.height           = getSumOfSizes(rowHeights);
+  return newGrid;
+}
+
+} // namespace combiner
@@ -0,0 +1,98 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+
+#include <HEVC/pic_parameter_set_rbsp.h>
+#include <HEVC/seq_parameter_set_rbsp.h>
+
+#include <optional>
+#include <string>
+#include <variant>
+#include <vector>
+
+namespace combiner
+{
+
+// The tile columns and rows of a picture (T-REC-H.265-201410 - 6.5.1). The boundaries are in
+// units of CTBs. There is one more boundary than there are columns/rows, so that the last one is
+// the width/height of the picture in CTBs. A picture without tiles is one tile.
+struct TileGrid
+{
+  std::vector<uint64_t> columnBoundaries;
+  std::vector<uint64_t> rowBoundaries;
+
+  // The size of the picture in luma samples. It can end within the last CTB column/row.
+  uint64_t CtbSizeY{};
+  uint64_t width{};
+  uint64_t height{};
+
+  size_t nrColumns() const { return this->columnBoundaries.size() - 1; }
+  size_t nrRows() const { return this->rowBoundaries.size() - 1; }
+
+  // The tile column/row that the CTB column/row is in
+  size_t findColumn(const uint64_t ctbX) const;
+  size_t findRow(const uint64_t ctbY) const;
+
+  // The size of the tile column/row in luma samples
+  uint64_t getColumnWidth(const size_t column) const;
+  uint64_t getRowHeight(const size_t row) const;
+};
+
+TileGrid getTileGrid(const parser::hevc::seq_parameter_set_rbsp &sps,
+                     const parser::hevc::pic_parameter_set_rbsp &pps);
+
+// A rectangle of tiles in a tile grid (in units of tiles)
+struct TileRegion
+{
+  unsigned firstColumn{};
+  unsigned firstRow{};
+  unsigned nrColumns{1};
+  unsigned nrRows{1};
+
+  // Parse a region like "1,0" (one tile) or "1,0,2,1" (2x1 tiles from column 1 row 0 on)
+  static TileRegion fromString(const std::string &text);
+  std::string       toString() const;
+};
+
+// Throws if the region is not completely inside of the grid
+void checkRegionInGrid(const TileRegion &region, const TileGrid &grid);
+
+// A new grid for all tiles of a picture. The tile at each position of the new grid (in raster
+// scan) is given by its index in the raster scan of the original grid.
+struct TileLayout
+{
+  unsigned              nrColumns{};
+  unsigned              nrRows{};
+  std::vector<unsigned> tilePerPosition;
+
+  // Parse a layout like "4x1" (the tiles in their order) or "2x2:3,2,1,0" (the tiles per position)
+  static TileLayout fromString(const std::string &text);
+  std::string       toString() const;
+};
+
+// How the tiles of a stream are rearranged: Extract a region of them or lay all of them out anew
+using TileArrangement = std::variant<TileRegion, TileLayout>;
+
+std::string toString(const TileArrangement &arrangement);
+
+// Where every tile of a grid (in raster scan) is moved to in the new grid. Tiles without a new
+// position are dropped.
+struct TileMapping
+{
+  size_t                             nrColumns{};
+  size_t                             nrRows{};
+  std::vector<std::optional<size_t>> newPositionPerTile;
+};
+
+TileMapping getTileMapping(const TileArrangement &arrangement, const TileGrid &grid);
+
+// The grid of the picture that the tiles are moved to. The tiles in a column of the new grid must
+// have the same width and the tiles in a row the same height. Only the tiles of the last new
+// column/row can end within a CTB. Throws otherwise.
+TileGrid getMappedTileGrid(const TileGrid &grid, const TileMapping &mapping);
+
+} // namespace combiner
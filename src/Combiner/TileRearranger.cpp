@@ -0,0 +1,279 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include "TileRearranger.h"
+
+#include <common/Logger.h>
+#include <common/SubByteWriter.h>
+#include <common/Tracer.h>
+
+#include "ParameterSetsModifiers.h"
+
+#include <algorithm>
+
+namespace combiner
+{
+
+using namespace parser::hevc;
+
+namespace
+{
+
+const std::string SLICE_OVER_MULTIPLE_TILES_ERROR =
+    "A slice segment spans more than one tile. Only tiles that start with a slice segment can be "
+    "rearranged.";
+
+} // namespace
+
+TileRearranger::TileRearranger(std::unique_ptr<NalUnitSource> &&input,
+                               NalUnitSink                     &output,
+                               const TileArrangement           &arrangement,
+                               PipelineStatistics              *statistics)
+    : parser(std::move(input), SliceParsingMode::SliceSegmentHeader), output(output),
+      arrangement(arrangement)
+{
+  if (statistics != nullptr)
+  {
+    this->statistics = &statistics->getInput(0);
+    this->parser.setStatistics(this->statistics);
+  }
+  this->parser.setTraceInput(0);
+
+  this->rearrangeTiles();
+}
+
+void TileRearranger::rearrangeTiles()
+{
+  while (true)
+  {
+    auto nal = this->parser.parseNextNalFromFile();
+    if (nal.rawData.empty())
+      break;
+
+    // The slice segments of the previous picture are written before anything else
+    const auto slice = dynamic_cast<slice_segment_layer_rbsp *>(nal.rbsp.get());
+    if (slice == nullptr || slice->sliceSegmentHeader.first_slice_segment_in_pic_flag)
+      this->writeSliceSegmentsOfPicture();
+
+    const auto timestamps = this->parser.getTimestampsOfLastNalUnit();
+    if (timestamps.PTS || timestamps.DTS)
+      this->output.setTimestampsOfNextNALUnits(timestamps);
+
+    const auto nalType = nal.header.nal_unit_type;
+    if (nalType == NalType::SPS_NUT)
+    {
+      const auto sps = dynamic_cast<seq_parameter_set_rbsp *>(nal.rbsp.get());
+      const auto pps = this->findWrittenPPSForSPS(sps->sps_seq_parameter_set_id);
+      if (pps != nullptr)
+        this->writeSPS(nal.header, *sps, *pps);
+      else
+        this->spsWaitingForPPS[sps->sps_seq_parameter_set_id] = nal.header;
+    }
+    else if (nalType == NalType::PPS_NUT)
+      this->writePPS(nal);
+    else if (slice != nullptr)
+      this->addSliceSegment(std::move(nal));
+    else
+    {
+      this->output.writeNALUnit(nal.rawData);
+      if (logger().isEnabled(LogLevel::Debug))
+        logger().debug("Pass through " + NalTypeMapper.getName(nalType) + " NAL.");
+    }
+  }
+  this->writeSliceSegmentsOfPicture();
+
+  if (this->nrStartedTiles != this->nrTilesInPicture)
+    throw std::runtime_error(SLICE_OVER_MULTIPLE_TILES_ERROR);
+  logger().info("Rearranged " + std::to_string(this->nrPictures) + " pictures.");
+}
+
+const pic_parameter_set_rbsp *TileRearranger::findWrittenPPSForSPS(const uint64_t spsID) const
+{
+  for (const auto &[ppsID, pps] : this->parser.getActiveParameterSets().ppsMap)
+    if (pps.pps_seq_parameter_set_id == spsID && this->tilesPerPPS.count(ppsID) > 0)
+      return &pps;
+  return nullptr;
+}
+
+void TileRearranger::writeSPS(const nal_unit_header        &header,
+                              const seq_parameter_set_rbsp &sps,
+                              const pic_parameter_set_rbsp &pps)
+{
+  const auto grid   = getTileGrid(sps, pps);
+  const auto newSPS = generateSPSForTileMapping(sps, grid, getTileMapping(this->arrangement, grid));
+
+  parser::SubByteWriter writer;
+  header.write(writer);
+  newSPS.write(writer);
+  const auto data = writer.finishWritingAndGetData();
+  this->output.writeNALUnit(data);
+
+  this->activeWritingParameterSets.spsMap[newSPS.sps_seq_parameter_set_id] = newSPS;
+  this->spsWaitingForPPS.erase(newSPS.sps_seq_parameter_set_id);
+
+  logger().info("SPS -> Frame size of the rearranged tiles " + newSPS.getFrameSize().toString());
+}
+
+void TileRearranger::writePPS(const NalUnitHEVC &nal)
+{
+  const auto pps   = dynamic_cast<pic_parameter_set_rbsp *>(nal.rbsp.get());
+  const auto spsID = pps->pps_seq_parameter_set_id;
+
+  const auto &spsMap = this->parser.getActiveParameterSets().spsMap;
+  if (spsMap.count(spsID) == 0)
+    throw std::runtime_error("The PPS refers to the SPS with ID " + std::to_string(spsID) +
+                             " which was not found.");
+  const auto &sps = spsMap.at(spsID);
+
+  TilesOfPPS tiles;
+  tiles.grid    = getTileGrid(sps, *pps);
+  tiles.mapping = getTileMapping(this->arrangement, tiles.grid);
+  tiles.newGrid = getMappedTileGrid(tiles.grid, tiles.mapping);
+
+  // The PPS of the input can be repeated after the rearranged SPS was written
+  const auto waitingSPS = this->spsWaitingForPPS.find(spsID);
+  if (waitingSPS != this->spsWaitingForPPS.end())
+    this->writeSPS(waitingSPS->second, sps, *pps);
+  else
+  {
+    const auto &writtenSPS = this->activeWritingParameterSets.spsMap.at(spsID);
+    if (tiles.newGrid.width != writtenSPS.pic_width_in_luma_samples ||
+        tiles.newGrid.height != writtenSPS.pic_height_in_luma_samples)
+      throw std::runtime_error("The tiles of the PPS with ID " +
+                               std::to_string(pps->pps_pic_parameter_set_id) +
+                               " give the rearranged picture another size than the SPS that was "
+                               "written.");
+  }
+
+  if (pps->tiles_enabled_flag && pps->loop_filter_across_tiles_enabled_flag)
+    logger().warning("The input is filtered across tile boundaries and the rearranged tiles are "
+                     "not. The samples at the tile boundaries do not decode like in the input.");
+  const auto newPPS = generatePPSForTileMapping(*pps, tiles.grid, tiles.mapping);
+
+  parser::SubByteWriter writer;
+  nal.header.write(writer);
+  newPPS.write(writer);
+  const auto data = writer.finishWritingAndGetData();
+  this->output.writeNALUnit(data);
+
+  this->activeWritingParameterSets.ppsMap[newPPS.pps_pic_parameter_set_id] = newPPS;
+
+  logger().info("PPS -> " + toString(this->arrangement) + " of " +
+                std::to_string(tiles.grid.nrColumns()) + "x" +
+                std::to_string(tiles.grid.nrRows()) + " tiles");
+  this->tilesPerPPS[newPPS.pps_pic_parameter_set_id] = std::move(tiles);
+}
+
+void TileRearranger::addSliceSegment(NalUnitHEVC &&nal)
+{
+  const auto slice  = dynamic_cast<slice_segment_layer_rbsp *>(nal.rbsp.get());
+  auto       header = slice->sliceSegmentHeader;
+
+  const auto &parameterSets = this->parser.getActiveParameterSets();
+  const auto &pps           = parameterSets.ppsMap.at(header.slice_pic_parameter_set_id);
+  const auto &sps           = parameterSets.spsMap.at(pps.pps_seq_parameter_set_id);
+  const auto &tiles         = this->tilesPerPPS.at(header.slice_pic_parameter_set_id);
+  const auto &grid          = tiles.grid;
+
+  const auto address =
+      header.first_slice_segment_in_pic_flag ? uint64_t(0) : header.slice_segment_address;
+  const auto ctbX   = address % sps.PicWidthInCtbsY;
+  const auto ctbY   = address / sps.PicWidthInCtbsY;
+  const auto column = grid.findColumn(ctbX);
+  const auto row    = grid.findRow(ctbY);
+
+  // The tiles are in raster scan in the picture and their slice segments in tile scan. A tile
+  // that does not start with a slice segment is (partly) in the slice segment of another tile.
+  if (header.first_slice_segment_in_pic_flag)
+  {
+    if (this->nrStartedTiles != this->nrTilesInPicture)
+      throw std::runtime_error(SLICE_OVER_MULTIPLE_TILES_ERROR);
+    this->nrStartedTiles   = 0;
+    this->nrTilesInPicture = grid.nrColumns() * grid.nrRows();
+  }
+  const auto tileIndex   = row * grid.nrColumns() + column;
+  const auto startsATile = (ctbX == grid.columnBoundaries.at(column) &&
+                            ctbY == grid.rowBoundaries.at(row));
+  if (startsATile && tileIndex == this->nrStartedTiles)
+    ++this->nrStartedTiles;
+  else if (startsATile || tileIndex + 1 != this->nrStartedTiles)
+    throw std::runtime_error(SLICE_OVER_MULTIPLE_TILES_ERROR);
+
+  // A dependent slice segment takes the header of the slice segment before it. That is another
+  // tile after rearranging.
+  if (startsATile && header.dependent_slice_segment_flag)
+    throw std::runtime_error("A tile starts with a dependent slice segment. Only tiles that start "
+                             "with an independent slice segment can be rearranged.");
+
+  const auto newPosition = tiles.mapping.newPositionPerTile.at(tileIndex);
+  if (!newPosition)
+    return;
+
+  RewrittenSliceSegment sliceSegment;
+  sliceSegment.newTileIndex = *newPosition;
+  {
+    ScopedTimer      timer(getCounter(this->statistics, &InputStatistics::headerRewriteTime));
+    ScopedTraceEvent traceEvent("rewrite", {0});
+    traceEvent.setPOC(header.PicOrderCntVal);
+
+    const auto &newGrid   = tiles.newGrid;
+    const auto  newColumn = *newPosition % newGrid.nrColumns();
+    const auto  newRow    = *newPosition / newGrid.nrColumns();
+    const auto  newCtbX   = newGrid.columnBoundaries.at(newColumn) + ctbX -
+                         grid.columnBoundaries.at(column);
+    const auto newCtbY = newGrid.rowBoundaries.at(newRow) + ctbY - grid.rowBoundaries.at(row);
+
+    const auto &newSPS = this->activeWritingParameterSets.spsMap.at(pps.pps_seq_parameter_set_id);
+    header.slice_segment_address           = newCtbY * newSPS.PicWidthInCtbsY + newCtbX;
+    header.first_slice_segment_in_pic_flag = (header.slice_segment_address == 0);
+
+    parser::SubByteWriter writer;
+    nal.header.write(writer);
+    header.write(writer, nal.header, this->activeWritingParameterSets);
+    sliceSegment.newHeader = writer.finishWritingAndGetData();
+  }
+
+  if (const auto filePath = this->parser.getFileOfLastNalUnit())
+    sliceSegment.originalInFile =
+        FileRange{filePath, this->parser.getFileOffsetOfLastNalUnit(), nal.rawData.size()};
+
+  // The slice data after the header is written unchanged
+  sliceSegment.nrReplacedBytes = slice->sliceSegmentHeader.nrBytesInHeader;
+  sliceSegment.nalData         = std::move(nal.rawData);
+  this->sliceSegmentsOfPicture.push_back(std::move(sliceSegment));
+
+  if (header.first_slice_segment_in_pic_flag && logger().isEnabled(LogLevel::Debug))
+    logger().debug("Rearranged POC " + std::to_string(header.PicOrderCntVal));
+}
+
+void TileRearranger::writeSliceSegmentsOfPicture()
+{
+  if (this->sliceSegmentsOfPicture.empty())
+    return;
+
+  // Within a tile the slice segments stay in their order
+  auto &sliceSegments = this->sliceSegmentsOfPicture;
+  std::stable_sort(sliceSegments.begin(),
+                   sliceSegments.end(),
+                   [](const RewrittenSliceSegment &a, const RewrittenSliceSegment &b)
+                   { return a.newTileIndex < b.newTileIndex; });
+
+  for (const auto &sliceSegment : sliceSegments)
+  {
+    this->output.writeNALUnitWithNewHeader(sliceSegment.newHeader,
+                                           sliceSegment.nalData,
+                                           sliceSegment.nrReplacedBytes,
+                                           sliceSegment.originalInFile);
+    addToCounter(getCounter(this->statistics, &InputStatistics::bytesWritten),
+                 sliceSegment.newHeader.size() + sliceSegment.nalData.size() -
+                     sliceSegment.nrReplacedBytes + 4);
+  }
+
+  sliceSegments.clear();
+  ++this->nrPictures;
+}
+
+} // namespace combiner
@@ -0,0 +1,95 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+
+#include <File/NalUnitSink.h>
+#include <File/NalUnitSource.h>
+#include <HEVC/NalUnitHEVC.h>
+#include <HEVC/ParserAnnexBHEVC.h>
+#include <HEVC/commonMaps.h>
+#include <common/PipelineStatistics.h>
+
+#include "TileGrid.h"
+
+#include <map>
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace combiner
+{
+
+/* Rearranges the tiles of a tiled stream without re-encoding: A rectangle of tiles is extracted
+ * into a standalone stream (the inverse of combining) or all tiles are laid out in a new grid.
+ * Nothing is decoded. The slice data is copied unchanged and only the parameter sets and slice
+ * segment headers are rewritten: The SPS gets the size of the new picture, the PPS the new tile
+ * grid and the slice segment addresses are moved to the new position of their tile. The slice
+ * segments of a picture are reordered into the tile scan of the new grid. The entry points stay
+ * valid because every slice segment stays within its tile.
+ * Every tile must start with an independent slice segment (no slice segments over multiple tiles).
+ * The rearranged stream is never filtered across tile boundaries. So the tiles only decode like in
+ * the original stream if they are motion constrained and were not filtered across tile boundaries
+ * either. The tiles of a combined stream decode like the original inputs.
+ */
+class TileRearranger
+{
+public:
+  TileRearranger(std::unique_ptr<NalUnitSource> &&input,
+                 NalUnitSink                     &output,
+                 const TileArrangement           &arrangement,
+                 PipelineStatistics              *statistics = nullptr);
+
+private:
+  void rearrangeTiles();
+
+  // A PPS of the input that refers to the SPS and that was already written
+  const parser::hevc::pic_parameter_set_rbsp *findWrittenPPSForSPS(const uint64_t spsID) const;
+
+  // The size of the SPS depends on the tiles of the PPS. It is written with the first PPS that
+  // refers to it (or right away if such a PPS was already written).
+  void writeSPS(const parser::hevc::nal_unit_header        &header,
+                const parser::hevc::seq_parameter_set_rbsp &sps,
+                const parser::hevc::pic_parameter_set_rbsp &pps);
+  void writePPS(const parser::hevc::NalUnitHEVC &nal);
+  // Slice segments of tiles without a new position are dropped. The others are kept until all
+  // slice segments of the picture are known.
+  void addSliceSegment(parser::hevc::NalUnitHEVC &&nal);
+  void writeSliceSegmentsOfPicture();
+
+  parser::hevc::ParserAnnexBHEVC parser;
+  NalUnitSink                   &output;
+  TileArrangement                arrangement{};
+  InputStatistics               *statistics{};
+
+  struct TilesOfPPS
+  {
+    TileGrid    grid;
+    TileMapping mapping;
+    TileGrid    newGrid;
+  };
+
+  std::map<uint64_t, parser::hevc::nal_unit_header> spsWaitingForPPS;
+  std::map<uint64_t, TilesOfPPS>                    tilesPerPPS;
+  parser::hevc::ActiveParameterSets                 activeWritingParameterSets{};
+
+  struct RewrittenSliceSegment
+  {
+    size_t                   newTileIndex{};
+    ByteVector               newHeader;
+    ByteVector               nalData;
+    size_t                   nrReplacedBytes{};
+    std::optional<FileRange> originalInFile;
+  };
+  std::vector<RewrittenSliceSegment> sliceSegmentsOfPicture;
+
+  // The tiles of the current picture in tile scan order that started with a slice segment
+  size_t nrStartedTiles{};
+  size_t nrTilesInPicture{};
+  size_t nrPictures{};
+};
+
+} // namespace combiner
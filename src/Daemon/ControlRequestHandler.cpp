@@ -0,0 +1,164 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include "ControlRequestHandler.h"
+
+#include <Combiner/ChunkedCombiner.h>
+#include <Combiner/Combiner.h>
+#include <Combiner/Pipeline.h>
+#include <Combiner/TileRearranger.h>
+#include <File/StoppableSource.h>
+#include <common/JSONObject.h>
+
+#include <stdexcept>
+
+namespace combiner
+{
+
+Settings parseJobArguments(const std::vector<std::string> &arguments)
+{
+  std::vector<const char *> argv = {"bitstreamCombiner"};
+  for (const auto &argument : arguments)
+    argv.push_back(argument.c_str());
+
+  const auto settings = parseCommandLineArguments(static_cast<int>(argv.size()), argv.data());
+  if (settings.logLevel)
+    throw std::invalid_argument("The log level can only be set for the whole daemon");
+  if (settings.writeIndex || settings.replayRTPDestination || settings.daemonSocket ||
+      settings.controlSocket || settings.statisticsFile || settings.traceFile)
+    throw std::invalid_argument("Only the options of a combination can be used for a job");
+  const auto nrInputs = settings.inputFiles.size();
+  if (!settings.outputFile || (nrInputs != 1 && nrInputs != 2 && nrInputs != 4))
+    throw std::invalid_argument("A job needs 1, 2 or 4 inputs and an output");
+  if (settings.tileArrangement && nrInputs != 1)
+    throw std::invalid_argument("A job that rearranges tiles needs exactly one input");
+  return settings;
+}
+
+void runJob(const Settings          &settings,
+            PipelineStatistics      &statistics,
+            const std::atomic<bool> &stopRequested,
+            InputSwitcher           *inputSwitcher)
+{
+  std::vector<std::unique_ptr<NalUnitSource>> fileSources;
+  if (settings.nrThreads == 1)
+    for (const auto &file : settings.inputFiles)
+      fileSources.push_back(openInputFile(file, settings.readRange));
+
+  auto output = openOutputs(settings, &statistics);
+  if (settings.tileArrangement)
+    TileRearranger rearranger(
+        std::make_unique<StoppableSource>(std::move(fileSources.front()), stopRequested),
+        *output,
+        *settings.tileArrangement,
+        &statistics);
+  else if (settings.nrThreads > 1)
+    ChunkedCombiner combiner(settings.inputFiles,
+                             *output,
+                             settings.nrThreads,
+                             &statistics,
+                             settings.highestTemporalId,
+                             &stopRequested);
+  else
+    Combiner combiner(std::move(fileSources),
+                      *output,
+                      &statistics,
+                      inputSwitcher,
+                      settings.skipTileTimeout,
+                      loadSlates(settings.slateFiles),
+                      settings.highestTemporalId,
+                      &stopRequested);
+  output->finish();
+}
+
+ControlRequestHandler::ControlRequestHandler(JobManager &jobManager, std::function<void()> shutdown)
+    : jobManager(jobManager), shutdown(std::move(shutdown))
+{
+}
+
+std::string ControlRequestHandler::handleRequest(const std::string &request)
+{
+  // The inputs of a job that ended (or that is not known anymore) can not be switched
+  for (auto job = this->switchableJobs.begin(); job != this->switchableJobs.end();)
+  {
+    const auto state = this->jobManager.getJobState(job->first);
+    if (state == JobState::Queued || state == JobState::Running)
+      ++job;
+    else
+      job = this->switchableJobs.erase(job);
+  }
+
+  JSONObject response;
+  response.setBool("ok", true);
+  try
+  {
+    const auto object  = JSONObject::parse(request);
+    const auto command = object.getString("command").value_or("");
+    const auto jobID   = object.getNumber("job");
+    if (command == "start")
+    {
+      const auto arguments = object.getStringArray("arguments");
+      const auto settings  = parseJobArguments(arguments);
+
+      std::string description;
+      for (const auto &argument : arguments)
+        description += (description.empty() ? "" : " ") + argument;
+      std::shared_ptr<InputSwitcher> inputSwitcher;
+      if (settings.nrThreads == 1)
+        inputSwitcher = std::make_shared<InputSwitcher>();
+      const auto id = this->jobManager.addJob(
+          description,
+          settings.inputFiles.size(),
+          1 + settings.additionalOutputFiles.size(),
+          [settings, inputSwitcher](PipelineStatistics      &statistics,
+                                    const std::atomic<bool> &stopRequested) {
+            runJob(settings, statistics, stopRequested, inputSwitcher.get());
+          });
+      if (inputSwitcher)
+        this->switchableJobs[id] = {inputSwitcher, settings.inputFiles.size()};
+      response.setNumber("job", static_cast<double>(id));
+    }
+    else if (command == "switch")
+    {
+      const auto inputIndex = object.getNumber("input");
+      const auto file       = object.getString("file");
+      if (!jobID || !inputIndex || !file)
+        throw std::invalid_argument("A switch needs a job, an input and a file");
+      const auto job = this->switchableJobs.find(static_cast<uint64_t>(*jobID));
+      if (job == this->switchableJobs.end())
+        throw std::invalid_argument("There is no such running job that can switch inputs");
+      if (*inputIndex < 0 || *inputIndex >= job->second.nrInputs)
+        throw std::invalid_argument("The job has no such input");
+
+      job->second.inputSwitcher->replaceInput(static_cast<size_t>(*inputIndex),
+                                              openInputFile(*file, {}));
+    }
+    else if (command == "stop")
+    {
+      if (!jobID || !this->jobManager.stopJob(static_cast<uint64_t>(*jobID)))
+        throw std::invalid_argument("There is no such job");
+    }
+    else if (command == "status")
+    {
+      if (jobID)
+        response.setJSON("job", this->jobManager.getStatusJSON(static_cast<uint64_t>(*jobID)));
+      else
+        response.setJSON("jobs", this->jobManager.getStatusJSON());
+    }
+    else if (command == "shutdown")
+      this->shutdown();
+    else
+      throw std::invalid_argument("Unknown command " + command);
+  }
+  catch (const std::exception &e)
+  {
+    response = {};
+    response.setBool("ok", false).setString("error", e.what());
+  }
+  return response.toString();
+}
+
+} // namespace combiner
@@ -0,0 +1,68 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+
+#include <Combiner/InputSwitcher.h>
+#include <Combiner/Settings.h>
+#include <common/PipelineStatistics.h>
+
+#include "JobManager.h"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace combiner
+{
+
+/* The settings of a daemon job are given as the arguments of a combination. Options that apply to
+ * the whole process (like the log level, statistics or tracing) can not be given per job.
+ * Throws std::invalid_argument if the arguments are not a valid job.
+ */
+Settings parseJobArguments(const std::vector<std::string> &arguments);
+
+// The combination of a daemon job. When the job is stopped, its inputs end, so that the
+// combination ends and the output is finished. The inputs can be switched (not with chunks).
+void runJob(const Settings          &settings,
+            PipelineStatistics      &statistics,
+            const std::atomic<bool> &stopRequested,
+            InputSwitcher           *inputSwitcher);
+
+/* Handles the requests on the control socket of the daemon (see ControlServer). Each request is
+ * a JSON object with a command:
+ *   {"command": "start", "arguments": [...]} starts a job with the given arguments
+ *   {"command": "switch", "job": 1, "input": 0, "file": "..."} switches an input of a running job
+ *   {"command": "stop", "job": 1} stops (or removes the queued) job
+ *   {"command": "status"} or {"command": "status", "job": 1} returns the state of the job(s)
+ *   {"command": "shutdown"} stops the daemon
+ * The response is a JSON object with "ok" (and "error" if the request failed).
+ */
+class ControlRequestHandler
+{
+public:
+  ControlRequestHandler(JobManager &jobManager, std::function<void()> shutdown);
+
+  std::string handleRequest(const std::string &request);
+
+private:
+  // The inputs of a running job can be switched (not with chunks on multiple threads)
+  struct SwitchableJob
+  {
+    std::shared_ptr<InputSwitcher> inputSwitcher;
+    size_t                         nrInputs{};
+  };
+
+  JobManager                       &jobManager;
+  std::function<void()>             shutdown;
+  std::map<uint64_t, SwitchableJob> switchableJobs;
+};
+
+} // namespace combiner
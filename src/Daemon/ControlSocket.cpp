@@ -0,0 +1,249 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include "ControlSocket.h"
+
+#include <common/Logger.h>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace combiner
+{
+
+#ifdef _WIN32
+
+ControlServer::ControlServer(const std::filesystem::path &)
+{
+  throw std::runtime_error("The control socket is not supported on Windows");
+}
+
+ControlServer::~ControlServer() = default;
+
+void ControlServer::run(const RequestHandler &)
+{
+  throw std::runtime_error("The control socket is not supported on Windows");
+}
+
+void ControlServer::stop()
+{
+}
+
+void ControlServer::serveConnection(const int, const RequestHandler &)
+{
+}
+
+std::string sendControlRequest(const std::filesystem::path &, const std::string &)
+{
+  throw std::runtime_error("The control socket is not supported on Windows");
+}
+
+#else
+
+namespace
+{
+
+// How often the server checks if it was stopped while waiting for clients or requests
+constexpr int POLL_INTERVAL_MS = 200;
+
+// A client that disconnects must not kill the daemon with SIGPIPE
+#ifdef MSG_NOSIGNAL
+constexpr int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+constexpr int SEND_FLAGS = 0;
+#endif
+
+// A client that does not send a complete request for this long is disconnected
+constexpr int REQUEST_TIMEOUT_MS = 10'000;
+
+std::string getErrorString()
+{
+  return std::string(std::strerror(errno));
+}
+
+sockaddr_un getSocketAddress(const std::filesystem::path &socketPath)
+{
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  const auto path    = socketPath.string();
+  if (path.size() >= sizeof(address.sun_path))
+    throw std::invalid_argument("The socket path " + path + " is too long");
+  std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+  return address;
+}
+
+void sendAll(const int fileDescriptor, const std::string &data)
+{
+  size_t position = 0;
+  while (position < data.size())
+  {
+    const auto sent =
+        ::send(fileDescriptor, data.data() + position, data.size() - position, SEND_FLAGS);
+    if (sent < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      throw std::runtime_error("Error sending on the control socket: " + getErrorString());
+    }
+    position += static_cast<size_t>(sent);
+  }
+}
+
+} // namespace
+
+ControlServer::ControlServer(const std::filesystem::path &socketPath) : socketPath(socketPath)
+{
+  const auto address = getSocketAddress(socketPath);
+
+  this->fileDescriptor = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (this->fileDescriptor < 0)
+    throw std::runtime_error("Unable to open the control socket: " + getErrorString());
+
+  std::error_code error;
+  if (std::filesystem::is_socket(socketPath, error))
+    std::filesystem::remove(socketPath, error);
+
+  const auto socketAddress = reinterpret_cast<const sockaddr *>(&address);
+  if (::bind(this->fileDescriptor, socketAddress, sizeof(address)) != 0 ||
+      ::listen(this->fileDescriptor, 16) != 0)
+  {
+    const auto message = getErrorString();
+    ::close(this->fileDescriptor);
+    throw std::runtime_error("Unable to listen on the control socket " + socketPath.string() +
+                             ": " + message);
+  }
+}
+
+ControlServer::~ControlServer()
+{
+  ::close(this->fileDescriptor);
+  std::error_code error;
+  std::filesystem::remove(this->socketPath, error);
+}
+
+void ControlServer::run(const RequestHandler &handler)
+{
+  while (!this->stopRequested)
+  {
+    pollfd     pollDescriptor{this->fileDescriptor, POLLIN, 0};
+    const auto result = ::poll(&pollDescriptor, 1, POLL_INTERVAL_MS);
+    if (result < 0 && errno != EINTR)
+      throw std::runtime_error("Error waiting on the control socket: " + getErrorString());
+    if (result <= 0)
+      continue;
+
+    const auto connection = ::accept(this->fileDescriptor, nullptr, nullptr);
+    if (connection < 0)
+      continue;
+    try
+    {
+      this->serveConnection(connection, handler);
+    }
+    catch (const std::exception &e)
+    {
+      logger().warning("Control connection closed: " + std::string(e.what()));
+    }
+    ::close(connection);
+  }
+}
+
+void ControlServer::stop()
+{
+  this->stopRequested = true;
+}
+
+void ControlServer::serveConnection(const int connection, const RequestHandler &handler)
+{
+  std::string received;
+  int         waitedMs = 0;
+  while (!this->stopRequested)
+  {
+    // Answer all complete requests that were received so far
+    size_t lineEnd;
+    while ((lineEnd = received.find('\n')) != std::string::npos)
+    {
+      const auto request = received.substr(0, lineEnd);
+      received.erase(0, lineEnd + 1);
+      sendAll(connection, handler(request) + "\n");
+      waitedMs = 0;
+    }
+
+    pollfd     pollDescriptor{connection, POLLIN, 0};
+    const auto result = ::poll(&pollDescriptor, 1, POLL_INTERVAL_MS);
+    if (result < 0 && errno != EINTR)
+      throw std::runtime_error("Error waiting for a request: " + getErrorString());
+    if (result <= 0)
+    {
+      waitedMs += POLL_INTERVAL_MS;
+      if (waitedMs >= REQUEST_TIMEOUT_MS)
+        throw std::runtime_error("Timeout waiting for a request");
+      continue;
+    }
+
+    char       buffer[4096];
+    const auto size = ::recv(connection, buffer, sizeof(buffer), 0);
+    if (size == 0)
+      return;
+    if (size < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      throw std::runtime_error("Error receiving a request: " + getErrorString());
+    }
+    received.append(buffer, static_cast<size_t>(size));
+  }
+}
+
+std::string sendControlRequest(const std::filesystem::path &socketPath, const std::string &request)
+{
+  const auto address = getSocketAddress(socketPath);
+
+  const auto fileDescriptor = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fileDescriptor < 0)
+    throw std::runtime_error("Unable to open a socket: " + getErrorString());
+  if (::connect(fileDescriptor, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0)
+  {
+    const auto message = getErrorString();
+    ::close(fileDescriptor);
+    throw std::runtime_error("Unable to connect to the control socket " + socketPath.string() +
+                             ": " + message);
+  }
+
+  std::string response;
+  try
+  {
+    sendAll(fileDescriptor, request + "\n");
+    while (response.find('\n') == std::string::npos)
+    {
+      char       buffer[4096];
+      const auto size = ::recv(fileDescriptor, buffer, sizeof(buffer), 0);
+      if (size < 0 && errno == EINTR)
+        continue;
+      if (size <= 0)
+        throw std::runtime_error("The daemon closed the connection without a response");
+      response.append(buffer, static_cast<size_t>(size));
+    }
+  }
+  catch (...)
+  {
+    ::close(fileDescriptor);
+    throw;
+  }
+  ::close(fileDescriptor);
+  return response.substr(0, response.find('\n'));
+}
+
+#endif
+
+} // namespace combiner
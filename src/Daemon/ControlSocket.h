@@ -0,0 +1,50 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <filesystem>
+#include <functional>
+#include <string>
+
+namespace combiner
+{
+
+/* A Unix domain socket on which a daemon is controlled locally. Each request is one line of text
+ * (a JSON object) and is answered with one line. Clients are served one after another and can
+ * send multiple requests over one connection.
+ * Unix domain sockets are currently only supported on POSIX systems.
+ */
+class ControlServer
+{
+public:
+  // Gets a request (without the line break) and returns the response
+  using RequestHandler = std::function<std::string(const std::string &request)>;
+
+  // A socket file that is left over from a daemon that did not exit cleanly is replaced
+  ControlServer(const std::filesystem::path &socketPath);
+  ~ControlServer();
+
+  ControlServer(const ControlServer &)            = delete;
+  ControlServer &operator=(const ControlServer &) = delete;
+
+  // Serve requests until stop is called (which may also happen in the handler)
+  void run(const RequestHandler &handler);
+  void stop();
+
+private:
+  void serveConnection(const int connection, const RequestHandler &handler);
+
+  std::filesystem::path socketPath;
+  int                   fileDescriptor{-1};
+  std::atomic<bool>     stopRequested{};
+};
+
+// Connect to the control socket, send one request and return the response (without line break).
+std::string sendControlRequest(const std::filesystem::path &socketPath, const std::string &request);
+
+} // namespace combiner
@@ -0,0 +1,240 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include "JobManager.h"
+
+#include <common/JSONObject.h>
+#include <common/Logger.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace combiner
+{
+
+namespace
+{
+
+std::string toString(const JobState state)
+{
+  switch (state)
+  {
+  case JobState::Queued:
+    return "queued";
+  case JobState::Running:
+    return "running";
+  case JobState::Finished:
+    return "finished";
+  case JobState::Failed:
+    return "failed";
+  case JobState::Stopped:
+    return "stopped";
+  }
+  return "unknown";
+}
+
+// The control socket protocol has one JSON object per line
+std::string removeLineBreaks(const std::string &json)
+{
+  std::string result;
+  result.reserve(json.size());
+  bool afterLineBreak = false;
+  for (const auto character : json)
+  {
+    if (character == '\n')
+      afterLineBreak = true;
+    else if (!afterLineBreak || character != ' ')
+    {
+      result += character;
+      afterLineBreak = false;
+    }
+  }
+  return result;
+}
+
+} // namespace
+
+JobManager::JobManager(const unsigned nrThreads, const size_t maxEndedJobs)
+    : maxEndedJobs(maxEndedJobs)
+{
+  if (nrThreads == 0)
+    throw std::invalid_argument("At least one worker thread is needed to run jobs");
+  for (unsigned i = 0; i < nrThreads; ++i)
+    this->workerThreads.emplace_back(&JobManager::runWorkerThread, this);
+}
+
+JobManager::~JobManager()
+{
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->shutdown = true;
+    for (auto &job : this->queuedJobs)
+      job->state = JobState::Stopped;
+    this->queuedJobs.clear();
+    for (auto &[id, job] : this->jobs)
+      job->stopRequested = true;
+  }
+  this->jobCondition.notify_all();
+  for (auto &thread : this->workerThreads)
+    thread.join();
+}
+
+uint64_t JobManager::addJob(const std::string &description,
+                            const size_t       nrInputs,
+                            const size_t       nrOutputs,
+                            JobFunction      &&function)
+{
+  auto job         = std::make_shared<Job>();
+  job->description = description;
+  job->function    = std::move(function);
+  job->nrInputs    = nrInputs;
+  job->nrOutputs   = nrOutputs;
+
+  uint64_t id{};
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    id      = this->nextJobID++;
+    job->id = id;
+    this->jobs[id] = job;
+    this->queuedJobs.push_back(job);
+  }
+  this->jobCondition.notify_one();
+  logger().info("Added job " + std::to_string(id) + ": " + description);
+  return id;
+}
+
+bool JobManager::stopJob(const uint64_t id)
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+  const auto                  it = this->jobs.find(id);
+  if (it == this->jobs.end())
+    return false;
+
+  auto &job = it->second;
+  if (job->state == JobState::Queued)
+  {
+    job->state = JobState::Stopped;
+    this->queuedJobs.erase(std::remove(this->queuedJobs.begin(), this->queuedJobs.end(), job),
+                           this->queuedJobs.end());
+    this->removeOldEndedJobs();
+  }
+  else if (job->state == JobState::Running)
+    job->stopRequested = true;
+  return true;
+}
+
+std::optional<JobState> JobManager::getJobState(const uint64_t id) const
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+  if (const auto it = this->jobs.find(id); it != this->jobs.end())
+    return it->second->state;
+  return {};
+}
+
+std::string JobManager::getStatusJSON(const std::optional<uint64_t> id) const
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+  if (id)
+  {
+    const auto it = this->jobs.find(*id);
+    if (it == this->jobs.end())
+      throw std::invalid_argument("There is no job " + std::to_string(*id));
+    return this->getJobJSON(*it->second);
+  }
+
+  std::string json = "[";
+  for (const auto &[jobID, job] : this->jobs)
+  {
+    if (json.size() > 1)
+      json += ", ";
+    json += this->getJobJSON(*job);
+  }
+  return json + "]";
+}
+
+std::string JobManager::getJobJSON(const Job &job) const
+{
+  JSONObject object;
+  object.setNumber("job", static_cast<double>(job.id))
+      .setString("state", toString(job.state))
+      .setString("description", job.description);
+  if (job.state == JobState::Failed)
+    object.setString("error", job.error);
+  if (job.statistics)
+    object.setJSON("statistics", removeLineBreaks(job.statistics->toJSON()));
+  return object.toString();
+}
+
+void JobManager::removeOldEndedJobs()
+{
+  size_t nrEndedJobs = 0;
+  for (const auto &[id, job] : this->jobs)
+    if (job->state != JobState::Queued && job->state != JobState::Running)
+      ++nrEndedJobs;
+
+  // The IDs increase, so the oldest jobs come first
+  auto it = this->jobs.begin();
+  while (nrEndedJobs > this->maxEndedJobs && it != this->jobs.end())
+  {
+    if (it->second->state == JobState::Queued || it->second->state == JobState::Running)
+    {
+      ++it;
+      continue;
+    }
+    it = this->jobs.erase(it);
+    --nrEndedJobs;
+  }
+}
+
+void JobManager::runWorkerThread()
+{
+  while (true)
+  {
+    std::shared_ptr<Job> job;
+    {
+      std::unique_lock<std::mutex> lock(this->mutex);
+      this->jobCondition.wait(
+          lock, [this]() { return this->shutdown || !this->queuedJobs.empty(); });
+      if (this->shutdown)
+        return;
+      job = this->queuedJobs.front();
+      this->queuedJobs.pop_front();
+      job->state      = JobState::Running;
+      job->statistics = std::make_unique<PipelineStatistics>(job->nrInputs, job->nrOutputs);
+    }
+
+    logger().info("Starting job " + std::to_string(job->id));
+    auto        state = JobState::Finished;
+    std::string error;
+    try
+    {
+      job->function(*job->statistics, job->stopRequested);
+    }
+    catch (const std::exception &e)
+    {
+      state = JobState::Failed;
+      error = e.what();
+    }
+    if (job->stopRequested)
+      state = JobState::Stopped;
+
+    {
+      std::lock_guard<std::mutex> lock(this->mutex);
+      job->state = state;
+      job->error = error;
+      // The work is done. Release what the function holds (e.g. open files).
+      job->function = {};
+      this->removeOldEndedJobs();
+    }
+    const auto message = "Job " + std::to_string(job->id) + " " + toString(state);
+    if (state == JobState::Failed)
+      logger().warning(message + ": " + error);
+    else
+      logger().info(message);
+  }
+}
+
+} // namespace combiner
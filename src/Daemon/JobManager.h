@@ -0,0 +1,99 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+
+#include <common/PipelineStatistics.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace combiner
+{
+
+enum class JobState
+{
+  Queued,
+  Running,
+  Finished,
+  Failed,
+  Stopped
+};
+
+// The work of a job. It has to return soon after a stop was requested (see StoppableSource).
+using JobFunction =
+    std::function<void(PipelineStatistics &statistics, const std::atomic<bool> &stopRequested)>;
+
+/* Runs jobs on a fixed number of worker threads that are started once and reused for all jobs.
+ * Jobs that are added while all threads are busy wait in a queue. Each job counts into its own
+ * statistics, which can be queried (together with the state of the job) while it is running.
+ * Jobs that ended are kept so that their final state can still be queried. Only the given number
+ * of them is kept. The oldest ones are removed first.
+ */
+class JobManager
+{
+public:
+  JobManager(const unsigned nrThreads, const size_t maxEndedJobs = 100);
+  // Stops all jobs and waits for the worker threads
+  ~JobManager();
+
+  JobManager(const JobManager &)            = delete;
+  JobManager &operator=(const JobManager &) = delete;
+
+  // Returns the ID of the new job. Its statistics count the given number of inputs and outputs.
+  uint64_t addJob(const std::string &description,
+                  const size_t       nrInputs,
+                  const size_t       nrOutputs,
+                  JobFunction      &&function);
+  // Queued jobs are removed, running jobs are asked to stop. False if there is no such job.
+  bool stopJob(const uint64_t id);
+
+  std::optional<JobState> getJobState(const uint64_t id) const;
+  // The state, description and statistics of one job (or of all jobs as an array) in JSON.
+  // Throws std::invalid_argument if there is no such job.
+  std::string getStatusJSON(const std::optional<uint64_t> id = {}) const;
+
+private:
+  struct Job
+  {
+    uint64_t                            id{};
+    std::string                         description;
+    JobFunction                         function;
+    size_t                              nrInputs{};
+    size_t                              nrOutputs{};
+    // Created when the job starts
+    std::unique_ptr<PipelineStatistics> statistics;
+    std::atomic<bool>                   stopRequested{};
+    JobState                            state{JobState::Queued};
+    std::string                         error;
+  };
+
+  void        runWorkerThread();
+  std::string getJobJSON(const Job &job) const;
+  // Must be called with the mutex locked
+  void removeOldEndedJobs();
+
+  mutable std::mutex                       mutex;
+  std::condition_variable                  jobCondition;
+  std::deque<std::shared_ptr<Job>>         queuedJobs;
+  std::map<uint64_t, std::shared_ptr<Job>> jobs;
+  size_t                                   maxEndedJobs{};
+  uint64_t                                 nextJobID{1};
+  bool                                     shutdown{};
+  std::vector<std::thread>                 workerThreads;
+};
+
+} // namespace combiner
@@ -0,0 +1,337 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include "FanOutSink.h"
+
+#include <HEVC/nal_unit_header.h>
+
+#include <common/Logger.h>
+#include <common/Tracer.h>
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+namespace combiner
+{
+
+namespace
+{
+
+using parser::hevc::nal_unit_header;
+using parser::hevc::NalType;
+
+// The NAL unit header and the first_slice_segment_in_pic_flag of slices
+constexpr size_t NR_START_BYTES = 3;
+
+// The first_slice_segment_in_pic_flag is the first bit after the NAL unit header
+bool isFirstSliceOfPicture(const nal_unit_header &header, const ByteVector &nalData)
+{
+  return header.isSlice() && nalData.size() > 2 && (nalData.at(2) & 0x80);
+}
+
+} // namespace
+
+FanOutSink::FanOutSink(const size_t maxQueuedNalUnits) : maxQueuedNalUnits(maxQueuedNalUnits)
+{
+  if (this->maxQueuedNalUnits == 0)
+    throw std::invalid_argument("The queue of the outputs can not be empty");
+}
+
+FanOutSink::~FanOutSink()
+{
+  // Without finish (e.g. after an error), what is still queued is not written anymore
+  this->stopWriterThreads(false);
+}
+
+void FanOutSink::addSink(std::unique_ptr<NalUnitSink> &&sink,
+                         const OverflowPolicy           policy,
+                         OutputStatistics              *statistics)
+{
+  auto output        = std::make_unique<Output>();
+  output->sink       = std::move(sink);
+  output->policy     = policy;
+  output->index      = this->outputs.size();
+  output->statistics = statistics;
+  output->sink->setStatistics(statistics);
+
+  output->writerThread = std::thread(&FanOutSink::runWriterThread, this, std::ref(*output));
+  this->outputs.push_back(std::move(output));
+}
+
+void FanOutSink::writeNALUnit(const ByteVector &nalData)
+{
+  if (nalData.empty())
+    return;
+  auto nalUnit             = std::make_shared<NalUnit>();
+  nalUnit->originalNalData = nalData;
+  this->writeToOutputs(std::move(nalUnit));
+}
+
+void FanOutSink::writeNALUnitWithNewHeader(const ByteVector               &newHeader,
+                                           const ByteVector               &originalNalData,
+                                           const size_t                    nrReplacedBytes,
+                                           const std::optional<FileRange> &originalInFile)
+{
+  if (newHeader.empty() && nrReplacedBytes == 0 && !originalInFile)
+  {
+    this->writeNALUnit(originalNalData);
+    return;
+  }
+
+  auto nalUnit             = std::make_shared<NalUnit>();
+  nalUnit->originalNalData = originalNalData;
+  nalUnit->newHeader       = newHeader;
+  nalUnit->nrReplacedBytes = nrReplacedBytes;
+  if (originalInFile)
+  {
+    nalUnit->inputFilePath  = *originalInFile->filePath;
+    nalUnit->originalInFile = FileRange{
+        &nalUnit->inputFilePath, originalInFile->offset, originalInFile->size};
+  }
+  this->writeToOutputs(std::move(nalUnit));
+}
+
+void FanOutSink::writeToOutputs(std::shared_ptr<const NalUnit> &&nalUnit)
+{
+  this->throwIfAnyOutputFailed();
+
+  // The first bytes of the NAL unit as it is written
+  const auto &original = nalUnit->originalNalData;
+  const auto  end      = std::min(original.size(), nalUnit->nrReplacedBytes + NR_START_BYTES);
+  auto        start    = nalUnit->newHeader;
+  if (nalUnit->nrReplacedBytes < end)
+    start.insert(start.end(),
+                 original.begin() + static_cast<std::ptrdiff_t>(nalUnit->nrReplacedBytes),
+                 original.begin() + static_cast<std::ptrdiff_t>(end));
+  if (start.empty())
+    return;
+
+  const auto header = nal_unit_header::fromNalData(start);
+  const auto item   = Item{std::move(nalUnit), {}};
+  if (header.isParameterSet())
+    this->lastParameterSets.at(static_cast<size_t>(header.nal_unit_type) -
+                               static_cast<size_t>(NalType::VPS_NUT)) = item;
+
+  ItemType type;
+  type.isVCL                 = header.isVCL();
+  type.isIRAP                = header.isIRAP();
+  type.isFirstSliceOfPicture = isFirstSliceOfPicture(header, start);
+  type.isCRA                 = (header.nal_unit_type == NalType::CRA_NUT);
+  type.isRASL                = header.isRASL();
+  type.isLeading             = header.isRASL() || header.isRADL();
+  type.isSuffix              = (header.nal_unit_type == NalType::SUFFIX_SEI_NUT ||
+                                header.nal_unit_type == NalType::FD_NUT);
+  for (auto &output : this->outputs)
+    this->write(*output, item, type);
+}
+
+void FanOutSink::setTimestampsOfNextNALUnits(const Timestamps &timestamps)
+{
+  this->throwIfAnyOutputFailed();
+
+  this->lastTimestamps = timestamps;
+  for (auto &output : this->outputs)
+    this->write(*output, Item{{}, timestamps}, {});
+}
+
+void FanOutSink::finish()
+{
+  for (auto &output : this->outputs)
+    this->pushHeldBackItems(*output);
+  this->stopWriterThreads(true);
+  this->throwIfAnyOutputFailed();
+}
+
+// Drops the RASL pictures after the CRA picture at which a dropping output continued (and what
+// belongs to them). Everything else goes on to the queue of the output.
+void FanOutSink::write(Output &output, const Item &item, const ItemType &type)
+{
+  if (!output.droppingRASLPictures)
+  {
+    this->push(output, item, type);
+    return;
+  }
+
+  if (!type.isVCL)
+  {
+    if (type.isSuffix && output.lastPictureWasDropped)
+      this->drop(output, item, type);
+    else
+      output.heldBackItems.push_back({item, type});
+    return;
+  }
+  if (type.isRASL)
+  {
+    for (const auto &[heldBackItem, heldBackType] : output.heldBackItems)
+      this->drop(output, heldBackItem, heldBackType);
+    output.heldBackItems.clear();
+    this->drop(output, item, type);
+    output.lastPictureWasDropped = true;
+    return;
+  }
+
+  if (!type.isLeading)
+  {
+    if (output.nrDroppedNalUnits > 0)
+      logger().info("Output " + std::to_string(output.index) + " dropped " +
+                    std::to_string(output.nrDroppedNalUnits) +
+                    " NAL units of RASL pictures after the CRA picture it continued at.");
+    output.droppingRASLPictures = false;
+    output.nrDroppedNalUnits    = 0;
+  }
+  output.lastPictureWasDropped = false;
+  this->pushHeldBackItems(output);
+  this->push(output, item, type);
+}
+
+void FanOutSink::pushHeldBackItems(Output &output)
+{
+  for (const auto &[heldBackItem, type] : output.heldBackItems)
+    this->push(output, heldBackItem, type);
+  output.heldBackItems.clear();
+}
+
+void FanOutSink::push(Output &output, const Item &item, const ItemType &type)
+{
+  std::unique_lock<std::mutex> lock(output.mutex);
+  if (output.error)
+    return;
+
+  if (output.policy == OverflowPolicy::Wait)
+  {
+    if (output.queue.size() >= this->maxQueuedNalUnits)
+    {
+      ScopedTraceEvent traceEvent("fan out wait");
+      output.condition.wait(lock, [this, &output]() {
+        return output.queue.size() < this->maxQueuedNalUnits || output.error;
+      });
+    }
+  }
+  else if (output.dropping)
+  {
+    // Continue at an IRAP picture once there is room for it and the parameter sets before it
+    const auto nrItemsToContinue = 1 + this->lastParameterSets.size() + 1;
+    if (!type.isIRAP || !type.isFirstSliceOfPicture ||
+        output.queue.size() + nrItemsToContinue > this->maxQueuedNalUnits)
+    {
+      this->drop(output, item, type);
+      return;
+    }
+
+    logger().info("Output " + std::to_string(output.index) + " continues at an IRAP picture " +
+                  "after dropping " + std::to_string(output.nrDroppedNalUnits) + " NAL units.");
+    output.dropping             = false;
+    output.nrDroppedNalUnits    = 0;
+    output.droppingRASLPictures = type.isCRA;
+    if (this->lastTimestamps)
+      output.queue.push_back(Item{{}, this->lastTimestamps});
+    for (const auto &parameterSet : this->lastParameterSets)
+      if (parameterSet.nalUnit)
+        output.queue.push_back(parameterSet);
+  }
+  else if (output.queue.size() >= this->maxQueuedNalUnits)
+  {
+    logger().warning("Output " + std::to_string(output.index) +
+                     " can not keep up. Dropping NAL units until the next IRAP picture.");
+    output.dropping = true;
+    this->drop(output, item, type);
+    return;
+  }
+
+  output.queue.push_back(item);
+  setCounter(getCounter(output.statistics, &OutputStatistics::queueDepth), output.queue.size());
+  lock.unlock();
+  output.condition.notify_all();
+}
+
+void FanOutSink::drop(Output &output, const Item &item, const ItemType &type)
+{
+  if (!item.nalUnit)
+    return;
+  ++output.nrDroppedNalUnits;
+  addToCounter(getCounter(output.statistics, &OutputStatistics::nrDroppedNalUnits), 1);
+  if (type.isFirstSliceOfPicture)
+    addToCounter(getCounter(output.statistics, &OutputStatistics::nrDroppedPictures), 1);
+}
+
+void FanOutSink::runWriterThread(Output &output)
+{
+  try
+  {
+    while (true)
+    {
+      Item item;
+      {
+        std::unique_lock<std::mutex> lock(output.mutex);
+        output.condition.wait(lock, [&output]() { return output.stop || !output.queue.empty(); });
+        if (output.stop && !output.finishOutput)
+          return;
+        if (output.queue.empty())
+          break;
+        item = std::move(output.queue.front());
+        output.queue.pop_front();
+        setCounter(getCounter(output.statistics, &OutputStatistics::queueDepth),
+                   output.queue.size());
+      }
+      output.condition.notify_all();
+
+      if (item.timestamps)
+        output.sink->setTimestampsOfNextNALUnits(*item.timestamps);
+      if (const auto &nalUnit = item.nalUnit)
+      {
+        if (nalUnit->newHeader.empty() && nalUnit->nrReplacedBytes == 0 &&
+            !nalUnit->originalInFile)
+          output.sink->writeNALUnit(nalUnit->originalNalData);
+        else
+          output.sink->writeNALUnitWithNewHeader(nalUnit->newHeader,
+                                                 nalUnit->originalNalData,
+                                                 nalUnit->nrReplacedBytes,
+                                                 nalUnit->originalInFile);
+      }
+    }
+    output.sink->finish();
+  }
+  catch (...)
+  {
+    {
+      std::lock_guard<std::mutex> lock(output.mutex);
+      output.error = std::current_exception();
+      output.queue.clear();
+      setCounter(getCounter(output.statistics, &OutputStatistics::queueDepth), 0);
+    }
+    output.condition.notify_all();
+  }
+}
+
+void FanOutSink::stopWriterThreads(const bool finishOutputs)
+{
+  for (auto &output : this->outputs)
+  {
+    {
+      std::lock_guard<std::mutex> lock(output->mutex);
+      if (!output->stop)
+        output->finishOutput = finishOutputs;
+      output->stop = true;
+    }
+    output->condition.notify_all();
+  }
+  for (auto &output : this->outputs)
+    if (output->writerThread.joinable())
+      output->writerThread.join();
+}
+
+void FanOutSink::throwIfAnyOutputFailed()
+{
+  for (auto &output : this->outputs)
+  {
+    std::lock_guard<std::mutex> lock(output->mutex);
+    if (output->error)
+      std::rethrow_exception(output->error);
+  }
+}
+
+} // namespace combiner
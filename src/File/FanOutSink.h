@@ -0,0 +1,141 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+
+#include "NalUnitSink.h"
+
+#include <array>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace combiner
+{
+
+/* Writes the same NAL units to multiple outputs. Each NAL unit is copied once into a reference
+ * counted buffer that is shared by the queues of all outputs. A NAL unit with a new header is
+ * passed on to the outputs with its range in the input file, so that they can still copy it from
+ * there. Every output has its own bounded
+ * queue and writer thread, so it is written at its own pace.
+ * If the queue of an output is full, the policy of the output decides what happens: Wait blocks
+ * until the output has caught up (for outputs that must be complete, like an archive file).
+ * DropUntilIRAP drops NAL units for this output until the next IRAP picture, so that a slow
+ * output can never stall the others. When it continues, the last VPS, SPS and PPS are sent again
+ * before the IRAP picture. If it continues at a CRA picture, the RASL pictures after it are dropped
+ * as well because they reference pictures from before the CRA that the output did not get.
+ * An error in any output is thrown from the next write (or from finish). Every output counts into
+ * its own statistics, including the depth of its queue and what it dropped.
+ */
+class FanOutSink : public NalUnitSink
+{
+public:
+  enum class OverflowPolicy
+  {
+    Wait,
+    DropUntilIRAP
+  };
+
+  FanOutSink(const size_t maxQueuedNalUnits = 4096);
+  ~FanOutSink();
+
+  FanOutSink(const FanOutSink &)            = delete;
+  FanOutSink &operator=(const FanOutSink &) = delete;
+
+  void addSink(std::unique_ptr<NalUnitSink> &&sink,
+               const OverflowPolicy           policy,
+               OutputStatistics              *statistics = nullptr);
+
+  void writeNALUnit(const ByteVector &nalData) override;
+  void writeNALUnitWithNewHeader(const ByteVector               &newHeader,
+                                 const ByteVector               &originalNalData,
+                                 const size_t                    nrReplacedBytes,
+                                 const std::optional<FileRange> &originalInFile) override;
+  void setTimestampsOfNextNALUnits(const Timestamps &timestamps) override;
+  void finish() override;
+
+private:
+  // The arguments of a write. The file range points to the path that is kept here because the
+  // input (and its path) may be gone before the NAL unit is written. So it is never copied.
+  struct NalUnit
+  {
+    ByteVector               originalNalData;
+    ByteVector               newHeader{};
+    size_t                   nrReplacedBytes{};
+    std::optional<FileRange> originalInFile{};
+    std::filesystem::path    inputFilePath{};
+  };
+
+  // A NAL unit or the timestamps for the NAL units after it
+  struct Item
+  {
+    std::shared_ptr<const NalUnit> nalUnit{};
+    std::optional<Timestamps>      timestamps{};
+  };
+
+  // What an output has to know about an item to decide if it drops it or continues at it
+  struct ItemType
+  {
+    bool isVCL{};
+    bool isIRAP{};
+    bool isFirstSliceOfPicture{};
+    bool isCRA{};
+    bool isRASL{};
+    bool isLeading{};
+    // A NAL unit that belongs to the picture before it (like a suffix SEI)
+    bool isSuffix{};
+  };
+
+  struct Output
+  {
+    std::unique_ptr<NalUnitSink> sink;
+    OverflowPolicy               policy{};
+    size_t                       index{};
+    OutputStatistics            *statistics{};
+
+    std::mutex              mutex;
+    std::condition_variable condition;
+    std::deque<Item>        queue;
+    bool                    stop{};
+    bool                    finishOutput{};
+    std::exception_ptr      error{};
+    std::thread             writerThread;
+
+    // Only used by the thread that writes into the fan out
+    bool     dropping{};
+    uint64_t nrDroppedNalUnits{};
+    // After continuing at a CRA picture, until the first picture that is not a leading picture.
+    // What comes before a slice is held back until the slice shows if it is a RASL picture.
+    bool                                   droppingRASLPictures{};
+    bool                                   lastPictureWasDropped{};
+    std::vector<std::pair<Item, ItemType>> heldBackItems;
+  };
+
+  void writeToOutputs(std::shared_ptr<const NalUnit> &&nalUnit);
+  void write(Output &output, const Item &item, const ItemType &type);
+  void push(Output &output, const Item &item, const ItemType &type);
+  void pushHeldBackItems(Output &output);
+  void drop(Output &output, const Item &item, const ItemType &type);
+  void runWriterThread(Output &output);
+  void stopWriterThreads(const bool finishOutputs);
+  void throwIfAnyOutputFailed();
+
+  size_t                               maxQueuedNalUnits{};
+  std::vector<std::unique_ptr<Output>> outputs;
+
+  // Sent again before the IRAP picture at which a dropping output continues
+  std::array<Item, 3>       lastParameterSets{};
+  std::optional<Timestamps> lastTimestamps{};
+};
+
+} // namespace combiner
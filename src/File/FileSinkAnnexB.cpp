@@ -6,6 +6,8 @@
 
 #include "FileSinkAnnexB.h"
 
+#include <HEVC/nal_unit_header.h>
+
 namespace combiner
 {
 
@@ -22,11 +24,19 @@ void FileSinkAnnexB::writeNALUnit(const ByteVector &nalData)
   if (!this->outputFile.is_open())
     throw std::runtime_error("Output file not open for writing");
 
+  ScopedTimer      timer(getCounter(this->statistics, &OutputStatistics::writeTime));
+  ScopedTraceEvent traceEvent("write");
+  if (nalData.size() > 1)
+    traceEvent.setNalUnitType(parser::hevc::nal_unit_header::fromNalData(nalData).nalUnitTypeID);
+
   this->outputFile.put(0);
   this->outputFile.put(0);
   this->outputFile.put(0);
   this->outputFile.put(1);
   this->outputFile.write(reinterpret_cast<const char *>(nalData.data()), nalData.size());
+
+  addToCounter(getCounter(this->statistics, &OutputStatistics::bytesWritten), nalData.size() + 4);
+  addToCounter(getCounter(this->statistics, &OutputStatistics::nrNalUnits), 1);
 }
 
 } // namespace combiner
@@ -6,7 +6,9 @@
 
 #pragma once
 
-#include <common/Typedef.h>
+#include "NalUnitSink.h"
+
+#include <common/Tracer.h>
 
 #include <filesystem>
 #include <fstream>
@@ -15,14 +17,14 @@
 namespace combiner
 {
 
-class FileSinkAnnexB
+class FileSinkAnnexB : public NalUnitSink
 {
 public:
   FileSinkAnnexB() = default;
   FileSinkAnnexB(const std::filesystem::path &filePath);
 
   // Get the raw data of the NAL unit without the start code
-  void writeNALUnit(const ByteVector &nalData);
+  void writeNALUnit(const ByteVector &nalData) override;
 
 private:
   std::ofstream outputFile{};
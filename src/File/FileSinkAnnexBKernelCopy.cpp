@@ -0,0 +1,127 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include "FileSinkAnnexBKernelCopy.h"
+
+#include <HEVC/nal_unit_header.h>
+#include <common/Tracer.h>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace combiner
+{
+
+namespace
+{
+
+constexpr auto STARTCODE = {uint8_t(0), uint8_t(0), uint8_t(0), uint8_t(1)};
+
+// Ranges below this size are written from memory
+constexpr size_t MIN_KERNEL_COPY_SIZE = 4096;
+
+// The pending data is written once it gets this large (if no copy writes it before)
+constexpr size_t MAX_PENDING_DATA_SIZE = 1024 * 1024;
+
+} // namespace
+
+FileSinkAnnexBKernelCopy::FileSinkAnnexBKernelCopy(const std::filesystem::path &filePath)
+    : outputFile(filePath)
+{
+}
+
+FileSinkAnnexBKernelCopy::~FileSinkAnnexBKernelCopy()
+{
+#ifndef _WIN32
+  for (const auto &[filePath, fileDescriptor] : this->inputFileDescriptors)
+    ::close(fileDescriptor);
+#endif
+}
+
+void FileSinkAnnexBKernelCopy::writeNALUnit(const ByteVector &nalData)
+{
+  this->writeNALUnitWithNewHeader({}, nalData, 0, {});
+}
+
+void FileSinkAnnexBKernelCopy::writeNALUnitWithNewHeader(
+    const ByteVector               &newHeader,
+    const ByteVector               &originalNalData,
+    const size_t                    nrReplacedBytes,
+    const std::optional<FileRange> &originalInFile)
+{
+  ScopedTimer      timer(getCounter(this->statistics, &OutputStatistics::writeTime));
+  ScopedTraceEvent traceEvent("write");
+
+  if (originalNalData.size() > 1)
+    traceEvent.setNalUnitType(
+        parser::hevc::nal_unit_header::fromNalData(originalNalData).nalUnitTypeID);
+
+  auto &pending = this->pendingData;
+  pending.insert(pending.end(), STARTCODE);
+  pending.insert(pending.end(), newHeader.begin(), newHeader.end());
+
+  const auto remainingSize = originalNalData.size() - nrReplacedBytes;
+  const auto nalSize       = newHeader.size() + remainingSize;
+
+#ifndef _WIN32
+  if (originalInFile && remainingSize >= MIN_KERNEL_COPY_SIZE)
+  {
+    this->writePendingData();
+    this->outputFile.copyFromFile(this->getInputFileDescriptor(*originalInFile->filePath),
+                                  originalInFile->offset + nrReplacedBytes,
+                                  remainingSize);
+    addToCounter(getCounter(this->statistics, &OutputStatistics::bytesCopiedFromInputs),
+                 remainingSize);
+  }
+  else
+#endif
+  {
+    pending.insert(pending.end(), originalNalData.begin() + nrReplacedBytes, originalNalData.end());
+    if (pending.size() >= MAX_PENDING_DATA_SIZE)
+      this->writePendingData();
+  }
+
+  addToCounter(getCounter(this->statistics, &OutputStatistics::bytesWritten), nalSize + 4);
+  addToCounter(getCounter(this->statistics, &OutputStatistics::nrNalUnits), 1);
+}
+
+void FileSinkAnnexBKernelCopy::finish()
+{
+  ScopedTimer timer(getCounter(this->statistics, &OutputStatistics::writeTime));
+  this->writePendingData();
+}
+
+void FileSinkAnnexBKernelCopy::writePendingData()
+{
+  if (this->pendingData.empty())
+    return;
+  this->outputFile.write(this->pendingData);
+  this->pendingData.clear();
+}
+
+#ifndef _WIN32
+int FileSinkAnnexBKernelCopy::getInputFileDescriptor(const std::filesystem::path &filePath)
+{
+  if (const auto it = this->inputFileDescriptors.find(filePath);
+      it != this->inputFileDescriptors.end())
+    return it->second;
+
+  const auto fileDescriptor = ::open(filePath.c_str(), O_RDONLY);
+  if (fileDescriptor < 0)
+    throw std::runtime_error("Error opening input file " + filePath.string() +
+                             " for copying: " + std::strerror(errno));
+  this->inputFileDescriptors[filePath] = fileDescriptor;
+  return fileDescriptor;
+}
+#endif
+
+} // namespace combiner
@@ -0,0 +1,51 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+
+#include "NalUnitSink.h"
+#include "OutputFile.h"
+
+#include <filesystem>
+#include <map>
+
+namespace combiner
+{
+
+/* Writes an Annex B file like FileSinkAnnexB, but the parts of the NAL units that are unchanged
+ * ranges of an input file (the slice data after a rewritten slice header) are copied by the kernel
+ * from the input file to the output file (see OutputFile::copyFromFile). Only the start codes, the
+ * new headers and all other NAL units are written from memory. They are collected in a buffer
+ * that is written before each copy. Short ranges are written from memory as well because the
+ * system call costs more than copying them.
+ * On Windows, everything is written from memory.
+ */
+class FileSinkAnnexBKernelCopy : public NalUnitSink
+{
+public:
+  FileSinkAnnexBKernelCopy(const std::filesystem::path &filePath);
+  ~FileSinkAnnexBKernelCopy();
+
+  void writeNALUnit(const ByteVector &nalData) override;
+  void writeNALUnitWithNewHeader(const ByteVector               &newHeader,
+                                 const ByteVector               &originalNalData,
+                                 const size_t                    nrReplacedBytes,
+                                 const std::optional<FileRange> &originalInFile) override;
+  void finish() override;
+
+private:
+  void writePendingData();
+#ifndef _WIN32
+  int getInputFileDescriptor(const std::filesystem::path &filePath);
+
+  std::map<std::filesystem::path, int> inputFileDescriptors;
+#endif
+
+  OutputFile outputFile;
+  ByteVector pendingData;
+};
+
+} // namespace combiner
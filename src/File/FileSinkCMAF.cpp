@@ -0,0 +1,423 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include "FileSinkCMAF.h"
+
+#include <common/Tracer.h>
+
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+namespace combiner
+{
+
+using namespace parser::hevc;
+
+namespace
+{
+
+constexpr auto NAL_UNIT_LENGTH_SIZE = 4u;
+
+constexpr uint32_t TFHD_DEFAULT_BASE_IS_MOOF = 0x020000;
+
+constexpr uint32_t TRUN_DATA_OFFSET_PRESENT                     = 0x000001;
+constexpr uint32_t TRUN_SAMPLE_DURATION_PRESENT                 = 0x000100;
+constexpr uint32_t TRUN_SAMPLE_SIZE_PRESENT                     = 0x000200;
+constexpr uint32_t TRUN_SAMPLE_FLAGS_PRESENT                    = 0x000400;
+constexpr uint32_t TRUN_SAMPLE_COMPOSITION_TIME_OFFSETS_PRESENT = 0x000800;
+
+// sample_depends_on = 2 (I picture)
+constexpr uint32_t SYNC_SAMPLE_FLAGS = 0x02000000;
+// sample_depends_on = 1, sample_is_non_sync_sample = 1
+constexpr uint32_t NON_SYNC_SAMPLE_FLAGS = 0x01010000;
+
+constexpr std::array<uint32_t, 9> UNITY_MATRIX = {
+    0x00010000, 0, 0, 0, 0x00010000, 0, 0, 0, 0x40000000};
+
+// Writes boxes into a buffer. The size of a box is filled in when it is ended.
+class BoxWriter
+{
+public:
+  void startBox(const char *type)
+  {
+    this->openBoxes.push_back(this->data.size());
+    this->writeU32(0);
+    this->data.insert(this->data.end(), type, type + 4);
+  }
+  void startFullBox(const char *type, const uint8_t version, const uint32_t flags)
+  {
+    this->startBox(type);
+    this->writeU32((uint32_t(version) << 24) | flags);
+  }
+  void endBox()
+  {
+    const auto start = this->openBoxes.back();
+    this->openBoxes.pop_back();
+    this->patchU32(start, static_cast<uint32_t>(this->data.size() - start));
+  }
+
+  void writeValue(const uint64_t value, const unsigned nrBytes)
+  {
+    for (unsigned i = nrBytes; i > 0; --i)
+      this->data.push_back(static_cast<uint8_t>(value >> (8 * (i - 1))));
+  }
+  void writeU8(const uint32_t value) { this->writeValue(value, 1); }
+  void writeU16(const uint32_t value) { this->writeValue(value, 2); }
+  void writeU32(const uint32_t value) { this->writeValue(value, 4); }
+  void writeU64(const uint64_t value) { this->writeValue(value, 8); }
+  void writeZeros(const size_t nrBytes) { this->data.insert(this->data.end(), nrBytes, 0); }
+  void writeBytes(const ByteVector &bytes)
+  {
+    this->data.insert(this->data.end(), bytes.begin(), bytes.end());
+  }
+  void writeMatrix()
+  {
+    for (const auto value : UNITY_MATRIX)
+      this->writeU32(value);
+  }
+
+  size_t getPosition() const { return this->data.size(); }
+  void   patchU32(const size_t position, const uint32_t value)
+  {
+    for (unsigned i = 0; i < 4; ++i)
+      this->data.at(position + i) = static_cast<uint8_t>(value >> (8 * (3 - i)));
+  }
+
+  ByteVector data;
+
+private:
+  std::vector<size_t> openBoxes;
+};
+
+// The HEVCDecoderConfigurationRecord (ISO/IEC 14496-15 8.3.3.1)
+void writeHvcC(BoxWriter                     &writer,
+               const seq_parameter_set_rbsp  &sps,
+               const std::vector<ByteVector> &parameterSets)
+{
+  const auto &ptl = sps.profileTierLevel;
+
+  writer.startBox("hvcC");
+  writer.writeU8(1);
+  writer.writeU8(static_cast<uint32_t>((ptl.general_profile_space << 6) |
+                                       (uint64_t(ptl.general_tier_flag) << 5) |
+                                       ptl.general_profile_idc));
+  uint32_t compatibilityFlags = 0;
+  for (unsigned j = 0; j < 32; ++j)
+    if (ptl.general_profile_compatibility_flag[j])
+      compatibilityFlags |= 1u << (31 - j);
+  writer.writeU32(compatibilityFlags);
+
+  const std::array<bool, 13> constraintFlags = {ptl.general_progressive_source_flag,
+                                                ptl.general_interlaced_source_flag,
+                                                ptl.general_non_packed_constraint_flag,
+                                                ptl.general_frame_only_constraint_flag,
+                                                ptl.general_max_12bit_constraint_flag,
+                                                ptl.general_max_10bit_constraint_flag,
+                                                ptl.general_max_8bit_constraint_flag,
+                                                ptl.general_max_422chroma_constraint_flag,
+                                                ptl.general_max_420chroma_constraint_flag,
+                                                ptl.general_max_monochrome_constraint_flag,
+                                                ptl.general_intra_constraint_flag,
+                                                ptl.general_one_picture_only_constraint_flag,
+                                                ptl.general_lower_bit_rate_constraint_flag};
+  uint64_t constraintIndicatorFlags = 0;
+  for (size_t i = 0; i < constraintFlags.size(); ++i)
+    if (constraintFlags.at(i))
+      constraintIndicatorFlags |= uint64_t(1) << (47 - i);
+  if (ptl.general_inbld_flag)
+    constraintIndicatorFlags |= 1;
+  writer.writeValue(constraintIndicatorFlags, 6);
+
+  writer.writeU8(static_cast<uint32_t>(ptl.general_level_idc));
+  writer.writeU16(0xf000);
+  writer.writeU8(0xfc);
+  writer.writeU8(0xfc | static_cast<uint32_t>(sps.chroma_format_idc));
+  writer.writeU8(0xf8 | static_cast<uint32_t>(sps.bit_depth_luma_minus8));
+  writer.writeU8(0xf8 | static_cast<uint32_t>(sps.bit_depth_chroma_minus8));
+  writer.writeU16(0);
+  writer.writeU8(static_cast<uint32_t>(((sps.sps_max_sub_layers_minus1 + 1) << 3) |
+                                       (uint64_t(sps.sps_temporal_id_nesting_flag) << 2) |
+                                       (NAL_UNIT_LENGTH_SIZE - 1)));
+
+  writer.writeU8(static_cast<uint32_t>(parameterSets.size()));
+  for (const auto &nal : parameterSets)
+  {
+    // array_completeness is 0 because the parameter sets can also be in the samples (hev1)
+    writer.writeU8(nal_unit_header::fromNalData(nal).nalUnitTypeID);
+    writer.writeU16(1);
+    writer.writeU16(static_cast<uint32_t>(nal.size()));
+    writer.writeBytes(nal);
+  }
+  writer.endBox();
+}
+
+} // namespace
+
+FileSinkCMAF::FileSinkCMAF(const std::filesystem::path &filePath,
+                           std::optional<unsigned>      framesPerFragment)
+    : outputFile(filePath), framesPerFragment(framesPerFragment)
+{
+  if (this->framesPerFragment && *this->framesPerFragment == 0)
+    throw std::invalid_argument("The number of frames per fragment must be greater than 0");
+}
+
+void FileSinkCMAF::writeNALUnit(const ByteVector &nalData)
+{
+  const auto nal = this->accessUnitTiming.update(nalData);
+  if (nal.startsAccessUnit)
+    this->finishSample();
+
+  const auto nalType = nal.header.nal_unit_type;
+  if (nalType == NalType::VPS_NUT && !this->vps)
+    this->vps = nalData;
+  else if (nalType == NalType::SPS_NUT && !this->sps)
+    this->sps = nalData;
+  else if (nalType == NalType::PPS_NUT && !this->pps)
+    this->pps = nalData;
+  else if (nal.picture)
+    this->currentSample.picture = nal.picture;
+
+  this->currentSample.nalUnits.push_back(nalData);
+  addToCounter(getCounter(this->statistics, &OutputStatistics::nrNalUnits), 1);
+}
+
+void FileSinkCMAF::finish()
+{
+  this->finishSample();
+  this->writeFragment();
+}
+
+void FileSinkCMAF::finishSample()
+{
+  if (this->currentSample.nalUnits.empty())
+    return;
+  if (!this->currentSample.picture)
+    throw std::runtime_error("Access unit without a slice can not be written as a CMAF sample");
+
+  auto      &sample = this->currentSample;
+  const auto isFragmentFull =
+      this->framesPerFragment ? (this->fragmentSamples.size() >= *this->framesPerFragment)
+                              : sample.picture->isIRAP;
+  if (isFragmentFull)
+    this->writeFragment();
+
+  this->fragmentSamples.push_back(std::move(sample));
+  this->currentSample = {};
+}
+
+void FileSinkCMAF::writeInitSegment()
+{
+  if (!this->vps || !this->sps || !this->pps)
+    throw std::runtime_error("VPS, SPS and PPS are needed before the first picture to write the "
+                             "CMAF init segment");
+
+  const auto timing    = this->accessUnitTiming.getPictureTiming();
+  this->timescale      = timing.timescale;
+  this->sampleDuration = timing.pictureDuration;
+
+  const auto &sps    = this->accessUnitTiming.getFirstSPS().value();
+  const auto  width  = static_cast<uint32_t>(sps.get_conformance_cropping_width());
+  const auto  height = static_cast<uint32_t>(sps.get_conformance_cropping_height());
+
+  BoxWriter writer;
+  writer.startBox("ftyp");
+  writer.writeBytes({'c', 'm', 'f', 'c'});
+  writer.writeU32(0);
+  writer.writeBytes({'i', 's', 'o', '6', 'c', 'm', 'f', 'c', 'h', 'e', 'v', '1'});
+  writer.endBox();
+
+  writer.startBox("moov");
+  writer.startFullBox("mvhd", 0, 0);
+  writer.writeZeros(8);
+  writer.writeU32(this->timescale);
+  writer.writeU32(0);
+  writer.writeU32(0x00010000);
+  writer.writeU16(0x0100);
+  writer.writeZeros(10);
+  writer.writeMatrix();
+  writer.writeZeros(24);
+  writer.writeU32(2);
+  writer.endBox();
+
+  writer.startBox("trak");
+  writer.startFullBox("tkhd", 0, 0x000003);
+  writer.writeZeros(8);
+  writer.writeU32(1);
+  writer.writeZeros(4 + 4 + 8 + 2 + 2 + 2 + 2);
+  writer.writeMatrix();
+  writer.writeU32(width << 16);
+  writer.writeU32(height << 16);
+  writer.endBox();
+
+  writer.startBox("mdia");
+  writer.startFullBox("mdhd", 0, 0);
+  writer.writeZeros(8);
+  writer.writeU32(this->timescale);
+  writer.writeU32(0);
+  writer.writeU16(0x55c4); // "und"
+  writer.writeU16(0);
+  writer.endBox();
+
+  writer.startFullBox("hdlr", 0, 0);
+  writer.writeU32(0);
+  writer.writeBytes({'v', 'i', 'd', 'e'});
+  writer.writeZeros(12);
+  writer.writeBytes({'V', 'i', 'd', 'e', 'o', 'H', 'a', 'n', 'd', 'l', 'e', 'r', 0});
+  writer.endBox();
+
+  writer.startBox("minf");
+  writer.startFullBox("vmhd", 0, 0x000001);
+  writer.writeZeros(8);
+  writer.endBox();
+  writer.startBox("dinf");
+  writer.startFullBox("dref", 0, 0);
+  writer.writeU32(1);
+  writer.startFullBox("url ", 0, 0x000001);
+  writer.endBox();
+  writer.endBox();
+  writer.endBox();
+
+  writer.startBox("stbl");
+  writer.startFullBox("stsd", 0, 0);
+  writer.writeU32(1);
+  writer.startBox("hev1");
+  writer.writeZeros(6);
+  writer.writeU16(1);
+  writer.writeZeros(16);
+  writer.writeU16(width);
+  writer.writeU16(height);
+  writer.writeU32(0x00480000);
+  writer.writeU32(0x00480000);
+  writer.writeU32(0);
+  writer.writeU16(1);
+  writer.writeZeros(32);
+  writer.writeU16(0x0018);
+  writer.writeU16(0xffff);
+  writeHvcC(writer, sps, {*this->vps, *this->sps, *this->pps});
+  writer.endBox();
+  writer.endBox();
+  for (const auto type : {"stts", "stsc", "stco"})
+  {
+    writer.startFullBox(type, 0, 0);
+    writer.writeU32(0);
+    writer.endBox();
+  }
+  writer.startFullBox("stsz", 0, 0);
+  writer.writeU32(0);
+  writer.writeU32(0);
+  writer.endBox();
+  writer.endBox(); // stbl
+  writer.endBox(); // minf
+  writer.endBox(); // mdia
+  writer.endBox(); // trak
+
+  writer.startBox("mvex");
+  writer.startFullBox("trex", 0, 0);
+  writer.writeU32(1);
+  writer.writeU32(1);
+  writer.writeZeros(12);
+  writer.endBox();
+  writer.endBox();
+  writer.endBox(); // moov
+
+  this->outputFile.write(writer.data);
+  addToCounter(getCounter(this->statistics, &OutputStatistics::bytesWritten), writer.data.size());
+  this->initSegmentWritten = true;
+}
+
+void FileSinkCMAF::writeFragment()
+{
+  if (this->fragmentSamples.empty())
+    return;
+
+  ScopedTimer      timer(getCounter(this->statistics, &OutputStatistics::writeTime));
+  ScopedTraceEvent traceEvent("write");
+
+  if (!this->initSegmentWritten)
+    this->writeInitSegment();
+
+  // The length prefixes are kept in one buffer. The NAL units are written from where they are.
+  size_t nrNalUnits = 0;
+  for (const auto &sample : this->fragmentSamples)
+    nrNalUnits += sample.nalUnits.size();
+  std::vector<std::array<uint8_t, NAL_UNIT_LENGTH_SIZE>> lengthPrefixes;
+  lengthPrefixes.reserve(nrNalUnits);
+
+  std::vector<ByteRange> ranges;
+  ranges.reserve(2 * nrNalUnits + 1);
+  ranges.push_back({});
+
+  BoxWriter writer;
+  writer.startBox("moof");
+  writer.startFullBox("mfhd", 0, 0);
+  writer.writeU32(this->fragmentSequenceNumber++);
+  writer.endBox();
+
+  writer.startBox("traf");
+  writer.startFullBox("tfhd", 0, TFHD_DEFAULT_BASE_IS_MOOF);
+  writer.writeU32(1);
+  writer.endBox();
+  writer.startFullBox("tfdt", 1, 0);
+  writer.writeU64(this->nrSamples * this->sampleDuration);
+  writer.endBox();
+
+  writer.startFullBox("trun",
+                      1,
+                      TRUN_DATA_OFFSET_PRESENT | TRUN_SAMPLE_DURATION_PRESENT |
+                          TRUN_SAMPLE_SIZE_PRESENT | TRUN_SAMPLE_FLAGS_PRESENT |
+                          TRUN_SAMPLE_COMPOSITION_TIME_OFFSETS_PRESENT);
+  writer.writeU32(static_cast<uint32_t>(this->fragmentSamples.size()));
+  const auto dataOffsetPosition = writer.getPosition();
+  writer.writeU32(0);
+
+  uint64_t mdatPayloadSize = 0;
+  for (const auto &sample : this->fragmentSamples)
+  {
+    uint64_t sampleSize = 0;
+    for (const auto &nal : sample.nalUnits)
+    {
+      auto &lengthPrefix = lengthPrefixes.emplace_back();
+      for (unsigned i = 0; i < NAL_UNIT_LENGTH_SIZE; ++i)
+        lengthPrefix.at(i) =
+            static_cast<uint8_t>(nal.size() >> (8 * (NAL_UNIT_LENGTH_SIZE - 1 - i)));
+      ranges.push_back({lengthPrefix.data(), lengthPrefix.size()});
+      ranges.push_back({nal.data(), nal.size()});
+      sampleSize += NAL_UNIT_LENGTH_SIZE + nal.size();
+    }
+    mdatPayloadSize += sampleSize;
+
+    writer.writeU32(this->sampleDuration);
+    writer.writeU32(static_cast<uint32_t>(sampleSize));
+    // The composition time is the presentation index (from the POC) times the sample duration
+    const auto &picture           = *sample.picture;
+    const auto  compositionOffset = picture.presentationIndex - picture.decodeIndex;
+    writer.writeU32(picture.isIRAP ? SYNC_SAMPLE_FLAGS : NON_SYNC_SAMPLE_FLAGS);
+    writer.writeU32(static_cast<uint32_t>(compositionOffset * this->sampleDuration));
+  }
+  writer.endBox(); // trun
+  writer.endBox(); // traf
+  writer.endBox(); // moof
+
+  const auto isLargeMdat    = (mdatPayloadSize + 8 > UINT32_MAX);
+  const auto mdatHeaderSize = isLargeMdat ? 16u : 8u;
+  writer.patchU32(dataOffsetPosition, static_cast<uint32_t>(writer.data.size() + mdatHeaderSize));
+  writer.writeU32(isLargeMdat ? 1 : static_cast<uint32_t>(mdatPayloadSize + 8));
+  writer.writeBytes({'m', 'd', 'a', 't'});
+  if (isLargeMdat)
+    writer.writeU64(mdatPayloadSize + 16);
+  ranges.front() = {writer.data.data(), writer.data.size()};
+
+  this->outputFile.writeGather(ranges);
+  addToCounter(getCounter(this->statistics, &OutputStatistics::bytesWritten),
+               writer.data.size() + mdatPayloadSize);
+
+  this->nrSamples += this->fragmentSamples.size();
+  this->fragmentSamples.clear();
+}
+
+} // namespace combiner
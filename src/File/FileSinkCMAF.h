@@ -0,0 +1,65 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+
+#include "NalUnitSink.h"
+#include "OutputFile.h"
+
+#include <HEVC/AccessUnitTiming.h>
+
+#include <filesystem>
+#include <optional>
+#include <vector>
+
+namespace combiner
+{
+
+/* Writes the NAL units as a fragmented MP4 (CMAF) file with one hev1 video track.
+ * The init segment (ftyp/moov) with the hvcC is written from the first VPS/SPS/PPS. The access
+ * units are then written as samples in moof/mdat fragments. A fragment is started at every IRAP
+ * picture or, if set, every framesPerFragment pictures. The sample duration is taken from the VUI
+ * timing of the SPS and the composition time of each sample from its POC.
+ */
+class FileSinkCMAF : public NalUnitSink
+{
+public:
+  FileSinkCMAF(const std::filesystem::path &filePath,
+               std::optional<unsigned>      framesPerFragment = {});
+
+  void writeNALUnit(const ByteVector &nalData) override;
+  void finish() override;
+
+private:
+  struct Sample
+  {
+    std::vector<ByteVector>                                nalUnits;
+    std::optional<parser::hevc::AccessUnitTiming::Picture> picture{};
+  };
+
+  void finishSample();
+  void writeInitSegment();
+  void writeFragment();
+
+  OutputFile              outputFile;
+  std::optional<unsigned> framesPerFragment{};
+
+  parser::hevc::AccessUnitTiming accessUnitTiming;
+
+  std::optional<ByteVector> vps;
+  std::optional<ByteVector> sps;
+  std::optional<ByteVector> pps;
+  bool                      initSegmentWritten{};
+  uint32_t                  timescale{};
+  uint32_t                  sampleDuration{};
+
+  Sample              currentSample;
+  std::vector<Sample> fragmentSamples;
+  uint32_t            fragmentSequenceNumber{1};
+  uint64_t            nrSamples{};
+};
+
+} // namespace combiner
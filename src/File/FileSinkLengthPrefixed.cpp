@@ -0,0 +1,49 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include "FileSinkLengthPrefixed.h"
+
+#include <HEVC/nal_unit_header.h>
+#include <common/Tracer.h>
+
+#include <limits>
+#include <stdexcept>
+
+namespace combiner
+{
+
+FileSinkLengthPrefixed::FileSinkLengthPrefixed(const std::filesystem::path &filePath)
+{
+  this->outputFile.open(filePath, std::ios_base::binary);
+  if (!this->outputFile.is_open())
+    throw std::runtime_error("Error opening output file " + filePath.string());
+}
+
+void FileSinkLengthPrefixed::writeNALUnit(const ByteVector &nalData)
+{
+  if (nalData.size() > std::numeric_limits<uint32_t>::max())
+    throw std::runtime_error("NAL unit is too large for a 4 byte length prefix");
+
+  ScopedTimer      timer(getCounter(this->statistics, &OutputStatistics::writeTime));
+  ScopedTraceEvent traceEvent("write");
+  if (nalData.size() > 1)
+    traceEvent.setNalUnitType(parser::hevc::nal_unit_header::fromNalData(nalData).nalUnitTypeID);
+
+  const auto size           = static_cast<uint32_t>(nalData.size());
+  const char lengthBytes[4] = {static_cast<char>(size >> 24),
+                               static_cast<char>(size >> 16),
+                               static_cast<char>(size >> 8),
+                               static_cast<char>(size)};
+  this->outputFile.write(lengthBytes, sizeof(lengthBytes));
+  this->outputFile.write(reinterpret_cast<const char *>(nalData.data()), nalData.size());
+  if (!this->outputFile)
+    throw std::runtime_error("Error writing to the output file");
+
+  addToCounter(getCounter(this->statistics, &OutputStatistics::bytesWritten), nalData.size() + 4);
+  addToCounter(getCounter(this->statistics, &OutputStatistics::nrNalUnits), 1);
+}
+
+} // namespace combiner
@@ -0,0 +1,29 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+
+#include "NalUnitSink.h"
+
+#include <filesystem>
+#include <fstream>
+
+namespace combiner
+{
+
+// Writes each NAL unit preceded by its size as a 4 byte big endian number (like hvc1 samples).
+class FileSinkLengthPrefixed : public NalUnitSink
+{
+public:
+  FileSinkLengthPrefixed(const std::filesystem::path &filePath);
+
+  void writeNALUnit(const ByteVector &nalData) override;
+
+private:
+  std::ofstream outputFile{};
+};
+
+} // namespace combiner
@@ -0,0 +1,293 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include "FileSinkSegmentedAnnexB.h"
+
+#include <common/Logger.h>
+#include <common/Tracer.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <sstream>
+#include <stdexcept>
+
+namespace combiner
+{
+
+using namespace parser::hevc;
+
+namespace
+{
+
+constexpr std::array<char, 4> START_CODE = {0, 0, 0, 1};
+
+NalType getNalType(const ByteVector &nalData)
+{
+  return nal_unit_header::fromNalData(nalData).nal_unit_type;
+}
+
+std::string createPlaylist(const std::vector<std::pair<std::string, double>> &entries,
+                           const bool                                         complete)
+{
+  double maxDuration = 0;
+  for (const auto &entry : entries)
+    maxDuration = std::max(maxDuration, entry.second);
+
+  std::ostringstream playlist;
+  playlist << "#EXTM3U\n";
+  playlist << "#EXT-X-VERSION:3\n";
+  playlist << "#EXT-X-TARGETDURATION:" << static_cast<unsigned>(std::ceil(maxDuration)) << "\n";
+  playlist << "#EXT-X-MEDIA-SEQUENCE:0\n";
+  playlist.setf(std::ios::fixed);
+  playlist.precision(3);
+  for (const auto &[fileName, duration] : entries)
+    playlist << "#EXTINF:" << duration << ",\n" << fileName << "\n";
+  if (complete)
+    playlist << "#EXT-X-ENDLIST\n";
+  return playlist.str();
+}
+
+// Write to a temporary file first, so that a reader never sees a partially written playlist
+void writePlaylist(const std::filesystem::path &playlistPath, const std::string &playlist)
+{
+  auto temporaryPath = playlistPath;
+  temporaryPath += ".tmp";
+  {
+    std::ofstream file(temporaryPath, std::ios_base::binary);
+    file << playlist;
+    if (!file)
+    {
+      logger().warning("Error writing the playlist " + temporaryPath.string());
+      return;
+    }
+  }
+  std::error_code error;
+  std::filesystem::rename(temporaryPath, playlistPath, error);
+  if (error)
+    logger().warning("Error renaming the playlist to " + playlistPath.string() + ": " +
+                     error.message());
+}
+
+} // namespace
+
+FileSinkSegmentedAnnexB::FileSinkSegmentedAnnexB(const std::filesystem::path &filePath,
+                                                 const SegmentLength         &length)
+    : filePath(filePath), length(length)
+{
+  if (length.seconds.has_value() == length.nrGOPs.has_value())
+    throw std::invalid_argument("Either a segment duration or a number of GOPs must be set");
+  if ((length.seconds && *length.seconds <= 0) || (length.nrGOPs && *length.nrGOPs == 0))
+    throw std::invalid_argument("Invalid segment length");
+
+  this->backgroundThread = std::thread(&FileSinkSegmentedAnnexB::runBackgroundThread, this);
+}
+
+FileSinkSegmentedAnnexB::~FileSinkSegmentedAnnexB()
+{
+  this->stopBackgroundThread();
+}
+
+std::filesystem::path
+FileSinkSegmentedAnnexB::getSegmentPath(const std::filesystem::path &filePath,
+                                        const unsigned               segmentIndex)
+{
+  char number[16]{};
+  std::snprintf(number, sizeof(number), "%05u", segmentIndex);
+  auto segmentPath = filePath;
+  segmentPath.replace_filename(filePath.stem().string() + "_" + number +
+                               filePath.extension().string());
+  return segmentPath;
+}
+
+std::filesystem::path
+FileSinkSegmentedAnnexB::getPlaylistPath(const std::filesystem::path &filePath)
+{
+  auto playlistPath = filePath;
+  playlistPath.replace_extension(".m3u8");
+  return playlistPath;
+}
+
+void FileSinkSegmentedAnnexB::writeNALUnit(const ByteVector &nalData)
+{
+  const auto nal = this->accessUnitTiming.update(nalData);
+  if (nal.startsAccessUnit)
+    this->finishAccessUnit();
+
+  if (nal.picture)
+  {
+    this->currentAccessUnit.hasSlice = true;
+    this->currentAccessUnit.isIRAP   = nal.picture->isIRAP;
+  }
+
+  this->currentAccessUnit.nalUnits.push_back(nalData);
+}
+
+void FileSinkSegmentedAnnexB::finish()
+{
+  this->finishAccessUnit();
+  if (this->segmentFile)
+    this->finishSegment(true);
+  this->stopBackgroundThread();
+}
+
+void FileSinkSegmentedAnnexB::finishAccessUnit()
+{
+  auto &accessUnit = this->currentAccessUnit;
+  if (accessUnit.nalUnits.empty())
+    return;
+
+  ScopedTimer      timer(getCounter(this->statistics, &OutputStatistics::writeTime));
+  ScopedTraceEvent traceEvent("write");
+
+  const auto newSegment = !this->segmentFile || (accessUnit.isIRAP && this->isSegmentComplete());
+  if (newSegment)
+  {
+    if (this->segmentFile)
+      this->finishSegment(false);
+    this->startSegment();
+  }
+
+  // The parameter sets that the access unit does not carry itself are repeated after an AUD
+  auto nalUnit = accessUnit.nalUnits.begin();
+  if (newSegment)
+  {
+    if (getNalType(*nalUnit) == NalType::AUD_NUT)
+      this->writeNalUnitToSegment(*nalUnit++);
+    for (const auto &[nalType, parameterSet] : this->parameterSets)
+    {
+      const auto inAccessUnit = std::any_of(
+          accessUnit.nalUnits.begin(),
+          accessUnit.nalUnits.end(),
+          [nalType = nalType](const ByteVector &nal) { return getNalType(nal) == nalType; });
+      if (!inAccessUnit)
+        this->writeNalUnitToSegment(parameterSet);
+    }
+  }
+  for (; nalUnit != accessUnit.nalUnits.end(); ++nalUnit)
+    this->writeNalUnitToSegment(*nalUnit);
+
+  for (auto &nal : accessUnit.nalUnits)
+  {
+    const auto header = nal_unit_header::fromNalData(nal);
+    if (!header.isParameterSet())
+      continue;
+    const auto nalType      = header.nal_unit_type;
+    auto       parameterSet = std::find_if(this->parameterSets.begin(),
+                                           this->parameterSets.end(),
+                                           [nalType](const auto &entry)
+                                           { return entry.first == nalType; });
+    if (parameterSet == this->parameterSets.end())
+      this->parameterSets.push_back({nalType, std::move(nal)});
+    else
+      parameterSet->second = std::move(nal);
+  }
+
+  if (accessUnit.hasSlice)
+    this->nrPicturesInSegment++;
+  if (accessUnit.isIRAP)
+    this->nrIRAPsInSegment++;
+  this->currentAccessUnit = {};
+}
+
+bool FileSinkSegmentedAnnexB::isSegmentComplete() const
+{
+  if (this->length.nrGOPs)
+    return this->nrIRAPsInSegment >= *this->length.nrGOPs;
+  return this->getSegmentDuration() >= *this->length.seconds;
+}
+
+double FileSinkSegmentedAnnexB::getSegmentDuration() const
+{
+  const auto timing = this->accessUnitTiming.getPictureTiming();
+  return double(this->nrPicturesInSegment) * timing.pictureDuration / timing.timescale;
+}
+
+void FileSinkSegmentedAnnexB::startSegment()
+{
+  const auto segmentPath = getSegmentPath(this->filePath, this->segmentIndex);
+  this->segmentFile      = std::make_unique<std::ofstream>(segmentPath, std::ios_base::binary);
+  if (!this->segmentFile->is_open())
+    throw std::runtime_error("Error opening output file " + segmentPath.string());
+
+  this->nrPicturesInSegment = 0;
+  this->nrIRAPsInSegment    = 0;
+}
+
+void FileSinkSegmentedAnnexB::finishSegment(const bool lastSegment)
+{
+  const auto segmentPath = getSegmentPath(this->filePath, this->segmentIndex);
+  this->playlist.push_back({segmentPath.filename().string(), this->getSegmentDuration()});
+  logger().info("Finished segment " + segmentPath.string());
+
+  // Closing flushes the rest of the segment. The playlist is only updated after that.
+  this->addBackgroundTask(
+      [file         = std::shared_ptr<std::ofstream>(std::move(this->segmentFile)),
+       segmentPath  = segmentPath,
+       playlistPath = getPlaylistPath(this->filePath),
+       playlist     = createPlaylist(this->playlist, lastSegment)]()
+      {
+        file->close();
+        if (file->fail())
+          logger().warning("Error closing segment " + segmentPath.string());
+        writePlaylist(playlistPath, playlist);
+      });
+  this->segmentIndex++;
+}
+
+void FileSinkSegmentedAnnexB::writeNalUnitToSegment(const ByteVector &nalData)
+{
+  this->segmentFile->write(START_CODE.data(), START_CODE.size());
+  this->segmentFile->write(reinterpret_cast<const char *>(nalData.data()), nalData.size());
+  if (!*this->segmentFile)
+    throw std::runtime_error("Error writing to segment " +
+                             getSegmentPath(this->filePath, this->segmentIndex).string());
+
+  addToCounter(getCounter(this->statistics, &OutputStatistics::bytesWritten),
+               nalData.size() + START_CODE.size());
+  addToCounter(getCounter(this->statistics, &OutputStatistics::nrNalUnits), 1);
+}
+
+void FileSinkSegmentedAnnexB::runBackgroundThread()
+{
+  while (true)
+  {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(this->mutex);
+      this->taskCondition.wait(lock, [this]() { return this->stop || !this->tasks.empty(); });
+      if (this->tasks.empty())
+        return;
+      task = std::move(this->tasks.front());
+      this->tasks.pop_front();
+    }
+    task();
+  }
+}
+
+void FileSinkSegmentedAnnexB::addBackgroundTask(std::function<void()> &&task)
+{
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->tasks.push_back(std::move(task));
+  }
+  this->taskCondition.notify_one();
+}
+
+void FileSinkSegmentedAnnexB::stopBackgroundThread()
+{
+  if (!this->backgroundThread.joinable())
+    return;
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->stop = true;
+  }
+  this->taskCondition.notify_one();
+  this->backgroundThread.join();
+}
+
+} // namespace combiner
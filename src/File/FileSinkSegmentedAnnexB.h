@@ -0,0 +1,100 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+
+#include "NalUnitSink.h"
+
+#include <HEVC/AccessUnitTiming.h>
+
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace combiner
+{
+
+// A segment ends at the first IRAP picture after the duration or after the number of GOPs.
+struct SegmentLength
+{
+  std::optional<double>   seconds{};
+  std::optional<unsigned> nrGOPs{};
+};
+
+/* Writes the NAL units as raw (Annex B) segments. A new segment file is started at an IRAP picture
+ * once the current segment is long enough. Each segment starts with the last VPS, SPS and PPS (if
+ * the IRAP access unit does not carry them itself), so it can be decoded on its own.
+ * For output.hevc the segments are written as output_00000.hevc, output_00001.hevc, ... and listed
+ * in an m3u8 style playlist output.m3u8 with the duration of each segment (from the VUI timing).
+ * Finished segments are closed (and flushed) on a background thread, which then updates the
+ * playlist. So a segment is only listed once it is complete and the writing never waits for it.
+ */
+class FileSinkSegmentedAnnexB : public NalUnitSink
+{
+public:
+  FileSinkSegmentedAnnexB(const std::filesystem::path &filePath, const SegmentLength &length);
+  ~FileSinkSegmentedAnnexB();
+
+  void writeNALUnit(const ByteVector &nalData) override;
+  void finish() override;
+
+  static std::filesystem::path getSegmentPath(const std::filesystem::path &filePath,
+                                              const unsigned               segmentIndex);
+  static std::filesystem::path getPlaylistPath(const std::filesystem::path &filePath);
+
+private:
+  struct AccessUnit
+  {
+    std::vector<ByteVector> nalUnits;
+    bool                    hasSlice{};
+    bool                    isIRAP{};
+  };
+
+  void   finishAccessUnit();
+  bool   isSegmentComplete() const;
+  double getSegmentDuration() const;
+  void   startSegment();
+  void   finishSegment(const bool lastSegment);
+  void   writeNalUnitToSegment(const ByteVector &nalData);
+
+  void runBackgroundThread();
+  void addBackgroundTask(std::function<void()> &&task);
+  void stopBackgroundThread();
+
+  std::filesystem::path filePath;
+  SegmentLength         length;
+
+  parser::hevc::AccessUnitTiming accessUnitTiming;
+
+  // The last parameter sets that were written (by NAL unit type)
+  std::vector<std::pair<parser::hevc::NalType, ByteVector>> parameterSets;
+
+  AccessUnit currentAccessUnit;
+
+  std::unique_ptr<std::ofstream> segmentFile;
+  unsigned                       segmentIndex{};
+  unsigned                       nrPicturesInSegment{};
+  unsigned                       nrIRAPsInSegment{};
+
+  // The file name and duration (in seconds) of all finished segments
+  std::vector<std::pair<std::string, double>> playlist;
+
+  std::mutex                        mutex;
+  std::condition_variable           taskCondition;
+  std::deque<std::function<void()>> tasks;
+  bool                              stop{};
+  std::thread                       backgroundThread;
+};
+
+} // namespace combiner
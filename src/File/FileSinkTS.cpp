@@ -0,0 +1,429 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include "FileSinkTS.h"
+
+#include <common/Logger.h>
+#include <common/Tracer.h>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace combiner
+{
+
+using namespace parser::hevc;
+
+namespace
+{
+
+constexpr size_t  PACKET_SIZE         = 188;
+constexpr size_t  PACKET_HEADER_SIZE  = 4;
+constexpr size_t  PACKET_PAYLOAD_SIZE = PACKET_SIZE - PACKET_HEADER_SIZE;
+constexpr uint8_t SYNC_BYTE           = 0x47;
+
+constexpr uint16_t PAT_PID        = 0x0000;
+constexpr uint16_t PMT_PID        = 0x1000;
+constexpr uint16_t VIDEO_PID      = 0x0100;
+constexpr uint16_t NULL_PID       = 0x1FFF;
+constexpr uint16_t PROGRAM_NUMBER = 1;
+
+constexpr uint8_t PAT_TABLE_ID     = 0x00;
+constexpr uint8_t PMT_TABLE_ID     = 0x02;
+constexpr uint8_t STREAM_TYPE_HEVC = 0x24;
+constexpr uint8_t STREAM_ID_VIDEO  = 0xE0;
+
+constexpr int64_t SYSTEM_CLOCK = 27000000;
+// The PCR runs this much ahead of the DTS of the access unit that is being sent
+constexpr int64_t MUX_DELAY = SYSTEM_CLOCK * 7 / 10;
+// The PAT and PMT are repeated at least this often
+constexpr int64_t PSI_INTERVAL = SYSTEM_CLOCK / 10;
+// A larger jump of the input timestamps is not filled up with null packets
+constexpr int64_t MAX_NULL_PACKET_GAP = SYSTEM_CLOCK;
+
+// The PCR and PTS/DTS wrap around after 2^33 ticks of the 90 kHz clock
+constexpr int64_t TIMESTAMP_WRAP = int64_t(1) << 33;
+constexpr int64_t PCR_WRAP       = TIMESTAMP_WRAP * 300;
+
+constexpr std::array<uint8_t, 4> START_CODE = {0, 0, 0, 1};
+
+uint32_t calculateCRC32(const uint8_t *data, const size_t size)
+{
+  uint32_t crc = 0xffffffff;
+  for (size_t i = 0; i < size; ++i)
+  {
+    crc ^= uint32_t(data[i]) << 24;
+    for (int bit = 0; bit < 8; ++bit)
+      crc = (crc & 0x80000000) ? ((crc << 1) ^ 0x04C11DB7) : (crc << 1);
+  }
+  return crc;
+}
+
+// A PSI section with the syntax indicator set, one section and the CRC
+ByteVector
+createSection(const uint8_t tableID, const uint16_t tableIDExtension, const ByteVector &data)
+{
+  const auto sectionLength = data.size() + 5 + 4;
+  ByteVector section(3 + sectionLength);
+  section[0] = tableID;
+  section[1] = static_cast<uint8_t>(0xB0 | (sectionLength >> 8));
+  section[2] = static_cast<uint8_t>(sectionLength & 0xff);
+  section[3] = static_cast<uint8_t>(tableIDExtension >> 8);
+  section[4] = static_cast<uint8_t>(tableIDExtension & 0xff);
+  section[5] = 0xC1;
+  std::copy(data.begin(), data.end(), section.begin() + 8);
+
+  const auto crcPosition = section.size() - 4;
+  const auto crc         = calculateCRC32(section.data(), crcPosition);
+  for (size_t i = 0; i < 4; ++i)
+    section[crcPosition + i] = static_cast<uint8_t>(crc >> (8 * (3 - i)));
+  return section;
+}
+
+void writeTimestamp(uint8_t *data, const uint8_t prefix, const int64_t time)
+{
+  const auto value = ((time / 300) % TIMESTAMP_WRAP + TIMESTAMP_WRAP) % TIMESTAMP_WRAP;
+  data[0]          = static_cast<uint8_t>((prefix << 4) | ((value >> 29) & 0x0e) | 1);
+  data[1]          = static_cast<uint8_t>(value >> 22);
+  data[2]          = static_cast<uint8_t>(((value >> 14) & 0xfe) | 1);
+  data[3]          = static_cast<uint8_t>(value >> 7);
+  data[4]          = static_cast<uint8_t>(((value << 1) & 0xfe) | 1);
+}
+
+void writePCR(uint8_t *data, const int64_t time)
+{
+  const auto value     = (time % PCR_WRAP + PCR_WRAP) % PCR_WRAP;
+  const auto base      = value / 300;
+  const auto extension = value % 300;
+  data[0]              = static_cast<uint8_t>(base >> 25);
+  data[1]              = static_cast<uint8_t>(base >> 17);
+  data[2]              = static_cast<uint8_t>(base >> 9);
+  data[3]              = static_cast<uint8_t>(base >> 1);
+  data[4]              = static_cast<uint8_t>(((base & 1) << 7) | 0x7e | (extension >> 8));
+  data[5]              = static_cast<uint8_t>(extension & 0xff);
+}
+
+void writePacketHeader(uint8_t       *packet,
+                       const uint16_t PID,
+                       const bool     payloadUnitStart,
+                       const uint8_t  adaptationFieldControl,
+                       const uint8_t  continuityCounter)
+{
+  packet[0] = SYNC_BYTE;
+  packet[1] = static_cast<uint8_t>((payloadUnitStart ? 0x40 : 0x00) | (PID >> 8));
+  packet[2] = static_cast<uint8_t>(PID & 0xff);
+  packet[3] = static_cast<uint8_t>((adaptationFieldControl << 4) | continuityCounter);
+}
+
+} // namespace
+
+FileSinkTS::FileSinkTS(const std::filesystem::path &filePath,
+                       std::chrono::milliseconds    pcrInterval,
+                       std::optional<uint64_t>      muxRate)
+    : outputFile(filePath), pcrInterval(pcrInterval.count() * (SYSTEM_CLOCK / 1000)),
+      muxRate(muxRate)
+{
+  if (this->pcrInterval <= 0)
+    throw std::invalid_argument("The PCR interval must be greater than 0");
+  if (this->muxRate && *this->muxRate == 0)
+    throw std::invalid_argument("The mux rate must be greater than 0");
+
+  this->programAssociationSection = createSection(
+      PAT_TABLE_ID,
+      1,
+      {0x00, PROGRAM_NUMBER, uint8_t(0xE0 | (PMT_PID >> 8)), uint8_t(PMT_PID & 0xff)});
+  this->programMapSection = createSection(PMT_TABLE_ID,
+                                          PROGRAM_NUMBER,
+                                          {uint8_t(0xE0 | (VIDEO_PID >> 8)),
+                                           uint8_t(VIDEO_PID & 0xff),
+                                           0xF0,
+                                           0x00,
+                                           STREAM_TYPE_HEVC,
+                                           uint8_t(0xE0 | (VIDEO_PID >> 8)),
+                                           uint8_t(VIDEO_PID & 0xff),
+                                           0xF0,
+                                           0x00});
+
+  this->packetBuffer.reserve(PACKET_SIZE * 1024);
+}
+
+void FileSinkTS::writeNALUnit(const ByteVector &nalData)
+{
+  const auto nal = this->accessUnitTiming.update(nalData);
+  if (nal.startsAccessUnit)
+    this->finishAccessUnit();
+  if (this->currentAccessUnit.nalUnits.empty())
+    this->currentAccessUnit.inputTimestamps = this->nextTimestamps;
+  if (nal.picture)
+    this->currentAccessUnit.picture = nal.picture;
+
+  this->currentAccessUnit.nalUnits.push_back(nalData);
+  addToCounter(getCounter(this->statistics, &OutputStatistics::nrNalUnits), 1);
+}
+
+void FileSinkTS::setTimestampsOfNextNALUnits(const Timestamps &timestamps)
+{
+  this->nextTimestamps = timestamps;
+}
+
+void FileSinkTS::finish()
+{
+  this->finishAccessUnit();
+}
+
+void FileSinkTS::finishAccessUnit()
+{
+  auto &accessUnit = this->currentAccessUnit;
+  if (accessUnit.nalUnits.empty())
+    return;
+  if (!accessUnit.picture)
+    throw std::runtime_error("Access unit without a slice can not be written to the transport "
+                             "stream");
+
+  int64_t DTS{};
+  int64_t PTS{};
+  const auto &inputTimestamps = accessUnit.inputTimestamps;
+  // Inputs with only a PTS (like RTP) do not tell the decoding time. Then the POC is used.
+  if (inputTimestamps.DTS)
+  {
+    PTS = static_cast<int64_t>(inputTimestamps.PTS.value_or(*inputTimestamps.DTS)) * 300;
+    DTS = static_cast<int64_t>(*inputTimestamps.DTS) * 300;
+
+    // The input timestamps are shifted if necessary so that the PCR does not start negative
+    if (!this->inputTimestampOffset)
+      this->inputTimestampOffset = std::max(int64_t(0), MUX_DELAY - DTS);
+    PTS += *this->inputTimestampOffset;
+    DTS += *this->inputTimestampOffset;
+  }
+  else
+  {
+    // The presentation index is calculated from the POC. The presentation is delayed by the
+    // maximum number of reordered pictures so that no picture is presented before it is decoded.
+    const auto &timing            = this->accessUnitTiming;
+    const auto &picture           = *accessUnit.picture;
+    const auto  presentationIndex = picture.presentationIndex + timing.getReorderDelay();
+    DTS = MUX_DELAY + timing.getTimeOfPictureIndex(picture.decodeIndex, SYSTEM_CLOCK);
+    PTS = std::max(DTS, MUX_DELAY + timing.getTimeOfPictureIndex(presentationIndex, SYSTEM_CLOCK));
+  }
+
+  this->writeAccessUnit(accessUnit, DTS, PTS);
+  this->nrAccessUnits++;
+  this->currentAccessUnit = {};
+}
+
+void FileSinkTS::writeAccessUnit(const AccessUnit &accessUnit, const int64_t DTS, const int64_t PTS)
+{
+  ScopedTimer      timer(getCounter(this->statistics, &OutputStatistics::writeTime));
+  ScopedTraceEvent traceEvent("write");
+
+  this->packetBuffer.clear();
+
+  // Without a mux rate, all packets of the access unit are sent at the same time. With a mux
+  // rate, the time of each packet follows from its position and null packets are inserted until
+  // it is time to send the access unit.
+  const auto accessUnitTime = DTS - MUX_DELAY;
+  if (this->muxRate)
+  {
+    if (!this->timeOfFirstPacket)
+      this->timeOfFirstPacket = accessUnitTime;
+    this->addNullPackets(accessUnitTime);
+  }
+  const auto getPacketTime = [&]()
+  { return this->muxRate ? this->getTimeOfNextPacket() : accessUnitTime; };
+
+  if (accessUnit.picture->isIRAP || !this->lastPSITime ||
+      getPacketTime() - *this->lastPSITime >= PSI_INTERVAL)
+  {
+    this->lastPSITime = getPacketTime();
+    this->addSectionPacket(PAT_PID, this->programAssociationSection, this->patContinuityCounter);
+    this->addSectionPacket(PMT_PID, this->programMapSection, this->pmtContinuityCounter);
+  }
+
+  // The PES header with an unbounded length. The DTS is only written if it differs from the PTS.
+  std::array<uint8_t, 19> pesHeader = {0x00, 0x00, 0x01, STREAM_ID_VIDEO, 0x00, 0x00, 0x84};
+  size_t                  pesHeaderSize = 9;
+  if (DTS == PTS)
+  {
+    pesHeader[7] = 0x80;
+    pesHeader[8] = 5;
+    writeTimestamp(pesHeader.data() + 9, 0x2, PTS);
+    pesHeaderSize += 5;
+  }
+  else
+  {
+    pesHeader[7] = 0xC0;
+    pesHeader[8] = 10;
+    writeTimestamp(pesHeader.data() + 9, 0x3, PTS);
+    writeTimestamp(pesHeader.data() + 14, 0x1, DTS);
+    pesHeaderSize += 10;
+  }
+
+  this->payloadRanges.clear();
+  this->payloadRanges.push_back({pesHeader.data(), pesHeaderSize});
+  size_t payloadSize = pesHeaderSize;
+  for (const auto &nal : accessUnit.nalUnits)
+  {
+    this->payloadRanges.push_back({START_CODE.data(), START_CODE.size()});
+    this->payloadRanges.push_back({nal.data(), nal.size()});
+    payloadSize += START_CODE.size() + nal.size();
+  }
+
+  size_t rangeIndex  = 0;
+  size_t rangeOffset = 0;
+  bool   firstPacket = true;
+  while (payloadSize > 0)
+  {
+    const auto packetTime   = getPacketTime();
+    const auto withPCR      = this->isPCRNeeded(packetTime, firstPacket);
+    const auto randomAccess = firstPacket && accessUnit.picture->isIRAP;
+
+    // The adaptation field carries the PCR and the random access indicator and fills up the
+    // last packet
+    size_t adaptationFieldSize = withPCR ? 8 : (randomAccess ? 2 : 0);
+    if (payloadSize < PACKET_PAYLOAD_SIZE - adaptationFieldSize)
+      adaptationFieldSize = PACKET_PAYLOAD_SIZE - payloadSize;
+
+    const auto packet = this->addPacket();
+    writePacketHeader(packet,
+                      VIDEO_PID,
+                      firstPacket,
+                      adaptationFieldSize > 0 ? 0x3 : 0x1,
+                      this->videoContinuityCounter);
+    this->videoContinuityCounter = (this->videoContinuityCounter + 1) & 0x0f;
+
+    if (adaptationFieldSize > 0)
+    {
+      packet[4] = static_cast<uint8_t>(adaptationFieldSize - 1);
+      if (adaptationFieldSize > 1)
+      {
+        packet[5] = static_cast<uint8_t>((randomAccess ? 0x40 : 0x00) | (withPCR ? 0x10 : 0x00));
+        size_t offset = 6;
+        if (withPCR)
+        {
+          writePCR(packet + offset, packetTime);
+          offset += 6;
+          this->lastPCR = packetTime;
+        }
+        std::memset(packet + offset, 0xff, PACKET_HEADER_SIZE + adaptationFieldSize - offset);
+      }
+    }
+
+    auto destination = packet + PACKET_HEADER_SIZE + adaptationFieldSize;
+    auto bytesToCopy = PACKET_PAYLOAD_SIZE - adaptationFieldSize;
+    payloadSize -= bytesToCopy;
+    while (bytesToCopy > 0)
+    {
+      const auto &range = this->payloadRanges.at(rangeIndex);
+      const auto  size  = std::min(bytesToCopy, range.size - rangeOffset);
+      std::memcpy(destination, range.data + rangeOffset, size);
+      destination += size;
+      bytesToCopy -= size;
+      rangeOffset += size;
+      if (rangeOffset == range.size)
+      {
+        rangeIndex++;
+        rangeOffset = 0;
+      }
+    }
+    firstPacket = false;
+  }
+
+  this->lastAccessUnitTime = accessUnitTime;
+
+  if (this->muxRate && this->getTimeOfNextPacket() > DTS && !this->muxRateTooLowWarned)
+  {
+    logger().warning("The mux rate is too low. Access unit " + std::to_string(this->nrAccessUnits) +
+                     " is sent after its decoding time.");
+    this->muxRateTooLowWarned = true;
+  }
+
+  this->outputFile.write(this->packetBuffer);
+  addToCounter(getCounter(this->statistics, &OutputStatistics::bytesWritten),
+               this->packetBuffer.size());
+}
+
+bool FileSinkTS::isPCRNeeded(const int64_t packetTime, const bool firstPacketOfAccessUnit) const
+{
+  if (!this->lastPCR || packetTime - *this->lastPCR >= this->pcrInterval)
+    return true;
+
+  // Without a mux rate, the packets in between access units have no time of their own. The PCR
+  // is also sent if the interval would be exceeded at the next access unit.
+  if (!this->muxRate && firstPacketOfAccessUnit && this->lastAccessUnitTime)
+    return (packetTime - *this->lastPCR) + (packetTime - *this->lastAccessUnitTime) >
+           this->pcrInterval;
+  return false;
+}
+
+int64_t FileSinkTS::getTimeOfNextPacket() const
+{
+  const auto bitsWritten = static_cast<double>(this->nrPacketsWritten) * PACKET_SIZE * 8;
+  return this->timeOfFirstPacket.value() +
+         static_cast<int64_t>(bitsWritten * SYSTEM_CLOCK / static_cast<double>(*this->muxRate));
+}
+
+uint8_t *FileSinkTS::addPacket()
+{
+  // The buffer keeps its capacity, so this only allocates if an access unit is larger than all
+  // before it
+  const auto offset = this->packetBuffer.size();
+  this->packetBuffer.resize(offset + PACKET_SIZE);
+  this->nrPacketsWritten++;
+  return this->packetBuffer.data() + offset;
+}
+
+void FileSinkTS::addSectionPacket(const uint16_t    PID,
+                                  const ByteVector &section,
+                                  uint8_t          &continuityCounter)
+{
+  const auto packet = this->addPacket();
+  writePacketHeader(packet, PID, true, 0x1, continuityCounter);
+  continuityCounter = (continuityCounter + 1) & 0x0f;
+
+  // The pointer field, the section and stuffing
+  packet[4] = 0;
+  std::memcpy(packet + 5, section.data(), section.size());
+  std::memset(packet + 5 + section.size(), 0xff, PACKET_SIZE - 5 - section.size());
+}
+
+void FileSinkTS::addPCRPacket(const int64_t PCR)
+{
+  // Only an adaptation field. The continuity counter is not incremented without a payload.
+  const auto packet = this->addPacket();
+  writePacketHeader(packet, VIDEO_PID, false, 0x2, (this->videoContinuityCounter + 15) & 0x0f);
+  packet[4] = static_cast<uint8_t>(PACKET_PAYLOAD_SIZE - 1);
+  packet[5] = 0x10;
+  writePCR(packet + 6, PCR);
+  std::memset(packet + 12, 0xff, PACKET_SIZE - 12);
+  this->lastPCR = PCR;
+}
+
+void FileSinkTS::addNullPackets(const int64_t untilTime)
+{
+  if (untilTime - this->getTimeOfNextPacket() > MAX_NULL_PACKET_GAP)
+  {
+    logger().warning("Gap in the timestamps. Restarting the constant mux rate.");
+    *this->timeOfFirstPacket += untilTime - this->getTimeOfNextPacket();
+  }
+
+  while (this->getTimeOfNextPacket() < untilTime)
+  {
+    const auto packetTime = this->getTimeOfNextPacket();
+    if (this->lastPCR && packetTime - *this->lastPCR >= this->pcrInterval)
+    {
+      this->addPCRPacket(packetTime);
+      continue;
+    }
+    const auto packet = this->addPacket();
+    writePacketHeader(packet, NULL_PID, false, 0x1, 0);
+    std::memset(packet + PACKET_HEADER_SIZE, 0xff, PACKET_PAYLOAD_SIZE);
+  }
+}
+
+} // namespace combiner
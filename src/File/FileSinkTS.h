@@ -0,0 +1,91 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+
+#include "NalUnitSink.h"
+#include "OutputFile.h"
+
+#include <HEVC/AccessUnitTiming.h>
+
+#include <chrono>
+#include <filesystem>
+#include <optional>
+#include <vector>
+
+namespace combiner
+{
+
+/* Writes the NAL units as an MPEG-2 transport stream with one program and one HEVC stream.
+ * Each access unit is written as one PES packet. The PTS/DTS are taken from the input (if it has
+ * decoding timestamps) or calculated from the VUI timing and the POC of the pictures. The PAT and
+ * PMT are repeated at every IRAP picture and at least every 100 ms. The PCR is carried on the video
+ * PID and inserted at least every pcrInterval (or with every access unit if they are further
+ * apart). With a mux rate, the stream is written with a constant bit rate by inserting null packets
+ * and the PCR follows the position in the stream.
+ * The packets of an access unit are filled from the NAL units directly into one packet buffer that
+ * is reused for all access units.
+ */
+class FileSinkTS : public NalUnitSink
+{
+public:
+  FileSinkTS(const std::filesystem::path &filePath,
+             std::chrono::milliseconds    pcrInterval = std::chrono::milliseconds(40),
+             std::optional<uint64_t>      muxRate     = {});
+
+  void writeNALUnit(const ByteVector &nalData) override;
+  void setTimestampsOfNextNALUnits(const Timestamps &timestamps) override;
+  void finish() override;
+
+private:
+  struct AccessUnit
+  {
+    std::vector<ByteVector>                                nalUnits;
+    std::optional<parser::hevc::AccessUnitTiming::Picture> picture{};
+    Timestamps                                             inputTimestamps{};
+  };
+
+  void     finishAccessUnit();
+  void     writeAccessUnit(const AccessUnit &accessUnit, const int64_t DTS, const int64_t PTS);
+  bool     isPCRNeeded(const int64_t packetTime, const bool firstPacketOfAccessUnit) const;
+  int64_t  getTimeOfNextPacket() const;
+  uint8_t *addPacket();
+  void     addSectionPacket(const uint16_t    PID,
+                            const ByteVector &section,
+                            uint8_t          &continuityCounter);
+  void     addPCRPacket(const int64_t PCR);
+  void     addNullPackets(const int64_t untilTime);
+
+  OutputFile              outputFile;
+  int64_t                 pcrInterval{};
+  std::optional<uint64_t> muxRate{};
+
+  parser::hevc::AccessUnitTiming accessUnitTiming;
+
+  AccessUnit             currentAccessUnit;
+  Timestamps             nextTimestamps{};
+  std::optional<int64_t> inputTimestampOffset{};
+  uint64_t               nrAccessUnits{};
+
+  ByteVector programAssociationSection;
+  ByteVector programMapSection;
+
+  // All times are in units of the 27 MHz system clock
+  ByteVector             packetBuffer;
+  std::vector<ByteRange> payloadRanges;
+  uint64_t               nrPacketsWritten{};
+  std::optional<int64_t> timeOfFirstPacket{};
+  std::optional<int64_t> lastPCR{};
+  std::optional<int64_t> lastPSITime{};
+  std::optional<int64_t> lastAccessUnitTime{};
+  bool                   muxRateTooLowWarned{};
+
+  uint8_t patContinuityCounter{};
+  uint8_t pmtContinuityCounter{};
+  uint8_t videoContinuityCounter{};
+};
+
+} // namespace combiner
@@ -27,7 +27,9 @@ void removeTailingZeroByte(ByteVector &data)
 
 } // namespace
 
-FileSourceAnnexB::FileSourceAnnexB(const std::filesystem::path &filePath)
+FileSourceAnnexB::FileSourceAnnexB(const std::filesystem::path   &filePath,
+                                   std::shared_ptr<const NalIndex> index)
+    : filePath(filePath), index(std::move(index))
 {
   this->inputFile.open(filePath, std::ios_base::binary);
 
@@ -35,6 +37,13 @@ FileSourceAnnexB::FileSourceAnnexB(const std::filesystem::path &filePath)
     throw std::runtime_error("Error opening input file " + filePath.string());
 
   this->fileBuffer.resize(BUFFERSIZE);
+  this->fileBufferPosition = this->fileBuffer.begin();
+  this->fileBufferEnd      = this->fileBuffer.begin();
+
+  // With an index, the first buffer is read at the offset of the first NAL unit that is read
+  if (this->index)
+    return;
+
   this->readNextBuffer();
   this->seekToFirstNAL();
 }
@@ -52,23 +61,126 @@ void FileSourceAnnexB::seekToFirstNAL()
 
 void FileSourceAnnexB::readNextBuffer()
 {
+  ScopedTraceEvent traceEvent("read", this->traceArguments);
+
   this->inputFile.read(reinterpret_cast<char *>(this->fileBuffer.data()), BUFFERSIZE);
-  const auto bytesRead     = this->inputFile.gcount();
-  this->fileBufferPosition = this->fileBuffer.begin();
-  this->fileBufferEnd      = this->fileBuffer.begin() + bytesRead;
-  this->canReadMoreData    = (bytesRead == BUFFERSIZE);
+  const auto bytesRead       = this->inputFile.gcount();
+  this->fileBufferPosition   = this->fileBuffer.begin();
+  this->fileBufferEnd        = this->fileBuffer.begin() + bytesRead;
+  this->canReadMoreData      = (bytesRead == BUFFERSIZE);
+  this->fileBufferFileOffset = this->nextReadFileOffset;
+  this->nextReadFileOffset += static_cast<uint64_t>(bytesRead);
+
+  this->totalBytesRead += static_cast<uint64_t>(bytesRead);
+  addToCounter(getCounter(this->statistics, &InputStatistics::bytesRead),
+               static_cast<uint64_t>(bytesRead));
+}
+
+void FileSourceAnnexB::readBufferAt(const uint64_t fileOffset)
+{
+  this->inputFile.clear();
+  this->inputFile.seekg(static_cast<std::streamoff>(fileOffset));
+  this->nextReadFileOffset = fileOffset;
+  this->readNextBuffer();
+}
+
+ByteVector FileSourceAnnexB::readFromFile(const uint64_t fileOffset, const size_t size)
+{
+  const auto bufferedSize = static_cast<uint64_t>(this->fileBufferEnd - this->fileBuffer.begin());
+  if (fileOffset < this->fileBufferFileOffset ||
+      fileOffset > this->fileBufferFileOffset + bufferedSize)
+    this->readBufferAt(fileOffset);
+
+  ByteVector data;
+  data.reserve(size);
+  auto position = this->fileBuffer.begin() + (fileOffset - this->fileBufferFileOffset);
+  while (true)
+  {
+    const auto bytesToCopy =
+        std::min(size - data.size(), static_cast<size_t>(this->fileBufferEnd - position));
+    data.insert(data.end(), position, position + bytesToCopy);
+    position += bytesToCopy;
+    if (data.size() == size)
+      break;
+
+    if (!this->canReadMoreData)
+      throw std::runtime_error("NAL index does not match the input file (file too short)");
+    this->readNextBuffer();
+    position = this->fileBuffer.begin();
+  }
+
+  this->fileBufferPosition = position;
+  return data;
 }
 
 ByteVector FileSourceAnnexB::getNextNALUnit()
 {
+  this->lastNALUnitIsFromFile = true;
+  if (!this->readPlan)
+    return this->readNextNALUnitFromFile();
+
+  auto &prefixNalUnits = this->readPlan->prefixNalUnits;
+  if (this->nextPrefixNalUnit < prefixNalUnits.size())
+  {
+    this->lastNALUnitIsFromFile = false;
+    return std::move(prefixNalUnits.at(this->nextPrefixNalUnit++));
+  }
+
+  while (true)
+  {
+    auto       nalData = this->readNextNALUnitFromFile();
+    const auto offset  = this->lastNALUnitFileOffset;
+    if (nalData.empty() || this->isAfterEnd(offset))
+      return {};
+    if (!this->isSkipped(offset))
+      return nalData;
+  }
+}
+
+bool FileSourceAnnexB::isAfterEnd(const uint64_t fileOffset) const
+{
+  return this->readPlan->endOffset && fileOffset >= *this->readPlan->endOffset;
+}
+
+bool FileSourceAnnexB::isSkipped(const uint64_t fileOffset)
+{
+  const auto &skippedOffsets = this->readPlan->skippedOffsets;
+  while (this->nextSkippedOffset < skippedOffsets.size() &&
+         skippedOffsets.at(this->nextSkippedOffset) < fileOffset)
+    ++this->nextSkippedOffset;
+  return this->nextSkippedOffset < skippedOffsets.size() &&
+         skippedOffsets.at(this->nextSkippedOffset) == fileOffset;
+}
+
+ByteVector FileSourceAnnexB::readNextNALUnitFromFile()
+{
+  if (this->index)
+  {
+    if (this->nextIndexEntry >= this->index->entries.size())
+      return {};
+    const auto &entry           = this->index->entries.at(this->nextIndexEntry++);
+    this->lastNALUnitFileOffset = entry.offset;
+    return this->readFromFile(entry.offset, entry.size);
+  }
+
   if (!this->canReadMoreData && this->fileBufferPosition == this->fileBufferEnd)
     return {};
 
+  this->lastNALUnitFileOffset =
+      this->fileBufferFileOffset +
+      static_cast<uint64_t>(this->fileBufferPosition - this->fileBuffer.begin());
+
   ByteVector nalData;
   while (true)
   {
-    const auto nextStartCodePosition = std::search(
-        this->fileBufferPosition, this->fileBufferEnd, std::begin(STARTCODE), std::end(STARTCODE));
+    ByteVector::iterator nextStartCodePosition;
+    {
+      ScopedTimer timer(getCounter(this->statistics, &InputStatistics::startCodeScanTime));
+      nextStartCodePosition = std::search(this->fileBufferPosition,
+                                          this->fileBufferEnd,
+                                          std::begin(STARTCODE),
+                                          std::end(STARTCODE));
+    }
     if (nextStartCodePosition != this->fileBufferEnd)
     {
       nalData.insert(nalData.end(), this->fileBufferPosition, nextStartCodePosition);
@@ -98,6 +210,43 @@ ByteVector FileSourceAnnexB::getNextNALUnit()
   }
 }
 
+uint64_t FileSourceAnnexB::getFileOffsetOfLastNALUnit() const
+{
+  return this->lastNALUnitFileOffset;
+}
+
+const std::filesystem::path *FileSourceAnnexB::getFileOfLastNALUnit() const
+{
+  return this->lastNALUnitIsFromFile ? &this->filePath : nullptr;
+}
+
+void FileSourceAnnexB::setReadPlan(NalReadPlan &&plan)
+{
+  this->readPlan          = std::move(plan);
+  this->nextPrefixNalUnit = 0;
+  this->nextSkippedOffset = 0;
+
+  const auto startOffset = this->readPlan->startOffset;
+  if (this->index)
+  {
+    const auto &entries = this->index->entries;
+    const auto  startEntry =
+        std::find_if(entries.begin(), entries.end(), [startOffset](const NalIndexEntry &entry) {
+          return entry.offset >= startOffset;
+        });
+    this->nextIndexEntry = static_cast<size_t>(std::distance(entries.begin(), startEntry));
+  }
+  else
+    this->readBufferAt(startOffset);
+}
+
+void FileSourceAnnexB::setStatistics(InputStatistics *statistics)
+{
+  this->statistics = statistics;
+  // The first buffer is already read in the constructor
+  addToCounter(getCounter(this->statistics, &InputStatistics::bytesRead), this->totalBytesRead);
+}
+
 std::optional<FileSourceAnnexB::BorderCaseResult>
 FileSourceAnnexB::analyzeIfStartCodeOnBufferBoder(ByteVector last2BytesInLastBuffer)
 {
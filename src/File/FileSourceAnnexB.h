@@ -6,27 +6,45 @@
 
 #pragma once
 
-#include <common/Typedef.h>
+#include "NalIndex.h"
+#include "NalReadPlan.h"
+#include "NalUnitSource.h"
 
 #include <filesystem>
 #include <fstream>
+#include <memory>
 #include <optional>
 
 namespace combiner
 {
 
-class FileSourceAnnexB
+class FileSourceAnnexB : public NalUnitSource
 {
 public:
   FileSourceAnnexB() = default;
-  FileSourceAnnexB(const std::filesystem::path &filePath);
+  // With an index, the NAL units are read at the offsets from the index instead of scanning for
+  // start codes. The index can be shared by multiple sources that read from the same file.
+  FileSourceAnnexB(const std::filesystem::path &filePath,
+                   std::shared_ptr<const NalIndex> index = {});
 
-  // Get the raw data of the NAL unit without the start code
-  ByteVector getNextNALUnit();
+  ByteVector getNextNALUnit() override;
+  uint64_t   getFileOffsetOfLastNALUnit() const override;
+
+  const std::filesystem::path *getFileOfLastNALUnit() const override;
+
+  // Only read the NAL units from the plan.
+  void setReadPlan(NalReadPlan &&plan);
+
+  void setStatistics(InputStatistics *statistics) override;
 
 private:
-  void seekToFirstNAL();
-  void readNextBuffer();
+  void       seekToFirstNAL();
+  void       readNextBuffer();
+  void       readBufferAt(const uint64_t fileOffset);
+  ByteVector readFromFile(const uint64_t fileOffset, const size_t size);
+  ByteVector readNextNALUnitFromFile();
+  bool       isAfterEnd(const uint64_t fileOffset) const;
+  bool       isSkipped(const uint64_t fileOffset);
 
   struct BorderCaseResult
   {
@@ -36,12 +54,27 @@ private:
   std::optional<BorderCaseResult>
   analyzeIfStartCodeOnBufferBoder(ByteVector last3BytesInLastBuffer);
 
-  std::ifstream        inputFile{};
+  std::filesystem::path filePath{};
+  std::ifstream         inputFile{};
   ByteVector           fileBuffer{};
   ByteVector::iterator fileBufferPosition{};
   ByteVector::iterator fileBufferEnd{};
 
   bool canReadMoreData{true};
+
+  uint64_t fileBufferFileOffset{};
+  uint64_t nextReadFileOffset{};
+  uint64_t lastNALUnitFileOffset{};
+  bool     lastNALUnitIsFromFile{};
+
+  std::shared_ptr<const NalIndex> index{};
+  size_t                          nextIndexEntry{};
+
+  std::optional<NalReadPlan> readPlan{};
+  size_t                     nextPrefixNalUnit{};
+  size_t                     nextSkippedOffset{};
+
+  uint64_t totalBytesRead{};
 };
 
 } // namespace combiner
@@ -0,0 +1,91 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include "FileSourceLengthPrefixed.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+namespace combiner
+{
+
+namespace
+{
+
+constexpr size_t LENGTH_SIZE = 4;
+
+// The size of a NAL unit is only known to be valid once its data was read. Larger NAL units are
+// read in parts so that an invalid size does not allocate up to 4 GB at once.
+constexpr size_t MAX_READ_SIZE = 16 * 1024 * 1024;
+
+const std::string LENGTH_PREFIXED_EXTENSION = ".hvcl";
+
+} // namespace
+
+FileSourceLengthPrefixed::FileSourceLengthPrefixed(const std::filesystem::path &filePath)
+    : filePath(filePath)
+{
+  this->inputFile.open(filePath, std::ios_base::binary);
+  if (!this->inputFile)
+    throw std::runtime_error("Error opening input file " + filePath.string());
+}
+
+bool FileSourceLengthPrefixed::isLengthPrefixedFile(const std::filesystem::path &filePath)
+{
+  return filePath.extension() == LENGTH_PREFIXED_EXTENSION;
+}
+
+ByteVector FileSourceLengthPrefixed::getNextNALUnit()
+{
+  ScopedTraceEvent traceEvent("read", this->traceArguments);
+
+  uint8_t lengthBytes[LENGTH_SIZE]{};
+  this->inputFile.read(reinterpret_cast<char *>(lengthBytes), LENGTH_SIZE);
+  if (this->inputFile.gcount() == 0)
+    return {};
+  if (static_cast<size_t>(this->inputFile.gcount()) != LENGTH_SIZE)
+    throw std::runtime_error("The length prefix at offset " + std::to_string(this->filePosition) +
+                             " of " + this->filePath.string() + " is truncated");
+
+  const auto size = (uint64_t(lengthBytes[0]) << 24) | (uint64_t(lengthBytes[1]) << 16) |
+                    (uint64_t(lengthBytes[2]) << 8) | uint64_t(lengthBytes[3]);
+  const auto nalFileOffset = this->filePosition + LENGTH_SIZE;
+  if (size == 0)
+    throw std::runtime_error("Invalid NAL unit size 0 at offset " +
+                             std::to_string(this->filePosition) + " of " +
+                             this->filePath.string());
+
+  ByteVector nalData;
+  while (nalData.size() < size)
+  {
+    const auto position = nalData.size();
+    nalData.resize(position + std::min(static_cast<size_t>(size) - position, MAX_READ_SIZE));
+    this->inputFile.read(reinterpret_cast<char *>(nalData.data() + position),
+                         static_cast<std::streamsize>(nalData.size() - position));
+    if (static_cast<size_t>(this->inputFile.gcount()) != nalData.size() - position)
+      throw std::runtime_error("The NAL unit of size " + std::to_string(size) + " at offset " +
+                               std::to_string(nalFileOffset) + " of " + this->filePath.string() +
+                               " is truncated");
+  }
+
+  this->lastNALUnitFileOffset = nalFileOffset;
+  this->filePosition          = nalFileOffset + size;
+  addToCounter(getCounter(this->statistics, &InputStatistics::bytesRead), LENGTH_SIZE + size);
+  return nalData;
+}
+
+uint64_t FileSourceLengthPrefixed::getFileOffsetOfLastNALUnit() const
+{
+  return this->lastNALUnitFileOffset;
+}
+
+const std::filesystem::path *FileSourceLengthPrefixed::getFileOfLastNALUnit() const
+{
+  return &this->filePath;
+}
+
+} // namespace combiner
@@ -0,0 +1,44 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+
+#include "NalUnitSource.h"
+
+#include <filesystem>
+#include <fstream>
+
+namespace combiner
+{
+
+/* Reads NAL units from a length prefixed file in which each NAL unit is preceded by its size as a
+ * 4 byte big endian number (like the samples of an hvc1 track). There are no start codes to scan
+ * for. Each NAL unit is read with one read of the known size directly into its own buffer.
+ * The file is read until its end, so it can also be a pipe. An invalid or truncated length prefix
+ * or NAL unit is an error.
+ * These files are recognized by their extension (.hvcl).
+ */
+class FileSourceLengthPrefixed : public NalUnitSource
+{
+public:
+  FileSourceLengthPrefixed(const std::filesystem::path &filePath);
+
+  static bool isLengthPrefixedFile(const std::filesystem::path &filePath);
+
+  ByteVector getNextNALUnit() override;
+  uint64_t   getFileOffsetOfLastNALUnit() const override;
+
+  const std::filesystem::path *getFileOfLastNALUnit() const override;
+
+private:
+  std::filesystem::path filePath{};
+  std::ifstream         inputFile{};
+  uint64_t              filePosition{};
+
+  uint64_t lastNALUnitFileOffset{};
+};
+
+} // namespace combiner
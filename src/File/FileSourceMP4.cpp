@@ -0,0 +1,607 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include "FileSourceMP4.h"
+
+#include <HEVC/nal_unit_header.h>
+
+#include <algorithm>
+#include <map>
+#include <optional>
+#include <stdexcept>
+#include <string>
+
+namespace combiner
+{
+
+namespace
+{
+
+constexpr auto BOX_HEADER_SIZE          = 8u;
+constexpr auto VISUAL_SAMPLE_ENTRY_SIZE = 78u;
+
+constexpr uint32_t TFHD_BASE_DATA_OFFSET_PRESENT         = 0x000001;
+constexpr uint32_t TFHD_SAMPLE_DESCRIPTION_INDEX_PRESENT = 0x000002;
+constexpr uint32_t TFHD_DEFAULT_SAMPLE_DURATION_PRESENT  = 0x000008;
+constexpr uint32_t TFHD_DEFAULT_SAMPLE_SIZE_PRESENT      = 0x000010;
+constexpr uint32_t TFHD_DEFAULT_SAMPLE_FLAGS_PRESENT     = 0x000020;
+constexpr uint32_t TFHD_DEFAULT_BASE_IS_MOOF             = 0x020000;
+
+constexpr uint32_t TRUN_DATA_OFFSET_PRESENT                     = 0x000001;
+constexpr uint32_t TRUN_FIRST_SAMPLE_FLAGS_PRESENT              = 0x000004;
+constexpr uint32_t TRUN_SAMPLE_DURATION_PRESENT                 = 0x000100;
+constexpr uint32_t TRUN_SAMPLE_SIZE_PRESENT                     = 0x000200;
+constexpr uint32_t TRUN_SAMPLE_FLAGS_PRESENT                    = 0x000400;
+constexpr uint32_t TRUN_SAMPLE_COMPOSITION_TIME_OFFSETS_PRESENT = 0x000800;
+
+// A box in a buffer. The positions are relative to the start of the buffer.
+struct Box
+{
+  std::string type;
+  size_t      payloadStart{};
+  size_t      end{};
+};
+
+// Reads big endian values from a buffer
+class BoxReader
+{
+public:
+  BoxReader(const ByteVector &data, const size_t start, const size_t end)
+      : data(data), position(start), end(end)
+  {
+  }
+  BoxReader(const ByteVector &data, const Box &box) : BoxReader(data, box.payloadStart, box.end) {}
+
+  uint64_t readValue(const unsigned nrBytes)
+  {
+    if (this->position + nrBytes > this->end)
+      throw std::runtime_error("Unexpected end of MP4 box");
+    uint64_t value = 0;
+    for (unsigned i = 0; i < nrBytes; ++i)
+      value = (value << 8) | this->data.at(this->position++);
+    return value;
+  }
+  uint32_t readU8() { return static_cast<uint32_t>(this->readValue(1)); }
+  uint32_t readU16() { return static_cast<uint32_t>(this->readValue(2)); }
+  uint32_t readU32() { return static_cast<uint32_t>(this->readValue(4)); }
+  uint64_t readU64() { return this->readValue(8); }
+
+  std::string readType()
+  {
+    if (this->position + 4 > this->end)
+      throw std::runtime_error("Unexpected end of MP4 box");
+    std::string type(this->data.begin() + this->position, this->data.begin() + this->position + 4);
+    this->position += 4;
+    return type;
+  }
+
+  void skip(const size_t nrBytes)
+  {
+    if (this->position + nrBytes > this->end)
+      throw std::runtime_error("Unexpected end of MP4 box");
+    this->position += nrBytes;
+  }
+
+  size_t getPosition() const { return this->position; }
+
+private:
+  const ByteVector &data;
+  size_t            position{};
+  size_t            end{};
+};
+
+std::vector<Box> parseBoxes(const ByteVector &data, size_t position, const size_t end)
+{
+  std::vector<Box> boxes;
+  while (position + BOX_HEADER_SIZE <= end)
+  {
+    BoxReader reader(data, position, end);
+    uint64_t  size = reader.readU32();
+
+    Box box;
+    box.type = reader.readType();
+    if (size == 1)
+      size = reader.readU64();
+    else if (size == 0)
+      size = end - position;
+
+    if (size < reader.getPosition() - position || size > end - position)
+      throw std::runtime_error("Invalid size of MP4 box " + box.type);
+
+    box.payloadStart = reader.getPosition();
+    box.end          = position + static_cast<size_t>(size);
+    boxes.push_back(box);
+    position = box.end;
+  }
+  return boxes;
+}
+
+std::vector<Box> parseChildBoxes(const ByteVector &data, const Box &parent)
+{
+  return parseBoxes(data, parent.payloadStart, parent.end);
+}
+
+std::optional<Box> findChildBox(const ByteVector &data, const Box &parent, const std::string &type)
+{
+  for (const auto &box : parseChildBoxes(data, parent))
+    if (box.type == type)
+      return box;
+  return {};
+}
+
+Box getChildBox(const ByteVector &data, const Box &parent, const std::string &type)
+{
+  if (auto box = findChildBox(data, parent, type))
+    return *box;
+  throw std::runtime_error("Missing MP4 box " + type + " in box " + parent.type);
+}
+
+// A box on the top level of the file. The positions are file offsets.
+struct FileBox
+{
+  std::string type;
+  uint64_t    offset{};
+  uint64_t    size{};
+};
+
+FileBox parseFileBoxHeader(const ByteVector &header, const uint64_t offset, const uint64_t fileSize)
+{
+  BoxReader reader(header, 0, header.size());
+  FileBox   box;
+  box.offset = offset;
+  box.size   = reader.readU32();
+  box.type   = reader.readType();
+  if (box.size == 1)
+    box.size = reader.readU64();
+  else if (box.size == 0)
+    box.size = fileSize - offset;
+
+  if (box.size < BOX_HEADER_SIZE || box.size > fileSize - offset)
+    throw std::runtime_error("Invalid size of MP4 box " + box.type + " at offset " +
+                             std::to_string(offset));
+  return box;
+}
+
+struct HEVCTrack
+{
+  uint32_t trackID{};
+  Box      stbl;
+  Box      hvcC;
+};
+
+std::optional<HEVCTrack> findHEVCTrack(const ByteVector &moov, const Box &trak)
+{
+  const auto mdia = getChildBox(moov, trak, "mdia");
+
+  BoxReader hdlrReader(moov, getChildBox(moov, mdia, "hdlr"));
+  hdlrReader.skip(8);
+  if (hdlrReader.readType() != "vide")
+    return {};
+
+  const auto stbl = getChildBox(moov, getChildBox(moov, mdia, "minf"), "stbl");
+  const auto stsd = getChildBox(moov, stbl, "stsd");
+
+  const auto sampleEntries = parseBoxes(moov, stsd.payloadStart + 8, stsd.end);
+  if (sampleEntries.empty())
+    return {};
+  auto sampleEntry = sampleEntries.front();
+  if (sampleEntry.type != "hvc1" && sampleEntry.type != "hev1")
+    return {};
+
+  HEVCTrack track;
+  track.stbl = stbl;
+
+  // The child boxes of a visual sample entry follow after its fixed fields
+  sampleEntry.payloadStart += VISUAL_SAMPLE_ENTRY_SIZE;
+  track.hvcC = getChildBox(moov, sampleEntry, "hvcC");
+
+  BoxReader  tkhdReader(moov, getChildBox(moov, trak, "tkhd"));
+  const auto version = tkhdReader.readU8();
+  tkhdReader.skip(3 + (version == 1 ? 16 : 8));
+  track.trackID = tkhdReader.readU32();
+  return track;
+}
+
+std::vector<uint64_t> parseSampleSizes(const ByteVector &moov, const Box &stbl)
+{
+  std::vector<uint64_t> sampleSizes;
+  if (const auto stsz = findChildBox(moov, stbl, "stsz"))
+  {
+    BoxReader reader(moov, *stsz);
+    reader.skip(4);
+    const auto sampleSize  = reader.readU32();
+    const auto sampleCount = reader.readU32();
+    for (uint32_t i = 0; i < sampleCount; ++i)
+      sampleSizes.push_back(sampleSize == 0 ? reader.readU32() : sampleSize);
+  }
+  else if (const auto stz2 = findChildBox(moov, stbl, "stz2"))
+  {
+    BoxReader reader(moov, *stz2);
+    reader.skip(7);
+    const auto fieldSize   = reader.readU8();
+    const auto sampleCount = reader.readU32();
+    if (fieldSize != 4 && fieldSize != 8 && fieldSize != 16)
+      throw std::runtime_error("Invalid field size in MP4 box stz2");
+    uint32_t byte = 0;
+    for (uint32_t i = 0; i < sampleCount; ++i)
+    {
+      if (fieldSize == 4)
+      {
+        if (i % 2 == 0)
+          byte = reader.readU8();
+        sampleSizes.push_back((i % 2 == 0) ? (byte >> 4) : (byte & 0x0f));
+      }
+      else
+        sampleSizes.push_back(reader.readValue(fieldSize / 8));
+    }
+  }
+  return sampleSizes;
+}
+
+std::vector<uint64_t> parseChunkOffsets(const ByteVector &moov, const Box &stbl)
+{
+  std::vector<uint64_t> chunkOffsets;
+  const auto            stco = findChildBox(moov, stbl, "stco");
+  const auto            co64 = findChildBox(moov, stbl, "co64");
+  if (!stco && !co64)
+    return chunkOffsets;
+
+  BoxReader reader(moov, stco ? *stco : *co64);
+  reader.skip(4);
+  const auto entryCount = reader.readU32();
+  for (uint32_t i = 0; i < entryCount; ++i)
+    chunkOffsets.push_back(stco ? reader.readU32() : reader.readU64());
+  return chunkOffsets;
+}
+
+// Get the position of all samples of the (not fragmented) track from the sample table
+std::vector<std::pair<uint64_t, uint64_t>> parseSampleTable(const ByteVector &moov,
+                                                            const Box        &stbl)
+{
+  const auto sampleSizes  = parseSampleSizes(moov, stbl);
+  const auto chunkOffsets = parseChunkOffsets(moov, stbl);
+
+  struct SampleToChunkEntry
+  {
+    uint32_t firstChunk{};
+    uint32_t samplesPerChunk{};
+  };
+  std::vector<SampleToChunkEntry> sampleToChunkEntries;
+  if (const auto stsc = findChildBox(moov, stbl, "stsc"))
+  {
+    BoxReader reader(moov, *stsc);
+    reader.skip(4);
+    const auto entryCount = reader.readU32();
+    for (uint32_t i = 0; i < entryCount; ++i)
+    {
+      SampleToChunkEntry entry;
+      entry.firstChunk      = reader.readU32();
+      entry.samplesPerChunk = reader.readU32();
+      reader.skip(4);
+      sampleToChunkEntries.push_back(entry);
+    }
+  }
+
+  std::vector<std::pair<uint64_t, uint64_t>> samples;
+  size_t                                     entryIndex = 0;
+  for (uint32_t chunk = 1; chunk <= chunkOffsets.size() && samples.size() < sampleSizes.size();
+       ++chunk)
+  {
+    while (entryIndex + 1 < sampleToChunkEntries.size() &&
+           sampleToChunkEntries.at(entryIndex + 1).firstChunk <= chunk)
+      ++entryIndex;
+    if (sampleToChunkEntries.empty())
+      throw std::runtime_error("Missing MP4 box stsc for the chunks of the track");
+
+    auto offset = chunkOffsets.at(chunk - 1);
+    for (uint32_t i = 0; i < sampleToChunkEntries.at(entryIndex).samplesPerChunk; ++i)
+    {
+      if (samples.size() == sampleSizes.size())
+        throw std::runtime_error("The MP4 sample tables stsc and stsz do not match");
+      const auto size = sampleSizes.at(samples.size());
+      samples.push_back({offset, size});
+      offset += size;
+    }
+  }
+
+  if (samples.size() != sampleSizes.size())
+    throw std::runtime_error("The MP4 sample tables stsc and stsz do not match");
+  return samples;
+}
+
+// The default sample size of each track from the trex boxes
+std::map<uint32_t, uint32_t> parseTrackExtendsDefaultSampleSizes(const ByteVector &moov,
+                                                                 const Box        &moovBox)
+{
+  std::map<uint32_t, uint32_t> defaultSampleSizes;
+  if (const auto mvex = findChildBox(moov, moovBox, "mvex"))
+  {
+    for (const auto &trex : parseChildBoxes(moov, *mvex))
+    {
+      if (trex.type != "trex")
+        continue;
+      BoxReader reader(moov, trex);
+      reader.skip(4);
+      const auto trackID = reader.readU32();
+      reader.skip(8);
+      defaultSampleSizes[trackID] = reader.readU32();
+    }
+  }
+  return defaultSampleSizes;
+}
+
+// Get the position of all samples of the track in the fragment. The data of the track fragments
+// and track runs follow each other if no explicit offsets are given.
+std::vector<std::pair<uint64_t, uint64_t>>
+parseTrackFragments(const ByteVector                   &moof,
+                    const uint64_t                      moofOffset,
+                    const uint32_t                      trackID,
+                    const std::map<uint32_t, uint32_t> &trackExtendsDefaultSampleSizes)
+{
+  std::vector<std::pair<uint64_t, uint64_t>> samples;
+
+  const auto moofBox                      = parseBoxes(moof, 0, moof.size()).at(0);
+  bool       isFirstTrackFragment         = true;
+  uint64_t   previousTrackFragmentDataEnd = 0;
+  for (const auto &traf : parseChildBoxes(moof, moofBox))
+  {
+    if (traf.type != "traf")
+      continue;
+
+    BoxReader  tfhdReader(moof, getChildBox(moof, traf, "tfhd"));
+    const auto tfhdFlags       = tfhdReader.readU32() & 0xffffff;
+    const auto fragmentTrackID = tfhdReader.readU32();
+
+    std::optional<uint64_t> baseDataOffset;
+    if (tfhdFlags & TFHD_BASE_DATA_OFFSET_PRESENT)
+      baseDataOffset = tfhdReader.readU64();
+    if (tfhdFlags & TFHD_SAMPLE_DESCRIPTION_INDEX_PRESENT)
+      tfhdReader.skip(4);
+    if (tfhdFlags & TFHD_DEFAULT_SAMPLE_DURATION_PRESENT)
+      tfhdReader.skip(4);
+
+    std::optional<uint32_t> defaultSampleSize;
+    if (tfhdFlags & TFHD_DEFAULT_SAMPLE_SIZE_PRESENT)
+      defaultSampleSize = tfhdReader.readU32();
+    else if (trackExtendsDefaultSampleSizes.count(fragmentTrackID) > 0)
+      defaultSampleSize = trackExtendsDefaultSampleSizes.at(fragmentTrackID);
+    if (tfhdFlags & TFHD_DEFAULT_SAMPLE_FLAGS_PRESENT)
+      tfhdReader.skip(4);
+
+    if (!baseDataOffset)
+      baseDataOffset = (isFirstTrackFragment || (tfhdFlags & TFHD_DEFAULT_BASE_IS_MOOF))
+                           ? moofOffset
+                           : previousTrackFragmentDataEnd;
+    isFirstTrackFragment = false;
+
+    auto dataOffset = *baseDataOffset;
+    for (const auto &trun : parseChildBoxes(moof, traf))
+    {
+      if (trun.type != "trun")
+        continue;
+
+      BoxReader  reader(moof, trun);
+      const auto trunFlags   = reader.readU32() & 0xffffff;
+      const auto sampleCount = reader.readU32();
+      if (trunFlags & TRUN_DATA_OFFSET_PRESENT)
+        dataOffset = *baseDataOffset + static_cast<int32_t>(reader.readU32());
+      if (trunFlags & TRUN_FIRST_SAMPLE_FLAGS_PRESENT)
+        reader.skip(4);
+
+      for (uint32_t i = 0; i < sampleCount; ++i)
+      {
+        if (trunFlags & TRUN_SAMPLE_DURATION_PRESENT)
+          reader.skip(4);
+        uint64_t size{};
+        if (trunFlags & TRUN_SAMPLE_SIZE_PRESENT)
+          size = reader.readU32();
+        else if (defaultSampleSize)
+          size = *defaultSampleSize;
+        else
+          throw std::runtime_error("No sample size for the MP4 track fragment run");
+        if (trunFlags & TRUN_SAMPLE_FLAGS_PRESENT)
+          reader.skip(4);
+        if (trunFlags & TRUN_SAMPLE_COMPOSITION_TIME_OFFSETS_PRESENT)
+          reader.skip(4);
+
+        if (fragmentTrackID == trackID)
+          samples.push_back({dataOffset, size});
+        dataOffset += size;
+      }
+    }
+    previousTrackFragmentDataEnd = dataOffset;
+  }
+  return samples;
+}
+
+} // namespace
+
+FileSourceMP4::FileSourceMP4(const std::filesystem::path &filePath)
+{
+  this->inputFile.open(filePath, std::ios_base::binary);
+
+  if (!this->inputFile.is_open())
+    throw std::runtime_error("Error opening input file " + filePath.string());
+
+  this->parseFile(std::filesystem::file_size(filePath));
+}
+
+bool FileSourceMP4::isMP4File(const std::filesystem::path &filePath)
+{
+  std::ifstream file(filePath, std::ios_base::binary);
+  char          header[BOX_HEADER_SIZE]{};
+  if (!file.read(header, BOX_HEADER_SIZE))
+    return false;
+  const std::string type(header + 4, header + 8);
+  return type == "ftyp" || type == "moov";
+}
+
+void FileSourceMP4::parseFile(const uint64_t fileSize)
+{
+  std::optional<std::pair<uint64_t, ByteVector>> moov;
+  std::vector<std::pair<uint64_t, ByteVector>>   moofs;
+  for (uint64_t offset = 0; offset + BOX_HEADER_SIZE <= fileSize;)
+  {
+    const auto header = this->readFromFile(offset, std::min(fileSize - offset, uint64_t(16)));
+    const auto box    = parseFileBoxHeader(header, offset, fileSize);
+    if (box.type == "moov")
+      moov = {box.offset, this->readFromFile(box.offset, static_cast<size_t>(box.size))};
+    else if (box.type == "moof")
+      moofs.push_back({box.offset, this->readFromFile(box.offset, static_cast<size_t>(box.size))});
+    offset += box.size;
+  }
+
+  if (!moov)
+    throw std::runtime_error("No moov box found in the MP4 file");
+  const auto &[moovOffset, moovData] = *moov;
+  const auto  moovBox                = parseBoxes(moovData, 0, moovData.size()).at(0);
+
+  std::optional<HEVCTrack> track;
+  for (const auto &trak : parseChildBoxes(moovData, moovBox))
+  {
+    if (trak.type == "trak")
+      track = findHEVCTrack(moovData, trak);
+    if (track)
+      break;
+  }
+  if (!track)
+    throw std::runtime_error("No HEVC video track (hvc1/hev1) found in the MP4 file");
+
+  BoxReader hvcCReader(moovData, track->hvcC);
+  hvcCReader.skip(21);
+  this->nalUnitLengthSize = (hvcCReader.readU8() & 0x03) + 1;
+  if (this->nalUnitLengthSize == 3)
+    throw std::runtime_error("Unsupported NAL unit length size 3 in the MP4 file");
+  const auto nrArrays = hvcCReader.readU8();
+  for (uint32_t i = 0; i < nrArrays; ++i)
+  {
+    hvcCReader.skip(1);
+    const auto nrNalUnits = hvcCReader.readU16();
+    for (uint32_t j = 0; j < nrNalUnits; ++j)
+    {
+      const auto size = hvcCReader.readU16();
+      ParameterSet parameterSet;
+      parameterSet.fileOffset = moovOffset + hvcCReader.getPosition();
+      hvcCReader.skip(size);
+      parameterSet.data = ByteVector(moovData.begin() + (parameterSet.fileOffset - moovOffset),
+                                     moovData.begin() + hvcCReader.getPosition());
+      this->parameterSets.push_back(std::move(parameterSet));
+    }
+  }
+
+  for (const auto &[offset, size] : parseSampleTable(moovData, track->stbl))
+    this->samples.push_back({offset, size});
+
+  const auto defaultSampleSizes = parseTrackExtendsDefaultSampleSizes(moovData, moovBox);
+  for (const auto &[moofOffset, moofData] : moofs)
+    for (const auto &[offset, size] :
+         parseTrackFragments(moofData, moofOffset, track->trackID, defaultSampleSizes))
+      this->samples.push_back({offset, size});
+
+  for (const auto &sample : this->samples)
+    if (sample.offset + sample.size > fileSize)
+      throw std::runtime_error("An MP4 sample is outside of the file");
+
+  // A hev1 track can repeat the parameter sets in the samples. Don't return them twice.
+  if (this->firstSampleContainsParameterSets())
+    this->parameterSets.clear();
+}
+
+bool FileSourceMP4::firstSampleContainsParameterSets()
+{
+  if (this->samples.empty())
+    return false;
+
+  const auto &sample = this->samples.front();
+  const auto  data   = this->readFromFile(sample.offset, static_cast<size_t>(sample.size));
+  for (size_t position = 0; position + this->nalUnitLengthSize < data.size();)
+  {
+    uint64_t size = 0;
+    for (unsigned i = 0; i < this->nalUnitLengthSize; ++i)
+      size = (size << 8) | data.at(position++);
+    if (parser::hevc::nal_unit_header::fromNalData(data, position).isParameterSet())
+      return true;
+    position += static_cast<size_t>(size);
+  }
+  return false;
+}
+
+ByteVector FileSourceMP4::readFromFile(const uint64_t fileOffset, const size_t size)
+{
+  // Seeking discards the buffer of the stream. The samples mostly follow each other directly.
+  if (fileOffset != this->filePosition)
+  {
+    this->inputFile.clear();
+    this->inputFile.seekg(static_cast<std::streamoff>(fileOffset));
+  }
+
+  ByteVector data(size);
+  this->inputFile.read(reinterpret_cast<char *>(data.data()), static_cast<std::streamsize>(size));
+  if (static_cast<size_t>(this->inputFile.gcount()) != size)
+    throw std::runtime_error("Unexpected end of the MP4 file");
+  this->filePosition = fileOffset + size;
+
+  this->totalBytesRead += size;
+  addToCounter(getCounter(this->statistics, &InputStatistics::bytesRead), size);
+  return data;
+}
+
+ByteVector FileSourceMP4::getNextNALUnit()
+{
+  if (this->nextParameterSet < this->parameterSets.size())
+  {
+    auto &parameterSet          = this->parameterSets.at(this->nextParameterSet++);
+    this->lastNALUnitFileOffset = parameterSet.fileOffset;
+    return std::move(parameterSet.data);
+  }
+
+  ScopedTraceEvent traceEvent("read", this->traceArguments);
+
+  while (true)
+  {
+    while (this->nextNalUnitOffset >= this->sampleEnd)
+    {
+      if (this->nextSample >= this->samples.size())
+        return {};
+      const auto &sample      = this->samples.at(this->nextSample++);
+      this->nextNalUnitOffset = sample.offset;
+      this->sampleEnd         = sample.offset + sample.size;
+    }
+
+    if (this->nextNalUnitOffset + this->nalUnitLengthSize > this->sampleEnd)
+      throw std::runtime_error("Invalid NAL unit length in MP4 sample " +
+                               std::to_string(this->nextSample - 1));
+    uint64_t size = 0;
+    for (const auto byte : this->readFromFile(this->nextNalUnitOffset, this->nalUnitLengthSize))
+      size = (size << 8) | byte;
+
+    const auto nalUnitOffset = this->nextNalUnitOffset + this->nalUnitLengthSize;
+    if (nalUnitOffset + size > this->sampleEnd)
+      throw std::runtime_error("Invalid NAL unit length in MP4 sample " +
+                               std::to_string(this->nextSample - 1));
+    this->nextNalUnitOffset = nalUnitOffset + size;
+
+    if (size > 0)
+    {
+      this->lastNALUnitFileOffset = nalUnitOffset;
+      return this->readFromFile(nalUnitOffset, static_cast<size_t>(size));
+    }
+  }
+}
+
+uint64_t FileSourceMP4::getFileOffsetOfLastNALUnit() const
+{
+  return this->lastNALUnitFileOffset;
+}
+
+void FileSourceMP4::setStatistics(InputStatistics *statistics)
+{
+  this->statistics = statistics;
+  // The boxes are already read in the constructor
+  addToCounter(getCounter(this->statistics, &InputStatistics::bytesRead), this->totalBytesRead);
+}
+
+} // namespace combiner
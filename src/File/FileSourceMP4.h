@@ -0,0 +1,72 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+
+#include "NalUnitSource.h"
+
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+namespace combiner
+{
+
+/* Reads the NAL units of the first HEVC video track (hvc1/hev1) of an ISOBMFF/MP4 file.
+ * The sample table (stbl) of the track and the track fragments (moof/traf/trun) of a fragmented
+ * file are parsed when the file is opened. The parameter sets from the hvcC box are returned
+ * first (unless the first sample carries them itself), followed by the NAL units of all samples
+ * in decoding order. The NAL units are length
+ * prefixed, so there are no start codes to scan for and each NAL unit is read directly into its
+ * own buffer.
+ */
+class FileSourceMP4 : public NalUnitSource
+{
+public:
+  FileSourceMP4(const std::filesystem::path &filePath);
+
+  // Check if the file starts with an ftyp (or moov) box.
+  static bool isMP4File(const std::filesystem::path &filePath);
+
+  ByteVector getNextNALUnit() override;
+  uint64_t   getFileOffsetOfLastNALUnit() const override;
+
+  void setStatistics(InputStatistics *statistics) override;
+
+private:
+  struct Sample
+  {
+    uint64_t offset{};
+    uint64_t size{};
+  };
+
+  void       parseFile(const uint64_t fileSize);
+  bool       firstSampleContainsParameterSets();
+  ByteVector readFromFile(const uint64_t fileOffset, const size_t size);
+
+  std::ifstream inputFile{};
+  uint64_t      filePosition{};
+
+  struct ParameterSet
+  {
+    uint64_t   fileOffset{};
+    ByteVector data;
+  };
+
+  unsigned                  nalUnitLengthSize{4};
+  std::vector<ParameterSet> parameterSets;
+  size_t                    nextParameterSet{};
+
+  std::vector<Sample> samples;
+  size_t              nextSample{};
+  uint64_t            nextNalUnitOffset{};
+  uint64_t            sampleEnd{};
+
+  uint64_t lastNALUnitFileOffset{};
+  uint64_t totalBytesRead{};
+};
+
+} // namespace combiner
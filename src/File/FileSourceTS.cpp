@@ -0,0 +1,385 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include "FileSourceTS.h"
+
+#include <common/Logger.h>
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace combiner
+{
+
+namespace
+{
+
+constexpr size_t  PACKET_SIZE = 188;
+constexpr size_t  BUFFERSIZE  = PACKET_SIZE * 2048;
+constexpr uint8_t SYNC_BYTE   = 0x47;
+
+constexpr uint16_t PAT_PID          = 0x0000;
+constexpr uint8_t  PAT_TABLE_ID     = 0x00;
+constexpr uint8_t  PMT_TABLE_ID     = 0x02;
+constexpr uint8_t  STREAM_TYPE_HEVC = 0x24;
+
+constexpr size_t SECTION_HEADER_SIZE = 3;
+constexpr size_t CRC_SIZE            = 4;
+constexpr size_t PES_HEADER_SIZE     = 9;
+
+uint64_t readTimestamp(const uint8_t *data)
+{
+  return (uint64_t((data[0] >> 1) & 0x07) << 30) | (uint64_t(data[1]) << 22) |
+         (uint64_t(data[2] >> 1) << 15) | (uint64_t(data[3]) << 7) | uint64_t(data[4] >> 1);
+}
+
+} // namespace
+
+FileSourceTS::FileSourceTS(const std::filesystem::path &filePath)
+{
+  this->inputFile.open(filePath, std::ios_base::binary);
+  if (!this->inputFile)
+    throw std::runtime_error("Error opening input file " + filePath.string());
+
+  this->fileBuffer.resize(BUFFERSIZE);
+  if (!this->readNextBuffer() || this->fileBuffer.at(0) != SYNC_BYTE)
+    throw std::runtime_error("The file " + filePath.string() + " is no MPEG-2 transport stream");
+}
+
+bool FileSourceTS::isTSFile(const std::filesystem::path &filePath)
+{
+  std::ifstream file(filePath, std::ios_base::binary);
+  if (!file)
+    return false;
+
+  ByteVector data(PACKET_SIZE * 2 + 1);
+  file.read(reinterpret_cast<char *>(data.data()), static_cast<std::streamsize>(data.size()));
+  const auto bytesRead = static_cast<size_t>(file.gcount());
+  if (bytesRead < PACKET_SIZE)
+    return false;
+
+  for (size_t position = 0; position < bytesRead; position += PACKET_SIZE)
+    if (data.at(position) != SYNC_BYTE)
+      return false;
+  return true;
+}
+
+bool FileSourceTS::readNextBuffer()
+{
+  ScopedTraceEvent traceEvent("read", this->traceArguments);
+
+  // Move the rest of an incomplete packet to the start of the buffer
+  const auto remainingBytes = this->bufferEnd - this->bufferPosition;
+  std::memmove(
+      this->fileBuffer.data(), this->fileBuffer.data() + this->bufferPosition, remainingBytes);
+  this->fileBufferFileOffset += this->bufferPosition;
+  this->bufferPosition = 0;
+  this->bufferEnd      = remainingBytes;
+
+  this->inputFile.read(reinterpret_cast<char *>(this->fileBuffer.data() + remainingBytes),
+                       static_cast<std::streamsize>(BUFFERSIZE - remainingBytes));
+  const auto bytesRead = static_cast<size_t>(this->inputFile.gcount());
+  this->bufferEnd += bytesRead;
+  this->endOfFile = (bytesRead < BUFFERSIZE - remainingBytes);
+
+  this->totalBytesRead += bytesRead;
+  addToCounter(getCounter(this->statistics, &InputStatistics::bytesRead), bytesRead);
+  return bytesRead > 0;
+}
+
+bool FileSourceTS::syncToNextPacket()
+{
+  if (this->inSync)
+    logger().warning("Lost transport stream sync at offset " +
+                     std::to_string(this->fileBufferFileOffset + this->bufferPosition));
+  this->inSync = false;
+
+  // The data of the NAL unit that was being collected is incomplete
+  this->currentNalUnit.reset();
+  this->lastContinuityCounter.reset();
+
+  // A packet start is only trusted if the next packet (if already read) also starts there
+  for (auto position = this->bufferPosition + 1; position + PACKET_SIZE <= this->bufferEnd;
+       ++position)
+  {
+    if (this->fileBuffer[position] != SYNC_BYTE)
+      continue;
+    const auto nextPacket = position + PACKET_SIZE;
+    if (nextPacket < this->bufferEnd && this->fileBuffer[nextPacket] != SYNC_BYTE)
+      continue;
+
+    this->bufferPosition = position;
+    this->inSync         = true;
+    logger().warning("Found transport stream sync again at offset " +
+                     std::to_string(this->fileBufferFileOffset + position));
+    return true;
+  }
+
+  // Keep the last bytes which could still be the start of a packet
+  this->bufferPosition = this->bufferEnd - PACKET_SIZE + 1;
+  return false;
+}
+
+void FileSourceTS::processPacket(const uint8_t *packet, const uint64_t fileOffset)
+{
+  const auto transportErrorIndicator = (packet[1] & 0x80) != 0;
+  const auto payloadUnitStart        = (packet[1] & 0x40) != 0;
+  const auto PID                     = static_cast<uint16_t>(((packet[1] & 0x1f) << 8) | packet[2]);
+  const auto scramblingControl       = packet[3] >> 6;
+  const auto adaptationFieldControl  = (packet[3] >> 4) & 0x03;
+  const auto continuityCounter       = static_cast<uint8_t>(packet[3] & 0x0f);
+
+  if (transportErrorIndicator || scramblingControl != 0)
+    return;
+
+  size_t payloadStart  = 4;
+  bool   discontinuity = false;
+  if (adaptationFieldControl & 0x02)
+  {
+    const auto adaptationFieldLength = packet[4];
+    if (adaptationFieldLength > 0)
+      discontinuity = (packet[5] & 0x80) != 0;
+    payloadStart += 1 + adaptationFieldLength;
+  }
+  if ((adaptationFieldControl & 0x01) == 0 || payloadStart >= PACKET_SIZE)
+    return;
+
+  const auto payload     = packet + payloadStart;
+  const auto payloadSize = PACKET_SIZE - payloadStart;
+
+  if (PID == PAT_PID || PID == this->programMapPID)
+  {
+    this->processSection(PID, payload, payloadSize, payloadUnitStart);
+    return;
+  }
+  if (PID != this->videoPID)
+    return;
+
+  if (this->lastContinuityCounter && !discontinuity)
+  {
+    // A packet may be sent twice. Packets in between were lost if the counter jumps.
+    if (continuityCounter == *this->lastContinuityCounter)
+      return;
+    if (continuityCounter != ((*this->lastContinuityCounter + 1) & 0x0f))
+    {
+      logger().warning("Continuity counter gap in PID " + std::to_string(PID) + " at offset " +
+                       std::to_string(fileOffset) + ". Dropping the incomplete NAL unit.");
+      this->currentNalUnit.reset();
+    }
+  }
+  this->lastContinuityCounter = continuityCounter;
+
+  if (payloadUnitStart)
+    this->processPESStart(payload, payloadSize, fileOffset + payloadStart);
+  else
+    this->scanForStartCodes(payload, payloadSize, fileOffset + payloadStart);
+}
+
+void FileSourceTS::processSection(const uint16_t PID,
+                                  const uint8_t *data,
+                                  const size_t   size,
+                                  const bool     start)
+{
+  auto &section = this->sections[PID];
+  if (start)
+  {
+    const auto pointerField = data[0];
+    if (1u + pointerField >= size)
+      return;
+    section.assign(data + 1 + pointerField, data + size);
+  }
+  else if (!section.empty())
+    section.insert(section.end(), data, data + size);
+
+  if (section.size() < SECTION_HEADER_SIZE)
+    return;
+  const auto sectionLength = static_cast<size_t>(((section[1] & 0x0f) << 8) | section[2]);
+  if (section.size() < SECTION_HEADER_SIZE + sectionLength)
+    return;
+  section.resize(SECTION_HEADER_SIZE + sectionLength);
+
+  if (PID == PAT_PID)
+    this->parseProgramAssociationTable(section);
+  else
+    this->parseProgramMapTable(section);
+  section.clear();
+}
+
+void FileSourceTS::parseProgramAssociationTable(const ByteVector &section)
+{
+  if (section.at(0) != PAT_TABLE_ID || this->programMapPID || section.size() < 8 + CRC_SIZE)
+    return;
+
+  // The first program which is not the network information table
+  for (size_t position = 8; position + 4 <= section.size() - CRC_SIZE; position += 4)
+  {
+    const auto programNumber = (section[position] << 8) | section[position + 1];
+    if (programNumber == 0)
+      continue;
+    this->programMapPID =
+        static_cast<uint16_t>(((section[position + 2] & 0x1f) << 8) | section[position + 3]);
+    return;
+  }
+}
+
+void FileSourceTS::parseProgramMapTable(const ByteVector &section)
+{
+  if (section.at(0) != PMT_TABLE_ID || this->videoPID || section.size() < 12 + CRC_SIZE)
+    return;
+
+  const auto programInfoLength = static_cast<size_t>(((section[10] & 0x0f) << 8) | section[11]);
+  auto       position          = 12 + programInfoLength;
+  while (position + 5 <= section.size() - CRC_SIZE)
+  {
+    const auto streamType    = section[position];
+    const auto elementaryPID = ((section[position + 1] & 0x1f) << 8) | section[position + 2];
+    const auto esInfoLength =
+        static_cast<size_t>(((section[position + 3] & 0x0f) << 8) | section[position + 4]);
+    if (streamType == STREAM_TYPE_HEVC)
+    {
+      this->videoPID = static_cast<uint16_t>(elementaryPID);
+      logger().info("Reading HEVC stream from PID " + std::to_string(elementaryPID));
+      return;
+    }
+    position += 5 + esInfoLength;
+  }
+}
+
+void FileSourceTS::processPESStart(const uint8_t *data,
+                                   const size_t   size,
+                                   const uint64_t fileOffset)
+{
+  if (size < PES_HEADER_SIZE || data[0] != 0 || data[1] != 0 || data[2] != 1)
+  {
+    logger().warning("Invalid PES header at offset " + std::to_string(fileOffset));
+    this->currentNalUnit.reset();
+    return;
+  }
+
+  const auto PTSDTSFlags      = data[7] >> 6;
+  const auto headerDataLength = static_cast<size_t>(data[8]);
+  const auto headerSize       = PES_HEADER_SIZE + headerDataLength;
+  if (headerSize > size || (PTSDTSFlags == 2 && headerDataLength < 5) ||
+      (PTSDTSFlags == 3 && headerDataLength < 10))
+  {
+    logger().warning("Unsupported PES header at offset " + std::to_string(fileOffset));
+    this->currentNalUnit.reset();
+    return;
+  }
+
+  this->currentPESTimestamps = {};
+  if (PTSDTSFlags & 0x02)
+  {
+    this->currentPESTimestamps.PTS = readTimestamp(data + PES_HEADER_SIZE);
+    // Without a DTS, it is equal to the PTS
+    this->currentPESTimestamps.DTS = (PTSDTSFlags == 3) ? readTimestamp(data + PES_HEADER_SIZE + 5)
+                                                        : this->currentPESTimestamps.PTS;
+  }
+
+  this->scanForStartCodes(data + headerSize, size - headerSize, fileOffset + headerSize);
+}
+
+void FileSourceTS::scanForStartCodes(const uint8_t *data,
+                                     const size_t   size,
+                                     const uint64_t fileOffset)
+{
+  ScopedTimer timer(getCounter(this->statistics, &InputStatistics::startCodeScanTime));
+
+  // The bytes are appended to the current NAL unit up to the next 0x01. If the two bytes before it
+  // are zero, it is a start code (which can also span packets).
+  size_t position = 0;
+  while (position < size)
+  {
+    auto &target = this->currentNalUnit ? this->currentNalUnit->data : this->skippedBytes;
+    const auto one = static_cast<const uint8_t *>(std::memchr(data + position, 1, size - position));
+    const auto end = one ? one : data + size;
+    target.insert(target.end(), data + position, end);
+    if (!one)
+      break;
+    position = static_cast<size_t>(one - data) + 1;
+
+    const auto targetSize = target.size();
+    if (targetSize >= 2 && target[targetSize - 1] == 0 && target[targetSize - 2] == 0)
+    {
+      target.resize(targetSize - 2);
+      this->finishNalUnit();
+      this->currentNalUnit = NalUnit{{}, fileOffset + position, this->currentPESTimestamps};
+    }
+    else
+      target.push_back(1);
+  }
+
+  // Only the last two bytes are needed to find a start code that spans packets
+  if (!this->currentNalUnit && this->skippedBytes.size() > 2)
+    this->skippedBytes.erase(this->skippedBytes.begin(), this->skippedBytes.end() - 2);
+}
+
+void FileSourceTS::finishNalUnit()
+{
+  this->skippedBytes.clear();
+  if (!this->currentNalUnit)
+    return;
+
+  // Remove trailing zero bytes (the first byte of a 4 byte start code or trailing_zero_8bits)
+  auto &data = this->currentNalUnit->data;
+  while (!data.empty() && data.back() == 0)
+    data.pop_back();
+  if (!data.empty())
+    this->nalUnits.push_back(std::move(*this->currentNalUnit));
+  this->currentNalUnit.reset();
+}
+
+ByteVector FileSourceTS::getNextNALUnit()
+{
+  while (this->nalUnits.empty())
+  {
+    if (this->bufferEnd - this->bufferPosition < PACKET_SIZE)
+    {
+      if (!this->endOfFile && this->readNextBuffer())
+        continue;
+
+      if (!this->videoPID)
+        throw std::runtime_error("No HEVC stream (stream_type 0x24) found in the transport stream");
+      this->finishNalUnit();
+      if (this->nalUnits.empty())
+        return {};
+      break;
+    }
+
+    if (this->fileBuffer[this->bufferPosition] != SYNC_BYTE && !this->syncToNextPacket())
+      continue;
+
+    this->processPacket(this->fileBuffer.data() + this->bufferPosition,
+                        this->fileBufferFileOffset + this->bufferPosition);
+    this->bufferPosition += PACKET_SIZE;
+  }
+
+  auto nalUnit = std::move(this->nalUnits.front());
+  this->nalUnits.pop_front();
+  this->lastNALUnitFileOffset = nalUnit.fileOffset;
+  this->lastNALUnitTimestamps = nalUnit.timestamps;
+  return std::move(nalUnit.data);
+}
+
+uint64_t FileSourceTS::getFileOffsetOfLastNALUnit() const
+{
+  return this->lastNALUnitFileOffset;
+}
+
+Timestamps FileSourceTS::getTimestampsOfLastNALUnit() const
+{
+  return this->lastNALUnitTimestamps;
+}
+
+void FileSourceTS::setStatistics(InputStatistics *statistics)
+{
+  this->statistics = statistics;
+  // The first buffer is already read in the constructor
+  addToCounter(getCounter(this->statistics, &InputStatistics::bytesRead), this->totalBytesRead);
+}
+
+} // namespace combiner
@@ -0,0 +1,85 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+
+#include "NalUnitSource.h"
+
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <optional>
+
+namespace combiner
+{
+
+/* Reads the NAL units of the first HEVC stream (stream_type 0x24) from an MPEG-2 transport stream.
+ * The 188 byte packets are read in large buffers. The PAT and PMT are followed to find the PID of
+ * the HEVC stream. The payload of its PES packets is an Annex B byte stream which is scanned for
+ * start codes directly in the packet buffer, so each NAL unit is copied only once into its own
+ * buffer. Gaps in the continuity counter are logged and the NAL unit that was affected by the lost
+ * packets is dropped. The PTS/DTS of the PES packet in which a NAL unit starts is kept with it.
+ */
+class FileSourceTS : public NalUnitSource
+{
+public:
+  FileSourceTS(const std::filesystem::path &filePath);
+
+  // Check if the file starts with 3 packets with the transport stream sync byte.
+  static bool isTSFile(const std::filesystem::path &filePath);
+
+  ByteVector getNextNALUnit() override;
+  uint64_t   getFileOffsetOfLastNALUnit() const override;
+  Timestamps getTimestampsOfLastNALUnit() const override;
+
+  void setStatistics(InputStatistics *statistics) override;
+
+private:
+  struct NalUnit
+  {
+    ByteVector data;
+    uint64_t   fileOffset{};
+    Timestamps timestamps{};
+  };
+
+  bool readNextBuffer();
+  bool syncToNextPacket();
+  void processPacket(const uint8_t *packet, const uint64_t fileOffset);
+  void processSection(const uint16_t PID, const uint8_t *data, const size_t size, const bool start);
+  void parseProgramAssociationTable(const ByteVector &section);
+  void parseProgramMapTable(const ByteVector &section);
+  void processPESStart(const uint8_t *data, const size_t size, const uint64_t fileOffset);
+  void scanForStartCodes(const uint8_t *data, const size_t size, const uint64_t fileOffset);
+  void finishNalUnit();
+
+  std::ifstream inputFile{};
+  ByteVector    fileBuffer{};
+  size_t        bufferPosition{};
+  size_t        bufferEnd{};
+  uint64_t      fileBufferFileOffset{};
+  bool          endOfFile{};
+  bool          inSync{true};
+
+  std::optional<uint16_t>        programMapPID{};
+  std::optional<uint16_t>        videoPID{};
+  std::map<uint16_t, ByteVector> sections{};
+
+  std::optional<uint8_t> lastContinuityCounter{};
+  Timestamps             currentPESTimestamps{};
+
+  // The NAL unit that is currently being collected. Without one, the bytes up to the next start
+  // code are skipped (at the start of the stream or after lost packets).
+  std::optional<NalUnit> currentNalUnit{};
+  ByteVector             skippedBytes{};
+  std::deque<NalUnit>    nalUnits{};
+
+  uint64_t   lastNALUnitFileOffset{};
+  Timestamps lastNALUnitTimestamps{};
+  uint64_t   totalBytesRead{};
+};
+
+} // namespace combiner
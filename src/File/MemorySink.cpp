@@ -0,0 +1,27 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include "MemorySink.h"
+
+namespace combiner
+{
+
+void MemorySink::writeNALUnit(const ByteVector &nalData)
+{
+  this->nalUnits.push_back(nalData);
+
+  // Counted with the start code like in the Annex B outputs so that the statistics of a chunked
+  // combination match the ones of a combination in one thread
+  addToCounter(getCounter(this->statistics, &OutputStatistics::bytesWritten), nalData.size() + 4);
+  addToCounter(getCounter(this->statistics, &OutputStatistics::nrNalUnits), 1);
+}
+
+std::vector<ByteVector> &MemorySink::getNalUnits()
+{
+  return this->nalUnits;
+}
+
+} // namespace combiner
@@ -0,0 +1,28 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+
+#include "NalUnitSink.h"
+
+#include <vector>
+
+namespace combiner
+{
+
+// Collects the NAL units in memory (e.g. to write them out later in a different order).
+class MemorySink : public NalUnitSink
+{
+public:
+  void writeNALUnit(const ByteVector &nalData) override;
+
+  std::vector<ByteVector> &getNalUnits();
+
+private:
+  std::vector<ByteVector> nalUnits;
+};
+
+} // namespace combiner
@@ -0,0 +1,163 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include "NalIndex.h"
+
+#include <array>
+#include <fstream>
+#include <stdexcept>
+
+namespace combiner
+{
+
+namespace
+{
+
+/* The sidecar file layout (all values little endian):
+ * Header: magic (8 bytes), version (4), source file size (8), source modification time (8),
+ *         number of entries (8)
+ * Entry:  offset (8), size (4), nal_unit_type (1), TemporalId (1), flags (1), reserved (1),
+ *         POC (4)
+ */
+constexpr std::array<char, 8> MAGIC   = {'N', 'A', 'L', 'I', 'N', 'D', 'E', 'X'};
+constexpr uint32_t            VERSION = 1;
+
+constexpr uint8_t FLAG_IRAP                       = 1 << 0;
+constexpr uint8_t FLAG_FIRST_SLICE_SEGMENT_IN_PIC = 1 << 1;
+constexpr uint8_t FLAG_HAS_POC                    = 1 << 2;
+
+struct SourceFileStamp
+{
+  uint64_t fileSize{};
+  int64_t  modificationTime{};
+
+  bool operator==(const SourceFileStamp &other) const
+  {
+    return this->fileSize == other.fileSize && this->modificationTime == other.modificationTime;
+  }
+};
+
+SourceFileStamp getSourceFileStamp(const std::filesystem::path &inputFile)
+{
+  SourceFileStamp stamp;
+  stamp.fileSize = static_cast<uint64_t>(std::filesystem::file_size(inputFile));
+  stamp.modificationTime =
+      static_cast<int64_t>(std::filesystem::last_write_time(inputFile).time_since_epoch().count());
+  return stamp;
+}
+
+void writeValue(std::ostream &stream, const uint64_t value, const int nrBytes)
+{
+  for (int i = 0; i < nrBytes; ++i)
+    stream.put(static_cast<char>((value >> (8 * i)) & 0xff));
+}
+
+uint64_t readValue(std::istream &stream, const int nrBytes)
+{
+  uint64_t value = 0;
+  for (int i = 0; i < nrBytes; ++i)
+  {
+    const auto byte = stream.get();
+    if (byte == std::char_traits<char>::eof())
+      throw std::runtime_error("Unexpected end of NAL index file");
+    value |= static_cast<uint64_t>(byte & 0xff) << (8 * i);
+  }
+  return value;
+}
+
+} // namespace
+
+std::filesystem::path NalIndex::getSidecarPath(const std::filesystem::path &inputFile)
+{
+  auto sidecarPath = inputFile;
+  sidecarPath += ".nalidx";
+  return sidecarPath;
+}
+
+std::optional<NalIndex> NalIndex::loadIfUpToDate(const std::filesystem::path &inputFile)
+{
+  std::ifstream file(getSidecarPath(inputFile), std::ios_base::binary);
+  if (!file.is_open())
+    return {};
+
+  std::array<char, 8> magic{};
+  file.read(magic.data(), magic.size());
+  if (!file || magic != MAGIC || readValue(file, 4) != VERSION)
+    return {};
+
+  SourceFileStamp stamp;
+  stamp.fileSize         = readValue(file, 8);
+  stamp.modificationTime = static_cast<int64_t>(readValue(file, 8));
+  if (!(stamp == getSourceFileStamp(inputFile)))
+    return {};
+
+  const auto nrEntries = readValue(file, 8);
+  if (nrEntries > stamp.fileSize)
+    throw std::runtime_error("Invalid number of entries in NAL index file");
+
+  NalIndex index;
+  index.entries.reserve(static_cast<size_t>(nrEntries));
+  for (uint64_t i = 0; i < nrEntries; ++i)
+  {
+    NalIndexEntry entry;
+    entry.offset      = readValue(file, 8);
+    entry.size        = static_cast<uint32_t>(readValue(file, 4));
+    entry.nalUnitType = static_cast<uint8_t>(readValue(file, 1));
+    entry.temporalId  = static_cast<uint8_t>(readValue(file, 1));
+    const auto flags  = static_cast<uint8_t>(readValue(file, 1));
+    readValue(file, 1);
+    const auto POC = static_cast<int32_t>(static_cast<uint32_t>(readValue(file, 4)));
+
+    entry.isIRAP                   = (flags & FLAG_IRAP) != 0;
+    entry.isFirstSliceSegmentInPic = (flags & FLAG_FIRST_SLICE_SEGMENT_IN_PIC) != 0;
+    if (flags & FLAG_HAS_POC)
+      entry.POC = POC;
+
+    if (entry.offset + entry.size > stamp.fileSize)
+      throw std::runtime_error("NAL index entry outside of the input file");
+    index.entries.push_back(entry);
+  }
+  return index;
+}
+
+void NalIndex::writeSidecar(const std::filesystem::path &inputFile) const
+{
+  const auto    sidecarPath = getSidecarPath(inputFile);
+  std::ofstream file(sidecarPath, std::ios_base::binary);
+  if (!file.is_open())
+    throw std::runtime_error("Error opening NAL index file " + sidecarPath.string());
+
+  const auto stamp = getSourceFileStamp(inputFile);
+  file.write(MAGIC.data(), MAGIC.size());
+  writeValue(file, VERSION, 4);
+  writeValue(file, stamp.fileSize, 8);
+  writeValue(file, static_cast<uint64_t>(stamp.modificationTime), 8);
+  writeValue(file, this->entries.size(), 8);
+
+  for (const auto &entry : this->entries)
+  {
+    uint8_t flags = 0;
+    if (entry.isIRAP)
+      flags |= FLAG_IRAP;
+    if (entry.isFirstSliceSegmentInPic)
+      flags |= FLAG_FIRST_SLICE_SEGMENT_IN_PIC;
+    if (entry.POC)
+      flags |= FLAG_HAS_POC;
+
+    writeValue(file, entry.offset, 8);
+    writeValue(file, entry.size, 4);
+    writeValue(file, entry.nalUnitType, 1);
+    writeValue(file, entry.temporalId, 1);
+    writeValue(file, flags, 1);
+    writeValue(file, 0, 1);
+    writeValue(file, static_cast<uint32_t>(entry.POC.value_or(0)), 4);
+  }
+
+  if (!file)
+    throw std::runtime_error("Error writing NAL index file " + sidecarPath.string());
+}
+
+} // namespace combiner
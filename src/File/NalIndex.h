@@ -0,0 +1,46 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <vector>
+
+namespace combiner
+{
+
+struct NalIndexEntry
+{
+  // Offset and size of the NAL unit in the file without the start code
+  uint64_t offset{};
+  uint32_t size{};
+
+  uint8_t            nalUnitType{};
+  uint8_t            temporalId{};
+  bool               isIRAP{};
+  bool               isFirstSliceSegmentInPic{};
+  std::optional<int> POC{};
+};
+
+/* An index of all NAL units in an Annex B file. It is stored in a compact binary sidecar file
+ * next to the input (<input>.nalidx). The sidecar stores the size and modification time of the
+ * input so that an outdated index is not used.
+ */
+struct NalIndex
+{
+  std::vector<NalIndexEntry> entries;
+
+  static std::filesystem::path getSidecarPath(const std::filesystem::path &inputFile);
+
+  // Returns no index if there is no sidecar file or if it does not match the input file anymore.
+  static std::optional<NalIndex> loadIfUpToDate(const std::filesystem::path &inputFile);
+
+  void writeSidecar(const std::filesystem::path &inputFile) const;
+};
+
+} // namespace combiner
@@ -0,0 +1,31 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+
+#include <common/Typedef.h>
+
+#include <optional>
+#include <vector>
+
+namespace combiner
+{
+
+// Which part of a file is read. This is used to start and end reading in the middle of a file.
+struct NalReadPlan
+{
+  // NAL units that are returned before the first NAL unit from the file (e.g. parameter sets that
+  // were sent before the start offset).
+  std::vector<ByteVector> prefixNalUnits;
+
+  uint64_t                startOffset{};
+  std::optional<uint64_t> endOffset{};
+
+  // NAL units at these offsets are skipped (sorted)
+  std::vector<uint64_t> skippedOffsets;
+};
+
+} // namespace combiner
@@ -0,0 +1,57 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+
+#include "OutputFile.h"
+
+#include <common/PipelineStatistics.h>
+#include <common/Timestamps.h>
+#include <common/Typedef.h>
+
+#include <optional>
+
+namespace combiner
+{
+
+// The interface of all outputs that the combined NAL units can be written to.
+class NalUnitSink
+{
+public:
+  virtual ~NalUnitSink() = default;
+
+  // Write the raw data of the NAL unit without the start code
+  virtual void writeNALUnit(const ByteVector &nalData) = 0;
+  // Write a NAL unit that starts with a new header and continues with the original NAL unit after
+  // its first nrReplacedBytes. If the original NAL unit is an unchanged range of an input file,
+  // outputs can copy the rest of it from there instead of from memory.
+  virtual void writeNALUnitWithNewHeader(const ByteVector               &newHeader,
+                                         const ByteVector               &originalNalData,
+                                         const size_t                    nrReplacedBytes,
+                                         const std::optional<FileRange> &)
+  {
+    if (newHeader.empty() && nrReplacedBytes == 0)
+    {
+      this->writeNALUnit(originalNalData);
+      return;
+    }
+    auto data = newHeader;
+    data.insert(data.end(), originalNalData.begin() + nrReplacedBytes, originalNalData.end());
+    this->writeNALUnit(data);
+  }
+  // The timestamps from the input for the NAL units that are written next. Only called if the
+  // input has timestamps.
+  virtual void setTimestampsOfNextNALUnits(const Timestamps &) {}
+  // Write out everything that is still buffered. Called once after the last NAL unit.
+  virtual void finish() {}
+
+  virtual void setStatistics(OutputStatistics *statistics) { this->statistics = statistics; }
+
+protected:
+  OutputStatistics *statistics{};
+};
+
+} // namespace combiner
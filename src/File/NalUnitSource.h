@@ -0,0 +1,54 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+
+#include <common/PipelineStatistics.h>
+#include <common/Timestamps.h>
+#include <common/Tracer.h>
+#include <common/Typedef.h>
+
+#include <chrono>
+#include <filesystem>
+
+namespace combiner
+{
+
+// The interface of all inputs that the NAL units to combine are read from.
+class NalUnitSource
+{
+public:
+  virtual ~NalUnitSource() = default;
+
+  // Get the raw data of the next NAL unit without the start code (or length prefix). The data is
+  // empty at the end of the input.
+  virtual ByteVector getNextNALUnit() = 0;
+
+  // Wait up to the timeout until the next NAL unit (or the end of the input) can be read without
+  // blocking. False if the timeout expired first. Files can always be read without waiting.
+  virtual bool waitForNALUnit(const std::chrono::milliseconds) { return true; }
+
+  // The byte offset in the file of the first byte of the NAL unit that was returned last.
+  virtual uint64_t getFileOffsetOfLastNALUnit() const = 0;
+
+  // The timestamps of the NAL unit that was returned last (if the input has timestamps).
+  virtual Timestamps getTimestampsOfLastNALUnit() const { return {}; }
+
+  // The file that the NAL unit that was returned last was read from unchanged (starting at its
+  // file offset). Null if the NAL unit is not a copy of a range of a file (e.g. it was reassembled
+  // from packets).
+  virtual const std::filesystem::path *getFileOfLastNALUnit() const { return nullptr; }
+
+  virtual void setStatistics(InputStatistics *statistics) { this->statistics = statistics; }
+  // The input index that trace events of this source are tagged with.
+  virtual void setTraceInput(const size_t inputIndex) { this->traceArguments.input = inputIndex; }
+
+protected:
+  InputStatistics *statistics{};
+  TraceArguments   traceArguments{};
+};
+
+} // namespace combiner
@@ -0,0 +1,196 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include "OutputFile.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <climits>
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace combiner
+{
+
+namespace
+{
+
+#ifndef _WIN32
+#ifdef IOV_MAX
+constexpr size_t MAX_RANGES_PER_CALL = IOV_MAX;
+#else
+constexpr size_t MAX_RANGES_PER_CALL = 1024;
+#endif
+
+constexpr size_t COPY_BUFFER_SIZE = 1024 * 1024;
+
+#ifdef __linux__
+// The kernel can not copy between these files with the method (e.g. different file systems for
+// copy_file_range or no pipe for splice).
+bool isCopyMethodNotSupported(const int error)
+{
+  return error == EXDEV || error == EINVAL || error == ENOSYS || error == EOPNOTSUPP;
+}
+#endif
+#endif
+
+} // namespace
+
+#ifdef _WIN32
+
+OutputFile::OutputFile(const std::filesystem::path &filePath)
+{
+  this->outputFile.open(filePath, std::ios_base::binary);
+  if (!this->outputFile.is_open())
+    throw std::runtime_error("Error opening output file " + filePath.string());
+}
+
+OutputFile::~OutputFile() = default;
+
+void OutputFile::writeGather(const std::vector<ByteRange> &ranges)
+{
+  for (const auto &range : ranges)
+    this->outputFile.write(reinterpret_cast<const char *>(range.data),
+                           static_cast<std::streamsize>(range.size));
+  if (!this->outputFile)
+    throw std::runtime_error("Error writing to the output file");
+}
+
+#else
+
+OutputFile::OutputFile(const std::filesystem::path &filePath)
+{
+  this->fileDescriptor = ::open(filePath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (this->fileDescriptor < 0)
+    throw std::runtime_error("Error opening output file " + filePath.string() + ": " +
+                             std::strerror(errno));
+}
+
+OutputFile::~OutputFile()
+{
+  ::close(this->fileDescriptor);
+}
+
+void OutputFile::writeGather(const std::vector<ByteRange> &ranges)
+{
+  std::vector<iovec> vectors;
+  vectors.reserve(ranges.size());
+  for (const auto &range : ranges)
+    if (range.size > 0)
+      vectors.push_back({const_cast<uint8_t *>(range.data), range.size});
+
+  size_t nextVector = 0;
+  while (nextVector < vectors.size())
+  {
+    const auto nrVectors = std::min(vectors.size() - nextVector, MAX_RANGES_PER_CALL);
+    const auto written =
+        ::writev(this->fileDescriptor, &vectors.at(nextVector), static_cast<int>(nrVectors));
+    if (written < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      throw std::runtime_error("Error writing to the output file: " +
+                               std::string(std::strerror(errno)));
+    }
+
+    // Skip what was written. After a partial write, continue in the middle of a range.
+    auto remaining = static_cast<size_t>(written);
+    while (nextVector < vectors.size() && remaining >= vectors.at(nextVector).iov_len)
+      remaining -= vectors.at(nextVector++).iov_len;
+    if (remaining > 0)
+    {
+      auto &ioVector    = vectors.at(nextVector);
+      ioVector.iov_base = static_cast<uint8_t *>(ioVector.iov_base) + remaining;
+      ioVector.iov_len -= remaining;
+    }
+  }
+}
+
+void OutputFile::copyFromFile(const int      inputFileDescriptor,
+                              const uint64_t offset,
+                              const size_t   size)
+{
+#ifdef __linux__
+  auto   inputOffset = static_cast<loff_t>(offset);
+  size_t remaining   = size;
+  while (remaining > 0 && this->copyMethod != CopyMethod::Buffer)
+  {
+    ssize_t copied{};
+    if (this->copyMethod == CopyMethod::CopyFileRange)
+      copied = ::copy_file_range(
+          inputFileDescriptor, &inputOffset, this->fileDescriptor, nullptr, remaining, 0);
+    else
+      copied = ::splice(inputFileDescriptor,
+                        &inputOffset,
+                        this->fileDescriptor,
+                        nullptr,
+                        remaining,
+                        SPLICE_F_MOVE);
+
+    if (copied < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      if (!isCopyMethodNotSupported(errno))
+        throw std::runtime_error("Error copying from the input file: " +
+                                 std::string(std::strerror(errno)));
+      this->copyMethod = (this->copyMethod == CopyMethod::CopyFileRange) ? CopyMethod::Splice
+                                                                         : CopyMethod::Buffer;
+      continue;
+    }
+    if (copied == 0)
+      throw std::runtime_error("Error copying from the input file: The file is too short");
+    remaining -= static_cast<size_t>(copied);
+  }
+  if (remaining > 0)
+    this->copyFromFileWithBuffer(
+        inputFileDescriptor, static_cast<uint64_t>(inputOffset), remaining);
+#else
+  this->copyFromFileWithBuffer(inputFileDescriptor, offset, size);
+#endif
+}
+
+void OutputFile::copyFromFileWithBuffer(const int inputFileDescriptor,
+                                        uint64_t  offset,
+                                        size_t    size)
+{
+  this->copyBuffer.resize(std::min(size, COPY_BUFFER_SIZE));
+  while (size > 0)
+  {
+    const auto bytesRead = ::pread(inputFileDescriptor,
+                                   this->copyBuffer.data(),
+                                   std::min(size, this->copyBuffer.size()),
+                                   static_cast<off_t>(offset));
+    if (bytesRead < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      throw std::runtime_error("Error reading from the input file: " +
+                               std::string(std::strerror(errno)));
+    }
+    if (bytesRead == 0)
+      throw std::runtime_error("Error copying from the input file: The file is too short");
+
+    this->writeGather({{this->copyBuffer.data(), static_cast<size_t>(bytesRead)}});
+    offset += static_cast<uint64_t>(bytesRead);
+    size -= static_cast<size_t>(bytesRead);
+  }
+}
+
+#endif
+
+void OutputFile::write(const ByteVector &data)
+{
+  this->writeGather({{data.data(), data.size()}});
+}
+
+} // namespace combiner
@@ -0,0 +1,75 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+
+#include <common/Typedef.h>
+
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+namespace combiner
+{
+
+// A range of bytes that is written from where it is (without copying it into one buffer first).
+struct ByteRange
+{
+  const uint8_t *data{};
+  size_t         size{};
+};
+
+// A range of bytes in an input file. The path is owned by whoever reads the file.
+struct FileRange
+{
+  const std::filesystem::path *filePath{};
+  uint64_t                     offset{};
+  size_t                       size{};
+};
+
+/* A binary output file that can write many separate byte ranges with one call. On POSIX systems,
+ * the ranges are written with writev (scatter-gather), on other systems they are written one
+ * after another.
+ * On POSIX systems, a range of another file can also be appended without passing the data through
+ * user space. On Linux this uses copy_file_range (or splice if the output is a pipe). If the kernel
+ * can not copy between the two files, the range is read and written with a buffer.
+ */
+class OutputFile
+{
+public:
+  OutputFile(const std::filesystem::path &filePath);
+  ~OutputFile();
+
+  OutputFile(const OutputFile &)            = delete;
+  OutputFile &operator=(const OutputFile &) = delete;
+
+  void write(const ByteVector &data);
+  void writeGather(const std::vector<ByteRange> &ranges);
+
+#ifndef _WIN32
+  void copyFromFile(const int inputFileDescriptor, const uint64_t offset, const size_t size);
+#endif
+
+private:
+#ifdef _WIN32
+  std::ofstream outputFile;
+#else
+  void copyFromFileWithBuffer(const int inputFileDescriptor, uint64_t offset, size_t size);
+
+  enum class CopyMethod
+  {
+    CopyFileRange,
+    Splice,
+    Buffer
+  };
+
+  int        fileDescriptor{-1};
+  CopyMethod copyMethod{CopyMethod::CopyFileRange};
+  ByteVector copyBuffer;
+#endif
+};
+
+} // namespace combiner
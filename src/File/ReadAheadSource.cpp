@@ -0,0 +1,177 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include "ReadAheadSource.h"
+
+#include <optional>
+#include <stdexcept>
+
+namespace combiner
+{
+
+namespace
+{
+
+// How often the reader thread checks if it should stop while the source is stalled
+constexpr auto STOP_POLL_INTERVAL = std::chrono::milliseconds(100);
+
+} // namespace
+
+ReadAheadSource::ReadAheadSource(std::unique_ptr<NalUnitSource> &&source,
+                                 const size_t                     maxQueuedNalUnits)
+    : source(std::move(source)), maxQueuedNalUnits(maxQueuedNalUnits)
+{
+  if (!this->source)
+    throw std::invalid_argument("The source to read ahead from is missing");
+  if (this->maxQueuedNalUnits == 0)
+    throw std::invalid_argument("The queue of the read ahead can not be empty");
+
+  this->readerThread = std::thread(&ReadAheadSource::runReaderThread, this);
+}
+
+ReadAheadSource::~ReadAheadSource()
+{
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->stop = true;
+  }
+  this->condition.notify_all();
+  if (this->readerThread.joinable())
+    this->readerThread.join();
+}
+
+ByteVector ReadAheadSource::getNextNALUnit()
+{
+  {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->condition.wait(lock, [this]() { return !this->queue.empty() || this->ended; });
+    if (this->queue.empty())
+    {
+      if (this->error)
+        std::rethrow_exception(this->error);
+      return {};
+    }
+    this->lastNalUnit = std::move(this->queue.front());
+    this->queue.pop_front();
+  }
+  this->condition.notify_all();
+  return std::move(this->lastNalUnit.nalData);
+}
+
+bool ReadAheadSource::waitForNALUnit(const std::chrono::milliseconds timeout)
+{
+  std::unique_lock<std::mutex> lock(this->mutex);
+  const auto canBeRead = [this]() { return !this->queue.empty() || this->ended; };
+
+  // A NAL unit that the source has ready is on its way into the queue
+  this->condition.wait(lock, [this, &canBeRead]() { return canBeRead() || this->sourceStalled; });
+  return this->condition.wait_for(lock, timeout, canBeRead);
+}
+
+uint64_t ReadAheadSource::getFileOffsetOfLastNALUnit() const
+{
+  return this->lastNalUnit.fileOffset;
+}
+
+Timestamps ReadAheadSource::getTimestampsOfLastNALUnit() const
+{
+  return this->lastNalUnit.timestamps;
+}
+
+const std::filesystem::path *ReadAheadSource::getFileOfLastNALUnit() const
+{
+  return this->lastNalUnit.file;
+}
+
+void ReadAheadSource::setStatistics(InputStatistics *statistics)
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->statistics            = statistics;
+  this->sourceSettingsChanged = true;
+}
+
+void ReadAheadSource::setTraceInput(const size_t inputIndex)
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->traceArguments.input  = inputIndex;
+  this->sourceSettingsChanged = true;
+}
+
+void ReadAheadSource::runReaderThread()
+{
+  const auto setSourceStalled = [this](const bool stalled) {
+    {
+      std::lock_guard<std::mutex> lock(this->mutex);
+      this->sourceStalled = stalled;
+    }
+    this->condition.notify_all();
+  };
+
+  try
+  {
+    while (true)
+    {
+      InputStatistics      *newStatistics{};
+      std::optional<size_t> newTraceInput{};
+      auto                  sourceSettingsChanged = false;
+      {
+        std::unique_lock<std::mutex> lock(this->mutex);
+        this->condition.wait(lock, [this]() {
+          return this->stop || this->queue.size() < this->maxQueuedNalUnits;
+        });
+        if (this->stop)
+          return;
+        newStatistics               = this->statistics;
+        newTraceInput               = this->traceArguments.input;
+        sourceSettingsChanged       = this->sourceSettingsChanged;
+        this->sourceSettingsChanged = false;
+      }
+      if (sourceSettingsChanged)
+      {
+        this->source->setStatistics(newStatistics);
+        if (newTraceInput)
+          this->source->setTraceInput(*newTraceInput);
+      }
+
+      if (!this->source->waitForNALUnit(std::chrono::milliseconds(0)))
+      {
+        setSourceStalled(true);
+        if (!this->source->waitForNALUnit(STOP_POLL_INTERVAL))
+          continue;
+        setSourceStalled(false);
+      }
+
+      NalUnit nalUnit;
+      nalUnit.nalData    = this->source->getNextNALUnit();
+      nalUnit.fileOffset = this->source->getFileOffsetOfLastNALUnit();
+      nalUnit.timestamps = this->source->getTimestampsOfLastNALUnit();
+      nalUnit.file       = this->source->getFileOfLastNALUnit();
+
+      const auto endOfSource = nalUnit.nalData.empty();
+      {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        if (endOfSource)
+          this->ended = true;
+        else
+          this->queue.push_back(std::move(nalUnit));
+      }
+      this->condition.notify_all();
+      if (endOfSource)
+        return;
+    }
+  }
+  catch (...)
+  {
+    {
+      std::lock_guard<std::mutex> lock(this->mutex);
+      this->error = std::current_exception();
+      this->ended = true;
+    }
+    this->condition.notify_all();
+  }
+}
+
+} // namespace combiner
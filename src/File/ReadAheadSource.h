@@ -0,0 +1,76 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+
+#include "NalUnitSource.h"
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace combiner
+{
+
+/* Reads the NAL units of another source ahead on its own thread into a bounded queue. If the queue
+ * is full, the thread waits until NAL units are taken from it.
+ * waitForNALUnit only waits for the source if it has no NAL unit ready. So a source that can always
+ * be read without waiting (like a file) is never reported as stalled, while a live source that
+ * stalls never blocks the reader for longer than the timeout.
+ * An error of the source is thrown from getNextNALUnit after the NAL units that were read before.
+ */
+class ReadAheadSource : public NalUnitSource
+{
+public:
+  ReadAheadSource(std::unique_ptr<NalUnitSource> &&source, const size_t maxQueuedNalUnits = 4096);
+  ~ReadAheadSource();
+
+  ReadAheadSource(const ReadAheadSource &)            = delete;
+  ReadAheadSource &operator=(const ReadAheadSource &) = delete;
+
+  ByteVector getNextNALUnit() override;
+  bool       waitForNALUnit(const std::chrono::milliseconds timeout) override;
+
+  uint64_t                     getFileOffsetOfLastNALUnit() const override;
+  Timestamps                   getTimestampsOfLastNALUnit() const override;
+  const std::filesystem::path *getFileOfLastNALUnit() const override;
+
+  // Passed on to the source by the reader thread before it reads the next NAL unit
+  void setStatistics(InputStatistics *statistics) override;
+  void setTraceInput(const size_t inputIndex) override;
+
+private:
+  struct NalUnit
+  {
+    ByteVector                   nalData;
+    uint64_t                     fileOffset{};
+    Timestamps                   timestamps{};
+    const std::filesystem::path *file{};
+  };
+
+  void runReaderThread();
+
+  std::unique_ptr<NalUnitSource> source;
+  size_t                         maxQueuedNalUnits{};
+
+  std::mutex              mutex;
+  std::condition_variable condition;
+  std::deque<NalUnit>     queue;
+  // The source has no NAL unit ready. The reader thread waits for it.
+  bool               sourceStalled{};
+  bool               ended{};
+  bool               stop{};
+  std::exception_ptr error{};
+  bool               sourceSettingsChanged{};
+  std::thread        readerThread;
+
+  NalUnit lastNalUnit;
+};
+
+} // namespace combiner
@@ -0,0 +1,69 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+
+#include "NalUnitSource.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+
+namespace combiner
+{
+
+/* Passes on the NAL units of another source until a stop is requested. Then the input ends, so
+ * that a combination that is stopped ends like at the end of its inputs and its output can be
+ * finished. While the source has no NAL unit ready (e.g. a stalled live input), the stop is checked
+ * regularly.
+ */
+class StoppableSource : public NalUnitSource
+{
+public:
+  StoppableSource(std::unique_ptr<NalUnitSource> &&source, const std::atomic<bool> &stopRequested)
+      : source(std::move(source)), stopRequested(stopRequested)
+  {
+  }
+
+  ByteVector getNextNALUnit() override
+  {
+    while (!this->stopRequested)
+      if (this->source->waitForNALUnit(STOP_POLL_INTERVAL))
+        return this->source->getNextNALUnit();
+    return {};
+  }
+  bool waitForNALUnit(const std::chrono::milliseconds timeout) override
+  {
+    return this->stopRequested || this->source->waitForNALUnit(timeout);
+  }
+
+  uint64_t getFileOffsetOfLastNALUnit() const override
+  {
+    return this->source->getFileOffsetOfLastNALUnit();
+  }
+  Timestamps getTimestampsOfLastNALUnit() const override
+  {
+    return this->source->getTimestampsOfLastNALUnit();
+  }
+  const std::filesystem::path *getFileOfLastNALUnit() const override
+  {
+    return this->source->getFileOfLastNALUnit();
+  }
+
+  void setStatistics(InputStatistics *statistics) override
+  {
+    this->source->setStatistics(statistics);
+  }
+  void setTraceInput(const size_t inputIndex) override { this->source->setTraceInput(inputIndex); }
+
+private:
+  static constexpr auto STOP_POLL_INTERVAL = std::chrono::milliseconds(100);
+
+  std::unique_ptr<NalUnitSource> source;
+  const std::atomic<bool>       &stopRequested;
+};
+
+} // namespace combiner
@@ -0,0 +1,29 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include "AccessUnitDetector.h"
+
+namespace combiner::parser::hevc
+{
+
+bool AccessUnitDetector::update(const nal_unit_header &header,
+                                const bool             firstSliceSegmentInPicFlag)
+{
+  if (header.startsAccessUnitAfterVCL() && this->seenVCLInAccessUnit)
+  {
+    this->seenVCLInAccessUnit = false;
+    return true;
+  }
+  if (header.isVCL())
+  {
+    const auto startsAccessUnit = firstSliceSegmentInPicFlag && this->seenVCLInAccessUnit;
+    this->seenVCLInAccessUnit   = true;
+    return startsAccessUnit;
+  }
+  return false;
+}
+
+} // namespace combiner::parser::hevc
@@ -0,0 +1,26 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+
+#include "nal_unit_header.h"
+
+namespace combiner::parser::hevc
+{
+
+// Finds the first NAL unit of each access unit (7.4.2.4.4) in a sequence of NAL units.
+class AccessUnitDetector
+{
+public:
+  // Must be called for all NAL units in decoding order. Returns true if the NAL unit is the first
+  // NAL unit of a new access unit (false for the NAL units before the first VCL NAL unit).
+  bool update(const nal_unit_header &header, const bool firstSliceSegmentInPicFlag);
+
+private:
+  bool seenVCLInAccessUnit{};
+};
+
+} // namespace combiner::parser::hevc
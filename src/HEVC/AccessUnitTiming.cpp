@@ -0,0 +1,167 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include "AccessUnitTiming.h"
+
+#include <common/Logger.h>
+
+#include "slice_segment_header.h"
+
+#include <stdexcept>
+#include <string>
+
+namespace combiner::parser::hevc
+{
+
+namespace
+{
+
+// Used if neither the SPS nor the VPS contain timing information
+constexpr uint32_t DEFAULT_TIMESCALE        = 90000;
+constexpr uint32_t DEFAULT_PICTURE_DURATION = 3600;
+
+bool resetsPOC(const nal_unit_header &header)
+{
+  return header.isBLA() || header.isIDR();
+}
+
+} // namespace
+
+AccessUnitTiming::NalUnit AccessUnitTiming::update(const ByteVector &nalData)
+{
+  NalUnit       nal;
+  SubByteReader reader(nalData);
+  nal.header.parse(reader);
+
+  // The first_slice_segment_in_pic_flag is the first bit after the nal_unit_header.
+  const auto firstSliceSegmentInPicFlag =
+      nal.header.isSlice() && nalData.size() > 2 && (nalData.at(2) & 0x80) != 0;
+  nal.startsAccessUnit = this->accessUnitDetector.update(nal.header, firstSliceSegmentInPicFlag);
+
+  const auto nalType = nal.header.nal_unit_type;
+  if (nalType == NalType::VPS_NUT)
+  {
+    video_parameter_set_rbsp vps;
+    vps.parse(reader);
+    this->activeParameterSets.vpsMap[vps.vps_video_parameter_set_id] = vps;
+  }
+  else if (nalType == NalType::SPS_NUT)
+  {
+    seq_parameter_set_rbsp sps;
+    sps.parse(reader);
+    this->activeParameterSets.spsMap[sps.sps_seq_parameter_set_id] = sps;
+
+    if (!this->firstSPS)
+    {
+      const auto &vpsMap = this->activeParameterSets.vpsMap;
+      const auto  vps    = vpsMap.find(sps.sps_video_parameter_set_id);
+      this->pictureTiming = hevc::getPictureTiming(
+          vps != vpsMap.end() ? vps->second : video_parameter_set_rbsp(), sps);
+      if (!this->pictureTiming)
+        logger().warning("No timing information in the SPS or VPS. Assuming 25 frames per "
+                         "second.");
+      this->firstSPS = std::move(sps);
+    }
+  }
+  else if (nalType == NalType::PPS_NUT)
+  {
+    pic_parameter_set_rbsp pps;
+    pps.parse(reader);
+    this->activeParameterSets.ppsMap[pps.pps_pic_parameter_set_id] = pps;
+  }
+  else if (firstSliceSegmentInPicFlag)
+    nal.picture = this->parsePicture(reader, nal.header);
+
+  return nal;
+}
+
+PictureTiming AccessUnitTiming::getPictureTiming() const
+{
+  return this->pictureTiming.value_or(PictureTiming{DEFAULT_TIMESCALE, DEFAULT_PICTURE_DURATION});
+}
+
+int64_t AccessUnitTiming::getTimeOfPictureIndex(const int64_t index, const int64_t clockRate) const
+{
+  const auto timing = this->getPictureTiming();
+  return index * int64_t(timing.pictureDuration) * clockRate / int64_t(timing.timescale);
+}
+
+int64_t AccessUnitTiming::getReorderDelay() const
+{
+  if (!this->firstSPS || this->firstSPS->sps_max_num_reorder_pics.empty())
+    return 0;
+  return static_cast<int64_t>(this->firstSPS->sps_max_num_reorder_pics.back());
+}
+
+const std::optional<seq_parameter_set_rbsp> &AccessUnitTiming::getFirstSPS() const
+{
+  return this->firstSPS;
+}
+
+AccessUnitTiming::Picture AccessUnitTiming::parsePicture(SubByteReader         &reader,
+                                                         const nal_unit_header &header)
+{
+  // The slice segment header (7.3.6.1) is only read up to the slice_pic_order_cnt_lsb. The first
+  // slice segment of a picture is never a dependent slice segment.
+  reader.readFlag(); // first_slice_segment_in_pic_flag
+  if (header.isIRAP())
+    reader.readFlag(); // no_output_of_prior_pics_flag
+  const auto slice_pic_parameter_set_id = reader.readUEV();
+
+  const auto &ppsMap = this->activeParameterSets.ppsMap;
+  const auto  pps    = ppsMap.find(slice_pic_parameter_set_id);
+  if (pps == ppsMap.end())
+    throw std::runtime_error("PPS with ID " + std::to_string(slice_pic_parameter_set_id) +
+                             " of a slice segment not found");
+  const auto &spsMap = this->activeParameterSets.spsMap;
+  const auto  sps    = spsMap.find(pps->second.pps_seq_parameter_set_id);
+  if (sps == spsMap.end())
+    throw std::runtime_error("SPS with ID " + std::to_string(pps->second.pps_seq_parameter_set_id) +
+                             " of a slice segment not found");
+
+  for (unsigned i = 0; i < pps->second.num_extra_slice_header_bits; i++)
+    reader.readFlag(); // slice_reserved_flag
+  reader.readUEV();    // slice_type
+  if (pps->second.output_flag_present_flag)
+    reader.readFlag(); // pic_output_flag
+  if (sps->second.separate_colour_plane_flag)
+    reader.readBits(2); // colour_plane_id
+
+  const auto log2MaxPicOrderCntLsb   = sps->second.log2_max_pic_order_cnt_lsb_minus4 + 4;
+  uint64_t   slice_pic_order_cnt_lsb = 0;
+  if (!header.isIDR())
+    slice_pic_order_cnt_lsb = reader.readBits(log2MaxPicOrderCntLsb);
+
+  // The POC is derived like in the decoder (8.3.1)
+  const auto NoRaslOutputFlag = resetsPOC(header) || this->nrPictures == 0;
+  const auto PicOrderCntMsb =
+      calculatePicOrderCntMsb(slice_pic_order_cnt_lsb,
+                              1u << log2MaxPicOrderCntLsb,
+                              header.isIRAP() && NoRaslOutputFlag,
+                              this->prevTid0PicSlicePicOrderCntLsb,
+                              this->prevTid0PicPicOrderCntMsb);
+  if (header.nuh_temporal_id_plus1 == 1 && !header.isRASL() && !header.isRADL())
+  {
+    this->prevTid0PicSlicePicOrderCntLsb = slice_pic_order_cnt_lsb;
+    this->prevTid0PicPicOrderCntMsb      = PicOrderCntMsb;
+  }
+
+  Picture picture;
+  picture.POC         = PicOrderCntMsb + static_cast<int>(slice_pic_order_cnt_lsb);
+  picture.isIRAP      = header.isIRAP();
+  picture.decodeIndex = this->nrPictures;
+  if (resetsPOC(header) || this->nrPictures == 0)
+  {
+    this->POCOfLastReset   = picture.POC;
+    this->indexOfLastReset = this->nrPictures;
+  }
+  picture.presentationIndex = this->indexOfLastReset + (picture.POC - this->POCOfLastReset);
+
+  this->nrPictures++;
+  return picture;
+}
+
+} // namespace combiner::parser::hevc
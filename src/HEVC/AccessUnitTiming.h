@@ -0,0 +1,82 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+
+#include <common/Typedef.h>
+
+#include "AccessUnitDetector.h"
+#include "PictureTiming.h"
+#include "commonMaps.h"
+#include "nal_unit_header.h"
+
+#include <cstdint>
+#include <optional>
+
+namespace combiner::parser::hevc
+{
+
+/* Follows the NAL units of a stream in decoding order to find the access units and the timing of
+ * their pictures. This is what sinks need that write a container with timestamps. Only the
+ * parameter sets are parsed. Of a slice segment only the NAL unit header is read and, for the first
+ * slice segment of a picture, the start of the slice segment header up to the POC.
+ * The timing is taken from the first SPS (and its VPS). The presentation index of a picture is its
+ * POC relative to the POC and decoding index of the last IDR or BLA picture that reset the POC.
+ * This assumes that the POCs step by one per picture, which the combiner keeps when it removes
+ * temporal sub-layers.
+ */
+class AccessUnitTiming
+{
+public:
+  struct Picture
+  {
+    int     POC{};
+    bool    isIRAP{};
+    int64_t decodeIndex{};
+    int64_t presentationIndex{};
+  };
+
+  struct NalUnit
+  {
+    nal_unit_header header;
+    // The NAL unit is the first NAL unit of a new access unit
+    bool startsAccessUnit{};
+    // Only set for the first slice segment of a picture
+    std::optional<Picture> picture{};
+  };
+
+  // Must be called for all NAL units in decoding order.
+  NalUnit update(const ByteVector &nalData);
+
+  // The timing of the first SPS. Without timing information (or before the first SPS), 25 frames
+  // per second are assumed.
+  PictureTiming getPictureTiming() const;
+  // The time of the picture with the given decode or presentation index in ticks of the clock.
+  int64_t getTimeOfPictureIndex(const int64_t index, const int64_t clockRate) const;
+  // The maximum number of pictures that precede a picture in decoding order and follow it in
+  // presentation order. The presentation can be delayed by this to never be before the decoding.
+  int64_t getReorderDelay() const;
+
+  const std::optional<seq_parameter_set_rbsp> &getFirstSPS() const;
+
+private:
+  Picture parsePicture(SubByteReader &reader, const nal_unit_header &header);
+
+  AccessUnitDetector  accessUnitDetector;
+  ActiveParameterSets activeParameterSets;
+
+  std::optional<seq_parameter_set_rbsp> firstSPS{};
+  std::optional<PictureTiming>          pictureTiming{};
+
+  int64_t  nrPictures{};
+  uint64_t prevTid0PicSlicePicOrderCntLsb{};
+  int      prevTid0PicPicOrderCntMsb{};
+
+  int     POCOfLastReset{};
+  int64_t indexOfLastReset{};
+};
+
+} // namespace combiner::parser::hevc
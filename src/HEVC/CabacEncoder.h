@@ -0,0 +1,52 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+
+#include <common/SubByteWriter.h>
+
+#include <cstdint>
+
+namespace combiner::parser::hevc
+{
+
+// The state of one context variable (T-REC-H.265-201410 - 9.3.2.2)
+struct CabacContext
+{
+  uint8_t pStateIdx{};
+  bool    valMps{};
+};
+
+// The initialization of a context variable from its initValue for the SliceQpY of the slice.
+CabacContext initCabacContext(const unsigned initValue, const int SliceQpY);
+
+/* The arithmetic encoding engine (T-REC-H.265-201410 - 9.3.4.3.1 and 9.3.5). The bits are written
+ * to the writer (with emulation prevention). Encoding a terminate bin with the value 1 flushes the
+ * engine. The last bit that is written then is the rbsp_stop_one_bit of the slice data.
+ */
+class CabacEncoder
+{
+public:
+  CabacEncoder(SubByteWriter &writer) : writer(writer) {}
+
+  void encodeDecision(CabacContext &context, const bool binVal);
+  void encodeBypass(const bool binVal);
+  void encodeTerminate(const bool binVal);
+
+private:
+  void renormalize();
+  void flush();
+  void putBit(const bool bit);
+
+  SubByteWriter &writer;
+
+  uint32_t ivlLow{};
+  uint32_t ivlCurrRange{510};
+  uint32_t bitsOutstanding{};
+  bool     firstBitFlag{true};
+};
+
+} // namespace combiner::parser::hevc
@@ -0,0 +1,45 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include "NalIndexHEVC.h"
+
+#include <File/FileSourceAnnexB.h>
+
+namespace combiner::parser::hevc
+{
+
+NalIndex createNalIndex(const std::filesystem::path &inputFile,
+                        const SliceParsingMode       sliceParsingMode,
+                        const IsIndexComplete       &isIndexComplete)
+{
+  ParserAnnexBHEVC parser(std::make_unique<FileSourceAnnexB>(inputFile), sliceParsingMode);
+
+  NalIndex index;
+  while (!isIndexComplete || !isIndexComplete(index))
+  {
+    const auto nal = parser.parseNextNalFromFile();
+    if (nal.rawData.empty())
+      return index;
+
+    NalIndexEntry entry;
+    entry.offset      = parser.getFileOffsetOfLastNalUnit();
+    entry.size        = static_cast<uint32_t>(nal.rawData.size());
+    entry.nalUnitType = static_cast<uint8_t>(nal.header.nalUnitTypeID);
+    entry.temporalId  = static_cast<uint8_t>(nal.header.nuh_temporal_id_plus1 - 1);
+    entry.isIRAP      = nal.header.isIRAP();
+    if (nal.header.isSlice() && nal.rawData.size() > 2)
+    {
+      // The first_slice_segment_in_pic_flag is the first bit after the nal_unit_header.
+      entry.isFirstSliceSegmentInPic = (nal.rawData.at(2) & 0x80) != 0;
+    }
+    if (const auto slice = dynamic_cast<slice_segment_layer_rbsp *>(nal.rbsp.get()))
+      entry.POC = slice->sliceSegmentHeader.PicOrderCntVal;
+    index.entries.push_back(entry);
+  }
+  return index;
+}
+
+} // namespace combiner::parser::hevc
@@ -0,0 +1,30 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+
+#include "ParserAnnexBHEVC.h"
+
+#include <File/NalIndex.h>
+
+#include <filesystem>
+#include <functional>
+
+namespace combiner::parser::hevc
+{
+
+using IsIndexComplete = std::function<bool(const NalIndex &)>;
+
+/* Scan and parse the Annex B file once and create an index of all NAL units in it. The scan can
+ * be stopped early with the isIndexComplete function. With the NalUnitHeaderOnly parsing mode,
+ * the index entries contain no POC.
+ */
+NalIndex createNalIndex(
+    const std::filesystem::path &inputFile,
+    const SliceParsingMode       sliceParsingMode = SliceParsingMode::SliceSegmentHeader,
+    const IsIndexComplete       &isIndexComplete  = {});
+
+} // namespace combiner::parser::hevc
@@ -28,6 +28,7 @@ class NalUnitHEVC
 public:
   NalUnitHEVC() = default;
   NalUnitHEVC(const ByteVector &rawData) : rawData(rawData) {}
+  NalUnitHEVC(ByteVector &&rawData) : rawData(std::move(rawData)) {}
 
   nal_unit_header          header{};
   std::unique_ptr<NalRBSP> rbsp{};
@@ -12,6 +12,7 @@
 #include <HEVC/video_parameter_set_rbsp.h>
 
 #include <iostream>
+#include <stdexcept>
 
 namespace combiner::parser::hevc
 {
@@ -21,20 +22,72 @@ namespace
 
 } // namespace
 
-ParserAnnexBHEVC::ParserAnnexBHEVC(combiner::FileSourceAnnexB &&fileSource)
-    : fileSource(std::move(fileSource))
+ParserAnnexBHEVC::ParserAnnexBHEVC(std::unique_ptr<NalUnitSource> &&source,
+                                   SliceParsingMode                 sliceParsingMode)
+    : source(std::move(source)), sliceParsingMode(sliceParsingMode)
+{
+}
+
+ParserAnnexBHEVC::ParserAnnexBHEVC(SliceParsingMode sliceParsingMode)
+    : sliceParsingMode(sliceParsingMode)
 {
 }
 
 NalUnitHEVC ParserAnnexBHEVC::parseNextNalFromFile()
 {
-  const auto nalData = this->fileSource.getNextNALUnit();
-  if (nalData.size() == 0)
-    return {};
+  if (!this->source)
+    throw std::logic_error("The parser has no source to read from");
+
+  while (true)
+  {
+    auto nalData = this->source->getNextNALUnit();
+    if (nalData.size() == 0)
+      return {};
+    if (this->highestTemporalId && nalData.size() >= 2)
+    {
+      nal_unit_header       header;
+      parser::SubByteReader reader(nalData);
+      header.parse(reader);
+      if (header.nuh_temporal_id_plus1 - 1 > *this->highestTemporalId)
+      {
+        addToCounter(getCounter(this->statistics, &InputStatistics::nrDroppedNalUnits), 1);
+        continue;
+      }
+    }
+    return this->parseNalUnit(std::move(nalData));
+  }
+}
+
+void ParserAnnexBHEVC::setHighestTemporalId(const std::optional<unsigned> highestTemporalId)
+{
+  this->highestTemporalId = highestTemporalId;
+}
+
+bool ParserAnnexBHEVC::waitForNalUnit(const std::chrono::milliseconds timeout)
+{
+  if (!this->source)
+    throw std::logic_error("The parser has no source to read from");
+  return this->source->waitForNALUnit(timeout);
+}
+
+NalUnitHEVC ParserAnnexBHEVC::parseNalUnit(ByteVector &&nalData)
+{
+  ScopedTimer      timer(getCounter(this->statistics, &InputStatistics::headerParseTime));
+  ScopedTraceEvent traceEvent("parse", this->traceArguments);
 
-  NalUnitHEVC           nal(nalData);
-  parser::SubByteReader reader(nalData);
+  NalUnitHEVC           nal(std::move(nalData));
+  parser::SubByteReader reader(nal.rawData);
   nal.header.parse(reader);
+  traceEvent.setNalUnitType(nal.header.nalUnitTypeID);
+
+  addToCounter(getCounter(this->statistics, &InputStatistics::nrNalUnits), 1);
+  if (this->statistics != nullptr && nal.header.isSlice() && nal.rawData.size() > 2)
+  {
+    // The first_slice_segment_in_pic_flag is the first bit after the nal_unit_header.
+    const auto firstSliceSegmentInPicFlag = (nal.rawData.at(2) & 0x80) != 0;
+    if (firstSliceSegmentInPicFlag)
+      addToCounter(&this->statistics->nrAccessUnits, 1);
+  }
 
   if (nal.header.nal_unit_type == NalType::VPS_NUT)
   {
@@ -60,39 +113,83 @@ NalUnitHEVC ParserAnnexBHEVC::parseNextNalFromFile()
 
     this->activeParameterSets.ppsMap[pps.pps_pic_parameter_set_id] = pps;
   }
-  if (nal.header.isSlice())
+  else if (nal.header.isSlice() &&
+           this->sliceParsingMode == SliceParsingMode::SliceSegmentHeader)
   {
-    slice_segment_layer_rbsp slice;
-    slice.parse(reader,
-                this->firstAUInDecodingOrder,
-                this->prevTid0PicSlicePicOrderCntLsb,
-                this->prevTid0PicPicOrderCntMsb,
-                nal.header,
-                this->activeParameterSets,
-                this->firstSliceInSegmentPicOrderCntLsb);
-
-    this->firstAUInDecodingOrder = false;
-    auto TemporalId              = nal.header.nuh_temporal_id_plus1 - 1;
-    if (TemporalId == 0 && !nal.header.isRASL() && !nal.header.isRADL())
-    {
-      // Let prevTid0Pic be the previous picture in decoding order that has TemporalId
-      // equal to 0 and that is not a RASL picture, a RADL picture or an SLNR picture.
-      // Set these for the next slice
-      this->prevTid0PicSlicePicOrderCntLsb = slice.sliceSegmentHeader.slice_pic_order_cnt_lsb;
-      this->prevTid0PicPicOrderCntMsb      = slice.sliceSegmentHeader.PicOrderCntMsb;
-    }
-    if (slice.sliceSegmentHeader.first_slice_segment_in_pic_flag)
-      this->firstSliceInSegmentPicOrderCntLsb = slice.sliceSegmentHeader.slice_pic_order_cnt_lsb;
-
-    nal.rbsp = std::make_unique<slice_segment_layer_rbsp>(slice);
+    this->parseSliceSegmentHeader(nal, reader);
+    const auto slice = dynamic_cast<slice_segment_layer_rbsp *>(nal.rbsp.get());
+    traceEvent.setPOC(slice->sliceSegmentHeader.PicOrderCntVal);
   }
 
   return nal;
 }
 
+void ParserAnnexBHEVC::parseSliceSegmentHeader(NalUnitHEVC &nal, SubByteReader &reader)
+{
+  auto slice = std::make_unique<slice_segment_layer_rbsp>();
+  slice->parse(reader,
+               this->firstAUInDecodingOrder,
+               this->prevTid0PicSlicePicOrderCntLsb,
+               this->prevTid0PicPicOrderCntMsb,
+               nal.header,
+               this->activeParameterSets,
+               this->firstSliceInSegmentPicOrderCntLsb);
+
+  const auto &sliceHeader      = slice->sliceSegmentHeader;
+  this->firstAUInDecodingOrder = false;
+  auto TemporalId              = nal.header.nuh_temporal_id_plus1 - 1;
+  if (TemporalId == 0 && !nal.header.isRASL() && !nal.header.isRADL())
+  {
+    // Let prevTid0Pic be the previous picture in decoding order that has TemporalId
+    // equal to 0 and that is not a RASL picture, a RADL picture or an SLNR picture.
+    // Set these for the next slice
+    this->prevTid0PicSlicePicOrderCntLsb = sliceHeader.slice_pic_order_cnt_lsb;
+    this->prevTid0PicPicOrderCntMsb      = sliceHeader.PicOrderCntMsb;
+  }
+  if (sliceHeader.first_slice_segment_in_pic_flag)
+    this->firstSliceInSegmentPicOrderCntLsb = sliceHeader.slice_pic_order_cnt_lsb;
+
+  nal.rbsp = std::move(slice);
+}
+
 const ActiveParameterSets &ParserAnnexBHEVC::getActiveParameterSets() const
 {
   return this->activeParameterSets;
 }
 
+uint64_t ParserAnnexBHEVC::getFileOffsetOfLastNalUnit() const
+{
+  if (!this->source)
+    throw std::logic_error("The parser has no source to read from");
+  return this->source->getFileOffsetOfLastNALUnit();
+}
+
+const std::filesystem::path *ParserAnnexBHEVC::getFileOfLastNalUnit() const
+{
+  if (!this->source)
+    return nullptr;
+  return this->source->getFileOfLastNALUnit();
+}
+
+Timestamps ParserAnnexBHEVC::getTimestampsOfLastNalUnit() const
+{
+  if (!this->source)
+    throw std::logic_error("The parser has no source to read from");
+  return this->source->getTimestampsOfLastNALUnit();
+}
+
+void ParserAnnexBHEVC::setStatistics(InputStatistics *statistics)
+{
+  this->statistics = statistics;
+  if (this->source)
+    this->source->setStatistics(statistics);
+}
+
+void ParserAnnexBHEVC::setTraceInput(const size_t inputIndex)
+{
+  this->traceArguments.input = inputIndex;
+  if (this->source)
+    this->source->setTraceInput(inputIndex);
+}
+
 } // namespace combiner::parser::hevc
@@ -10,23 +10,58 @@
 #include "commonMaps.h"
 #include "slice_segment_layer_rbsp.h"
 
-#include <File/FileSourceAnnexB.h>
+#include <File/NalUnitSource.h>
+
+#include <chrono>
+#include <memory>
 #include <optional>
 
 namespace combiner::parser::hevc
 {
 
+// How much of a slice NAL unit is parsed. Parameter sets are always parsed completely and all
+// other NAL units (SEI, AUD, filler data ...) only get their nal_unit_header parsed.
+enum class SliceParsingMode
+{
+  // Only parse the nal_unit_header. Use this if slices are passed through unmodified.
+  NalUnitHeaderOnly,
+  // Parse the slice segment header so that it can be rewritten (e.g. for a new layout).
+  SliceSegmentHeader
+};
+
 class ParserAnnexBHEVC
 {
 public:
-  ParserAnnexBHEVC(combiner::FileSourceAnnexB &&file);
+  ParserAnnexBHEVC(std::unique_ptr<NalUnitSource> &&source,
+                   SliceParsingMode sliceParsingMode = SliceParsingMode::SliceSegmentHeader);
+  // Without a source, the NAL units must be passed in with parseNalUnit.
+  ParserAnnexBHEVC(SliceParsingMode sliceParsingMode = SliceParsingMode::SliceSegmentHeader);
 
   NalUnitHEVC parseNextNalFromFile();
+  NalUnitHEVC parseNalUnit(ByteVector &&nalData);
+
+  // Wait up to the timeout until the next NAL unit can be parsed from the source without blocking.
+  bool waitForNalUnit(const std::chrono::milliseconds timeout);
 
-  const ActiveParameterSets &getActiveParameterSets() const;
+  const ActiveParameterSets   &getActiveParameterSets() const;
+  uint64_t                     getFileOffsetOfLastNalUnit() const;
+  const std::filesystem::path *getFileOfLastNalUnit() const;
+  Timestamps                   getTimestampsOfLastNalUnit() const;
+
+  // Drop all NAL units from the source that have a higher TemporalId (before they are parsed).
+  void                    setHighestTemporalId(const std::optional<unsigned> highestTemporalId);
+  std::optional<unsigned> getHighestTemporalId() const { return this->highestTemporalId; }
+
+  // Count NAL units, access units and the parsing time of this input (and of its source).
+  void setStatistics(InputStatistics *statistics);
+  // The input index that trace events of this parser (and of its source) are tagged with.
+  void setTraceInput(const size_t inputIndex);
 
 private:
-  FileSourceAnnexB fileSource;
+  void parseSliceSegmentHeader(NalUnitHEVC &nal, SubByteReader &reader);
+
+  std::unique_ptr<NalUnitSource> source;
+  SliceParsingMode               sliceParsingMode{};
 
   ActiveParameterSets activeParameterSets;
 
@@ -35,6 +70,10 @@ private:
   int      prevTid0PicPicOrderCntMsb{};
 
   std::optional<uint64_t> firstSliceInSegmentPicOrderCntLsb{};
+  std::optional<unsigned> highestTemporalId{};
+
+  InputStatistics *statistics{};
+  TraceArguments   traceArguments{};
 };
 
 } // namespace combiner::parser::hevc
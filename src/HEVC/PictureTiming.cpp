@@ -0,0 +1,27 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include "PictureTiming.h"
+
+namespace combiner::parser::hevc
+{
+
+std::optional<PictureTiming> getPictureTiming(const video_parameter_set_rbsp &vps,
+                                              const seq_parameter_set_rbsp   &sps)
+{
+  const auto &vui = sps.vuiParameters;
+  if (sps.vui_parameters_present_flag && vui.vui_timing_info_present_flag &&
+      vui.vui_time_scale > 0 && vui.vui_num_units_in_tick > 0)
+    return PictureTiming{static_cast<uint32_t>(vui.vui_time_scale),
+                         static_cast<uint32_t>(vui.vui_num_units_in_tick)};
+  if (vps.vps_timing_info_present_flag && vps.vps_time_scale > 0 &&
+      vps.vps_num_units_in_tick > 0)
+    return PictureTiming{static_cast<uint32_t>(vps.vps_time_scale),
+                         static_cast<uint32_t>(vps.vps_num_units_in_tick)};
+  return {};
+}
+
+} // namespace combiner::parser::hevc
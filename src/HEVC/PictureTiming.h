@@ -0,0 +1,29 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+
+#include "seq_parameter_set_rbsp.h"
+#include "video_parameter_set_rbsp.h"
+
+#include <cstdint>
+#include <optional>
+
+namespace combiner::parser::hevc
+{
+
+// The time scale (ticks per second) and the duration of one picture in ticks.
+struct PictureTiming
+{
+  uint32_t timescale{};
+  uint32_t pictureDuration{};
+};
+
+// The timing from the VUI of the SPS or, if not present there, from the VPS.
+std::optional<PictureTiming> getPictureTiming(const video_parameter_set_rbsp &vps,
+                                              const seq_parameter_set_rbsp   &sps);
+
+} // namespace combiner::parser::hevc
@@ -0,0 +1,392 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include "ReadPlanHEVC.h"
+
+#include "AccessUnitDetector.h"
+#include "NalIndexHEVC.h"
+
+#include <HEVC/pic_parameter_set_rbsp.h>
+#include <HEVC/seq_parameter_set_rbsp.h>
+#include <HEVC/video_parameter_set_rbsp.h>
+
+#include <fstream>
+#include <functional>
+#include <map>
+#include <set>
+#include <stdexcept>
+
+namespace combiner::parser::hevc
+{
+
+namespace
+{
+
+using ReadNalUnitFunction = std::function<ByteVector(const NalIndexEntry &)>;
+
+// The index only has the numeric nal_unit_type of every entry
+nal_unit_header getHeader(const NalIndexEntry &entry)
+{
+  return nal_unit_header::fromNalUnitTypeID(entry.nalUnitType);
+}
+
+ByteVector readNalUnit(std::ifstream &file, const NalIndexEntry &entry)
+{
+  ByteVector data(entry.size);
+  file.clear();
+  file.seekg(static_cast<std::streamoff>(entry.offset));
+  file.read(reinterpret_cast<char *>(data.data()), static_cast<std::streamsize>(entry.size));
+  if (!file)
+    throw std::runtime_error("Error reading NAL unit at offset " + std::to_string(entry.offset));
+  return data;
+}
+
+std::pair<NalType, uint64_t> parseParameterSetID(const ByteVector &nalData)
+{
+  SubByteReader   reader(nalData);
+  nal_unit_header header;
+  header.parse(reader);
+
+  if (header.nal_unit_type == NalType::VPS_NUT)
+  {
+    video_parameter_set_rbsp vps;
+    vps.parse(reader);
+    return {NalType::VPS_NUT, vps.vps_video_parameter_set_id};
+  }
+  if (header.nal_unit_type == NalType::SPS_NUT)
+  {
+    seq_parameter_set_rbsp sps;
+    sps.parse(reader);
+    return {NalType::SPS_NUT, sps.sps_seq_parameter_set_id};
+  }
+  pic_parameter_set_rbsp pps;
+  pps.parse(reader);
+  return {NalType::PPS_NUT, pps.pps_pic_parameter_set_id};
+}
+
+std::optional<double> parseFrameDuration(const ByteVector &spsData)
+{
+  SubByteReader   reader(spsData);
+  nal_unit_header header;
+  header.parse(reader);
+  seq_parameter_set_rbsp sps;
+  sps.parse(reader);
+
+  const auto &vui = sps.vuiParameters;
+  if (!sps.vui_parameters_present_flag || !vui.vui_timing_info_present_flag ||
+      vui.vui_time_scale == 0)
+    return {};
+  return static_cast<double>(vui.vui_num_units_in_tick) / static_cast<double>(vui.vui_time_scale);
+}
+
+// Finds the first NAL unit of each access unit while going through the entries.
+class AccessUnitTracker
+{
+public:
+  // Returns the index of the first entry of the access unit that the entry belongs to.
+  size_t update(const size_t entryIndex, const NalIndexEntry &entry)
+  {
+    if (this->detector.update(getHeader(entry), entry.isFirstSliceSegmentInPic))
+      this->accessUnitStart = entryIndex;
+    return this->accessUnitStart;
+  }
+
+private:
+  AccessUnitDetector detector;
+  size_t             accessUnitStart{};
+};
+
+// Goes through the index entries in decoding order until the start and end of the range are found.
+class ReadRangeFinder
+{
+public:
+  ReadRangeFinder(const ReadRange &range, ReadNalUnitFunction readNalUnit)
+      : range(range), readNalUnit(readNalUnit)
+  {
+    if (!this->range.start)
+    {
+      this->startEntry          = 0;
+      this->leadingPicturesDone = true;
+    }
+  }
+
+  void update(const NalIndex &index)
+  {
+    while (!this->isDone() && this->nextEntry < index.entries.size())
+    {
+      this->processEntry(index.entries.at(this->nextEntry));
+      ++this->nextEntry;
+    }
+  }
+
+  bool isDone() const
+  {
+    return this->startEntry && this->leadingPicturesDone && (!this->range.end || this->endEntry);
+  }
+
+  std::optional<size_t> startEntry{};
+  std::optional<size_t> endEntry{};
+  std::vector<size_t>   skippedEntries;
+
+private:
+  void processEntry(const NalIndexEntry &entry)
+  {
+    const auto header     = getHeader(entry);
+    this->accessUnitStart = this->accessUnitTracker.update(this->nextEntry, entry);
+
+    if (header.nal_unit_type == NalType::SPS_NUT && !this->frameDuration)
+      this->frameDuration = parseFrameDuration(this->readNalUnit(entry));
+
+    if (!header.isVCL())
+      return;
+
+    if (entry.isFirstSliceSegmentInPic)
+      this->processFirstSliceOfPicture(entry);
+
+    if (header.isRASL() && !this->seenTrailingPictureSinceLastIRAP)
+    {
+      this->raslEntriesOfLastIRAP.push_back(this->nextEntry);
+      if (this->startEntry && this->startIsCRAOrBLA && !this->leadingPicturesDone)
+        this->skippedEntries.push_back(this->nextEntry);
+    }
+  }
+
+  void processFirstSliceOfPicture(const NalIndexEntry &entry)
+  {
+    const auto header = getHeader(entry);
+    ++this->pictureIndex;
+    if (entry.isIRAP)
+    {
+      ++this->irapIndex;
+      this->lastIRAPAccessUnitStart          = this->accessUnitStart;
+      this->lastIRAPHeader                   = header;
+      this->seenTrailingPictureSinceLastIRAP = false;
+      this->raslEntriesOfLastIRAP.clear();
+    }
+    else if (!header.isRADL() && !header.isRASL())
+      this->seenTrailingPictureSinceLastIRAP = true;
+
+    if (!this->startEntry)
+    {
+      if (this->isAtPosition(entry, *this->range.start))
+      {
+        if (!this->lastIRAPAccessUnitStart)
+          throw std::runtime_error("No IRAP picture before the start position");
+        this->startEntry          = this->lastIRAPAccessUnitStart;
+        this->startIsCRAOrBLA     = (this->lastIRAPHeader.nal_unit_type == NalType::CRA_NUT ||
+                                 this->lastIRAPHeader.isBLA());
+        this->startPictureIndex   = this->pictureIndex;
+        this->leadingPicturesDone = this->seenTrailingPictureSinceLastIRAP;
+        if (this->startIsCRAOrBLA)
+          this->skippedEntries = this->raslEntriesOfLastIRAP;
+      }
+      return;
+    }
+
+    const auto isNextIRAP = entry.isIRAP && this->accessUnitStart != *this->startEntry;
+    if (this->seenTrailingPictureSinceLastIRAP || isNextIRAP)
+      this->leadingPicturesDone = true;
+
+    if (this->range.end && !this->endEntry && this->pictureIndex > this->startPictureIndex &&
+        this->isAtPosition(entry, *this->range.end))
+      this->endEntry = this->accessUnitStart;
+  }
+
+  bool isAtPosition(const NalIndexEntry &entry, const RangePosition &position) const
+  {
+    switch (position.type)
+    {
+    case RangePosition::Type::POC:
+      return entry.POC && *entry.POC == static_cast<int>(position.value) &&
+             this->irapIndex >= position.afterIRAP.value_or(0);
+    case RangePosition::Type::IRAP:
+      return entry.isIRAP && this->irapIndex == static_cast<int64_t>(position.value);
+    case RangePosition::Type::Time:
+      if (!this->frameDuration)
+        throw std::runtime_error("Time positions need the VUI timing info in the SPS");
+      return static_cast<double>(this->pictureIndex) * *this->frameDuration >= position.value;
+    }
+    return false;
+  }
+
+  const ReadRange     range;
+  ReadNalUnitFunction readNalUnit;
+
+  AccessUnitTracker     accessUnitTracker;
+  size_t                accessUnitStart{};
+  size_t                nextEntry{};
+  int64_t               pictureIndex{-1};
+  int64_t               irapIndex{-1};
+  std::optional<size_t> lastIRAPAccessUnitStart{};
+  nal_unit_header       lastIRAPHeader{};
+  bool                  seenTrailingPictureSinceLastIRAP{};
+  std::vector<size_t>   raslEntriesOfLastIRAP;
+  std::optional<double> frameDuration{};
+  bool                  startIsCRAOrBLA{};
+  int64_t               startPictureIndex{-1};
+  bool                  leadingPicturesDone{};
+};
+
+// The most recent parameter sets before the start entry that are not sent again in the start
+// access unit. Going backwards stops at the first complete set of VPS, SPS and PPS.
+std::vector<ByteVector> findParameterSetsBeforeStart(const NalIndex            &index,
+                                                     const size_t               startEntry,
+                                                     const ReadNalUnitFunction &readNalUnit)
+{
+  using ParameterSetKey = std::pair<NalType, uint64_t>;
+
+  std::set<ParameterSetKey> sentInStartAccessUnit;
+  for (auto i = startEntry; i < index.entries.size() && !getHeader(index.entries.at(i)).isVCL();
+       ++i)
+  {
+    const auto &entry = index.entries.at(i);
+    if (getHeader(entry).isParameterSet())
+      sentInStartAccessUnit.insert(parseParameterSetID(readNalUnit(entry)));
+  }
+
+  std::map<ParameterSetKey, ByteVector> parameterSets;
+  std::set<NalType>                     foundTypes;
+  for (auto i = startEntry; i > 0; --i)
+  {
+    const auto &entry  = index.entries.at(i - 1);
+    const auto  header = getHeader(entry);
+    if (header.isVCL() && foundTypes.size() == 3)
+      break;
+    if (!header.isParameterSet())
+      continue;
+
+    auto       data = readNalUnit(entry);
+    const auto key  = parseParameterSetID(data);
+    foundTypes.insert(key.first);
+    if (sentInStartAccessUnit.count(key) == 0 && parameterSets.count(key) == 0)
+      parameterSets[key] = std::move(data);
+  }
+
+  // The map is sorted by type so the order is VPS, SPS, PPS
+  std::vector<ByteVector> sortedParameterSets;
+  for (auto &parameterSet : parameterSets)
+    sortedParameterSets.push_back(std::move(parameterSet.second));
+  return sortedParameterSets;
+}
+
+} // namespace
+
+RangePosition RangePosition::fromString(const std::string &text)
+{
+  RangePosition position;
+  auto          valueText         = text;
+  const auto    separatorPosition = text.find(':');
+  if (separatorPosition != std::string::npos)
+  {
+    const auto typeText = text.substr(0, separatorPosition);
+    valueText           = text.substr(separatorPosition + 1);
+    if (typeText == "poc")
+      position.type = Type::POC;
+    else if (typeText == "irap")
+      position.type = Type::IRAP;
+    else if (typeText == "time")
+      position.type = Type::Time;
+    else
+      throw std::invalid_argument("Invalid position type " + typeText);
+  }
+
+  const auto irapSeparatorPosition = valueText.find('@');
+  if (irapSeparatorPosition != std::string::npos)
+  {
+    if (position.type != Type::POC)
+      throw std::invalid_argument("Only a POC position can be given after an IRAP picture");
+    const auto irapPosition = fromString(valueText.substr(irapSeparatorPosition + 1));
+    if (irapPosition.type != Type::IRAP || irapPosition.afterIRAP)
+      throw std::invalid_argument("Invalid position " + text);
+    position.afterIRAP = static_cast<int64_t>(irapPosition.value);
+    valueText          = valueText.substr(0, irapSeparatorPosition);
+  }
+
+  size_t parsedCharacters{};
+  try
+  {
+    position.value = std::stod(valueText, &parsedCharacters);
+  }
+  catch (const std::exception &)
+  {
+    parsedCharacters = 0;
+  }
+  if (parsedCharacters == 0 || parsedCharacters != valueText.size() ||
+      (position.type == Type::IRAP && position.value < 0))
+    throw std::invalid_argument("Invalid position " + text);
+  return position;
+}
+
+NalReadPlan createReadPlan(const std::filesystem::path &inputFile,
+                           const NalIndex              *index,
+                           const ReadRange             &range)
+{
+  std::ifstream file(inputFile, std::ios_base::binary);
+  if (!file.is_open())
+    throw std::runtime_error("Error opening input file " + inputFile.string());
+
+  ReadRangeFinder finder(
+      range, [&file](const NalIndexEntry &entry) { return readNalUnit(file, entry); });
+
+  NalIndex scannedIndex;
+  if (index == nullptr)
+  {
+    const auto usesPOC =
+        (range.start && range.start->type == RangePosition::Type::POC) ||
+        (range.end && range.end->type == RangePosition::Type::POC);
+    const auto sliceParsingMode =
+        usesPOC ? SliceParsingMode::SliceSegmentHeader : SliceParsingMode::NalUnitHeaderOnly;
+    scannedIndex = createNalIndex(inputFile, sliceParsingMode, [&finder](const NalIndex &scanned) {
+      finder.update(scanned);
+      return finder.isDone();
+    });
+    index = &scannedIndex;
+  }
+  else
+    finder.update(*index);
+
+  if (!finder.startEntry)
+    throw std::runtime_error("Start position not found in " + inputFile.string());
+
+  auto plan = createReadPlanForEntries(inputFile, *index, *finder.startEntry, finder.endEntry);
+  for (const auto skippedEntry : finder.skippedEntries)
+    plan.skippedOffsets.push_back(index->entries.at(skippedEntry).offset);
+  return plan;
+}
+
+NalReadPlan createReadPlanForEntries(const std::filesystem::path &inputFile,
+                                     const NalIndex              &index,
+                                     const size_t                 startEntry,
+                                     const std::optional<size_t>  endEntry)
+{
+  std::ifstream file(inputFile, std::ios_base::binary);
+  if (!file.is_open())
+    throw std::runtime_error("Error opening input file " + inputFile.string());
+
+  NalReadPlan plan;
+  plan.prefixNalUnits = findParameterSetsBeforeStart(
+      index, startEntry, [&file](const NalIndexEntry &entry) { return readNalUnit(file, entry); });
+  plan.startOffset = index.entries.at(startEntry).offset;
+  if (endEntry)
+    plan.endOffset = index.entries.at(*endEntry).offset;
+  return plan;
+}
+
+std::vector<size_t> findIRAPAccessUnits(const NalIndex &index)
+{
+  std::vector<size_t> irapAccessUnits;
+  AccessUnitTracker   accessUnitTracker;
+  for (size_t i = 0; i < index.entries.size(); ++i)
+  {
+    const auto &entry           = index.entries.at(i);
+    const auto  accessUnitStart = accessUnitTracker.update(i, entry);
+    if (entry.isIRAP && entry.isFirstSliceSegmentInPic)
+      irapAccessUnits.push_back(accessUnitStart);
+  }
+  return irapAccessUnits;
+}
+
+} // namespace combiner::parser::hevc
@@ -0,0 +1,72 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+
+#include <File/NalIndex.h>
+#include <File/NalReadPlan.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace combiner::parser::hevc
+{
+
+struct RangePosition
+{
+  enum class Type
+  {
+    POC,
+    IRAP,
+    Time
+  };
+
+  Type type{};
+  // The POC, the index of the IRAP picture (counted from 0) or the time in seconds
+  double value{};
+  // POCs start again at every IDR/BLA picture. A POC position is the first picture with the POC in
+  // decoding order at or after the IRAP picture with this index (or from the start of the file).
+  std::optional<int64_t> afterIRAP{};
+
+  // Parse a position like "poc:16", "poc:16@irap:2", "irap:3" or "time:12.5". A plain number is a
+  // POC.
+  static RangePosition fromString(const std::string &text);
+};
+
+struct ReadRange
+{
+  std::optional<RangePosition> start;
+  // The picture at the end position is not included anymore
+  std::optional<RangePosition> end;
+};
+
+/* Find the part of the file that has to be read for the range. Reading starts at the access unit
+ * of the nearest IRAP at or before the start position and ends before the access unit of the end
+ * position. The most recent parameter sets from before the start are carried forward and the
+ * RASL pictures of a CRA/BLA at the start are skipped.
+ * Positions are counted in decoding order. The time of a picture is its index in decoding order
+ * times the frame duration from the VUI timing info.
+ * With an index, no data has to be scanned. Without an index, the file is scanned (only the
+ * nal_unit_headers unless a POC position is used) up to the end of the range.
+ */
+NalReadPlan createReadPlan(const std::filesystem::path &inputFile,
+                           const NalIndex              *index,
+                           const ReadRange             &range);
+
+// Read the entries [startEntry, endEntry) of the index. The most recent parameter sets from before
+// the start are carried forward. Leading pictures are not skipped.
+NalReadPlan createReadPlanForEntries(const std::filesystem::path &inputFile,
+                                     const NalIndex              &index,
+                                     const size_t                 startEntry,
+                                     const std::optional<size_t>  endEntry);
+
+// The index of the first entry of the access unit of each IRAP picture
+std::vector<size_t> findIRAPAccessUnits(const NalIndex &index);
+
+} // namespace combiner::parser::hevc
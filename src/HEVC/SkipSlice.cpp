@@ -0,0 +1,586 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include "SkipSlice.h"
+
+#include "CabacEncoder.h"
+#include "pic_parameter_set_rbsp.h"
+#include "seq_parameter_set_rbsp.h"
+#include "slice_segment_layer_rbsp.h"
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+#include <vector>
+
+namespace combiner::parser::hevc
+{
+
+namespace
+{
+
+// The initValues of the context variables that are used (T-REC-H.265-201410 - 9.3.2.2). The P
+// slices are written with a cabac_init_flag of 0 (initType 1) and the I slices have initType 0.
+constexpr std::array<unsigned, 3> INIT_SPLIT_CU_FLAG_P            = {107, 139, 126};
+constexpr std::array<unsigned, 3> INIT_SPLIT_CU_FLAG_I            = {139, 141, 157};
+constexpr unsigned                INIT_CU_TRANSQUANT_BYPASS_FLAG  = 154;
+constexpr std::array<unsigned, 3> INIT_CU_SKIP_FLAG_P             = {197, 185, 201};
+constexpr unsigned                INIT_MERGE_IDX_P                = 122;
+constexpr unsigned                INIT_PRED_MODE_FLAG_P           = 149;
+constexpr unsigned                INIT_PART_MODE_P                = 154;
+constexpr unsigned                INIT_MERGE_FLAG_P               = 110;
+constexpr unsigned                INIT_REF_IDX_P                  = 153;
+constexpr unsigned                INIT_ABS_MVD_GREATER0_FLAG_P    = 140;
+constexpr unsigned                INIT_MVP_FLAG_P                 = 168;
+constexpr unsigned                INIT_RQT_ROOT_CBF_P             = 79;
+constexpr unsigned                INIT_PART_MODE_I                = 184;
+constexpr unsigned                INIT_PREV_INTRA_LUMA_PRED_FLAG_I = 184;
+constexpr unsigned                INIT_INTRA_CHROMA_PRED_MODE_I    = 63;
+constexpr std::array<unsigned, 3> INIT_SPLIT_TRANSFORM_FLAG_I     = {153, 138, 138};
+constexpr std::array<unsigned, 2> INIT_CBF_LUMA_I                 = {111, 141};
+constexpr unsigned                INIT_CBF_CHROMA_DEPTH_0_I        = 94;
+
+// num_ref_idx_l0_active_minus1 is at most 14
+constexpr size_t MAX_NUM_REF_IDX_ACTIVE = 15;
+
+template <size_t N>
+std::array<CabacContext, N> initCabacContexts(const std::array<unsigned, N> &initValues,
+                                              const int                      SliceQpY)
+{
+  std::array<CabacContext, N> contexts;
+  for (size_t i = 0; i < N; ++i)
+    contexts.at(i) = initCabacContext(initValues.at(i), SliceQpY);
+  return contexts;
+}
+
+// The position of a block in the z-scan order within its coding tree block
+uint64_t zScanOrder(const unsigned x, const unsigned y)
+{
+  uint64_t order = 0;
+  for (unsigned bit = 0; bit < 16; ++bit)
+  {
+    order |= uint64_t((x >> bit) & 1) << (2 * bit);
+    order |= uint64_t((y >> bit) & 1) << (2 * bit + 1);
+  }
+  return order;
+}
+
+/* Writes the slice_segment_data() of a slice that covers the whole picture. Only the syntax
+ * elements that are needed for skipped (or intra predicted) coding units without a residual and
+ * for inter coding units with a zero motion vector difference are written. All other flags are
+ * off, so their syntax elements are not present.
+ */
+class SliceDataWriter
+{
+public:
+  SliceDataWriter(const seq_parameter_set_rbsp &sps,
+                  const pic_parameter_set_rbsp &pps,
+                  const slice_segment_header   &header,
+                  SubByteWriter                &writer);
+
+  void writeSliceData();
+
+private:
+  void writeCodingQuadtree(const int      x0,
+                           const int      y0,
+                           const unsigned log2CbSize,
+                           const unsigned cqtDepth);
+  // Returns the cu_skip_flag
+  bool writeCodingUnit(const int x0, const int y0, const unsigned log2CbSize);
+  void writeZeroMotionPredictionUnit(const int x0, const int y0, const int nCbS);
+  void writeTransformTree(const int      x0,
+                          const int      y0,
+                          const unsigned log2TrafoSize,
+                          const unsigned trafoDepth);
+
+  // T-REC-H.265-201410 - 6.4.1 for a slice that covers the whole picture without tiles
+  bool isAvailable(const int xCurr, const int yCurr, const int xNbY, const int yNbY) const;
+  bool isAnySpatialCandidateAvailable(const int  x0,
+                                      const int  y0,
+                                      const int  nCbS,
+                                      const bool forMerging) const;
+
+  size_t  getMinCbAddr(const int x, const int y) const;
+  uint8_t getCtDepth(const int x, const int y) const;
+
+  const seq_parameter_set_rbsp &sps;
+  const pic_parameter_set_rbsp &pps;
+  const bool                    interPrediction{};
+  const uint64_t                nrReferencePictures{};
+  CabacEncoder                  encoder;
+
+  std::array<CabacContext, 3> splitCuFlag{};
+  CabacContext                cuTransquantBypassFlag{};
+  std::array<CabacContext, 3> cuSkipFlag{};
+  CabacContext                mergeIdx{};
+  CabacContext                predModeFlag{};
+  CabacContext                mergeFlag{};
+  CabacContext                refIdx{};
+  CabacContext                absMvdGreater0Flag{};
+  CabacContext                mvpFlag{};
+  CabacContext                rqtRootCbf{};
+  CabacContext                partMode{};
+  CabacContext                prevIntraLumaPredFlag{};
+  CabacContext                intraChromaPredMode{};
+  std::array<CabacContext, 3> splitTransformFlag{};
+  std::array<CabacContext, 2> cbfLuma{};
+  CabacContext                cbfChroma{};
+
+  // The coding quadtree depth and the cu_skip_flag of the coding units per minimum coding block
+  std::vector<uint8_t> ctDepth;
+  std::vector<bool>    skipped;
+};
+
+SliceDataWriter::SliceDataWriter(const seq_parameter_set_rbsp &sps,
+                                 const pic_parameter_set_rbsp &pps,
+                                 const slice_segment_header   &header,
+                                 SubByteWriter                &writer)
+    : sps(sps), pps(pps), interPrediction(header.slice_type == SliceType::P),
+      nrReferencePictures(header.num_ref_idx_l0_active_minus1 + 1), encoder(writer),
+      ctDepth(sps.PicSizeInMinCbsY), skipped(sps.PicSizeInMinCbsY)
+{
+  const auto SliceQpY = static_cast<int>(26 + pps.init_qp_minus26 + header.slice_qp_delta);
+
+  this->cuTransquantBypassFlag = initCabacContext(INIT_CU_TRANSQUANT_BYPASS_FLAG, SliceQpY);
+  if (this->interPrediction)
+  {
+    this->splitCuFlag        = initCabacContexts(INIT_SPLIT_CU_FLAG_P, SliceQpY);
+    this->cuSkipFlag         = initCabacContexts(INIT_CU_SKIP_FLAG_P, SliceQpY);
+    this->mergeIdx           = initCabacContext(INIT_MERGE_IDX_P, SliceQpY);
+    this->predModeFlag       = initCabacContext(INIT_PRED_MODE_FLAG_P, SliceQpY);
+    this->partMode           = initCabacContext(INIT_PART_MODE_P, SliceQpY);
+    this->mergeFlag          = initCabacContext(INIT_MERGE_FLAG_P, SliceQpY);
+    this->refIdx             = initCabacContext(INIT_REF_IDX_P, SliceQpY);
+    this->absMvdGreater0Flag = initCabacContext(INIT_ABS_MVD_GREATER0_FLAG_P, SliceQpY);
+    this->mvpFlag            = initCabacContext(INIT_MVP_FLAG_P, SliceQpY);
+    this->rqtRootCbf         = initCabacContext(INIT_RQT_ROOT_CBF_P, SliceQpY);
+  }
+  else
+  {
+    this->splitCuFlag           = initCabacContexts(INIT_SPLIT_CU_FLAG_I, SliceQpY);
+    this->partMode              = initCabacContext(INIT_PART_MODE_I, SliceQpY);
+    this->prevIntraLumaPredFlag = initCabacContext(INIT_PREV_INTRA_LUMA_PRED_FLAG_I, SliceQpY);
+    this->intraChromaPredMode   = initCabacContext(INIT_INTRA_CHROMA_PRED_MODE_I, SliceQpY);
+    this->splitTransformFlag    = initCabacContexts(INIT_SPLIT_TRANSFORM_FLAG_I, SliceQpY);
+    this->cbfLuma               = initCabacContexts(INIT_CBF_LUMA_I, SliceQpY);
+    this->cbfChroma             = initCabacContext(INIT_CBF_CHROMA_DEPTH_0_I, SliceQpY);
+  }
+}
+
+void SliceDataWriter::writeSliceData()
+{
+  for (uint64_t CtbAddrInRs = 0; CtbAddrInRs < this->sps.PicSizeInCtbsY; ++CtbAddrInRs)
+  {
+    const auto xCtb = static_cast<int>((CtbAddrInRs % this->sps.PicWidthInCtbsY)
+                                       << this->sps.CtbLog2SizeY);
+    const auto yCtb = static_cast<int>((CtbAddrInRs / this->sps.PicWidthInCtbsY)
+                                       << this->sps.CtbLog2SizeY);
+    this->writeCodingQuadtree(xCtb, yCtb, static_cast<unsigned>(this->sps.CtbLog2SizeY), 0);
+
+    const auto end_of_slice_segment_flag = (CtbAddrInRs + 1 == this->sps.PicSizeInCtbsY);
+    this->encoder.encodeTerminate(end_of_slice_segment_flag);
+  }
+}
+
+void SliceDataWriter::writeCodingQuadtree(const int      x0,
+                                          const int      y0,
+                                          const unsigned log2CbSize,
+                                          const unsigned cqtDepth)
+{
+  const auto width         = static_cast<int>(this->sps.pic_width_in_luma_samples);
+  const auto height        = static_cast<int>(this->sps.pic_height_in_luma_samples);
+  const auto size          = 1 << log2CbSize;
+  const auto canBeSplit    = (log2CbSize > this->sps.MinCbLog2SizeY);
+  const auto insidePicture = (x0 + size <= width && y0 + size <= height);
+
+  // Blocks that cross the picture boundary are split implicitly. All others are not split.
+  if (insidePicture && canBeSplit)
+  {
+    const auto condL =
+        this->isAvailable(x0, y0, x0 - 1, y0) && this->getCtDepth(x0 - 1, y0) > cqtDepth;
+    const auto condA =
+        this->isAvailable(x0, y0, x0, y0 - 1) && this->getCtDepth(x0, y0 - 1) > cqtDepth;
+    this->encoder.encodeDecision(this->splitCuFlag.at(condL + condA), false);
+  }
+
+  if (!insidePicture && canBeSplit)
+  {
+    const auto half = size / 2;
+    for (const auto &[x, y] : {std::pair(x0, y0),
+                               std::pair(x0 + half, y0),
+                               std::pair(x0, y0 + half),
+                               std::pair(x0 + half, y0 + half)})
+      if (x < width && y < height)
+        this->writeCodingQuadtree(x, y, log2CbSize - 1, cqtDepth + 1);
+    return;
+  }
+
+  const auto cu_skip_flag = this->writeCodingUnit(x0, y0, log2CbSize);
+
+  const auto MinCbSizeY = static_cast<int>(this->sps.MinCbSizeY);
+  for (int y = y0; y < y0 + size; y += MinCbSizeY)
+    for (int x = x0; x < x0 + size; x += MinCbSizeY)
+    {
+      const auto minCbAddr        = this->getMinCbAddr(x, y);
+      this->ctDepth.at(minCbAddr) = static_cast<uint8_t>(cqtDepth);
+      this->skipped.at(minCbAddr) = cu_skip_flag;
+    }
+}
+
+bool SliceDataWriter::writeCodingUnit(const int x0, const int y0, const unsigned log2CbSize)
+{
+  if (this->pps.transquant_bypass_enabled_flag)
+    this->encoder.encodeDecision(this->cuTransquantBypassFlag, false);
+
+  if (this->interPrediction)
+  {
+    // A spatial candidate is a coded neighbour with a zero motion vector to the first reference
+    // picture. Without one, the first candidate may be the temporal one. The second is then the
+    // zero candidate to the first reference picture if there is only one. With more reference
+    // pictures, it may be the zero candidate to the second one, so the coding unit is not skipped
+    // and its zero motion vector is coded. MaxNumMergeCand is 5.
+    const auto nCbS             = 1 << log2CbSize;
+    const auto spatialCandidate = this->isAnySpatialCandidateAvailable(x0, y0, nCbS, true);
+    const auto cu_skip_flag     = (spatialCandidate || this->nrReferencePictures == 1);
+
+    const auto condL = this->isAvailable(x0, y0, x0 - 1, y0) &&
+                       this->skipped.at(this->getMinCbAddr(x0 - 1, y0));
+    const auto condA = this->isAvailable(x0, y0, x0, y0 - 1) &&
+                       this->skipped.at(this->getMinCbAddr(x0, y0 - 1));
+    this->encoder.encodeDecision(this->cuSkipFlag.at(condL + condA), cu_skip_flag);
+    if (!cu_skip_flag)
+    {
+      this->writeZeroMotionPredictionUnit(x0, y0, nCbS);
+      return false;
+    }
+
+    const auto merge_idx = spatialCandidate ? 0 : 1;
+    this->encoder.encodeDecision(this->mergeIdx, merge_idx > 0);
+    if (merge_idx > 0)
+      this->encoder.encodeBypass(false);
+    return true;
+  }
+
+  // PART_2Nx2N
+  if (log2CbSize == this->sps.MinCbLog2SizeY)
+    this->encoder.encodeDecision(this->partMode, true);
+
+  const auto Log2MinIpcmCbSizeY = this->sps.log2_min_pcm_luma_coding_block_size_minus3 + 3;
+  const auto Log2MaxIpcmCbSizeY =
+      Log2MinIpcmCbSizeY + this->sps.log2_diff_max_min_pcm_luma_coding_block_size;
+  if (this->sps.pcm_enabled_flag && log2CbSize >= Log2MinIpcmCbSizeY &&
+      log2CbSize <= Log2MaxIpcmCbSizeY)
+    this->encoder.encodeTerminate(false);
+
+  // The first most probable mode and the same mode for chroma. All neighbours are either
+  // unavailable or flat, so all of these modes predict the same flat block.
+  this->encoder.encodeDecision(this->prevIntraLumaPredFlag, true);
+  this->encoder.encodeBypass(false);
+  if (this->sps.ChromaArrayType != 0)
+    this->encoder.encodeDecision(this->intraChromaPredMode, false);
+
+  this->writeTransformTree(x0, y0, log2CbSize, 0);
+  return false;
+}
+
+// An inter coding unit (PART_2Nx2N) with a zero motion vector to the first reference picture and
+// without a residual
+void SliceDataWriter::writeZeroMotionPredictionUnit(const int x0, const int y0, const int nCbS)
+{
+  // pred_mode_flag (MODE_INTER), part_mode (PART_2Nx2N) and merge_flag
+  this->encoder.encodeDecision(this->predModeFlag, false);
+  this->encoder.encodeDecision(this->partMode, true);
+  this->encoder.encodeDecision(this->mergeFlag, false);
+
+  if (this->nrReferencePictures > 1)
+    this->encoder.encodeDecision(this->refIdx, false);
+
+  // The motion vector difference is zero (abs_mvd_greater0_flag for both components)
+  this->encoder.encodeDecision(this->absMvdGreater0Flag, false);
+  this->encoder.encodeDecision(this->absMvdGreater0Flag, false);
+
+  // A spatial predictor is a neighbour with a zero motion vector. Without one, the first predictor
+  // may be the temporal one and the second one is zero (T-REC-H.265-201410 - 8.5.3.2.6).
+  const auto mvp_l0_flag = !this->isAnySpatialCandidateAvailable(x0, y0, nCbS, false);
+  this->encoder.encodeDecision(this->mvpFlag, mvp_l0_flag);
+
+  this->encoder.encodeDecision(this->rqtRootCbf, false);
+}
+
+void SliceDataWriter::writeTransformTree(const int      x0,
+                                         const int      y0,
+                                         const unsigned log2TrafoSize,
+                                         const unsigned trafoDepth)
+{
+  const auto MinTbLog2SizeY = this->sps.log2_min_luma_transform_block_size_minus2 + 2;
+  const auto MaxTbLog2SizeY =
+      MinTbLog2SizeY + this->sps.log2_diff_max_min_luma_transform_block_size;
+  const auto MaxTrafoDepth = this->sps.max_transform_hierarchy_depth_intra;
+
+  const auto split_transform_flag = (log2TrafoSize > MaxTbLog2SizeY);
+  if (log2TrafoSize <= MaxTbLog2SizeY && log2TrafoSize > MinTbLog2SizeY &&
+      trafoDepth < MaxTrafoDepth)
+    this->encoder.encodeDecision(this->splitTransformFlag.at(5 - log2TrafoSize), false);
+
+  // The chroma cbf flags of the deeper levels are not present because they are 0 here
+  const auto ChromaArrayType = this->sps.ChromaArrayType;
+  if (trafoDepth == 0 &&
+      ((log2TrafoSize > 2 && ChromaArrayType != 0) || ChromaArrayType == 3))
+  {
+    const auto nrCbfPerComponent =
+        (ChromaArrayType == 2 && (!split_transform_flag || log2TrafoSize == 3)) ? 2 : 1;
+    for (int i = 0; i < 2 * nrCbfPerComponent; ++i)
+      this->encoder.encodeDecision(this->cbfChroma, false);
+  }
+
+  if (split_transform_flag)
+  {
+    const auto half = 1 << (log2TrafoSize - 1);
+    this->writeTransformTree(x0, y0, log2TrafoSize - 1, trafoDepth + 1);
+    this->writeTransformTree(x0 + half, y0, log2TrafoSize - 1, trafoDepth + 1);
+    this->writeTransformTree(x0, y0 + half, log2TrafoSize - 1, trafoDepth + 1);
+    this->writeTransformTree(x0 + half, y0 + half, log2TrafoSize - 1, trafoDepth + 1);
+    return;
+  }
+
+  this->encoder.encodeDecision(this->cbfLuma.at(trafoDepth == 0 ? 1 : 0), false);
+}
+
+size_t SliceDataWriter::getMinCbAddr(const int x, const int y) const
+{
+  const auto MinCbLog2SizeY = this->sps.MinCbLog2SizeY;
+  return (y >> MinCbLog2SizeY) * this->sps.PicWidthInMinCbsY + (x >> MinCbLog2SizeY);
+}
+
+uint8_t SliceDataWriter::getCtDepth(const int x, const int y) const
+{
+  return this->ctDepth.at(this->getMinCbAddr(x, y));
+}
+
+bool SliceDataWriter::isAvailable(const int xCurr,
+                                  const int yCurr,
+                                  const int xNbY,
+                                  const int yNbY) const
+{
+  const auto width  = static_cast<int>(this->sps.pic_width_in_luma_samples);
+  const auto height = static_cast<int>(this->sps.pic_height_in_luma_samples);
+  if (xNbY < 0 || yNbY < 0 || xNbY >= width || yNbY >= height)
+    return false;
+
+  const auto CtbLog2SizeY = this->sps.CtbLog2SizeY;
+  const auto ctbAddrCurr =
+      (yCurr >> CtbLog2SizeY) * this->sps.PicWidthInCtbsY + (xCurr >> CtbLog2SizeY);
+  const auto ctbAddrNb =
+      (yNbY >> CtbLog2SizeY) * this->sps.PicWidthInCtbsY + (xNbY >> CtbLog2SizeY);
+  if (ctbAddrNb != ctbAddrCurr)
+    return ctbAddrNb < ctbAddrCurr;
+
+  const auto MinTbLog2SizeY = this->sps.log2_min_luma_transform_block_size_minus2 + 2;
+  const auto ctbMask        = (1 << CtbLog2SizeY) - 1;
+  return zScanOrder((xNbY & ctbMask) >> MinTbLog2SizeY, (yNbY & ctbMask) >> MinTbLog2SizeY) <
+         zScanOrder((xCurr & ctbMask) >> MinTbLog2SizeY, (yCurr & ctbMask) >> MinTbLog2SizeY);
+}
+
+// T-REC-H.265-201410 - 8.5.3.2.3 (merging) and 8.5.3.2.7 for a 2Nx2N prediction unit. All coded
+// neighbours are inter coded.
+bool SliceDataWriter::isAnySpatialCandidateAvailable(const int  x0,
+                                                     const int  y0,
+                                                     const int  nCbS,
+                                                     const bool forMerging) const
+{
+  const auto Log2ParMrgLevel = this->pps.log2_parallel_merge_level_minus2 + 2;
+  const auto candidates      = {std::pair(x0 - 1, y0 + nCbS - 1),
+                                std::pair(x0 + nCbS - 1, y0 - 1),
+                                std::pair(x0 + nCbS, y0 - 1),
+                                std::pair(x0 - 1, y0 + nCbS),
+                                std::pair(x0 - 1, y0 - 1)};
+  for (const auto &[xNb, yNb] : candidates)
+  {
+    const auto inSameMergeEstimationRegion =
+        ((x0 >> Log2ParMrgLevel) == (xNb >> Log2ParMrgLevel) &&
+         (y0 >> Log2ParMrgLevel) == (yNb >> Log2ParMrgLevel));
+    if (!(forMerging && inSameMergeEstimationRegion) && this->isAvailable(x0, y0, xNb, yNb))
+      return true;
+  }
+  return false;
+}
+
+/* The collocated picture of a P or B slice as an index into the pictures that the picture can
+ * reference: the short term pictures before it, the ones after it and the long term pictures
+ * (RefPicListTemp0 without its repetitions, T-REC-H.265-201410 - 8.3.4).
+ */
+size_t getCollocatedPictureIndex(const slice_segment_header &header)
+{
+  const auto &rps = header.stRefPicSet;
+  const auto  nrBefore =
+      static_cast<size_t>(std::count(rps.usedByCurrPicS0.begin(), rps.usedByCurrPicS0.end(), true));
+  const auto nrAfter =
+      static_cast<size_t>(std::count(rps.usedByCurrPicS1.begin(), rps.usedByCurrPicS1.end(), true));
+  const auto NumPicTotalCurr = static_cast<size_t>(rps.NumPicTotalCurr(&header));
+  if (NumPicTotalCurr == 0)
+    throw std::runtime_error("The reference slice has no pictures to reference");
+
+  const auto &modification = header.refPicListsModification;
+  const auto  fromL0 = (header.slice_type == SliceType::P || header.collocated_from_l0_flag);
+  auto        index  = header.collocated_ref_idx;
+  if (fromL0 && modification.ref_pic_list_modification_flag_l0)
+    index = modification.list_entry_l0.at(index);
+  if (!fromL0 && modification.ref_pic_list_modification_flag_l1)
+    index = modification.list_entry_l1.at(index);
+
+  // The temporary lists repeat the pictures. RefPicListTemp1 starts with the ones after the
+  // current picture.
+  index %= NumPicTotalCurr;
+  if (fromL0 || index >= nrAfter + nrBefore)
+    return index;
+  if (index < nrAfter)
+    return nrBefore + index;
+  return index - nrAfter;
+}
+
+} // namespace
+
+NalUnitHEVC generateSkipSlice(const NalUnitHEVC         &referenceSlice,
+                              const ActiveParameterSets &activeParameterSets)
+{
+  const auto reference = dynamic_cast<slice_segment_layer_rbsp *>(referenceSlice.rbsp.get());
+  if (reference == nullptr)
+    throw std::logic_error("The slice header of the reference slice was not parsed");
+
+  auto  slice  = std::make_unique<slice_segment_layer_rbsp>();
+  auto &header = slice->sliceSegmentHeader;
+  header       = reference->sliceSegmentHeader;
+
+  const auto ppsIt = activeParameterSets.ppsMap.find(header.slice_pic_parameter_set_id);
+  if (ppsIt == activeParameterSets.ppsMap.end())
+    throw std::runtime_error("No PPS with ID " + std::to_string(header.slice_pic_parameter_set_id) +
+                             " to generate a skip slice for");
+  const auto &pps   = ppsIt->second;
+  const auto  spsIt = activeParameterSets.spsMap.find(pps.pps_seq_parameter_set_id);
+  if (spsIt == activeParameterSets.spsMap.end())
+    throw std::runtime_error("No SPS with ID " + std::to_string(pps.pps_seq_parameter_set_id) +
+                             " to generate a skip slice for");
+  const auto &sps = spsIt->second;
+
+  if (pps.tiles_enabled_flag || pps.entropy_coding_sync_enabled_flag)
+    throw std::runtime_error(
+        "Skip slices can not be generated with tiles or wavefront parallel processing");
+
+  header.first_slice_segment_in_pic_flag = true;
+  header.dependent_slice_segment_flag    = false;
+  header.slice_segment_address           = 0;
+  header.slice_sao_luma_flag             = false;
+  header.slice_sao_chroma_flag           = false;
+  header.slice_qp_delta                  = 0;
+
+  // IRAP pictures can only contain I slices. A P or B slice has at least one reference picture.
+  header.slice_type = (referenceSlice.header.isIRAP() ||
+                       reference->sliceSegmentHeader.slice_type == SliceType::I)
+                          ? SliceType::I
+                          : SliceType::P;
+  if (header.slice_type == SliceType::P)
+  {
+    // The collocated picture must be the same in all slices of a picture. Without modifying the
+    // list, it is at the same index in the reference picture list of the P slice.
+    size_t collocatedIndex = 0;
+    if (header.slice_temporal_mvp_enabled_flag)
+      collocatedIndex = getCollocatedPictureIndex(reference->sliceSegmentHeader);
+    if (collocatedIndex >= MAX_NUM_REF_IDX_ACTIVE)
+      throw std::runtime_error("The collocated picture can not be referenced by a skip slice");
+
+    header.num_ref_idx_active_override_flag                      = true;
+    header.num_ref_idx_l0_active_minus1                          = collocatedIndex;
+    header.refPicListsModification.ref_pic_list_modification_flag_l0 = false;
+    header.cabac_init_flag                                       = false;
+    header.collocated_from_l0_flag                               = true;
+    header.collocated_ref_idx                                    = collocatedIndex;
+    header.predWeightTable                                       = {};
+    header.five_minus_max_num_merge_cand                         = 0;
+    header.predWeightTable.luma_weight_l0_flag.assign(collocatedIndex + 1, false);
+    header.predWeightTable.chroma_weight_l0_flag.assign(collocatedIndex + 1, false);
+  }
+
+  // The repeated or flat content does not need any filtering
+  if (pps.deblocking_filter_override_enabled_flag)
+  {
+    header.deblocking_filter_override_flag       = true;
+    header.slice_deblocking_filter_disabled_flag = true;
+  }
+  header.slice_loop_filter_across_slices_enabled_flag = false;
+
+  header.num_entry_point_offsets = 0;
+  header.entry_point_offset_minus1.clear();
+  header.slice_segment_header_extension_length = 0;
+  header.slice_segment_header_extension_data_byte.clear();
+
+  NalUnitHEVC nal;
+  nal.header = referenceSlice.header;
+
+  SubByteWriter headerWriter;
+  nal.header.write(headerWriter);
+  header.write(headerWriter, nal.header, activeParameterSets);
+  nal.rawData            = headerWriter.finishWritingAndGetData();
+  header.nrBytesInHeader = nal.rawData.size();
+
+  SubByteWriter   dataWriter;
+  SliceDataWriter sliceDataWriter(sps, pps, header, dataWriter);
+  sliceDataWriter.writeSliceData();
+  const auto data = dataWriter.finishWritingAndGetData();
+  nal.rawData.insert(nal.rawData.end(), data.begin(), data.end());
+
+  nal.rbsp = std::move(slice);
+  return nal;
+}
+
+NalUnitHEVC generateSlateSlice(const NalUnitHEVC &slateSlice, const NalUnitHEVC &referenceSlice)
+{
+  const auto slate     = dynamic_cast<slice_segment_layer_rbsp *>(slateSlice.rbsp.get());
+  const auto reference = dynamic_cast<slice_segment_layer_rbsp *>(referenceSlice.rbsp.get());
+  if (slate == nullptr || reference == nullptr)
+    throw std::logic_error("The slice headers of the slate or the reference were not parsed");
+
+  const auto &slateHeader = slate->sliceSegmentHeader;
+  if (slateHeader.slice_type != SliceType::I || !slateHeader.first_slice_segment_in_pic_flag ||
+      slateHeader.num_entry_point_offsets > 0)
+    throw std::runtime_error("The slate must be a single I slice without entry points");
+
+  auto  slice  = std::make_unique<slice_segment_layer_rbsp>();
+  auto &header = slice->sliceSegmentHeader;
+  header       = reference->sliceSegmentHeader;
+
+  header.first_slice_segment_in_pic_flag = true;
+  header.dependent_slice_segment_flag    = false;
+  header.slice_segment_address           = 0;
+  header.slice_type                      = SliceType::I;
+
+  // The values that the decoding of the slice data depends on
+  header.slice_sao_luma_flag              = slateHeader.slice_sao_luma_flag;
+  header.slice_sao_chroma_flag            = slateHeader.slice_sao_chroma_flag;
+  header.slice_qp_delta                   = slateHeader.slice_qp_delta;
+  header.slice_cb_qp_offset               = slateHeader.slice_cb_qp_offset;
+  header.slice_cr_qp_offset               = slateHeader.slice_cr_qp_offset;
+  header.cu_chroma_qp_offset_enabled_flag = slateHeader.cu_chroma_qp_offset_enabled_flag;
+
+  header.deblocking_filter_override_flag       = slateHeader.deblocking_filter_override_flag;
+  header.slice_deblocking_filter_disabled_flag = slateHeader.slice_deblocking_filter_disabled_flag;
+  header.slice_beta_offset_div2                = slateHeader.slice_beta_offset_div2;
+  header.slice_tc_offset_div2                  = slateHeader.slice_tc_offset_div2;
+  header.slice_loop_filter_across_slices_enabled_flag = false;
+
+  header.num_entry_point_offsets = 0;
+  header.entry_point_offset_minus1.clear();
+  header.slice_segment_header_extension_length = 0;
+  header.slice_segment_header_extension_data_byte.clear();
+  header.nrBytesInHeader = slateHeader.nrBytesInHeader;
+
+  NalUnitHEVC nal;
+  nal.header  = referenceSlice.header;
+  nal.rawData = slateSlice.rawData;
+  nal.rbsp    = std::move(slice);
+  return nal;
+}
+
+} // namespace combiner::parser::hevc
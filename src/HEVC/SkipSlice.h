@@ -0,0 +1,43 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+
+#include "NalUnitHEVC.h"
+#include "commonMaps.h"
+
+namespace combiner::parser::hevc
+{
+
+/* Generate a slice that covers a whole picture without coding any new content. In a picture with
+ * reference pictures, it is a P slice in which every coding unit has a zero motion vector to the
+ * first reference picture, so the previous content is repeated. With temporal motion vector
+ * prediction, the P slice references the pictures up to the collocated picture of the reference
+ * slice and uses it as its collocated picture. The coding units are skipped unless a merge
+ * candidate could be the one to another reference picture. Then the motion vector is coded.
+ * IRAP pictures (and pictures without reference pictures) get an I slice that predicts every
+ * coding unit from the unavailable (mid gray) neighbours without a residual, which gives a gray
+ * picture.
+ * The slice header is derived from the parsed header of the reference slice, which is a slice of
+ * the same picture from another input. It keeps the values that must be identical in all slices
+ * of a picture (POC, reference picture set, ...). The picture size and coding tools are taken
+ * from the given parameter sets. These must not use tiles or wavefront parallel processing.
+ * The returned NAL unit has the parsed slice header (with nrBytesInHeader) and its raw data.
+ */
+NalUnitHEVC generateSkipSlice(const NalUnitHEVC         &referenceSlice,
+                              const ActiveParameterSets &activeParameterSets);
+
+/* Use the intra coded slice of a pre-encoded picture (a slate) in a picture that can not reference
+ * other pictures (an IRAP picture or a picture with I slices). The slice data is not changed. The
+ * slice header keeps the values that the slice data depends on (QP, SAO, deblocking, ...) and
+ * gets the values that must be identical in all slices of the picture from the reference slice.
+ * The slate slice must cover the whole picture without tiles, WPP or entry points.
+ * The returned NAL unit has the parsed slice header. Its raw data is the one of the slate slice
+ * and has to be written with the new slice header (see nrBytesInHeader).
+ */
+NalUnitHEVC generateSlateSlice(const NalUnitHEVC &slateSlice, const NalUnitHEVC &referenceSlice);
+
+} // namespace combiner::parser::hevc
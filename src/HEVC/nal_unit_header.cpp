@@ -101,6 +101,27 @@ parser::CodingEnum<NalType> nalTypeCoding(
 
 }
 
+nal_unit_header::nal_unit_header(const NalType nal_unit_type)
+    : nal_unit_type(nal_unit_type), nalUnitTypeID(nalTypeCoding.getCode(nal_unit_type))
+{
+}
+
+nal_unit_header nal_unit_header::fromNalUnitTypeID(const unsigned nalUnitTypeID)
+{
+  nal_unit_header header;
+  header.nalUnitTypeID = nalUnitTypeID;
+  header.nal_unit_type = nalTypeCoding.getValue(nalUnitTypeID);
+  return header;
+}
+
+nal_unit_header nal_unit_header::fromNalData(const ByteVector &nalData, const size_t offset)
+{
+  SubByteReader   reader(nalData, offset);
+  nal_unit_header header;
+  header.parse(reader);
+  return header;
+}
+
 void nal_unit_header::parse(SubByteReader &reader)
 {
   const auto forbidden_zero_bit = reader.readFlag();
@@ -136,6 +157,19 @@ bool nal_unit_header::isIRAP() const
           this->nal_unit_type == hevc::NalType::RSV_IRAP_VCL23);
 }
 
+bool nal_unit_header::isIDR() const
+{
+  return (this->nal_unit_type == hevc::NalType::IDR_W_RADL ||
+          this->nal_unit_type == hevc::NalType::IDR_N_LP);
+}
+
+bool nal_unit_header::isBLA() const
+{
+  return (this->nal_unit_type == hevc::NalType::BLA_W_LP ||
+          this->nal_unit_type == hevc::NalType::BLA_W_RADL ||
+          this->nal_unit_type == hevc::NalType::BLA_N_LP);
+}
+
 bool nal_unit_header::isSLNR() const
 {
   return (this->nal_unit_type == hevc::NalType::TRAIL_N ||
@@ -179,4 +213,44 @@ bool nal_unit_header::isSlice() const
       this->nal_unit_type == hevc::NalType::RASL_N || this->nal_unit_type == hevc::NalType::RASL_R);
 }
 
+bool nal_unit_header::isVCL() const
+{
+  // All types before VPS_NUT are (reserved) VCL NAL unit types
+  return this->nal_unit_type < hevc::NalType::VPS_NUT;
+}
+
+bool nal_unit_header::isParameterSet() const
+{
+  return (this->nal_unit_type == hevc::NalType::VPS_NUT ||
+          this->nal_unit_type == hevc::NalType::SPS_NUT ||
+          this->nal_unit_type == hevc::NalType::PPS_NUT);
+}
+
+bool nal_unit_header::startsAccessUnitAfterVCL() const
+{
+  switch (this->nal_unit_type)
+  {
+  case hevc::NalType::VPS_NUT:
+  case hevc::NalType::SPS_NUT:
+  case hevc::NalType::PPS_NUT:
+  case hevc::NalType::AUD_NUT:
+  case hevc::NalType::PREFIX_SEI_NUT:
+  case hevc::NalType::RSV_NVCL41:
+  case hevc::NalType::RSV_NVCL42:
+  case hevc::NalType::RSV_NVCL43:
+  case hevc::NalType::RSV_NVCL44:
+  case hevc::NalType::UNSPEC48:
+  case hevc::NalType::UNSPEC49:
+  case hevc::NalType::UNSPEC50:
+  case hevc::NalType::UNSPEC51:
+  case hevc::NalType::UNSPEC52:
+  case hevc::NalType::UNSPEC53:
+  case hevc::NalType::UNSPEC54:
+  case hevc::NalType::UNSPEC55:
+    return true;
+  default:
+    return false;
+  }
+}
+
 } // namespace combiner::parser::hevc
@@ -10,6 +10,7 @@
 
 #include <common/SubByteReader.h>
 #include <common/SubByteWriter.h>
+#include <common/Typedef.h>
 
 namespace combiner::parser::hevc
 {
@@ -153,22 +154,33 @@ class nal_unit_header
 {
 public:
   nal_unit_header() = default;
-  nal_unit_header(const NalType nal_unit_type) : nal_unit_type(nal_unit_type) {}
+  nal_unit_header(const NalType nal_unit_type);
   ~nal_unit_header() = default;
   void parse(parser::SubByteReader &reader);
   void write(parser::SubByteWriter &writer) const;
 
+  // The header of a NAL unit with the numeric nal_unit_type value (Table 7-1)
+  static nal_unit_header fromNalUnitTypeID(const unsigned nalUnitTypeID);
+  // Parse the header at the offset of the raw NAL unit data (without start code)
+  static nal_unit_header fromNalData(const ByteVector &nalData, const size_t offset = 0);
+
   bool isIRAP() const;
+  bool isIDR() const;
+  bool isBLA() const;
   bool isSLNR() const;
   bool isRADL() const;
   bool isRASL() const;
   bool isSlice() const;
+  bool isVCL() const;
+  bool isParameterSet() const;
+  // NAL units of these types start a new access unit if they follow a VCL NAL unit (7.4.2.4.4)
+  bool startsAccessUnitAfterVCL() const;
 
-  unsigned nuh_layer_id;
-  unsigned nuh_temporal_id_plus1;
+  unsigned nuh_layer_id{};
+  unsigned nuh_temporal_id_plus1{1};
 
-  NalType  nal_unit_type;
-  unsigned nalUnitTypeID;
+  NalType  nal_unit_type{};
+  unsigned nalUnitTypeID{};
 };
 
 } // namespace combiner::parser::hevc
@@ -163,14 +163,14 @@ void seq_parameter_set_rbsp::write(SubByteWriter &writer) const
   writer.writeUEV(this->log2_max_pic_order_cnt_lsb_minus4);
 
   writer.writeFlag(this->sps_sub_layer_ordering_info_present_flag);
-  for (uint64_t i =
-           (this->sps_sub_layer_ordering_info_present_flag ? 0 : this->sps_max_sub_layers_minus1);
-       i <= this->sps_max_sub_layers_minus1;
-       i++)
+  // Like in parsing, the values of the first coded sub-layer are at index 0
+  const auto firstSubLayer =
+      (this->sps_sub_layer_ordering_info_present_flag ? 0 : this->sps_max_sub_layers_minus1);
+  for (uint64_t i = firstSubLayer; i <= this->sps_max_sub_layers_minus1; i++)
   {
-    writer.writeUEV(this->sps_max_dec_pic_buffering_minus1.at(i));
-    writer.writeUEV(this->sps_max_num_reorder_pics.at(i));
-    writer.writeUEV(this->sps_max_latency_increase_plus1.at(i));
+    writer.writeUEV(this->sps_max_dec_pic_buffering_minus1.at(i - firstSubLayer));
+    writer.writeUEV(this->sps_max_num_reorder_pics.at(i - firstSubLayer));
+    writer.writeUEV(this->sps_max_latency_increase_plus1.at(i - firstSubLayer));
   }
 
   writer.writeUEV(this->log2_min_luma_coding_block_size_minus3);
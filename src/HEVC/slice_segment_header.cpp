@@ -28,6 +28,30 @@ static parser::CodingEnum<SliceType> sliceTypeCoding({{0, SliceType::B, "B", "B-
 
 }
 
+int calculatePicOrderCntMsb(const uint64_t slice_pic_order_cnt_lsb,
+                            const unsigned MaxPicOrderCntLsb,
+                            const bool     isIRAPWithNoRaslOutputFlag,
+                            const uint64_t prevTid0PicSlicePicOrderCntLsb,
+                            const int      prevTid0PicPicOrderCntMsb)
+{
+  // If the current picture is an IRAP picture with NoRaslOutputFlag equal to 1, PicOrderCntMsb is
+  // set equal to 0.
+  if (isIRAPWithNoRaslOutputFlag)
+    return 0;
+
+  // Otherwise, the variables prevPicOrderCntLsb and prevPicOrderCntMsb are derived from the
+  // previous TemporalId 0 picture and PicOrderCntMsb is derived as follows: (8-1)
+  const auto prevPicOrderCntLsb = static_cast<int>(prevTid0PicSlicePicOrderCntLsb);
+  const auto prevPicOrderCntMsb = prevTid0PicPicOrderCntMsb;
+  if (((int)slice_pic_order_cnt_lsb < prevPicOrderCntLsb) &&
+      (((int)prevPicOrderCntLsb - (int)slice_pic_order_cnt_lsb) >= ((int)MaxPicOrderCntLsb / 2)))
+    return prevPicOrderCntMsb + MaxPicOrderCntLsb;
+  if (((int)slice_pic_order_cnt_lsb > prevPicOrderCntLsb) &&
+      (((int)slice_pic_order_cnt_lsb - prevPicOrderCntLsb) > ((int)MaxPicOrderCntLsb / 2)))
+    return prevPicOrderCntMsb - MaxPicOrderCntLsb;
+  return prevPicOrderCntMsb;
+}
+
 void slice_segment_header::parse(SubByteReader &               reader,
                                  const bool                    firstAUInDecodingOrder,
                                  const uint64_t                prevTid0PicSlicePicOrderCntLsb,
@@ -153,9 +177,7 @@ void slice_segment_header::parse(SubByteReader &               reader,
           this->num_ref_idx_l1_active_minus1 = reader.readUEV();
       }
 
-      auto CurrRpsIdx = (this->short_term_ref_pic_set_sps_flag) ? this->short_term_ref_pic_set_idx
-                                                                : sps.num_short_term_ref_pic_sets;
-      auto NumPicTotalCurr = this->stRefPicSet.NumPicTotalCurr(CurrRpsIdx, this);
+      auto NumPicTotalCurr = this->stRefPicSet.NumPicTotalCurr(this);
       if (pps.lists_modification_present_flag && NumPicTotalCurr > 1)
         this->refPicListsModification.parse(reader, NumPicTotalCurr, this);
 
@@ -254,35 +276,11 @@ void slice_segment_header::parse(SubByteReader &               reader,
 
   // T-REC-H.265-201410 - 8.3.1 Decoding process for picture order count
 
-  int prevPicOrderCntLsb = 0;
-  int prevPicOrderCntMsb = 0;
-  // When the current picture is not an IRAP picture with NoRaslOutputFlag equal to 1, ...
-  if (!(nalUnitHeader.isIRAP() && this->NoRaslOutputFlag))
-  {
-    // the variables prevPicOrderCntLsb and prevPicOrderCntMsb are derived as follows:
-    prevPicOrderCntLsb = static_cast<int>(prevTid0PicSlicePicOrderCntLsb);
-    prevPicOrderCntMsb = prevTid0PicPicOrderCntMsb;
-  }
-
-  // The variable PicOrderCntMsb of the current picture is derived as follows:
-  if (nalUnitHeader.isIRAP() && this->NoRaslOutputFlag)
-  {
-    // If the current picture is an IRAP picture with NoRaslOutputFlag equal to 1, PicOrderCntMsb is
-    // set equal to 0.
-    PicOrderCntMsb = 0;
-  }
-  else
-  {
-    // Otherwise, PicOrderCntMsb is derived as follows: (8-1)
-    if (((int)slice_pic_order_cnt_lsb < prevPicOrderCntLsb) &&
-        (((int)prevPicOrderCntLsb - (int)slice_pic_order_cnt_lsb) >= ((int)MaxPicOrderCntLsb / 2)))
-      PicOrderCntMsb = prevPicOrderCntMsb + MaxPicOrderCntLsb;
-    else if (((int)slice_pic_order_cnt_lsb > prevPicOrderCntLsb) &&
-             (((int)slice_pic_order_cnt_lsb - prevPicOrderCntLsb) > ((int)MaxPicOrderCntLsb / 2)))
-      PicOrderCntMsb = prevPicOrderCntMsb - MaxPicOrderCntLsb;
-    else
-      PicOrderCntMsb = prevPicOrderCntMsb;
-  }
+  PicOrderCntMsb = calculatePicOrderCntMsb(this->slice_pic_order_cnt_lsb,
+                                          MaxPicOrderCntLsb,
+                                          nalUnitHeader.isIRAP() && this->NoRaslOutputFlag,
+                                          prevTid0PicSlicePicOrderCntLsb,
+                                          prevTid0PicPicOrderCntMsb);
 
   // PicOrderCntVal is derived as follows: (8-2)
   PicOrderCntVal = PicOrderCntMsb + static_cast<int>(slice_pic_order_cnt_lsb);
@@ -403,10 +401,7 @@ void slice_segment_header::write(SubByteWriter &            writer,
           writer.writeUEV(this->num_ref_idx_l1_active_minus1);
       }
 
-      const auto CurrRpsIdx      = (this->short_term_ref_pic_set_sps_flag)
-                                       ? this->short_term_ref_pic_set_idx
-                                       : sps.num_short_term_ref_pic_sets;
-      const auto NumPicTotalCurr = this->stRefPicSet.NumPicTotalCurr(CurrRpsIdx, this);
+      const auto NumPicTotalCurr = this->stRefPicSet.NumPicTotalCurr(this);
       if (pps.lists_modification_present_flag && NumPicTotalCurr > 1)
         this->refPicListsModification.write(writer, NumPicTotalCurr, this);
 
@@ -30,6 +30,14 @@ class slice_segment_layer_rbsp;
 
 std::string to_string(SliceType sliceType);
 
+// T-REC-H.265-201410 - 8.3.1 PicOrderCntMsb of a picture from the previous picture with TemporalId
+// equal to 0 (that is not a RASL, RADL or SLNR picture)
+int calculatePicOrderCntMsb(const uint64_t slice_pic_order_cnt_lsb,
+                            const unsigned MaxPicOrderCntLsb,
+                            const bool     isIRAPWithNoRaslOutputFlag,
+                            const uint64_t prevTid0PicSlicePicOrderCntLsb,
+                            const int      prevTid0PicPicOrderCntMsb);
+
 // T-REC-H.265-201410 - 7.3.6.1 slice_segment_header()
 class slice_segment_header
 {
@@ -13,13 +13,13 @@
 namespace combiner::parser::hevc
 {
 
-std::array<uint64_t, 65> st_ref_pic_set::st_ref_pic_set::NumNegativePics{};
-std::array<uint64_t, 65> st_ref_pic_set::st_ref_pic_set::NumPositivePics{};
-array2D<int, 65, 16>     st_ref_pic_set::st_ref_pic_set::DeltaPocS0{};
-array2D<int, 65, 16>     st_ref_pic_set::st_ref_pic_set::DeltaPocS1{};
-array2D<bool, 65, 16>    st_ref_pic_set::st_ref_pic_set::UsedByCurrPicS0{};
-array2D<bool, 65, 16>    st_ref_pic_set::st_ref_pic_set::UsedByCurrPicS1{};
-std::array<uint64_t, 65> st_ref_pic_set::st_ref_pic_set::NumDeltaPocs{};
+thread_local std::array<uint64_t, 65> st_ref_pic_set::st_ref_pic_set::NumNegativePics{};
+thread_local std::array<uint64_t, 65> st_ref_pic_set::st_ref_pic_set::NumPositivePics{};
+thread_local array2D<int, 65, 16>     st_ref_pic_set::st_ref_pic_set::DeltaPocS0{};
+thread_local array2D<int, 65, 16>     st_ref_pic_set::st_ref_pic_set::DeltaPocS1{};
+thread_local array2D<bool, 65, 16>    st_ref_pic_set::st_ref_pic_set::UsedByCurrPicS0{};
+thread_local array2D<bool, 65, 16>    st_ref_pic_set::st_ref_pic_set::UsedByCurrPicS1{};
+thread_local std::array<uint64_t, 65> st_ref_pic_set::st_ref_pic_set::NumDeltaPocs{};
 
 void st_ref_pic_set::parse(SubByteReader &reader,
                            const uint64_t stRpsIdx,
@@ -146,6 +146,53 @@ void st_ref_pic_set::parse(SubByteReader &reader,
   }
 
   NumDeltaPocs[stRpsIdx] = NumNegativePics[stRpsIdx] + NumPositivePics[stRpsIdx]; // (7-69)
+
+  this->deltaPocS0.assign(DeltaPocS0[stRpsIdx].begin(),
+                          DeltaPocS0[stRpsIdx].begin() + NumNegativePics[stRpsIdx]);
+  this->usedByCurrPicS0.assign(UsedByCurrPicS0[stRpsIdx].begin(),
+                               UsedByCurrPicS0[stRpsIdx].begin() + NumNegativePics[stRpsIdx]);
+  this->deltaPocS1.assign(DeltaPocS1[stRpsIdx].begin(),
+                          DeltaPocS1[stRpsIdx].begin() + NumPositivePics[stRpsIdx]);
+  this->usedByCurrPicS1.assign(UsedByCurrPicS1[stRpsIdx].begin(),
+                               UsedByCurrPicS1[stRpsIdx].begin() + NumPositivePics[stRpsIdx]);
+}
+
+st_ref_pic_set st_ref_pic_set::fromDeltaPocs(const vector<int>  &deltaPocS0,
+                                             const vector<bool> &usedByCurrPicS0,
+                                             const vector<int>  &deltaPocS1,
+                                             const vector<bool> &usedByCurrPicS1)
+{
+  if (deltaPocS0.size() > 16 || deltaPocS1.size() > 16)
+    throw std::logic_error("A short term ref pic set can have at most 16 entries per direction");
+
+  st_ref_pic_set rps;
+  rps.num_negative_pics = deltaPocS0.size();
+  rps.num_positive_pics = deltaPocS1.size();
+
+  int previousDeltaPoc = 0;
+  for (const auto deltaPoc : deltaPocS0)
+  {
+    if (deltaPoc >= previousDeltaPoc)
+      throw std::logic_error("The negative POC deltas must be decreasing");
+    rps.delta_poc_s0_minus1.push_back(static_cast<uint64_t>(previousDeltaPoc - deltaPoc - 1));
+    previousDeltaPoc = deltaPoc;
+  }
+  previousDeltaPoc = 0;
+  for (const auto deltaPoc : deltaPocS1)
+  {
+    if (deltaPoc <= previousDeltaPoc)
+      throw std::logic_error("The positive POC deltas must be increasing");
+    rps.delta_poc_s1_minus1.push_back(static_cast<uint64_t>(deltaPoc - previousDeltaPoc - 1));
+    previousDeltaPoc = deltaPoc;
+  }
+  rps.used_by_curr_pic_s0_flag = usedByCurrPicS0;
+  rps.used_by_curr_pic_s1_flag = usedByCurrPicS1;
+
+  rps.deltaPocS0      = deltaPocS0;
+  rps.usedByCurrPicS0 = usedByCurrPicS0;
+  rps.deltaPocS1      = deltaPocS1;
+  rps.usedByCurrPicS1 = usedByCurrPicS1;
+  return rps;
 }
 
 void st_ref_pic_set::write(SubByteWriter &writer,
@@ -194,15 +241,14 @@ void st_ref_pic_set::write(SubByteWriter &writer,
 }
 
 // (7-55)
-unsigned st_ref_pic_set::NumPicTotalCurr(const uint64_t              CurrRpsIdx,
-                                         const slice_segment_header *slice) const
+unsigned st_ref_pic_set::NumPicTotalCurr(const slice_segment_header *slice) const
 {
   int NumPicTotalCurr = 0;
-  for (unsigned int i = 0; i < NumNegativePics[CurrRpsIdx]; i++)
-    if (UsedByCurrPicS0[CurrRpsIdx][i])
+  for (const auto used : this->usedByCurrPicS0)
+    if (used)
       NumPicTotalCurr++;
-  for (unsigned int i = 0; i < NumPositivePics[CurrRpsIdx]; i++)
-    if (UsedByCurrPicS1[CurrRpsIdx][i])
+  for (const auto used : this->usedByCurrPicS1)
+    if (used)
       NumPicTotalCurr++;
   for (unsigned int i = 0; i < slice->num_long_term_sps + slice->num_long_term_pics; i++)
     if (slice->UsedByCurrPicLt[i])
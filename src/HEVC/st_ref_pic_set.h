@@ -26,7 +26,14 @@ public:
              const uint64_t stRpsIdx,
              const uint64_t num_short_term_ref_pic_sets) const;
 
-  unsigned NumPicTotalCurr(const uint64_t CurrRpsIdx, const slice_segment_header *slice) const;
+  // A set that is coded explicitly (without prediction) with the given POC deltas in the order
+  // of the spec (negative deltas decreasing, positive deltas increasing).
+  static st_ref_pic_set fromDeltaPocs(const vector<int>  &deltaPocS0,
+                                      const vector<bool> &usedByCurrPicS0,
+                                      const vector<int>  &deltaPocS1,
+                                      const vector<bool> &usedByCurrPicS1);
+
+  unsigned NumPicTotalCurr(const slice_segment_header *slice) const;
 
   bool         inter_ref_pic_set_prediction_flag{};
   uint64_t     delta_idx_minus1{};
@@ -42,14 +49,22 @@ public:
   vector<uint64_t> delta_poc_s1_minus1;
   vector<bool>     used_by_curr_pic_s1_flag;
 
-  // Calculated values. These are static. They are used for reference picture set prediction.
-  static std::array<uint64_t, 65> NumNegativePics;
-  static std::array<uint64_t, 65> NumPositivePics;
-  static array2D<int, 65, 16>     DeltaPocS0;
-  static array2D<int, 65, 16>     DeltaPocS1;
-  static array2D<bool, 65, 16>    UsedByCurrPicS0;
-  static array2D<bool, 65, 16>    UsedByCurrPicS1;
-  static std::array<uint64_t, 65> NumDeltaPocs;
+  // Calculated values of this set. Unlike the static arrays, these are not overwritten when the
+  // sets of another SPS are parsed.
+  vector<int>  deltaPocS0;
+  vector<bool> usedByCurrPicS0;
+  vector<int>  deltaPocS1;
+  vector<bool> usedByCurrPicS1;
+
+  // Calculated values. These are static (per thread so that multiple threads can parse). They
+  // are used for reference picture set prediction.
+  static thread_local std::array<uint64_t, 65> NumNegativePics;
+  static thread_local std::array<uint64_t, 65> NumPositivePics;
+  static thread_local array2D<int, 65, 16>     DeltaPocS0;
+  static thread_local array2D<int, 65, 16>     DeltaPocS1;
+  static thread_local array2D<bool, 65, 16>    UsedByCurrPicS0;
+  static thread_local array2D<bool, 65, 16>    UsedByCurrPicS1;
+  static thread_local std::array<uint64_t, 65> NumDeltaPocs;
 };
 
 } // namespace combiner::parser::hevc
\ No newline at end of file
@@ -0,0 +1,41 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+
+#include <common/Typedef.h>
+
+#include <vector>
+
+namespace combiner
+{
+
+// Buffers of a fixed size that are reused instead of being allocated for every packet.
+class BufferPool
+{
+public:
+  BufferPool(const size_t bufferSize) : bufferSize(bufferSize) {}
+
+  ByteVector get()
+  {
+    if (this->freeBuffers.empty())
+      return ByteVector(this->bufferSize);
+    auto buffer = std::move(this->freeBuffers.back());
+    this->freeBuffers.pop_back();
+    return buffer;
+  }
+  void release(ByteVector &&buffer)
+  {
+    if (buffer.size() == this->bufferSize)
+      this->freeBuffers.push_back(std::move(buffer));
+  }
+
+private:
+  size_t                  bufferSize{};
+  std::vector<ByteVector> freeBuffers;
+};
+
+} // namespace combiner
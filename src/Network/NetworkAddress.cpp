@@ -0,0 +1,63 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include "NetworkAddress.h"
+
+#include <stdexcept>
+
+namespace combiner
+{
+
+namespace
+{
+
+const std::string RTP_SCHEME = "rtp://";
+
+} // namespace
+
+NetworkAddress NetworkAddress::fromString(const std::string &address)
+{
+  const auto separator = address.rfind(':');
+  if (separator == std::string::npos || separator == 0 || separator + 1 == address.size())
+    throw std::invalid_argument("Invalid network address " + address + " (expected host:port)");
+
+  NetworkAddress networkAddress;
+  networkAddress.host = address.substr(0, separator);
+  if (networkAddress.host.front() == '[' && networkAddress.host.back() == ']')
+    networkAddress.host = networkAddress.host.substr(1, networkAddress.host.size() - 2);
+
+  const auto portString = address.substr(separator + 1);
+  size_t     parsedCharacters{};
+  int        port{};
+  try
+  {
+    port = std::stoi(portString, &parsedCharacters);
+  }
+  catch (const std::exception &)
+  {
+    parsedCharacters = 0;
+  }
+  if (parsedCharacters != portString.size() || port < 1 || port > 65535)
+    throw std::invalid_argument("Invalid port in network address " + address);
+  networkAddress.port = static_cast<uint16_t>(port);
+  return networkAddress;
+}
+
+std::optional<NetworkAddress> NetworkAddress::fromRTPURL(const std::string &url)
+{
+  if (url.compare(0, RTP_SCHEME.size(), RTP_SCHEME) != 0)
+    return {};
+  return fromString(url.substr(RTP_SCHEME.size()));
+}
+
+std::string NetworkAddress::toString() const
+{
+  if (this->host.find(':') != std::string::npos)
+    return "[" + this->host + "]:" + std::to_string(this->port);
+  return this->host + ":" + std::to_string(this->port);
+}
+
+} // namespace combiner
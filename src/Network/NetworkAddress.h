@@ -0,0 +1,30 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
+namespace combiner
+{
+
+// A host (name or IP address) and a port
+struct NetworkAddress
+{
+  std::string host;
+  uint16_t    port{};
+
+  // Parse "host:port". IPv6 addresses are given in brackets ("[::1]:5004").
+  static NetworkAddress fromString(const std::string &address);
+  // Parse "rtp://host:port". Returns nothing if the URL has a different scheme.
+  static std::optional<NetworkAddress> fromRTPURL(const std::string &url);
+
+  std::string toString() const;
+};
+
+} // namespace combiner
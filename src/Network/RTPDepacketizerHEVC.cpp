@@ -0,0 +1,256 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include "RTPDepacketizerHEVC.h"
+
+#include <common/Logger.h>
+
+#include <algorithm>
+#include <string>
+#include <type_traits>
+
+namespace combiner
+{
+
+namespace
+{
+
+constexpr size_t  RTP_HEADER_SIZE         = 12;
+constexpr uint8_t RTP_VERSION             = 2;
+constexpr size_t  NAL_UNIT_HEADER_SIZE    = 2;
+constexpr size_t  FU_HEADER_SIZE          = 1;
+constexpr size_t  AP_NAL_UNIT_SIZE_LENGTH = 2;
+
+constexpr uint8_t PAYLOAD_TYPE_AP   = 48;
+constexpr uint8_t PAYLOAD_TYPE_FU   = 49;
+constexpr uint8_t PAYLOAD_TYPE_PACI = 50;
+
+uint16_t readUInt16(const uint8_t *data)
+{
+  return uint16_t((data[0] << 8) | data[1]);
+}
+
+uint32_t readUInt32(const uint8_t *data)
+{
+  return (uint32_t(data[0]) << 24) | (uint32_t(data[1]) << 16) | (uint32_t(data[2]) << 8) |
+         uint32_t(data[3]);
+}
+
+// Extend a 16 or 32 bit counter to the value closest to the reference
+template <typename T> int64_t unwrap(const T value, const int64_t reference)
+{
+  using SignedT    = std::make_signed_t<T>;
+  const auto delta = static_cast<SignedT>(static_cast<T>(value - static_cast<T>(reference)));
+  return reference + delta;
+}
+
+} // namespace
+
+RTPDepacketizerHEVC::RTPDepacketizerHEVC(BufferPool &bufferPool, const size_t reorderBufferSize)
+    : bufferPool(bufferPool), reorderBufferSize(reorderBufferSize)
+{
+}
+
+void RTPDepacketizerHEVC::addPacket(ByteVector &&packet, const size_t size)
+{
+  if (size < RTP_HEADER_SIZE || (packet.at(0) >> 6) != RTP_VERSION)
+  {
+    logger().warning("Dropped a UDP datagram that is no RTP packet");
+    this->bufferPool.release(std::move(packet));
+    return;
+  }
+
+  const auto sequenceNumberInPacket = readUInt16(packet.data() + 2);
+  if (!this->nextSequenceNumber)
+    this->nextSequenceNumber = sequenceNumberInPacket;
+  const auto sequenceNumber = unwrap(sequenceNumberInPacket, *this->nextSequenceNumber);
+
+  if (sequenceNumber < *this->nextSequenceNumber || this->reorderBuffer.count(sequenceNumber) > 0)
+  {
+    logger().debug("Dropped late or duplicate RTP packet " + std::to_string(sequenceNumber));
+    this->bufferPool.release(std::move(packet));
+    return;
+  }
+  this->reorderBuffer[sequenceNumber] = {std::move(packet), size};
+
+  if (this->reorderBuffer.size() > this->reorderBufferSize)
+    this->skipLostPackets(this->reorderBuffer.begin()->first);
+
+  while (!this->reorderBuffer.empty() &&
+         this->reorderBuffer.begin()->first == *this->nextSequenceNumber)
+  {
+    auto it = this->reorderBuffer.begin();
+    this->processPacket(it->first, it->second);
+    this->bufferPool.release(std::move(it->second.data));
+    this->reorderBuffer.erase(it);
+    ++(*this->nextSequenceNumber);
+  }
+}
+
+void RTPDepacketizerHEVC::flush()
+{
+  for (auto &[sequenceNumber, packet] : this->reorderBuffer)
+  {
+    this->skipLostPackets(sequenceNumber);
+    this->processPacket(sequenceNumber, packet);
+    this->bufferPool.release(std::move(packet.data));
+    this->nextSequenceNumber = sequenceNumber + 1;
+  }
+  this->reorderBuffer.clear();
+
+  if (this->fragmentedNalUnit)
+    this->dropFragmentedNalUnit("the stream ended");
+}
+
+std::optional<RTPNalUnit> RTPDepacketizerHEVC::getNextNalUnit()
+{
+  if (this->nalUnits.empty())
+    return {};
+  auto nalUnit = std::move(this->nalUnits.front());
+  this->nalUnits.pop_front();
+  return nalUnit;
+}
+
+void RTPDepacketizerHEVC::skipLostPackets(const int64_t nextReceivedSequenceNumber)
+{
+  if (nextReceivedSequenceNumber <= *this->nextSequenceNumber)
+    return;
+
+  const auto nrLost = static_cast<uint64_t>(nextReceivedSequenceNumber - *this->nextSequenceNumber);
+  logger().warning("Lost " + std::to_string(nrLost) + " RTP packet(s) before sequence number " +
+                   std::to_string(nextReceivedSequenceNumber));
+  this->nrLostPackets += nrLost;
+  this->nextSequenceNumber = nextReceivedSequenceNumber;
+}
+
+void RTPDepacketizerHEVC::processPacket(const int64_t sequenceNumber, const Packet &packet)
+{
+  const auto data = packet.data.data();
+  auto       size = packet.size;
+
+  const auto hasPadding   = (data[0] & 0x20) != 0;
+  const auto hasExtension = (data[0] & 0x10) != 0;
+  const auto csrcCount    = size_t(data[0] & 0x0f);
+
+  // A header extension that does not fit leaves no valid payload and the packet is dropped
+  auto headerSize = RTP_HEADER_SIZE + csrcCount * 4;
+  if (hasExtension)
+  {
+    const auto extensionStart = headerSize;
+    headerSize += 4;
+    if (headerSize <= size)
+      headerSize += size_t(readUInt16(data + extensionStart + 2)) * 4;
+  }
+  if (hasPadding && size > 0)
+    size -= std::min(size, size_t(data[size - 1]));
+  if (headerSize + NAL_UNIT_HEADER_SIZE > size)
+  {
+    logger().warning("Dropped RTP packet " + std::to_string(sequenceNumber) +
+                     " without a valid payload");
+    return;
+  }
+
+  const auto timestamp = readUInt32(data + 4);
+  this->lastTimestamp  = this->lastTimestamp ? unwrap(timestamp, *this->lastTimestamp)
+                                             : static_cast<int64_t>(timestamp);
+
+  this->processPayload(sequenceNumber, *this->lastTimestamp, data + headerSize, size - headerSize);
+}
+
+void RTPDepacketizerHEVC::processPayload(const int64_t  sequenceNumber,
+                                         const int64_t  timestamp,
+                                         const uint8_t *payload,
+                                         const size_t   size)
+{
+  const auto payloadType = uint8_t((payload[0] >> 1) & 0x3f);
+
+  auto addNalUnit = [&](const uint8_t *nalData, const size_t nalSize) {
+    this->nalUnits.push_back({ByteVector(nalData, nalData + nalSize),
+                              static_cast<uint64_t>(timestamp),
+                              static_cast<uint64_t>(sequenceNumber)});
+  };
+
+  if (payloadType != PAYLOAD_TYPE_FU && this->fragmentedNalUnit)
+    this->dropFragmentedNalUnit("its end fragment is missing");
+
+  if (payloadType < PAYLOAD_TYPE_AP)
+    addNalUnit(payload, size);
+  else if (payloadType == PAYLOAD_TYPE_AP)
+  {
+    size_t position = NAL_UNIT_HEADER_SIZE;
+    while (position + AP_NAL_UNIT_SIZE_LENGTH <= size)
+    {
+      const auto nalSize = size_t(readUInt16(payload + position));
+      position += AP_NAL_UNIT_SIZE_LENGTH;
+      if (nalSize == 0 || position + nalSize > size)
+      {
+        logger().warning("Invalid NAL unit size in RTP aggregation packet " +
+                         std::to_string(sequenceNumber));
+        break;
+      }
+      addNalUnit(payload + position, nalSize);
+      position += nalSize;
+    }
+  }
+  else if (payloadType == PAYLOAD_TYPE_FU)
+  {
+    if (size < NAL_UNIT_HEADER_SIZE + FU_HEADER_SIZE)
+      return;
+
+    const auto fuHeader      = payload[NAL_UNIT_HEADER_SIZE];
+    const auto isStart       = (fuHeader & 0x80) != 0;
+    const auto isEnd         = (fuHeader & 0x40) != 0;
+    const auto nalUnitType   = uint8_t(fuHeader & 0x3f);
+    const auto fragmentStart = payload + NAL_UNIT_HEADER_SIZE + FU_HEADER_SIZE;
+    const auto fragmentEnd   = payload + size;
+
+    if (isStart)
+    {
+      if (this->fragmentedNalUnit)
+        this->dropFragmentedNalUnit("its end fragment is missing");
+
+      RTPNalUnit nalUnit;
+      nalUnit.timestamp      = static_cast<uint64_t>(timestamp);
+      nalUnit.sequenceNumber = static_cast<uint64_t>(sequenceNumber);
+      nalUnit.data.push_back(uint8_t((payload[0] & 0x81) | (nalUnitType << 1)));
+      nalUnit.data.push_back(payload[1]);
+      this->fragmentedNalUnit = std::move(nalUnit);
+    }
+    else if (!this->fragmentedNalUnit)
+      return;
+    else if (sequenceNumber != this->nextFragmentSequenceNumber)
+    {
+      this->dropFragmentedNalUnit("fragments were lost");
+      return;
+    }
+
+    auto &data = this->fragmentedNalUnit->data;
+    data.insert(data.end(), fragmentStart, fragmentEnd);
+    this->nextFragmentSequenceNumber = sequenceNumber + 1;
+
+    if (isEnd)
+    {
+      this->nalUnits.push_back(std::move(*this->fragmentedNalUnit));
+      this->fragmentedNalUnit.reset();
+    }
+  }
+  else if (!this->unsupportedPacketWarned)
+  {
+    logger().warning("Dropping RTP packets with unsupported payload type " +
+                     std::to_string(payloadType) +
+                     (payloadType == PAYLOAD_TYPE_PACI ? " (PACI)" : ""));
+    this->unsupportedPacketWarned = true;
+  }
+}
+
+void RTPDepacketizerHEVC::dropFragmentedNalUnit(const std::string &reason)
+{
+  logger().warning("Dropped a fragmented NAL unit starting in RTP packet " +
+                   std::to_string(this->fragmentedNalUnit->sequenceNumber) + " because " + reason);
+  this->fragmentedNalUnit.reset();
+}
+
+} // namespace combiner
@@ -0,0 +1,84 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+
+#include "BufferPool.h"
+
+#include <common/Typedef.h>
+
+#include <deque>
+#include <map>
+#include <optional>
+#include <string>
+
+namespace combiner
+{
+
+struct RTPNalUnit
+{
+  ByteVector data;
+  // The RTP timestamp and extended sequence number of the packet that the NAL unit started in
+  uint64_t timestamp{};
+  uint64_t sequenceNumber{};
+};
+
+/* Reassembles HEVC NAL units from RTP packets (RFC 7798). Single NAL unit packets, aggregation
+ * packets (AP) and fragmentation units (FU) are supported. DONL fields (sprop-max-don-diff > 0)
+ * and PACI packets are not.
+ * The packets are put into a reorder buffer keyed on the extended sequence number. Packets are
+ * processed in order as soon as there is no gap. If the buffer overflows, the missing packets are
+ * considered lost and a fragmented NAL unit that was affected by the loss is dropped. Late and
+ * duplicate packets are dropped. The packet buffers are returned to the pool once processed.
+ * The NAL units are copied out of the packets into their own buffers. These are not taken from
+ * the pool because they are handed on and never come back.
+ */
+class RTPDepacketizerHEVC
+{
+public:
+  RTPDepacketizerHEVC(BufferPool &bufferPool, const size_t reorderBufferSize = 64);
+
+  // Add a received packet (the first size bytes of the buffer)
+  void addPacket(ByteVector &&packet, const size_t size);
+  // Process all packets in the reorder buffer (at the end of the stream)
+  void flush();
+
+  std::optional<RTPNalUnit> getNextNalUnit();
+
+  uint64_t getNrLostPackets() const { return this->nrLostPackets; }
+
+private:
+  struct Packet
+  {
+    ByteVector data;
+    size_t     size{};
+  };
+
+  void processPacket(const int64_t sequenceNumber, const Packet &packet);
+  void processPayload(const int64_t  sequenceNumber,
+                      const int64_t  timestamp,
+                      const uint8_t *payload,
+                      const size_t   size);
+  void skipLostPackets(const int64_t nextReceivedSequenceNumber);
+  void dropFragmentedNalUnit(const std::string &reason);
+
+  BufferPool &bufferPool;
+  size_t      reorderBufferSize{};
+
+  std::map<int64_t, Packet> reorderBuffer;
+  std::optional<int64_t>    nextSequenceNumber{};
+  std::optional<int64_t>    lastTimestamp{};
+
+  // A fragmented NAL unit that is being reassembled and the sequence number of its next fragment
+  std::optional<RTPNalUnit> fragmentedNalUnit{};
+  int64_t                   nextFragmentSequenceNumber{};
+
+  std::deque<RTPNalUnit> nalUnits;
+  uint64_t               nrLostPackets{};
+  bool                   unsupportedPacketWarned{};
+};
+
+} // namespace combiner
@@ -0,0 +1,223 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include "RTPPacketizerHEVC.h"
+
+#include <HEVC/nal_unit_header.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace combiner
+{
+
+namespace
+{
+
+constexpr size_t  RTP_HEADER_SIZE         = 12;
+constexpr uint8_t RTP_VERSION             = 2;
+constexpr size_t  NAL_UNIT_HEADER_SIZE    = 2;
+constexpr size_t  FU_HEADER_SIZE          = 1;
+constexpr size_t  AP_NAL_UNIT_SIZE_LENGTH = 2;
+
+constexpr uint8_t PAYLOAD_TYPE_AP = 48;
+constexpr uint8_t PAYLOAD_TYPE_FU = 49;
+
+using parser::hevc::nal_unit_header;
+
+nal_unit_header getNalUnitHeader(const ByteRange &nal)
+{
+  return nal_unit_header::fromNalUnitTypeID(static_cast<unsigned>((nal.data[0] >> 1) & 0x3f));
+}
+
+} // namespace
+
+RTPPacketizerHEVC::RTPPacketizerHEVC(const uint32_t ssrc,
+                                     const size_t   maxPayloadSize,
+                                     const uint8_t  payloadType)
+    : ssrc(ssrc), maxPayloadSize(maxPayloadSize), payloadType(payloadType)
+{
+  if (maxPayloadSize <= NAL_UNIT_HEADER_SIZE + FU_HEADER_SIZE)
+    throw std::invalid_argument("The maximum RTP payload size is too small");
+}
+
+const GatherDatagrams &
+RTPPacketizerHEVC::packetizeAccessUnit(const std::vector<ByteVector> &nalUnits,
+                                       const uint32_t                 timestamp)
+{
+  this->nalUnitRanges.clear();
+  for (const auto &nal : nalUnits)
+    this->nalUnitRanges.push_back({nal.data(), nal.size()});
+  return this->packetizeAccessUnit(this->nalUnitRanges, timestamp);
+}
+
+const GatherDatagrams &
+RTPPacketizerHEVC::packetizeAccessUnit(const std::vector<ByteRange> &nalUnits,
+                                       const uint32_t                timestamp)
+{
+  this->packets.ranges.clear();
+  this->packets.nrRangesPerDatagram.clear();
+  this->headerBufferPosition = 0;
+  const auto maxHeaderSize   = this->getMaxHeaderSize(nalUnits);
+  if (this->headerBuffer.size() < maxHeaderSize)
+    this->headerBuffer.resize(maxHeaderSize);
+
+  size_t nalIndex = 0;
+  while (nalIndex < nalUnits.size())
+  {
+    const auto &nal = nalUnits.at(nalIndex);
+    if (nal.size < NAL_UNIT_HEADER_SIZE)
+    {
+      ++nalIndex;
+      continue;
+    }
+
+    const auto nrToAggregate = this->getNrNalUnitsToAggregate(nalUnits, nalIndex);
+    if (nrToAggregate > 1)
+    {
+      // The F bit is set if any of the NAL units has it. The layer and temporal ID are the lowest.
+      uint8_t forbiddenZeroBit = 0;
+      uint8_t layerId          = 63;
+      uint8_t temporalIdPlus1  = 7;
+      for (size_t i = nalIndex; i < nalIndex + nrToAggregate; ++i)
+      {
+        const auto header = nalUnits.at(i).data;
+        forbiddenZeroBit |= header[0] & 0x80;
+        layerId         = std::min(layerId, uint8_t(((header[0] & 0x01) << 5) | (header[1] >> 3)));
+        temporalIdPlus1 = std::min(temporalIdPlus1, uint8_t(header[1] & 0x07));
+      }
+
+      this->startPacket(timestamp);
+      auto payloadHeader = this->addHeaderBytes(NAL_UNIT_HEADER_SIZE);
+      payloadHeader[0]   = uint8_t(forbiddenZeroBit | (PAYLOAD_TYPE_AP << 1) | (layerId >> 5));
+      payloadHeader[1]   = uint8_t(((layerId & 0x1f) << 3) | temporalIdPlus1);
+      for (size_t i = nalIndex; i < nalIndex + nrToAggregate; ++i)
+      {
+        const auto &aggregatedNal = nalUnits.at(i);
+        auto        sizeField     = this->addHeaderBytes(AP_NAL_UNIT_SIZE_LENGTH);
+        sizeField[0]              = uint8_t(aggregatedNal.size >> 8);
+        sizeField[1]              = uint8_t(aggregatedNal.size & 0xff);
+        this->addPayload(aggregatedNal.data, aggregatedNal.size);
+      }
+      nalIndex += nrToAggregate;
+      continue;
+    }
+
+    if (nal.size <= this->maxPayloadSize)
+    {
+      this->startPacket(timestamp);
+      this->addPayload(nal.data, nal.size);
+      ++nalIndex;
+      continue;
+    }
+
+    const auto maxFragmentSize = this->maxPayloadSize - NAL_UNIT_HEADER_SIZE - FU_HEADER_SIZE;
+    const auto nalUnitTypeID   = getNalUnitHeader(nal).nalUnitTypeID;
+    for (size_t position = NAL_UNIT_HEADER_SIZE; position < nal.size; position += maxFragmentSize)
+    {
+      const auto fragmentSize = std::min(maxFragmentSize, nal.size - position);
+      const auto isStart      = position == NAL_UNIT_HEADER_SIZE;
+      const auto isEnd        = position + fragmentSize == nal.size;
+
+      this->startPacket(timestamp);
+      auto headers = this->addHeaderBytes(NAL_UNIT_HEADER_SIZE + FU_HEADER_SIZE);
+      headers[0]   = uint8_t((nal.data[0] & 0x81) | (PAYLOAD_TYPE_FU << 1));
+      headers[1]   = nal.data[1];
+      headers[2]   = uint8_t((isStart ? 0x80 : 0x00) | (isEnd ? 0x40 : 0x00) | nalUnitTypeID);
+      this->addPayload(nal.data + position, fragmentSize);
+    }
+    ++nalIndex;
+  }
+
+  if (!this->packets.nrRangesPerDatagram.empty())
+    this->headerBuffer[this->lastPacketHeaderPosition + 1] |= 0x80;
+  return this->packets;
+}
+
+size_t RTPPacketizerHEVC::getMaxHeaderSize(const std::vector<ByteRange> &nalUnits) const
+{
+  // Every NAL unit is at most in its own aggregation packet or in fragmentation units
+  const auto maxFragmentSize    = this->maxPayloadSize - NAL_UNIT_HEADER_SIZE - FU_HEADER_SIZE;
+  const auto apHeaderSize       = RTP_HEADER_SIZE + NAL_UNIT_HEADER_SIZE + AP_NAL_UNIT_SIZE_LENGTH;
+  const auto fragmentHeaderSize = RTP_HEADER_SIZE + NAL_UNIT_HEADER_SIZE + FU_HEADER_SIZE;
+  size_t     maxHeaderSize      = 0;
+  for (const auto &nal : nalUnits)
+  {
+    const auto nrFragments = (nal.size + maxFragmentSize - 1) / maxFragmentSize;
+    maxHeaderSize += std::max(apHeaderSize, nrFragments * fragmentHeaderSize);
+  }
+  return maxHeaderSize;
+}
+
+size_t RTPPacketizerHEVC::getNrNalUnitsToAggregate(const std::vector<ByteRange> &nalUnits,
+                                                   const size_t                  firstIndex) const
+{
+  auto   payloadSize = NAL_UNIT_HEADER_SIZE;
+  size_t nrNalUnits  = 0;
+  for (auto i = firstIndex; i < nalUnits.size(); ++i)
+  {
+    const auto &nal = nalUnits.at(i);
+    if (nal.size < NAL_UNIT_HEADER_SIZE)
+      break;
+    // Only non-VCL NAL units are aggregated. The types from PAYLOAD_TYPE_AP on are used by RTP.
+    const auto header = getNalUnitHeader(nal);
+    if (header.isVCL() || header.nalUnitTypeID >= PAYLOAD_TYPE_AP)
+      break;
+    if (payloadSize + AP_NAL_UNIT_SIZE_LENGTH + nal.size > this->maxPayloadSize)
+      break;
+    payloadSize += AP_NAL_UNIT_SIZE_LENGTH + nal.size;
+    ++nrNalUnits;
+  }
+  return nrNalUnits;
+}
+
+void RTPPacketizerHEVC::startPacket(const uint32_t timestamp)
+{
+  this->packets.nrRangesPerDatagram.push_back(0);
+  this->lastPacketHeaderPosition = this->headerBufferPosition;
+
+  auto header = this->addHeaderBytes(RTP_HEADER_SIZE);
+  header[0]   = uint8_t(RTP_VERSION << 6);
+  header[1]   = this->payloadType;
+  header[2]   = uint8_t(this->sequenceNumber >> 8);
+  header[3]   = uint8_t(this->sequenceNumber & 0xff);
+  header[4]   = uint8_t(timestamp >> 24);
+  header[5]   = uint8_t(timestamp >> 16);
+  header[6]   = uint8_t(timestamp >> 8);
+  header[7]   = uint8_t(timestamp);
+  header[8]   = uint8_t(this->ssrc >> 24);
+  header[9]   = uint8_t(this->ssrc >> 16);
+  header[10]  = uint8_t(this->ssrc >> 8);
+  header[11]  = uint8_t(this->ssrc);
+  ++this->sequenceNumber;
+}
+
+uint8_t *RTPPacketizerHEVC::addHeaderBytes(const size_t size)
+{
+  auto data = this->headerBuffer.data() + this->headerBufferPosition;
+  this->headerBufferPosition += size;
+
+  // Header bytes that directly follow a header range of the packet extend it
+  auto &nrRanges = this->packets.nrRangesPerDatagram.back();
+  if (nrRanges > 0 && this->lastRangeIsHeader)
+    this->packets.ranges.back().size += size;
+  else
+  {
+    this->packets.ranges.push_back({data, size});
+    ++nrRanges;
+  }
+  this->lastRangeIsHeader = true;
+  return data;
+}
+
+void RTPPacketizerHEVC::addPayload(const uint8_t *data, const size_t size)
+{
+  this->packets.ranges.push_back({data, size});
+  ++this->packets.nrRangesPerDatagram.back();
+  this->lastRangeIsHeader = false;
+}
+
+} // namespace combiner
@@ -0,0 +1,63 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+
+#include "UdpSocket.h"
+
+#include <common/Typedef.h>
+
+#include <vector>
+
+namespace combiner
+{
+
+/* Splits the NAL units of access units into RTP packets (RFC 7798). NAL units that fit into the
+ * maximum payload size are sent as single NAL unit packets. Larger NAL units are split into
+ * fragmentation units (FU). Consecutive small non-VCL NAL units (parameter sets, SEI) are
+ * aggregated into aggregation packets (AP). The marker bit is set on the last packet of an
+ * access unit.
+ * The packets are not copied together. The RTP and payload headers are written into a buffer of
+ * the packetizer and the payload ranges point directly into the NAL units.
+ */
+class RTPPacketizerHEVC
+{
+public:
+  RTPPacketizerHEVC(const uint32_t ssrc,
+                    const size_t   maxPayloadSize = 1400,
+                    const uint8_t  payloadType    = 96);
+
+  // Packetize the NAL units (without start codes) of one access unit. The packets are valid until
+  // the next call and as long as the NAL units are not modified.
+  const GatherDatagrams &packetizeAccessUnit(const std::vector<ByteVector> &nalUnits,
+                                             const uint32_t                 timestamp);
+  const GatherDatagrams &packetizeAccessUnit(const std::vector<ByteRange> &nalUnits,
+                                             const uint32_t                timestamp);
+
+private:
+  size_t   getMaxHeaderSize(const std::vector<ByteRange> &nalUnits) const;
+  size_t   getNrNalUnitsToAggregate(const std::vector<ByteRange> &nalUnits,
+                                    const size_t                  firstIndex) const;
+  void     startPacket(const uint32_t timestamp);
+  uint8_t *addHeaderBytes(const size_t size);
+  void     addPayload(const uint8_t *data, const size_t size);
+
+  uint32_t ssrc{};
+  size_t   maxPayloadSize{};
+  uint8_t  payloadType{};
+  uint16_t sequenceNumber{};
+
+  std::vector<ByteRange> nalUnitRanges;
+
+  // Sized for the worst case of each access unit, so that the ranges stay valid while it grows
+  ByteVector      headerBuffer;
+  size_t          headerBufferPosition{};
+  size_t          lastPacketHeaderPosition{};
+  bool            lastRangeIsHeader{};
+  GatherDatagrams packets;
+};
+
+} // namespace combiner
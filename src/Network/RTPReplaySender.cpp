@@ -0,0 +1,32 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include "RTPReplaySender.h"
+
+#include "RTPSinkHEVC.h"
+
+#include <File/FileSourceAnnexB.h>
+
+namespace combiner
+{
+
+void replayAnnexBFileAsRTP(const std::filesystem::path &filePath,
+                           const NetworkAddress        &destination,
+                           const bool                   realTime)
+{
+  FileSourceAnnexB fileSource(filePath);
+  RTPSinkHEVC      sink(destination, realTime);
+  while (true)
+  {
+    const auto nalData = fileSource.getNextNALUnit();
+    if (nalData.empty())
+      break;
+    sink.writeNALUnit(nalData);
+  }
+  sink.finish();
+}
+
+} // namespace combiner
@@ -0,0 +1,24 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+
+#include "NetworkAddress.h"
+
+#include <filesystem>
+
+namespace combiner
+{
+
+/* Send the NAL units of a raw (Annex B) HEVC file through an RTPSinkHEVC. In real time mode, each
+ * access unit is sent at its time. Otherwise everything is sent as fast as possible.
+ * This can be used to feed an RTP input of the combiner for testing.
+ */
+void replayAnnexBFileAsRTP(const std::filesystem::path &filePath,
+                           const NetworkAddress        &destination,
+                           const bool                   realTime);
+
+} // namespace combiner
@@ -0,0 +1,152 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include "RTPSinkHEVC.h"
+
+#include <common/Logger.h>
+#include <common/Tracer.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace combiner
+{
+
+using namespace parser::hevc;
+
+namespace
+{
+
+constexpr int64_t RTP_CLOCK_RATE = 90000;
+
+} // namespace
+
+RTPSinkHEVC::RTPSinkHEVC(const NetworkAddress &destination,
+                         const bool            realTime,
+                         const size_t          maxPayloadSize)
+    : socket(UdpSocket::openSender(destination)),
+      packetizer(std::random_device{}(), maxPayloadSize), realTime(realTime),
+      timestampOffset(std::random_device{}())
+{
+  logger().info("Sending RTP to " + destination.toString());
+}
+
+void RTPSinkHEVC::writeNALUnit(const ByteVector &nalData)
+{
+  this->addNALUnit(nalData, {}, 0);
+}
+
+void RTPSinkHEVC::writeNALUnitWithNewHeader(const ByteVector               &newHeader,
+                                           const ByteVector               &originalNalData,
+                                           const size_t                    nrReplacedBytes,
+                                           const std::optional<FileRange> &)
+{
+  this->addNALUnit(newHeader, originalNalData, nrReplacedBytes);
+}
+
+void RTPSinkHEVC::addNALUnit(const ByteVector &nalStart,
+                             const ByteVector &originalNalData,
+                             const size_t      nrReplacedBytes)
+{
+  // A new header is the complete (rewritten) slice segment header. The timing is taken from it.
+  const auto &headerData = nalStart.empty() ? originalNalData : nalStart;
+  const auto  nal        = this->accessUnitTiming.update(headerData);
+  if (nal.startsAccessUnit)
+    this->finishAccessUnit();
+
+  auto &accessUnit = this->currentAccessUnit;
+  if (accessUnit.nalUnitSizes.empty())
+    accessUnit.inputTimestamps = this->nextTimestamps;
+  if (nal.picture)
+    accessUnit.picture = nal.picture;
+
+  const auto sizeBefore = accessUnit.data.size();
+  accessUnit.data.insert(accessUnit.data.end(), nalStart.begin(), nalStart.end());
+  if (originalNalData.size() > nrReplacedBytes)
+    accessUnit.data.insert(accessUnit.data.end(),
+                           originalNalData.begin() + static_cast<std::ptrdiff_t>(nrReplacedBytes),
+                           originalNalData.end());
+  accessUnit.nalUnitSizes.push_back(accessUnit.data.size() - sizeBefore);
+  addToCounter(getCounter(this->statistics, &OutputStatistics::nrNalUnits), 1);
+}
+
+void RTPSinkHEVC::setTimestampsOfNextNALUnits(const Timestamps &timestamps)
+{
+  this->nextTimestamps = timestamps;
+}
+
+void RTPSinkHEVC::finish()
+{
+  this->finishAccessUnit();
+  logger().info("Sent " + std::to_string(this->nrAccessUnits) + " access units in " +
+                std::to_string(this->nrPackets) + " RTP packets");
+}
+
+void RTPSinkHEVC::finishAccessUnit()
+{
+  auto &accessUnit = this->currentAccessUnit;
+  if (accessUnit.nalUnitSizes.empty())
+    return;
+  if (!accessUnit.picture)
+    throw std::runtime_error("Access unit without a slice can not be sent as RTP");
+
+  // The presentation index is calculated from the POC. The presentation is delayed by the maximum
+  // number of reordered pictures so that no picture is presented before it is decoded.
+  const auto &timing = this->accessUnitTiming;
+  int64_t     presentationTime{};
+  if (accessUnit.inputTimestamps.PTS)
+    presentationTime = static_cast<int64_t>(*accessUnit.inputTimestamps.PTS);
+  else
+    presentationTime = timing.getTimeOfPictureIndex(
+        accessUnit.picture->presentationIndex + timing.getReorderDelay(), RTP_CLOCK_RATE);
+
+  if (this->realTime)
+  {
+    const auto now = std::chrono::steady_clock::now();
+    if (!this->startTime)
+      this->startTime = now;
+    const auto decodeTime = std::chrono::microseconds(
+        timing.getTimeOfPictureIndex(accessUnit.picture->decodeIndex, 1000000));
+    std::this_thread::sleep_until(*this->startTime + decodeTime);
+  }
+
+  {
+    ScopedTimer      timer(getCounter(this->statistics, &OutputStatistics::writeTime));
+    ScopedTraceEvent traceEvent("write");
+
+    // The views are only taken now because the buffer can move while the access unit grows
+    this->nalUnitViews.clear();
+    auto nalData = accessUnit.data.data();
+    for (const auto size : accessUnit.nalUnitSizes)
+    {
+      this->nalUnitViews.push_back({nalData, size});
+      nalData += size;
+    }
+
+    const auto  timestamp = static_cast<uint32_t>(presentationTime) + this->timestampOffset;
+    const auto &packets   = this->packetizer.packetizeAccessUnit(this->nalUnitViews, timestamp);
+    this->socket.send(packets);
+    this->nrPackets += packets.size();
+
+    size_t bytesSent = 0;
+    for (const auto &range : packets.ranges)
+      bytesSent += range.size;
+    addToCounter(getCounter(this->statistics, &OutputStatistics::bytesWritten), bytesSent);
+  }
+
+  this->nrAccessUnits++;
+  // The buffer is cleared but keeps its capacity for the next access unit
+  accessUnit.data.clear();
+  accessUnit.nalUnitSizes.clear();
+  accessUnit.picture.reset();
+  accessUnit.inputTimestamps = {};
+}
+
+} // namespace combiner
@@ -0,0 +1,78 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+
+#include "NetworkAddress.h"
+#include "RTPPacketizerHEVC.h"
+#include "UdpSocket.h"
+
+#include <File/NalUnitSink.h>
+#include <HEVC/AccessUnitTiming.h>
+
+#include <chrono>
+#include <optional>
+#include <vector>
+
+namespace combiner
+{
+
+/* Sends the NAL units as RTP over UDP (RFC 7798) to a remote address. The NAL units are collected
+ * per access unit and all packets of an access unit are sent with one call. The written NAL units
+ * are appended to one buffer that is kept from access unit to access unit. The packets are
+ * gathered from views into this buffer. The RTP timestamp is
+ * the PTS from the input (if it has timestamps) or is calculated from the VUI timing and the POC
+ * of the picture. In real time mode, each access unit is sent at its decoding time relative to the
+ * first one. Otherwise everything is sent as fast as it is written.
+ */
+class RTPSinkHEVC : public NalUnitSink
+{
+public:
+  RTPSinkHEVC(const NetworkAddress &destination,
+              const bool            realTime       = true,
+              const size_t          maxPayloadSize = 1400);
+
+  void writeNALUnit(const ByteVector &nalData) override;
+  void writeNALUnitWithNewHeader(const ByteVector               &newHeader,
+                                 const ByteVector               &originalNalData,
+                                 const size_t                    nrReplacedBytes,
+                                 const std::optional<FileRange> &fileRange) override;
+  void setTimestampsOfNextNALUnits(const Timestamps &timestamps) override;
+  void finish() override;
+
+private:
+  struct AccessUnit
+  {
+    // The NAL units one after the other and the size of each of them
+    ByteVector                                             data;
+    std::vector<size_t>                                    nalUnitSizes;
+    std::optional<parser::hevc::AccessUnitTiming::Picture> picture{};
+    Timestamps                                             inputTimestamps{};
+  };
+
+  void addNALUnit(const ByteVector &nalStart,
+                  const ByteVector &originalNalData,
+                  const size_t      nrReplacedBytes);
+  void finishAccessUnit();
+
+  UdpSocket         socket;
+  RTPPacketizerHEVC packetizer;
+  bool              realTime{};
+
+  parser::hevc::AccessUnitTiming accessUnitTiming;
+
+  AccessUnit             currentAccessUnit;
+  std::vector<ByteRange> nalUnitViews;
+  Timestamps             nextTimestamps{};
+  uint64_t               nrAccessUnits{};
+  uint64_t               nrPackets{};
+
+  // RFC 3550 recommends a random start value for the RTP timestamps
+  uint32_t                                             timestampOffset{};
+  std::optional<std::chrono::steady_clock::time_point> startTime{};
+};
+
+} // namespace combiner
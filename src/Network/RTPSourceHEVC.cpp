@@ -0,0 +1,131 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include "RTPSourceHEVC.h"
+
+#include <common/Logger.h>
+
+#include <algorithm>
+
+namespace combiner
+{
+
+namespace
+{
+
+// Large enough for jumbo frames. Larger datagrams are dropped.
+constexpr size_t RECEIVE_BUFFER_SIZE  = 9216;
+constexpr size_t NR_RECEIVE_BUFFERS   = 64;
+constexpr auto   WAIT_FOR_FIRST_PACKET = std::chrono::milliseconds(-1);
+
+} // namespace
+
+RTPSourceHEVC::RTPSourceHEVC(const NetworkAddress &localAddress, std::chrono::milliseconds timeout)
+    : socket(UdpSocket::openReceiver(localAddress)), timeout(timeout),
+      bufferPool(RECEIVE_BUFFER_SIZE), depacketizer(bufferPool),
+      receiveBuffers(NR_RECEIVE_BUFFERS)
+{
+  logger().info("Waiting for RTP packets on " + localAddress.toString());
+}
+
+ByteVector RTPSourceHEVC::getNextNALUnit()
+{
+  while (!this->pendingNalUnit)
+  {
+    this->pendingNalUnit = this->depacketizer.getNextNalUnit();
+    if (this->pendingNalUnit)
+      break;
+    if (this->endOfStream)
+      return {};
+    this->receivePackets(this->receivedFirstPacket ? this->timeout : WAIT_FOR_FIRST_PACKET);
+  }
+
+  auto nalUnit = std::move(*this->pendingNalUnit);
+  this->pendingNalUnit.reset();
+  this->lastNALUnitSequenceNumber = nalUnit.sequenceNumber;
+  this->lastNALUnitTimestamp      = nalUnit.timestamp;
+  return std::move(nalUnit.data);
+}
+
+bool RTPSourceHEVC::waitForNALUnit(const std::chrono::milliseconds timeout)
+{
+  const auto deadline = std::chrono::steady_clock::now() + timeout;
+  auto       timedOut = false;
+  while (!this->pendingNalUnit && !this->endOfStream)
+  {
+    this->pendingNalUnit = this->depacketizer.getNextNalUnit();
+    if (this->pendingNalUnit)
+      break;
+    if (timedOut)
+      return false;
+
+    const auto remainingTime = std::chrono::duration_cast<std::chrono::milliseconds>(
+        deadline - std::chrono::steady_clock::now());
+    this->receivePackets(std::max(remainingTime, std::chrono::milliseconds(0)));
+    timedOut = (std::chrono::steady_clock::now() >= deadline);
+  }
+  return true;
+}
+
+void RTPSourceHEVC::receivePackets(const std::chrono::milliseconds waitTime)
+{
+  ScopedTraceEvent traceEvent("read", this->traceArguments);
+
+  // Buffers that were handed to the depacketizer are replaced from the pool
+  for (auto &buffer : this->receiveBuffers)
+    if (buffer.empty())
+      buffer = this->bufferPool.get();
+
+  const auto nrReceived = this->socket.receive(this->receiveBuffers, this->receivedSizes, waitTime);
+  const auto now        = std::chrono::steady_clock::now();
+  if (nrReceived == 0)
+  {
+    if (this->receivedFirstPacket && now - this->lastPacketTime >= this->timeout)
+    {
+      logger().info("No RTP packets received for " + std::to_string(this->timeout.count()) +
+                    " ms. End of stream.");
+      this->depacketizer.flush();
+      this->endOfStream = true;
+    }
+    return;
+  }
+
+  this->receivedFirstPacket = true;
+  this->lastPacketTime      = now;
+  uint64_t bytesRead        = 0;
+  for (size_t i = 0; i < nrReceived; ++i)
+  {
+    const auto size = this->receivedSizes.at(i);
+    if (size == 0)
+      continue;
+    bytesRead += size;
+    this->depacketizer.addPacket(std::move(this->receiveBuffers.at(i)), size);
+    this->receiveBuffers.at(i).clear();
+  }
+  this->totalBytesRead += bytesRead;
+  addToCounter(getCounter(this->statistics, &InputStatistics::bytesRead), bytesRead);
+}
+
+uint64_t RTPSourceHEVC::getFileOffsetOfLastNALUnit() const
+{
+  return this->lastNALUnitSequenceNumber;
+}
+
+Timestamps RTPSourceHEVC::getTimestampsOfLastNALUnit() const
+{
+  Timestamps timestamps;
+  timestamps.PTS = this->lastNALUnitTimestamp;
+  return timestamps;
+}
+
+void RTPSourceHEVC::setStatistics(InputStatistics *statistics)
+{
+  this->statistics = statistics;
+  // Count what was read before the statistics were set
+  addToCounter(getCounter(this->statistics, &InputStatistics::bytesRead), this->totalBytesRead);
+}
+
+} // namespace combiner
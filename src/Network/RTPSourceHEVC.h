@@ -0,0 +1,64 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+
+#include "BufferPool.h"
+#include "NetworkAddress.h"
+#include "RTPDepacketizerHEVC.h"
+#include "UdpSocket.h"
+
+#include <File/NalUnitSource.h>
+
+#include <chrono>
+#include <optional>
+
+namespace combiner
+{
+
+/* Receives an HEVC stream as RTP over UDP (RFC 7798) on a local address. The datagrams are received
+ * in batches into pooled buffers and passed through the depacketizer. The source waits for the
+ * first packet without a limit. After that, the stream is considered to have ended if no packet
+ * is received within the timeout. A NAL unit that was completed while waiting for one with a
+ * shorter timeout is kept until it is read.
+ * The "file offset" of a NAL unit is the extended RTP sequence number of the packet it started in.
+ * The RTP timestamp (90 kHz) is reported as the PTS.
+ */
+class RTPSourceHEVC : public NalUnitSource
+{
+public:
+  RTPSourceHEVC(const NetworkAddress    &localAddress,
+                std::chrono::milliseconds timeout = std::chrono::seconds(2));
+
+  ByteVector getNextNALUnit() override;
+  bool       waitForNALUnit(const std::chrono::milliseconds timeout) override;
+  uint64_t   getFileOffsetOfLastNALUnit() const override;
+  Timestamps getTimestampsOfLastNALUnit() const override;
+
+  void setStatistics(InputStatistics *statistics) override;
+
+private:
+  void receivePackets(const std::chrono::milliseconds waitTime);
+
+  UdpSocket                 socket;
+  std::chrono::milliseconds timeout{};
+
+  BufferPool              bufferPool;
+  RTPDepacketizerHEVC     depacketizer;
+  std::vector<ByteVector> receiveBuffers;
+  std::vector<size_t>     receivedSizes;
+
+  std::optional<RTPNalUnit>             pendingNalUnit{};
+  std::chrono::steady_clock::time_point lastPacketTime{};
+  bool                                  receivedFirstPacket{};
+  bool                                  endOfStream{};
+
+  uint64_t lastNALUnitSequenceNumber{};
+  uint64_t lastNALUnitTimestamp{};
+  uint64_t totalBytesRead{};
+};
+
+} // namespace combiner
@@ -0,0 +1,281 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include "UdpSocket.h"
+
+#include <common/Logger.h>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#ifndef _WIN32
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace combiner
+{
+
+#ifdef _WIN32
+
+UdpSocket UdpSocket::openReceiver(const NetworkAddress &)
+{
+  throw std::runtime_error("UDP sockets are not supported on Windows");
+}
+
+UdpSocket UdpSocket::openSender(const NetworkAddress &)
+{
+  throw std::runtime_error("UDP sockets are not supported on Windows");
+}
+
+UdpSocket::~UdpSocket() = default;
+
+size_t
+UdpSocket::receive(std::vector<ByteVector> &, std::vector<size_t> &, std::chrono::milliseconds)
+{
+  throw std::runtime_error("UDP sockets are not supported on Windows");
+}
+
+void UdpSocket::send(const uint8_t *, const size_t)
+{
+  throw std::runtime_error("UDP sockets are not supported on Windows");
+}
+
+void UdpSocket::send(const GatherDatagrams &)
+{
+  throw std::runtime_error("UDP sockets are not supported on Windows");
+}
+
+#else
+
+namespace
+{
+
+// A large receive buffer so that no datagrams are dropped while the combiner is busy
+constexpr int RECEIVE_BUFFER_SIZE = 4 * 1024 * 1024;
+
+std::string getErrorString()
+{
+  return std::string(std::strerror(errno));
+}
+
+int openSocket(const NetworkAddress &address, const bool bindToAddress)
+{
+  addrinfo hints{};
+  hints.ai_family   = AF_UNSPEC;
+  hints.ai_socktype = SOCK_DGRAM;
+  hints.ai_flags    = bindToAddress ? AI_PASSIVE : 0;
+
+  addrinfo  *addresses{};
+  const auto port   = std::to_string(address.port);
+  const auto result = getaddrinfo(address.host.c_str(), port.c_str(), &hints, &addresses);
+  if (result != 0)
+    throw std::runtime_error("Unable to resolve " + address.toString() + ": " +
+                             gai_strerror(result));
+
+  int fileDescriptor = -1;
+  for (auto info = addresses; info != nullptr; info = info->ai_next)
+  {
+    fileDescriptor = ::socket(info->ai_family, info->ai_socktype, info->ai_protocol);
+    if (fileDescriptor < 0)
+      continue;
+
+    const auto success = bindToAddress
+                             ? ::bind(fileDescriptor, info->ai_addr, info->ai_addrlen) == 0
+                             : ::connect(fileDescriptor, info->ai_addr, info->ai_addrlen) == 0;
+    if (success)
+      break;
+    ::close(fileDescriptor);
+    fileDescriptor = -1;
+  }
+  freeaddrinfo(addresses);
+
+  if (fileDescriptor < 0)
+    throw std::runtime_error("Unable to open a UDP socket for " + address.toString() + ": " +
+                             getErrorString());
+  return fileDescriptor;
+}
+
+} // namespace
+
+UdpSocket UdpSocket::openReceiver(const NetworkAddress &localAddress)
+{
+  const auto fileDescriptor = openSocket(localAddress, true);
+  // The kernel may limit the size. That is not an error.
+  ::setsockopt(fileDescriptor,
+               SOL_SOCKET,
+               SO_RCVBUF,
+               &RECEIVE_BUFFER_SIZE,
+               sizeof(RECEIVE_BUFFER_SIZE));
+  return UdpSocket(fileDescriptor);
+}
+
+UdpSocket UdpSocket::openSender(const NetworkAddress &remoteAddress)
+{
+  return UdpSocket(openSocket(remoteAddress, false));
+}
+
+UdpSocket::~UdpSocket()
+{
+  if (this->fileDescriptor >= 0)
+    ::close(this->fileDescriptor);
+}
+
+size_t UdpSocket::receive(std::vector<ByteVector>  &buffers,
+                          std::vector<size_t>      &sizes,
+                          std::chrono::milliseconds timeout)
+{
+  sizes.assign(buffers.size(), 0);
+  if (buffers.empty())
+    return 0;
+
+  pollfd pollDescriptor{};
+  pollDescriptor.fd     = this->fileDescriptor;
+  pollDescriptor.events = POLLIN;
+  const auto ready      = ::poll(&pollDescriptor, 1, static_cast<int>(timeout.count()));
+  if (ready < 0 && errno != EINTR)
+    throw std::runtime_error("Error waiting for UDP datagrams: " + getErrorString());
+  if (ready <= 0)
+    return 0;
+
+#ifdef __linux__
+  std::vector<iovec>   vectors(buffers.size());
+  std::vector<mmsghdr> messages(buffers.size());
+  for (size_t i = 0; i < buffers.size(); ++i)
+  {
+    vectors[i].iov_base            = buffers[i].data();
+    vectors[i].iov_len             = buffers[i].size();
+    messages[i].msg_hdr.msg_iov    = &vectors[i];
+    messages[i].msg_hdr.msg_iovlen = 1;
+  }
+
+  const auto nrReceived = ::recvmmsg(this->fileDescriptor,
+                                     messages.data(),
+                                     static_cast<unsigned>(messages.size()),
+                                     MSG_DONTWAIT,
+                                     nullptr);
+  if (nrReceived < 0)
+  {
+    if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+      return 0;
+    throw std::runtime_error("Error receiving UDP datagrams: " + getErrorString());
+  }
+
+  for (size_t i = 0; i < static_cast<size_t>(nrReceived); ++i)
+  {
+    if (messages[i].msg_hdr.msg_flags & MSG_TRUNC)
+      logger().warning("Dropped a UDP datagram that is larger than " +
+                       std::to_string(buffers[i].size()) + " bytes");
+    else
+      sizes[i] = messages[i].msg_len;
+  }
+  return static_cast<size_t>(nrReceived);
+#else
+  size_t nrReceived = 0;
+  for (; nrReceived < buffers.size(); ++nrReceived)
+  {
+    auto      &buffer = buffers[nrReceived];
+    const auto size   = ::recv(this->fileDescriptor,
+                             buffer.data(),
+                             buffer.size(),
+                             MSG_DONTWAIT | MSG_TRUNC);
+    if (size < 0)
+    {
+      if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+        break;
+      throw std::runtime_error("Error receiving UDP datagrams: " + getErrorString());
+    }
+    if (static_cast<size_t>(size) > buffer.size())
+      logger().warning("Dropped a UDP datagram that is larger than " +
+                       std::to_string(buffer.size()) + " bytes");
+    else
+      sizes[nrReceived] = static_cast<size_t>(size);
+  }
+  return nrReceived;
+#endif
+}
+
+void UdpSocket::send(const uint8_t *data, const size_t size)
+{
+  while (::send(this->fileDescriptor, data, size, 0) < 0)
+  {
+    // A receiver that is not (yet) listening causes ECONNREFUSED on connected sockets
+    if (errno == EINTR || errno == ECONNREFUSED)
+      continue;
+    throw std::runtime_error("Error sending UDP datagram: " + getErrorString());
+  }
+}
+
+void UdpSocket::send(const GatherDatagrams &datagrams)
+{
+  std::vector<iovec> vectors;
+  vectors.reserve(datagrams.ranges.size());
+  for (const auto &range : datagrams.ranges)
+    vectors.push_back({const_cast<uint8_t *>(range.data), range.size});
+
+#ifdef __linux__
+  std::vector<mmsghdr> messages(datagrams.size());
+  size_t               firstRange = 0;
+  for (size_t i = 0; i < datagrams.size(); ++i)
+  {
+    messages[i].msg_hdr.msg_iov    = vectors.data() + firstRange;
+    messages[i].msg_hdr.msg_iovlen = datagrams.nrRangesPerDatagram[i];
+    firstRange += datagrams.nrRangesPerDatagram[i];
+  }
+
+  size_t nrSent = 0;
+  while (nrSent < messages.size())
+  {
+    const auto result = ::sendmmsg(this->fileDescriptor,
+                                   messages.data() + nrSent,
+                                   static_cast<unsigned>(messages.size() - nrSent),
+                                   0);
+    if (result < 0)
+    {
+      if (errno == EINTR || errno == ECONNREFUSED)
+        continue;
+      throw std::runtime_error("Error sending UDP datagrams: " + getErrorString());
+    }
+    nrSent += static_cast<size_t>(result);
+  }
+#else
+  size_t firstRange = 0;
+  for (const auto nrRanges : datagrams.nrRangesPerDatagram)
+  {
+    msghdr message{};
+    message.msg_iov    = vectors.data() + firstRange;
+    message.msg_iovlen = static_cast<int>(nrRanges);
+    while (::sendmsg(this->fileDescriptor, &message, 0) < 0)
+    {
+      if (errno == EINTR || errno == ECONNREFUSED)
+        continue;
+      throw std::runtime_error("Error sending UDP datagram: " + getErrorString());
+    }
+    firstRange += nrRanges;
+  }
+#endif
+}
+
+#endif
+
+UdpSocket::UdpSocket(UdpSocket &&other) : fileDescriptor(other.fileDescriptor)
+{
+  other.fileDescriptor = -1;
+}
+
+UdpSocket &UdpSocket::operator=(UdpSocket &&other)
+{
+  std::swap(this->fileDescriptor, other.fileDescriptor);
+  return *this;
+}
+
+} // namespace combiner
@@ -0,0 +1,63 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+
+#include "NetworkAddress.h"
+
+#include <File/OutputFile.h>
+#include <common/Typedef.h>
+
+#include <chrono>
+#include <vector>
+
+namespace combiner
+{
+
+// Datagrams that are gathered from byte ranges. Each datagram consists of the next ranges.
+struct GatherDatagrams
+{
+  std::vector<ByteRange> ranges;
+  std::vector<size_t>    nrRangesPerDatagram;
+
+  size_t size() const { return this->nrRangesPerDatagram.size(); }
+};
+
+/* A UDP socket that either receives on a local address or sends to a remote address.
+ * Datagrams are received in batches (with recvmmsg on Linux) into buffers that are provided by the
+ * caller. Datagrams are sent in batches (with sendmmsg on Linux) gathered from byte ranges.
+ * UDP sockets are currently only supported on POSIX systems.
+ */
+class UdpSocket
+{
+public:
+  static UdpSocket openReceiver(const NetworkAddress &localAddress);
+  static UdpSocket openSender(const NetworkAddress &remoteAddress);
+
+  ~UdpSocket();
+  UdpSocket(UdpSocket &&other);
+  UdpSocket &operator=(UdpSocket &&other);
+  UdpSocket(const UdpSocket &)            = delete;
+  UdpSocket &operator=(const UdpSocket &) = delete;
+
+  // Wait up to the timeout for datagrams and receive as many as there are buffers. The size of
+  // each received datagram is set in sizes (0 for datagrams that did not fit into the buffer).
+  // Returns the number of received datagrams (0 if the timeout expired).
+  size_t receive(std::vector<ByteVector>  &buffers,
+                 std::vector<size_t>      &sizes,
+                 std::chrono::milliseconds timeout);
+
+  void send(const uint8_t *data, const size_t size);
+  // Send all datagrams (in batches with sendmmsg on Linux)
+  void send(const GatherDatagrams &datagrams);
+
+private:
+  UdpSocket(const int fileDescriptor) : fileDescriptor(fileDescriptor) {}
+
+  int fileDescriptor{-1};
+};
+
+} // namespace combiner
@@ -0,0 +1,368 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include "JSONObject.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <stdexcept>
+
+namespace combiner
+{
+
+namespace
+{
+
+class Reader
+{
+public:
+  Reader(const std::string &text) : text(text) {}
+
+  void skipWhitespace()
+  {
+    while (this->position < this->text.size() &&
+           (this->text[this->position] == ' ' || this->text[this->position] == '\t' ||
+            this->text[this->position] == '\n' || this->text[this->position] == '\r'))
+      ++this->position;
+  }
+
+  char peek()
+  {
+    this->skipWhitespace();
+    if (this->position >= this->text.size())
+      throw std::invalid_argument("Unexpected end of the JSON text");
+    return this->text[this->position];
+  }
+
+  void expect(const char character)
+  {
+    if (this->peek() != character)
+      throw std::invalid_argument(std::string("Expected '") + character + "' at position " +
+                                  std::to_string(this->position) + " of the JSON text");
+    ++this->position;
+  }
+
+  bool isAtEnd()
+  {
+    this->skipWhitespace();
+    return this->position >= this->text.size();
+  }
+
+  std::string readString()
+  {
+    this->expect('"');
+    std::string value;
+    while (true)
+    {
+      if (this->position >= this->text.size())
+        throw std::invalid_argument("Unterminated string in the JSON text");
+      const auto character = this->text[this->position++];
+      if (character == '"')
+        return value;
+      if (character != '\\')
+      {
+        value += character;
+        continue;
+      }
+
+      if (this->position >= this->text.size())
+        throw std::invalid_argument("Unterminated string in the JSON text");
+      const auto escaped = this->text[this->position++];
+      switch (escaped)
+      {
+      case 'n':
+        value += '\n';
+        break;
+      case 't':
+        value += '\t';
+        break;
+      case 'r':
+        value += '\r';
+        break;
+      case 'b':
+        value += '\b';
+        break;
+      case 'f':
+        value += '\f';
+        break;
+      case 'u':
+        value += this->readUnicodeEscape();
+        break;
+      default:
+        value += escaped;
+      }
+    }
+  }
+
+  bool readBool()
+  {
+    this->skipWhitespace();
+    for (const auto value : {true, false})
+    {
+      const std::string literal = value ? "true" : "false";
+      if (this->text.compare(this->position, literal.size(), literal) == 0)
+      {
+        this->position += literal.size();
+        return value;
+      }
+    }
+    throw std::invalid_argument("Invalid value at position " + std::to_string(this->position) +
+                                " of the JSON text");
+  }
+
+  double readNumber()
+  {
+    this->skipWhitespace();
+    const auto start = this->position;
+    while (this->position < this->text.size() &&
+           std::string("+-.0123456789eE").find(this->text[this->position]) != std::string::npos)
+      ++this->position;
+    try
+    {
+      size_t     nrCharacters{};
+      const auto number =
+          std::stod(this->text.substr(start, this->position - start), &nrCharacters);
+      if (nrCharacters == this->position - start)
+        return number;
+    }
+    catch (const std::exception &)
+    {
+    }
+    throw std::invalid_argument("Invalid value at position " + std::to_string(start) +
+                                " of the JSON text");
+  }
+
+private:
+  // Code points are encoded as UTF-8. Surrogate pairs are not combined.
+  std::string readUnicodeEscape()
+  {
+    if (this->position + 4 > this->text.size())
+      throw std::invalid_argument("Invalid unicode escape in the JSON text");
+    const auto codePoint = std::stoul(this->text.substr(this->position, 4), nullptr, 16);
+    this->position += 4;
+
+    std::string utf8;
+    if (codePoint < 0x80)
+      utf8 += char(codePoint);
+    else if (codePoint < 0x800)
+    {
+      utf8 += char(0xC0 | (codePoint >> 6));
+      utf8 += char(0x80 | (codePoint & 0x3F));
+    }
+    else
+    {
+      utf8 += char(0xE0 | (codePoint >> 12));
+      utf8 += char(0x80 | ((codePoint >> 6) & 0x3F));
+      utf8 += char(0x80 | (codePoint & 0x3F));
+    }
+    return utf8;
+  }
+
+  const std::string &text;
+  size_t             position{};
+};
+
+} // namespace
+
+JSONObject JSONObject::parse(const std::string &text)
+{
+  JSONObject object;
+  Reader     reader(text);
+
+  reader.expect('{');
+  if (reader.peek() == '}')
+    reader.expect('}');
+  else
+  {
+    while (true)
+    {
+      const auto key = reader.readString();
+      reader.expect(':');
+
+      const auto next = reader.peek();
+      if (next == '"')
+        object.setString(key, reader.readString());
+      else if (next == '[')
+      {
+        reader.expect('[');
+        std::vector<std::string> values;
+        if (reader.peek() == ']')
+          reader.expect(']');
+        else
+        {
+          while (true)
+          {
+            values.push_back(reader.readString());
+            if (reader.peek() == ']')
+            {
+              reader.expect(']');
+              break;
+            }
+            reader.expect(',');
+          }
+        }
+        object.setStringArray(key, values);
+      }
+      else if (next == 't' || next == 'f')
+        object.setBool(key, reader.readBool());
+      else
+        object.setNumber(key, reader.readNumber());
+
+      if (reader.peek() == '}')
+      {
+        reader.expect('}');
+        break;
+      }
+      reader.expect(',');
+    }
+  }
+
+  if (!reader.isAtEnd())
+    throw std::invalid_argument("Unexpected text after the JSON object");
+  return object;
+}
+
+std::optional<std::string> JSONObject::getString(const std::string &key) const
+{
+  if (const auto it = this->strings.find(key); it != this->strings.end())
+    return it->second;
+  return {};
+}
+
+std::optional<double> JSONObject::getNumber(const std::string &key) const
+{
+  if (const auto it = this->numbers.find(key); it != this->numbers.end())
+    return it->second;
+  return {};
+}
+
+std::optional<bool> JSONObject::getBool(const std::string &key) const
+{
+  if (const auto it = this->bools.find(key); it != this->bools.end())
+    return it->second;
+  return {};
+}
+
+std::vector<std::string> JSONObject::getStringArray(const std::string &key) const
+{
+  if (const auto it = this->stringArrays.find(key); it != this->stringArrays.end())
+    return it->second;
+  return {};
+}
+
+JSONObject &JSONObject::setString(const std::string &key, const std::string &value)
+{
+  this->setMember(key, toJSONString(value));
+  this->strings[key] = value;
+  return *this;
+}
+
+JSONObject &JSONObject::setNumber(const std::string &key, const double value)
+{
+  this->setMember(key, toJSONNumber(value));
+  this->numbers[key] = value;
+  return *this;
+}
+
+JSONObject &JSONObject::setBool(const std::string &key, const bool value)
+{
+  this->setMember(key, value ? "true" : "false");
+  this->bools[key] = value;
+  return *this;
+}
+
+JSONObject &JSONObject::setStringArray(const std::string              &key,
+                                       const std::vector<std::string> &values)
+{
+  std::string json = "[";
+  for (const auto &value : values)
+    json += (json.size() > 1 ? ", " : "") + toJSONString(value);
+  this->setMember(key, json + "]");
+  this->stringArrays[key] = values;
+  return *this;
+}
+
+JSONObject &JSONObject::setJSON(const std::string &key, const std::string &json)
+{
+  this->setMember(key, json);
+  return *this;
+}
+
+std::string JSONObject::toString() const
+{
+  std::string json = "{";
+  for (const auto &[key, value] : this->members)
+    json += (json.size() > 1 ? ", " : "") + toJSONString(key) + ": " + value;
+  return json + "}";
+}
+
+void JSONObject::setMember(const std::string &key, const std::string &json)
+{
+  this->strings.erase(key);
+  this->numbers.erase(key);
+  this->bools.erase(key);
+  this->stringArrays.erase(key);
+
+  for (auto &member : this->members)
+  {
+    if (member.first == key)
+    {
+      member.second = json;
+      return;
+    }
+  }
+  this->members.emplace_back(key, json);
+}
+
+std::string toJSONString(const std::string &value)
+{
+  std::string json = "\"";
+  for (const auto character : value)
+  {
+    switch (character)
+    {
+    case '"':
+      json += "\\\"";
+      break;
+    case '\\':
+      json += "\\\\";
+      break;
+    case '\n':
+      json += "\\n";
+      break;
+    case '\r':
+      json += "\\r";
+      break;
+    case '\t':
+      json += "\\t";
+      break;
+    default:
+      if (static_cast<unsigned char>(character) < 0x20)
+      {
+        char escaped[8];
+        std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(character));
+        json += escaped;
+      }
+      else
+        json += character;
+    }
+  }
+  return json + "\"";
+}
+
+std::string toJSONNumber(const double value)
+{
+  // Doubles represent all integers up to 2^53 exactly
+  if (value == std::trunc(value) && std::abs(value) <= 9007199254740992.0)
+    return std::to_string(static_cast<int64_t>(value));
+
+  char number[32];
+  std::snprintf(number, sizeof(number), "%.17g", value);
+  return number;
+}
+
+} // namespace combiner
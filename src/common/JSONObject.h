@@ -0,0 +1,61 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+
+#include <map>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace combiner
+{
+
+/* A flat JSON object like the requests and responses of the control socket. The values can be
+ * strings, numbers, booleans or arrays of strings. Nested objects and null are not supported when
+ * parsing. An object that is written can contain values that already are JSON text (setJSON).
+ */
+class JSONObject
+{
+public:
+  // Throws std::invalid_argument if the text is no such object
+  static JSONObject parse(const std::string &text);
+
+  std::optional<std::string> getString(const std::string &key) const;
+  std::optional<double>      getNumber(const std::string &key) const;
+  std::optional<bool>        getBool(const std::string &key) const;
+  std::vector<std::string>   getStringArray(const std::string &key) const;
+
+  // Setting a key again replaces its value. The members are written in the order they were added.
+  JSONObject &setString(const std::string &key, const std::string &value);
+  JSONObject &setNumber(const std::string &key, const double value);
+  JSONObject &setBool(const std::string &key, const bool value);
+  JSONObject &setStringArray(const std::string &key, const std::vector<std::string> &values);
+  // The value is JSON text (like a nested object) that is written as it is
+  JSONObject &setJSON(const std::string &key, const std::string &json);
+
+  // The object in one line like {"ok": true, "job": 1}
+  std::string toString() const;
+
+private:
+  void setMember(const std::string &key, const std::string &json);
+
+  std::map<std::string, std::string>              strings;
+  std::map<std::string, double>                   numbers;
+  std::map<std::string, bool>                     bools;
+  std::map<std::string, std::vector<std::string>> stringArrays;
+
+  // The values of all members as JSON text
+  std::vector<std::pair<std::string, std::string>> members;
+};
+
+// The value as a quoted JSON string with all special characters escaped
+std::string toJSONString(const std::string &value);
+// Integral values are written without a fraction
+std::string toJSONNumber(const double value);
+
+} // namespace combiner
@@ -0,0 +1,159 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include "Logger.h"
+
+#include <cstring>
+#include <ctime>
+#include <iomanip>
+#include <sstream>
+
+namespace combiner
+{
+
+namespace
+{
+
+constexpr auto WRITER_THREAD_IDLE_TIME = std::chrono::milliseconds(10);
+
+std::string formatTime(const std::chrono::system_clock::time_point time)
+{
+  const auto timeT        = std::chrono::system_clock::to_time_t(time);
+  const auto milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(
+                                time.time_since_epoch())
+                                .count() %
+                            1000;
+
+  std::ostringstream stream;
+  stream << std::put_time(std::localtime(&timeT), "%H:%M:%S") << "." << std::setfill('0')
+         << std::setw(3) << milliseconds;
+  return stream.str();
+}
+
+} // namespace
+
+Logger::Logger(std::ostream &outputStream, const LogLevel level)
+    : outputStream(outputStream), level(level), ringBuffer(RING_BUFFER_SIZE)
+{
+  for (size_t i = 0; i < RING_BUFFER_SIZE; ++i)
+    this->ringBuffer[i].sequence.store(i, std::memory_order_relaxed);
+
+  this->writerThread = std::thread(&Logger::runWriterThread, this);
+}
+
+Logger::~Logger()
+{
+  this->stopWriterThread = true;
+  this->writerThread.join();
+}
+
+void Logger::setLevel(const LogLevel level)
+{
+  this->level.store(level, std::memory_order_relaxed);
+}
+
+LogLevel Logger::getLevel() const
+{
+  return this->level.load(std::memory_order_relaxed);
+}
+
+bool Logger::isEnabled(const LogLevel level) const
+{
+  return level >= this->level.load(std::memory_order_relaxed);
+}
+
+void Logger::log(const LogLevel level, const std::string &message)
+{
+  if (!this->isEnabled(level))
+    return;
+
+  auto position = this->writePosition.load(std::memory_order_relaxed);
+  while (true)
+  {
+    auto      &slot       = this->ringBuffer[position % RING_BUFFER_SIZE];
+    const auto sequence   = slot.sequence.load(std::memory_order_acquire);
+    const auto difference = static_cast<std::ptrdiff_t>(sequence - position);
+    if (difference == 0)
+    {
+      if (this->writePosition.compare_exchange_weak(
+              position, position + 1, std::memory_order_relaxed))
+      {
+        slot.level  = level;
+        slot.time   = std::chrono::system_clock::now();
+        slot.length = message.size();
+        if (slot.length <= MAX_MESSAGE_LENGTH)
+          std::memcpy(slot.text.data(), message.data(), slot.length);
+        else
+          slot.longText = message;
+        slot.sequence.store(position + 1, std::memory_order_release);
+        return;
+      }
+    }
+    else if (difference < 0)
+    {
+      this->droppedMessages.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    else
+      position = this->writePosition.load(std::memory_order_relaxed);
+  }
+}
+
+void Logger::flush()
+{
+  const auto position = this->writePosition.load(std::memory_order_acquire);
+  while (this->readPosition.load(std::memory_order_acquire) < position)
+    std::this_thread::sleep_for(WRITER_THREAD_IDLE_TIME / 10);
+  this->outputStream.flush();
+}
+
+bool Logger::writeNextMessage()
+{
+  const auto position = this->readPosition.load(std::memory_order_relaxed);
+  auto      &slot     = this->ringBuffer[position % RING_BUFFER_SIZE];
+  if (slot.sequence.load(std::memory_order_acquire) != position + 1)
+    return false;
+
+  if (const auto dropped = this->droppedMessages.exchange(0, std::memory_order_relaxed))
+    this->outputStream << formatTime(slot.time) << " WARNING Dropped " << dropped
+                       << " log messages.\n";
+
+  this->outputStream << formatTime(slot.time) << " " << LogLevelMapper.getText(slot.level) << " ";
+  if (slot.length <= MAX_MESSAGE_LENGTH)
+    this->outputStream.write(slot.text.data(), static_cast<std::streamsize>(slot.length));
+  else
+  {
+    this->outputStream << slot.longText;
+    slot.longText.clear();
+  }
+  this->outputStream << "\n";
+
+  slot.sequence.store(position + RING_BUFFER_SIZE, std::memory_order_release);
+  this->readPosition.store(position + 1, std::memory_order_release);
+  return true;
+}
+
+void Logger::runWriterThread()
+{
+  while (true)
+  {
+    if (this->writeNextMessage())
+      continue;
+
+    this->outputStream.flush();
+    if (this->stopWriterThread)
+      return;
+    std::this_thread::sleep_for(WRITER_THREAD_IDLE_TIME);
+  }
+}
+
+Logger &logger()
+{
+  static Logger processLogger;
+  return processLogger;
+}
+
+} // namespace combiner
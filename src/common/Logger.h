@@ -0,0 +1,92 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+
+#include <common/EnumMapper.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace combiner
+{
+
+enum class LogLevel
+{
+  Debug,
+  Info,
+  Warning,
+  Error
+};
+
+const EnumMapper<LogLevel> LogLevelMapper({{LogLevel::Debug, "debug", "DEBUG"},
+                                           {LogLevel::Info, "info", "INFO"},
+                                           {LogLevel::Warning, "warning", "WARNING"},
+                                           {LogLevel::Error, "error", "ERROR"}});
+
+/* An asynchronous logger. Logging a message only copies it into a slot of a lock free ring buffer
+ * (multiple producers, one consumer). A background thread takes the messages out of the ring
+ * buffer and writes them to the output stream. If the ring buffer is full, the message is dropped
+ * and the number of dropped messages is reported with the next written message. Messages that are
+ * longer than the text of a slot are copied to the heap instead of being cut off.
+ */
+class Logger
+{
+public:
+  Logger(std::ostream &outputStream = std::cout, const LogLevel level = LogLevel::Info);
+  ~Logger();
+
+  void     setLevel(const LogLevel level);
+  LogLevel getLevel() const;
+  bool     isEnabled(const LogLevel level) const;
+
+  void log(const LogLevel level, const std::string &message);
+  void debug(const std::string &message) { this->log(LogLevel::Debug, message); }
+  void info(const std::string &message) { this->log(LogLevel::Info, message); }
+  void warning(const std::string &message) { this->log(LogLevel::Warning, message); }
+  void error(const std::string &message) { this->log(LogLevel::Error, message); }
+
+  // Block until all messages that were logged so far are written to the output stream.
+  void flush();
+
+private:
+  static constexpr size_t RING_BUFFER_SIZE   = 1024;
+  static constexpr size_t MAX_MESSAGE_LENGTH = 240;
+
+  struct Slot
+  {
+    std::atomic<size_t>                   sequence{};
+    LogLevel                              level{};
+    std::chrono::system_clock::time_point time{};
+    size_t                                length{};
+    std::array<char, MAX_MESSAGE_LENGTH>  text{};
+    std::string                           longText;
+  };
+
+  bool writeNextMessage();
+  void runWriterThread();
+
+  std::ostream         &outputStream;
+  std::atomic<LogLevel> level{};
+
+  std::vector<Slot>   ringBuffer;
+  std::atomic<size_t> writePosition{};
+  std::atomic<size_t> readPosition{};
+  std::atomic<size_t> droppedMessages{};
+
+  std::atomic<bool> stopWriterThread{false};
+  std::thread       writerThread;
+};
+
+// The process wide logger. Messages are written to std::cout.
+Logger &logger();
+
+} // namespace combiner
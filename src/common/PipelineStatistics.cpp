@@ -0,0 +1,158 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include "PipelineStatistics.h"
+
+#include <common/Logger.h>
+
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+namespace combiner
+{
+
+namespace
+{
+
+double toSeconds(const Counter &nanoseconds)
+{
+  return static_cast<double>(nanoseconds.load(std::memory_order_relaxed)) / 1e9;
+}
+
+uint64_t toValue(const Counter &counter)
+{
+  return counter.load(std::memory_order_relaxed);
+}
+
+void tryWriteJSON(const PipelineStatistics &statistics, const std::filesystem::path &filePath)
+{
+  try
+  {
+    statistics.writeJSON(filePath);
+  }
+  catch (const std::exception &e)
+  {
+    logger().error("Error writing statistics: " + std::string(e.what()));
+  }
+}
+
+} // namespace
+
+PipelineStatistics::PipelineStatistics(const size_t nrInputs, const size_t nrOutputs)
+    : inputs(nrInputs), outputs(nrOutputs)
+{
+}
+
+InputStatistics &PipelineStatistics::getInput(const size_t inputIndex)
+{
+  return this->inputs.at(inputIndex);
+}
+
+OutputStatistics &PipelineStatistics::getOutput(const size_t outputIndex)
+{
+  return this->outputs.at(outputIndex);
+}
+
+std::string PipelineStatistics::toJSON() const
+{
+  const auto elapsedTime = std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                                         this->startTime);
+
+  std::ostringstream json;
+  json << std::fixed << std::setprecision(6);
+  json << "{\n";
+  json << "  \"elapsedSeconds\": " << elapsedTime.count() << ",\n";
+  json << "  \"inputs\": [";
+  for (size_t i = 0; i < this->inputs.size(); ++i)
+  {
+    const auto &input = this->inputs.at(i);
+    json << (i == 0 ? "\n" : ",\n");
+    json << "    {\n";
+    json << "      \"index\": " << i << ",\n";
+    json << "      \"bytesRead\": " << toValue(input.bytesRead) << ",\n";
+    json << "      \"nalUnits\": " << toValue(input.nrNalUnits) << ",\n";
+    json << "      \"accessUnits\": " << toValue(input.nrAccessUnits) << ",\n";
+    json << "      \"startCodeScanSeconds\": " << toSeconds(input.startCodeScanTime) << ",\n";
+    json << "      \"headerParseSeconds\": " << toSeconds(input.headerParseTime) << ",\n";
+    json << "      \"headerRewriteSeconds\": " << toSeconds(input.headerRewriteTime) << ",\n";
+    json << "      \"readSeconds\": " << toSeconds(input.readTime) << ",\n";
+    json << "      \"lockstepWaitSeconds\": " << toSeconds(input.lockstepWaitTime) << ",\n";
+    json << "      \"bytesWritten\": " << toValue(input.bytesWritten) << ",\n";
+    json << "      \"switches\": " << toValue(input.nrSwitches) << ",\n";
+    json << "      \"skipSlices\": " << toValue(input.nrSkipSlices) << ",\n";
+    json << "      \"slateSlices\": " << toValue(input.nrSlateSlices) << ",\n";
+    json << "      \"droppedNalUnits\": " << toValue(input.nrDroppedNalUnits) << "\n";
+    json << "    }";
+  }
+  json << "\n  ],\n";
+  json << "  \"outputs\": [";
+  for (size_t i = 0; i < this->outputs.size(); ++i)
+  {
+    const auto &output = this->outputs.at(i);
+    json << (i == 0 ? "\n" : ",\n");
+    json << "    {\n";
+    json << "      \"index\": " << i << ",\n";
+    json << "      \"bytesWritten\": " << toValue(output.bytesWritten) << ",\n";
+    json << "      \"nalUnits\": " << toValue(output.nrNalUnits) << ",\n";
+    json << "      \"bytesCopiedFromInputs\": " << toValue(output.bytesCopiedFromInputs) << ",\n";
+    json << "      \"writeSeconds\": " << toSeconds(output.writeTime) << ",\n";
+    json << "      \"queueDepth\": " << toValue(output.queueDepth) << ",\n";
+    json << "      \"droppedNalUnits\": " << toValue(output.nrDroppedNalUnits) << ",\n";
+    json << "      \"droppedPictures\": " << toValue(output.nrDroppedPictures) << "\n";
+    json << "    }";
+  }
+  json << "\n  ]\n";
+  json << "}\n";
+  return json.str();
+}
+
+void PipelineStatistics::writeJSON(const std::filesystem::path &filePath) const
+{
+  // Write to a temporary file first so that a reader never sees a partially written report.
+  auto temporaryPath = filePath;
+  temporaryPath += ".tmp";
+  {
+    std::ofstream file(temporaryPath);
+    if (!file.is_open())
+      throw std::runtime_error("Error opening statistics file " + temporaryPath.string());
+    file << this->toJSON();
+  }
+  std::filesystem::rename(temporaryPath, filePath);
+}
+
+StatisticsFileWriter::StatisticsFileWriter(const PipelineStatistics       &statistics,
+                                           const std::filesystem::path    &filePath,
+                                           const std::chrono::milliseconds interval)
+    : statistics(statistics), filePath(filePath), interval(interval)
+{
+  if (this->interval.count() > 0)
+    this->writerThread = std::thread(&StatisticsFileWriter::runWriterThread, this);
+}
+
+StatisticsFileWriter::~StatisticsFileWriter()
+{
+  if (this->writerThread.joinable())
+  {
+    {
+      std::lock_guard<std::mutex> lock(this->mutex);
+      this->stop = true;
+    }
+    this->stopCondition.notify_one();
+    this->writerThread.join();
+  }
+  tryWriteJSON(this->statistics, this->filePath);
+}
+
+void StatisticsFileWriter::runWriterThread()
+{
+  std::unique_lock<std::mutex> lock(this->mutex);
+  while (!this->stopCondition.wait_for(lock, this->interval, [this]() { return this->stop; }))
+    tryWriteJSON(this->statistics, this->filePath);
+}
+
+} // namespace combiner
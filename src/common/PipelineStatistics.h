@@ -0,0 +1,154 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace combiner
+{
+
+using Counter = std::atomic<uint64_t>;
+
+// All times are counted in nanoseconds.
+struct InputStatistics
+{
+  Counter bytesRead{};
+  Counter nrNalUnits{};
+  Counter nrAccessUnits{};
+  Counter startCodeScanTime{};
+  Counter headerParseTime{};
+  Counter headerRewriteTime{};
+  // The time spent reading (and parsing) the input and the time its NAL units then waited for the
+  // other inputs of the lockstep
+  Counter readTime{};
+  Counter lockstepWaitTime{};
+  Counter bytesWritten{};
+  // How often the source of the input was replaced while combining
+  Counter nrSwitches{};
+  // The slices that were generated for the input while it was stalled or after it ended
+  Counter nrSkipSlices{};
+  // The slate slices that were sent for the input before it started
+  Counter nrSlateSlices{};
+  // The NAL units above the highest TemporalId that were dropped without parsing them
+  Counter nrDroppedNalUnits{};
+};
+
+struct OutputStatistics
+{
+  Counter bytesWritten{};
+  Counter nrNalUnits{};
+  Counter writeTime{};
+  // The part of bytesWritten that was copied from the input files by the kernel
+  Counter bytesCopiedFromInputs{};
+  // Only for the outputs of a fan out: The NAL units (and timestamps) that currently wait in the
+  // queue of the output and the NAL units and pictures that were dropped because the output could
+  // not keep up
+  Counter queueDepth{};
+  Counter nrDroppedNalUnits{};
+  Counter nrDroppedPictures{};
+};
+
+/* Counters and timers for all stages of the combination. The stages get a pointer to their
+ * counters. If statistics are disabled, the pointer is null and nothing is counted.
+ * All counters are atomic so that they can be read (exported) while the combination is running.
+ */
+class PipelineStatistics
+{
+public:
+  // With a fan out, every output of it has its own statistics
+  PipelineStatistics(const size_t nrInputs, const size_t nrOutputs = 1);
+
+  InputStatistics  &getInput(const size_t inputIndex);
+  OutputStatistics &getOutput(const size_t outputIndex = 0);
+
+  std::string toJSON() const;
+  void        writeJSON(const std::filesystem::path &filePath) const;
+
+private:
+  std::chrono::steady_clock::time_point startTime{std::chrono::steady_clock::now()};
+  std::deque<InputStatistics>           inputs;
+  std::deque<OutputStatistics>          outputs;
+};
+
+// Add the time between construction and destruction to the counter (if the counter is set).
+class ScopedTimer
+{
+public:
+  ScopedTimer(Counter *counter) : counter(counter)
+  {
+    if (this->counter != nullptr)
+      this->start = std::chrono::steady_clock::now();
+  }
+  ~ScopedTimer()
+  {
+    if (this->counter != nullptr)
+      this->counter->fetch_add(
+          static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                    std::chrono::steady_clock::now() - this->start)
+                                    .count()),
+          std::memory_order_relaxed);
+  }
+
+private:
+  Counter                              *counter{};
+  std::chrono::steady_clock::time_point start{};
+};
+
+// Get the counter from the statistics or null if the statistics are disabled (null).
+template <typename Statistics>
+Counter *getCounter(Statistics *statistics, Counter Statistics::*counter)
+{
+  if (statistics == nullptr)
+    return nullptr;
+  return &(statistics->*counter);
+}
+
+inline void addToCounter(Counter *counter, const uint64_t value)
+{
+  if (counter != nullptr)
+    counter->fetch_add(value, std::memory_order_relaxed);
+}
+
+inline void setCounter(Counter *counter, const uint64_t value)
+{
+  if (counter != nullptr)
+    counter->store(value, std::memory_order_relaxed);
+}
+
+/* Writes the statistics to a JSON file every interval (if an interval is set) and once more when
+ * it is destructed.
+ */
+class StatisticsFileWriter
+{
+public:
+  StatisticsFileWriter(const PipelineStatistics       &statistics,
+                       const std::filesystem::path    &filePath,
+                       const std::chrono::milliseconds interval);
+  ~StatisticsFileWriter();
+
+private:
+  void runWriterThread();
+
+  const PipelineStatistics       &statistics;
+  const std::filesystem::path     filePath;
+  const std::chrono::milliseconds interval;
+
+  std::mutex              mutex;
+  std::condition_variable stopCondition;
+  bool                    stop{false};
+  std::thread             writerThread;
+};
+
+} // namespace combiner
@@ -14,7 +14,8 @@ namespace combiner::parser
 {
 
 SubByteReader::SubByteReader(const ByteVector &inArr, size_t inArrOffset)
-    : byteVector(inArr), posInBufferBytes(inArrOffset), initialPosInBuffer(inArrOffset){};
+    : data(inArr.data()), dataSize(inArr.size()), posInBufferBytes(inArrOffset),
+      initialPosInBuffer(inArrOffset){};
 
 bool SubByteReader::readFlag()
 {
@@ -67,7 +68,7 @@ uint64_t SubByteReader::readBits(size_t nrBits)
     // Shift output value so that the new bits fit
     out = out << readBits;
 
-    char c   = this->byteVector[this->posInBufferBytes];
+    char c   = this->data[this->posInBufferBytes];
     c        = c >> offset;
     int mask = ((1 << readBits) - 1);
 
@@ -96,7 +97,7 @@ ByteVector SubByteReader::readBytes(size_t nrBytes)
   ByteVector retVector;
   for (unsigned i = 0; i < nrBytes; i++)
   {
-    auto c = this->byteVector[this->posInBufferBytes];
+    auto c = this->data[this->posInBufferBytes];
     retVector.push_back(c);
 
     if (!this->gotoNextByte())
@@ -234,7 +235,7 @@ bool SubByteReader::more_rbsp_data() const
   else if (posBits != 0)
   {
     // Check the remainder of the current byte
-    unsigned char c = this->byteVector[posBytes];
+    unsigned char c = this->data[posBytes];
     if (c & (1 << (7 - posBits)))
       terminatingBitFound = true;
     else
@@ -249,9 +250,9 @@ bool SubByteReader::more_rbsp_data() const
     }
     posBytes++;
   }
-  while (posBytes < (unsigned int)this->byteVector.size())
+  while (posBytes < (unsigned int)this->dataSize)
   {
-    unsigned char c = this->byteVector[posBytes];
+    unsigned char c = this->data[posBytes];
     if (terminatingBitFound && c != 0)
       return true;
     else if (!terminatingBitFound && (c == 128))
@@ -285,13 +286,13 @@ bool SubByteReader::payload_extension_present() const
 
 bool SubByteReader::canReadBits(unsigned nrBits) const
 {
-  if (this->posInBufferBytes == this->byteVector.size())
+  if (this->posInBufferBytes == this->dataSize)
     return false;
 
   assert(this->posInBufferBits <= 8);
   const auto curBitsLeft = 8 - this->posInBufferBits;
-  assert(this->byteVector.size() > this->posInBufferBytes);
-  const auto entireBytesLeft  = this->byteVector.size() - this->posInBufferBytes - 1;
+  assert(this->dataSize > this->posInBufferBytes);
+  const auto entireBytesLeft  = this->dataSize - this->posInBufferBytes - 1;
   const auto nrBitsLeftToRead = curBitsLeft + entireBytesLeft * 8;
 
   return nrBits <= nrBitsLeftToRead;
@@ -309,9 +310,9 @@ size_t SubByteReader::nrBytesRead() const
 
 size_t SubByteReader::nrBytesLeft() const
 {
-  if (this->byteVector.size() <= this->posInBufferBytes)
+  if (this->dataSize <= this->posInBufferBytes)
     return 0;
-  return this->byteVector.size() - this->posInBufferBytes - 1;
+  return this->dataSize - this->posInBufferBytes - 1;
 }
 
 ByteVector SubByteReader::peekBytes(unsigned nrBytes) const
@@ -323,19 +324,19 @@ ByteVector SubByteReader::peekBytes(unsigned nrBytes) const
   if (this->posInBufferBits == 8)
     pos++;
 
-  if (pos + nrBytes > this->byteVector.size())
+  if (pos + nrBytes > this->dataSize)
     throw std::logic_error("Not enough data in the input to peek that far");
 
-  return ByteVector(this->byteVector.begin() + pos, this->byteVector.begin() + pos + nrBytes);
+  return ByteVector(this->data + pos, this->data + pos + nrBytes);
 }
 
 bool SubByteReader::gotoNextByte()
 {
   // Before we go to the neyt byte, check if the last (current) byte is a zero
   // byte.
-  if (this->posInBufferBytes >= unsigned(this->byteVector.size()))
+  if (this->posInBufferBytes >= unsigned(this->dataSize))
     throw std::out_of_range("Reading out of bounds");
-  if (this->byteVector[this->posInBufferBytes] == (char)0)
+  if (this->data[this->posInBufferBytes] == (char)0)
     this->numEmuPrevZeroBytes++;
 
   // Skip the remaining sub-byte-bits
@@ -343,18 +344,18 @@ bool SubByteReader::gotoNextByte()
   // Advance pointer
   this->posInBufferBytes++;
 
-  if (this->posInBufferBytes >= (unsigned int)this->byteVector.size())
+  if (this->posInBufferBytes >= (unsigned int)this->dataSize)
     // The next byte is outside of the current buffer. Error.
     return false;
 
   if (this->skipEmulationPrevention)
   {
-    if (this->numEmuPrevZeroBytes == 2 && this->byteVector[this->posInBufferBytes] == (char)3)
+    if (this->numEmuPrevZeroBytes == 2 && this->data[this->posInBufferBytes] == (char)3)
     {
       // The current byte is an emulation prevention 3 byte. Skip it.
       this->posInBufferBytes++; // Skip byte
 
-      if (this->posInBufferBytes >= (unsigned int)this->byteVector.size())
+      if (this->posInBufferBytes >= (unsigned int)this->dataSize)
       {
         // The next byte is outside of the current buffer. Error
         return false;
@@ -363,7 +364,7 @@ bool SubByteReader::gotoNextByte()
       // Reset counter
       this->numEmuPrevZeroBytes = 0;
     }
-    else if (this->byteVector[this->posInBufferBytes] != (char)0)
+    else if (this->data[this->posInBufferBytes] != (char)0)
       // No zero byte. No emulation prevention 3 byte
       this->numEmuPrevZeroBytes = 0;
   }
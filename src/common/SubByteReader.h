@@ -18,12 +18,14 @@ namespace combiner::parser
 /* This class provides the ability to read a byte array bit wise. Reading of ue(v) symbols is also
  * supported. This class can "read out" the emulation prevention bytes. This is enabled by default
  * but can be disabled if needed.
+ * The reader does not copy the data. The given byte array must outlive the reader.
  */
 class SubByteReader
 {
 public:
   SubByteReader() = default;
   SubByteReader(const ByteVector &inArr, size_t inArrOffset = 0);
+  SubByteReader(ByteVector &&inArr, size_t inArrOffset = 0) = delete;
 
   [[nodiscard]] bool more_rbsp_data() const;
   [[nodiscard]] bool byte_aligned() const;
@@ -51,7 +53,8 @@ public:
   int64_t  readSU(unsigned nrBits);
 
 private:
-  ByteVector byteVector;
+  const uint8_t *data{};
+  size_t         dataSize{};
 
   bool skipEmulationPrevention{true};
 
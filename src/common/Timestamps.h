@@ -0,0 +1,22 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <optional>
+
+namespace combiner
+{
+
+// The presentation and decoding time stamps (in 90 kHz units) of a NAL unit from a container.
+struct Timestamps
+{
+  std::optional<uint64_t> PTS{};
+  std::optional<uint64_t> DTS{};
+};
+
+} // namespace combiner
@@ -0,0 +1,136 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include "Tracer.h"
+
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+namespace combiner
+{
+
+namespace
+{
+
+constexpr size_t INITIAL_EVENTS_PER_THREAD = 4096;
+
+std::atomic<size_t> nextTracerID{0};
+
+double toMicroseconds(const Tracer::Clock::duration duration)
+{
+  return std::chrono::duration<double, std::micro>(duration).count();
+}
+
+} // namespace
+
+Tracer::Tracer() : tracerID(nextTracerID.fetch_add(1))
+{
+}
+
+void Tracer::enable()
+{
+  this->enabled.store(true, std::memory_order_relaxed);
+}
+
+void Tracer::addEvent(const char             *name,
+                      const Clock::time_point start,
+                      const Clock::time_point end,
+                      const TraceArguments   &arguments)
+{
+  auto                       &buffer = this->getThreadBuffer();
+  std::lock_guard<std::mutex> lock(buffer.mutex);
+  buffer.events.push_back({name, start, end, arguments});
+}
+
+Tracer::ThreadBuffer &Tracer::getThreadBuffer()
+{
+  // The buffer of this thread is looked up under the global mutex only once per thread.
+  struct CachedBuffer
+  {
+    std::optional<size_t> tracerID{};
+    ThreadBuffer         *buffer{};
+  };
+  thread_local CachedBuffer cachedBuffer;
+  if (cachedBuffer.tracerID == this->tracerID)
+    return *cachedBuffer.buffer;
+
+  std::lock_guard<std::mutex> lock(this->threadBuffersMutex);
+  auto                        buffer = std::make_unique<ThreadBuffer>();
+  buffer->threadIndex                = this->threadBuffers.size();
+  buffer->events.reserve(INITIAL_EVENTS_PER_THREAD);
+  this->threadBuffers.push_back(std::move(buffer));
+
+  cachedBuffer.tracerID = this->tracerID;
+  cachedBuffer.buffer   = this->threadBuffers.back().get();
+  return *cachedBuffer.buffer;
+}
+
+std::string Tracer::toJSON() const
+{
+  std::ostringstream json;
+  json << std::fixed << std::setprecision(3);
+  json << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+
+  bool firstEvent = true;
+  auto separator  = [&firstEvent]() {
+    const auto text = firstEvent ? "\n" : ",\n";
+    firstEvent      = false;
+    return text;
+  };
+
+  std::lock_guard<std::mutex> lock(this->threadBuffersMutex);
+  for (const auto &buffer : this->threadBuffers)
+  {
+    json << separator() << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": "
+         << buffer->threadIndex << ", \"args\": {\"name\": \"Thread " << buffer->threadIndex
+         << "\"}}";
+
+    std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+    for (const auto &event : buffer->events)
+    {
+      json << separator() << "{\"name\": \"" << event.name
+           << "\", \"cat\": \"combiner\", \"ph\": \"X\", \"pid\": 1, \"tid\": "
+           << buffer->threadIndex << ", \"ts\": " << toMicroseconds(event.start - this->startTime)
+           << ", \"dur\": " << toMicroseconds(event.end - event.start) << ", \"args\": {";
+
+      std::string argumentSeparator;
+      if (event.arguments.input)
+      {
+        json << "\"input\": " << *event.arguments.input;
+        argumentSeparator = ", ";
+      }
+      if (event.arguments.POC)
+      {
+        json << argumentSeparator << "\"POC\": " << *event.arguments.POC;
+        argumentSeparator = ", ";
+      }
+      if (event.arguments.nalUnitType)
+        json << argumentSeparator << "\"nalUnitType\": " << *event.arguments.nalUnitType;
+      json << "}}";
+    }
+  }
+
+  json << "\n]}\n";
+  return json.str();
+}
+
+void Tracer::writeJSON(const std::filesystem::path &filePath) const
+{
+  std::ofstream file(filePath);
+  if (!file.is_open())
+    throw std::runtime_error("Error opening trace file " + filePath.string());
+  file << this->toJSON();
+}
+
+Tracer &tracer()
+{
+  static Tracer processTracer;
+  return processTracer;
+}
+
+} // namespace combiner
@@ -0,0 +1,110 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace combiner
+{
+
+struct TraceArguments
+{
+  std::optional<size_t>   input{};
+  std::optional<int>      POC{};
+  std::optional<unsigned> nalUnitType{};
+};
+
+/* Records begin/end (complete) events of the pipeline stages and writes them in the Chrome Trace
+ * Event JSON format which can be opened in Perfetto or chrome://tracing.
+ * Every thread records into its own buffer so that tracing does not serialize the threads. If
+ * tracing is disabled, recording an event only costs the check of one atomic flag.
+ */
+class Tracer
+{
+public:
+  using Clock = std::chrono::steady_clock;
+
+  Tracer();
+
+  void enable();
+  bool isEnabled() const { return this->enabled.load(std::memory_order_relaxed); }
+
+  // The name must be a string literal (or otherwise outlive the tracer).
+  void addEvent(const char             *name,
+                const Clock::time_point start,
+                const Clock::time_point end,
+                const TraceArguments   &arguments);
+
+  std::string toJSON() const;
+  void        writeJSON(const std::filesystem::path &filePath) const;
+
+private:
+  struct Event
+  {
+    const char       *name{};
+    Clock::time_point start{};
+    Clock::time_point end{};
+    TraceArguments    arguments{};
+  };
+
+  struct ThreadBuffer
+  {
+    size_t             threadIndex{};
+    mutable std::mutex mutex;
+    std::vector<Event> events;
+  };
+
+  ThreadBuffer &getThreadBuffer();
+
+  const size_t      tracerID;
+  std::atomic<bool> enabled{false};
+  Clock::time_point startTime{Clock::now()};
+
+  mutable std::mutex                         threadBuffersMutex;
+  std::vector<std::unique_ptr<ThreadBuffer>> threadBuffers;
+};
+
+// The process wide tracer. It is disabled until enable() is called.
+Tracer &tracer();
+
+// Records one event from construction to destruction if tracing is enabled.
+class ScopedTraceEvent
+{
+public:
+  ScopedTraceEvent(const char *name, const TraceArguments &arguments = {})
+  {
+    if (tracer().isEnabled())
+    {
+      this->name      = name;
+      this->arguments = arguments;
+      this->start     = Tracer::Clock::now();
+    }
+  }
+  ~ScopedTraceEvent()
+  {
+    if (this->name != nullptr)
+      tracer().addEvent(this->name, this->start, Tracer::Clock::now(), this->arguments);
+  }
+
+  // Arguments that are only known at the end of the event (e.g. after parsing).
+  void setPOC(const int POC) { this->arguments.POC = POC; }
+  void setNalUnitType(const unsigned nalUnitType) { this->arguments.nalUnitType = nalUnitType; }
+
+private:
+  const char               *name{};
+  TraceArguments            arguments{};
+  Tracer::Clock::time_point start{};
+};
+
+} // namespace combiner
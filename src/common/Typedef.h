@@ -29,6 +29,10 @@ struct FrameSize
   uint64_t width{};
   uint64_t height{};
 
+  bool operator==(const FrameSize &other) const
+  {
+    return this->width == other.width && this->height == other.height;
+  }
   bool operator!=(const FrameSize &other)
   {
     return this->width != other.width || this->height != other.height;
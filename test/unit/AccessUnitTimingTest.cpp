@@ -0,0 +1,62 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include <gtest/gtest.h>
+
+#include <HEVC/AccessUnitTiming.h>
+
+#include "Functions.h"
+
+namespace combiner
+{
+
+using namespace parser::hevc;
+
+TEST(AccessUnitTiming, TestPicturesAndAccessUnitsOfTestData)
+{
+  AccessUnitTiming timing;
+
+  std::vector<AccessUnitTiming::NalUnit> nalUnits;
+  for (const auto &nalData : getTestNalUnits())
+    nalUnits.push_back(timing.update(nalData));
+  ASSERT_EQ(nalUnits.size(), 6u);
+
+  for (size_t i = 0; i < 3; ++i)
+  {
+    EXPECT_FALSE(nalUnits.at(i).startsAccessUnit);
+    EXPECT_FALSE(nalUnits.at(i).picture);
+  }
+  EXPECT_FALSE(nalUnits.at(3).startsAccessUnit);
+  EXPECT_TRUE(nalUnits.at(4).startsAccessUnit);
+  EXPECT_TRUE(nalUnits.at(5).startsAccessUnit);
+
+  // IDR (POC 0), TRAIL_R (POC 4), TRAIL_N (POC 1). The IDR is the first picture, so the
+  // presentation index is the POC.
+  const std::vector<int> expectedPOCs = {0, 4, 1};
+  for (size_t i = 0; i < 3; ++i)
+  {
+    const auto &picture = nalUnits.at(3 + i).picture;
+    ASSERT_TRUE(picture);
+    EXPECT_EQ(picture->POC, expectedPOCs.at(i));
+    EXPECT_EQ(picture->isIRAP, i == 0);
+    EXPECT_EQ(picture->decodeIndex, int64_t(i));
+    EXPECT_EQ(picture->presentationIndex, int64_t(expectedPOCs.at(i)));
+  }
+
+  ASSERT_TRUE(timing.getFirstSPS());
+  const auto pictureTiming = timing.getPictureTiming();
+  EXPECT_GT(pictureTiming.timescale, 0u);
+  EXPECT_EQ(timing.getTimeOfPictureIndex(2, pictureTiming.timescale),
+            2 * int64_t(pictureTiming.pictureDuration));
+}
+
+TEST(AccessUnitTiming, TestSliceWithoutParameterSetsThrows)
+{
+  AccessUnitTiming timing;
+  EXPECT_THROW(timing.update(getTestNalUnits().at(3)), std::runtime_error);
+}
+
+} // namespace combiner
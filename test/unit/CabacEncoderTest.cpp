@@ -0,0 +1,102 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include <gtest/gtest.h>
+
+#include <HEVC/CabacEncoder.h>
+
+#include "CabacDecoder.h"
+
+#include <random>
+
+namespace combiner
+{
+
+namespace
+{
+
+using namespace parser::hevc;
+
+enum class BinType
+{
+  Decision,
+  Bypass,
+  Terminate
+};
+
+} // namespace
+
+TEST(CabacEncoder, TestContextInitialization)
+{
+  // initValue 154 is the equiprobable state for all QPs
+  const auto context = initCabacContext(154, 30);
+  EXPECT_EQ(context.pStateIdx, 0);
+  EXPECT_EQ(context.valMps, true);
+
+  // m = 15 and n = 24 with the QP clipped to 51: ((15 * 51) >> 4) + 24 = 71
+  const auto clippedContext = initCabacContext(197, 60);
+  EXPECT_EQ(clippedContext.pStateIdx, 7);
+  EXPECT_EQ(clippedContext.valMps, true);
+}
+
+TEST(CabacEncoder, TestEncodedBinsCanBeDecoded)
+{
+  std::mt19937                          random(42);
+  std::vector<std::pair<BinType, bool>> bins;
+  for (int i = 0; i < 20000; ++i)
+  {
+    const auto value = random() % 100;
+    if (value < 70)
+      bins.emplace_back(BinType::Decision, random() % 10 < 8);
+    else if (value < 95)
+      bins.emplace_back(BinType::Bypass, random() % 2 == 0);
+    else
+      bins.emplace_back(BinType::Terminate, false);
+  }
+  bins.emplace_back(BinType::Terminate, true);
+
+  parser::SubByteWriter writer;
+  {
+    std::array<CabacContext, 4> contexts = {initCabacContext(154, 26),
+                                            initCabacContext(197, 26),
+                                            initCabacContext(63, 26),
+                                            initCabacContext(111, 26)};
+    CabacEncoder                encoder(writer);
+    for (size_t i = 0; i < bins.size(); ++i)
+    {
+      const auto [type, value] = bins.at(i);
+      if (type == BinType::Decision)
+        encoder.encodeDecision(contexts.at(i % contexts.size()), value);
+      else if (type == BinType::Bypass)
+        encoder.encodeBypass(value);
+      else
+        encoder.encodeTerminate(value);
+    }
+  }
+  const auto data = writer.finishWritingAndGetData();
+
+  std::array<CabacContext, 4> contexts = {initCabacContext(154, 26),
+                                          initCabacContext(197, 26),
+                                          initCabacContext(63, 26),
+                                          initCabacContext(111, 26)};
+  CabacDecoder                decoder(data);
+  for (size_t i = 0; i < bins.size(); ++i)
+  {
+    const auto [type, value] = bins.at(i);
+    if (type == BinType::Decision)
+      ASSERT_EQ(decoder.decodeDecision(contexts.at(i % contexts.size())), value) << "Bin " << i;
+    else if (type == BinType::Bypass)
+      ASSERT_EQ(decoder.decodeBypass(), value) << "Bin " << i;
+    else
+      ASSERT_EQ(decoder.decodeTerminate(), value) << "Bin " << i;
+  }
+
+  // The stop bit was the last bit that was written. Only the alignment bits follow it.
+  EXPECT_EQ(decoder.reader.nrBytesLeft(), 0u);
+  EXPECT_NE(data.back(), 0);
+}
+
+} // namespace combiner
@@ -0,0 +1,444 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include <gtest/gtest.h>
+
+#include <Combiner/ChunkedCombiner.h>
+#include <Combiner/Combiner.h>
+#include <Combiner/InputSwitcher.h>
+#include <File/FileSinkAnnexB.h>
+#include <File/FileSourceAnnexB.h>
+#include <File/MemorySink.h>
+#include <HEVC/AccessUnitTiming.h>
+#include <HEVC/slice_segment_layer_rbsp.h>
+#include <common/SubByteWriter.h>
+
+#include "Functions.h"
+
+#include <atomic>
+#include <fstream>
+#include <stdexcept>
+#include <thread>
+
+namespace combiner
+{
+
+namespace
+{
+
+using namespace parser::hevc;
+
+template <typename ParameterSet>
+ByteVector writeNalUnit(const nal_unit_header &header, const ParameterSet &parameterSet)
+{
+  parser::SubByteWriter writer;
+  header.write(writer);
+  parameterSet.write(writer);
+  return writer.finishWritingAndGetData();
+}
+
+const slice_segment_header &getSliceHeader(const NalUnitHEVC &nal)
+{
+  return dynamic_cast<slice_segment_layer_rbsp &>(*nal.rbsp).sliceSegmentHeader;
+}
+
+struct Picture
+{
+  NalType          nalType{};
+  unsigned         temporalId{};
+  int              POC{};
+  std::vector<int> deltaPocS0{};
+  std::vector<int> deltaPocS1{};
+};
+
+// A slice segment with the header of the IDR or P slice of the test data and the given POC and
+// reference pictures. The slice data is not valid. It is never decoded. It starts with the marker
+// which tells the stream that the slice came from.
+ByteVector writeSlice(const Picture             &picture,
+                      const ActiveParameterSets &parameterSets,
+                      const uint8_t              marker)
+{
+  nal_unit_header nalHeader(picture.nalType);
+  nalHeader.nuh_temporal_id_plus1 = picture.temporalId + 1;
+
+  auto        testNalUnits  = getTestNalUnits();
+  auto        parser        = parserWithParameterSets();
+  const auto  idrSlice      = parser.parseNalUnit(std::move(testNalUnits.at(3)));
+  const auto  pSlice        = parser.parseNalUnit(std::move(testNalUnits.at(4)));
+  const auto &templateSlice = nalHeader.isIRAP() ? idrSlice : pSlice;
+  auto        header        = getSliceHeader(templateSlice);
+
+  header.slice_pic_order_cnt_lsb = static_cast<uint64_t>(picture.POC % 256);
+  header.stRefPicSet             = st_ref_pic_set::fromDeltaPocs(
+      picture.deltaPocS0,
+      std::vector<bool>(picture.deltaPocS0.size(), true),
+      picture.deltaPocS1,
+      std::vector<bool>(picture.deltaPocS1.size(), true));
+
+  parser::SubByteWriter writer;
+  nalHeader.write(writer);
+  header.write(writer, nalHeader, parameterSets);
+  auto data = writer.finishWritingAndGetData();
+  append(data, {marker, 0xCD});
+  return data;
+}
+
+// The parameter sets of the test data with timing. With the upper sub-layer, the stream has 50
+// instead of 25 pictures per second.
+ActiveParameterSets getParameterSets(const bool withUpperSubLayer)
+{
+  auto parameterSets = parseParameterSetsOfTestData();
+  auto &vps          = parameterSets.vpsMap.at(0);
+  auto &sps          = parameterSets.spsMap.at(0);
+  const uint64_t timeScale = withUpperSubLayer ? 50 : 25;
+
+  vps.vps_timing_info_present_flag = true;
+  vps.vps_num_units_in_tick        = 1;
+  vps.vps_time_scale               = timeScale;
+
+  sps.log2_max_pic_order_cnt_lsb_minus4          = 4;
+  sps.vui_parameters_present_flag                = true;
+  sps.vuiParameters.vui_timing_info_present_flag = true;
+  sps.vuiParameters.vui_num_units_in_tick        = 1;
+  sps.vuiParameters.vui_time_scale               = timeScale;
+
+  if (withUpperSubLayer)
+  {
+    vps.vps_max_sub_layers_minus1                = 1;
+    vps.vps_temporal_id_nesting_flag             = false;
+    vps.vps_sub_layer_ordering_info_present_flag = true;
+    vps.vps_max_dec_pic_buffering_minus1[1]      = vps.vps_max_dec_pic_buffering_minus1[0];
+
+    sps.sps_max_sub_layers_minus1                = 1;
+    sps.sps_temporal_id_nesting_flag             = false;
+    sps.sps_sub_layer_ordering_info_present_flag = true;
+    sps.sps_max_dec_pic_buffering_minus1         = {1, 2};
+    sps.sps_max_num_reorder_pics                 = {0, 1};
+    sps.sps_max_latency_increase_plus1           = {0, 0};
+    // The HRD parameters of the test data are only for one sub-layer
+    sps.vuiParameters.vui_hrd_parameters_present_flag = false;
+  }
+  return parameterSets;
+}
+
+std::vector<ByteVector> writeStream(const std::vector<Picture> &pictures,
+                                    const bool                  withUpperSubLayer,
+                                    const uint8_t               marker = 0xAB)
+{
+  const auto parameterSets = getParameterSets(withUpperSubLayer);
+
+  std::vector<ByteVector> nalUnits;
+  nalUnits.push_back(writeNalUnit(nal_unit_header(NalType::VPS_NUT), parameterSets.vpsMap.at(0)));
+  nalUnits.push_back(writeNalUnit(nal_unit_header(NalType::SPS_NUT), parameterSets.spsMap.at(0)));
+  nalUnits.push_back(writeNalUnit(nal_unit_header(NalType::PPS_NUT), parameterSets.ppsMap.at(0)));
+  for (const auto &picture : pictures)
+    nalUnits.push_back(writeSlice(picture, parameterSets, marker));
+  return nalUnits;
+}
+
+// The pictures of an IDR period with one picture per tick. The pictures of the upper sub-layer
+// have the odd POCs.
+std::vector<Picture> getIDRPeriod(const int nrPictures, const bool withUpperSubLayer)
+{
+  std::vector<Picture> pictures;
+  pictures.push_back({NalType::IDR_W_RADL, 0, 0});
+  if (!withUpperSubLayer)
+  {
+    for (int POC = 1; POC < nrPictures; ++POC)
+      pictures.push_back({NalType::TRAIL_R, 0, POC, {-1}});
+    return pictures;
+  }
+  for (int POC = 2; POC < nrPictures; POC += 2)
+  {
+    pictures.push_back({NalType::TRAIL_R, 0, POC, {-2}});
+    pictures.push_back({NalType::TSA_N, 1, POC - 1, {-1}, {1}});
+  }
+  return pictures;
+}
+
+std::vector<ByteVector> getStream(const int nrPictures, const bool withUpperSubLayer)
+{
+  return writeStream(getIDRPeriod(nrPictures, withUpperSubLayer), withUpperSubLayer);
+}
+
+std::vector<std::unique_ptr<NalUnitSource>> getInputs(const size_t nrInputs, const int nrPictures)
+{
+  std::vector<std::unique_ptr<NalUnitSource>> inputs;
+  for (size_t i = 0; i < nrInputs; ++i)
+    inputs.push_back(std::make_unique<MemorySource>(getStream(nrPictures, true)));
+  return inputs;
+}
+
+// A raw (Annex B) file in the temporary directory
+std::filesystem::path writeAnnexBFile(const std::vector<ByteVector> &nalUnits)
+{
+  const auto    filePath = getUniqueTemporaryPath("CombinerTest.hevc");
+  std::ofstream file(filePath, std::ios_base::binary);
+  for (const auto &nal : nalUnits)
+  {
+    file.write("\0\0\0\1", 4);
+    file.write(reinterpret_cast<const char *>(nal.data()), nal.size());
+  }
+  return filePath;
+}
+
+// The marker of each slice segment (its second last byte)
+std::vector<uint8_t> getSliceMarkers(const std::vector<ByteVector> &nalUnits)
+{
+  std::vector<uint8_t> markers;
+  for (const auto &nalData : nalUnits)
+    if (nal_unit_header::fromNalData(nalData).isSlice())
+      markers.push_back(nalData.at(nalData.size() - 2));
+  return markers;
+}
+
+// A replacement that never delivers anything. Reading from it would block.
+class StalledSource : public NalUnitSource
+{
+public:
+  ByteVector getNextNALUnit() override { throw std::logic_error("Blocked on a stalled source"); }
+  bool       waitForNALUnit(const std::chrono::milliseconds) override { return false; }
+  uint64_t   getFileOffsetOfLastNALUnit() const override { return 0; }
+};
+
+std::vector<AccessUnitTiming::Picture> getPictures(const std::vector<ByteVector> &nalUnits)
+{
+  AccessUnitTiming                       timing;
+  std::vector<AccessUnitTiming::Picture> pictures;
+  for (const auto &nalData : nalUnits)
+    if (const auto picture = timing.update(nalData).picture)
+      pictures.push_back(*picture);
+  return pictures;
+}
+
+} // namespace
+
+TEST(Combiner, TestPOCsStepByOneAfterRemovingSubLayers)
+{
+  for (const size_t nrInputs : {1, 2})
+  {
+    MemorySink output;
+    Combiner(getInputs(nrInputs, 9), output, nullptr, nullptr, {}, {}, 0);
+
+    // The sinks take the presentation order from the POCs and the timing from the SPS
+    const auto pictures = getPictures(output.getNalUnits());
+    ASSERT_EQ(pictures.size(), 5u);
+    for (size_t i = 0; i < pictures.size(); ++i)
+    {
+      EXPECT_EQ(pictures.at(i).POC, static_cast<int>(i));
+      EXPECT_EQ(pictures.at(i).presentationIndex, pictures.at(i).decodeIndex);
+    }
+
+    AccessUnitTiming timing;
+    for (const auto &nalData : output.getNalUnits())
+      timing.update(nalData);
+    EXPECT_EQ(timing.getPictureTiming().timescale, 50u);
+    EXPECT_EQ(timing.getPictureTiming().pictureDuration, 2u);
+  }
+}
+
+TEST(Combiner, TestVPSGetsDecimatedSubLayersAndTiming)
+{
+  std::vector<std::unique_ptr<NalUnitSource>> inputs;
+  inputs.push_back(std::make_unique<MemorySource>(getStream(9, true)));
+  inputs.push_back(std::make_unique<MemorySource>(getStream(5, false)));
+
+  MemorySink output;
+  Combiner(std::move(inputs), output);
+
+  const auto &nalUnits = output.getNalUnits();
+  ASSERT_FALSE(nalUnits.empty());
+  ASSERT_EQ(nal_unit_header::fromNalData(nalUnits.front()).nal_unit_type, NalType::VPS_NUT);
+
+  const auto vps = parserParameterSetFromData<video_parameter_set_rbsp>(
+      ByteVector(nalUnits.front().begin() + 2, nalUnits.front().end()));
+  EXPECT_EQ(vps.vps_max_sub_layers_minus1, 0u);
+  EXPECT_TRUE(vps.vps_temporal_id_nesting_flag);
+  EXPECT_TRUE(vps.vps_timing_info_present_flag);
+  EXPECT_EQ(vps.vps_time_scale, 50u);
+  EXPECT_EQ(vps.vps_num_units_in_tick, 2u);
+  EXPECT_EQ(getPictures(nalUnits).size(), 5u);
+}
+
+TEST(Combiner, TestSwitchPointsDroppedByDecimationAreSkipped)
+{
+  // Three IDR periods of two pictures in the lowest sub-layer
+  std::vector<Picture> upperSubLayerPictures;
+  std::vector<Picture> lowestSubLayerPictures;
+  for (int i = 0; i < 3; ++i)
+  {
+    const auto upperSubLayerPeriod  = getIDRPeriod(3, true);
+    const auto lowestSubLayerPeriod = getIDRPeriod(2, false);
+    upperSubLayerPictures.insert(
+        upperSubLayerPictures.end(), upperSubLayerPeriod.begin(), upperSubLayerPeriod.end());
+    lowestSubLayerPictures.insert(
+        lowestSubLayerPictures.end(), lowestSubLayerPeriod.begin(), lowestSubLayerPeriod.end());
+  }
+
+  // The first switch point of the replacement has an odd POC and is dropped with the upper
+  // sub-layer. The switch happens at the IDR picture after it.
+  auto replacementPictures = std::vector<Picture>({{NalType::BLA_W_RADL, 0, 3}});
+  replacementPictures.insert(
+      replacementPictures.end(), upperSubLayerPictures.begin(), upperSubLayerPictures.end());
+
+  InputSwitcher inputSwitcher;
+  inputSwitcher.replaceInput(
+      0, std::make_unique<MemorySource>(writeStream(replacementPictures, true, 0x03)));
+
+  std::vector<std::unique_ptr<NalUnitSource>> inputs;
+  inputs.push_back(std::make_unique<MemorySource>(writeStream(upperSubLayerPictures, true, 0x01)));
+  inputs.push_back(
+      std::make_unique<MemorySource>(writeStream(lowestSubLayerPictures, false, 0x02)));
+
+  MemorySink output;
+  Combiner(std::move(inputs), output, nullptr, &inputSwitcher);
+
+  EXPECT_EQ(getSliceMarkers(output.getNalUnits()),
+            std::vector<uint8_t>({3, 2, 3, 2, 3, 2, 3, 2, 3, 2, 3, 2}));
+}
+
+TEST(Combiner, TestSwitchPointAheadOfTheInputsIsKept)
+{
+  // BLA pictures every second picture, starting with POC 2
+  std::vector<Picture> pictures;
+  for (int POC = 2; POC < 8; POC += 2)
+  {
+    pictures.push_back({NalType::BLA_W_RADL, 0, POC});
+    pictures.push_back({NalType::TRAIL_R, 0, POC + 1, {-1}});
+  }
+
+  // The replacement is taken at the BLA picture with POC 2. Its first switch point can only be
+  // switched to at the next one.
+  const auto replacementPictures = std::vector<Picture>(pictures.begin() + 2, pictures.end());
+  InputSwitcher inputSwitcher;
+  inputSwitcher.replaceInput(
+      1, std::make_unique<MemorySource>(writeStream(replacementPictures, false, 0x03)));
+
+  std::vector<std::unique_ptr<NalUnitSource>> inputs;
+  inputs.push_back(std::make_unique<MemorySource>(writeStream(pictures, false, 0x01)));
+  inputs.push_back(std::make_unique<MemorySource>(writeStream(pictures, false, 0x02)));
+
+  MemorySink output;
+  Combiner(std::move(inputs), output, nullptr, &inputSwitcher);
+
+  EXPECT_EQ(getSliceMarkers(output.getNalUnits()),
+            std::vector<uint8_t>({1, 2, 1, 2, 1, 3, 1, 3, 1, 3, 1, 3}));
+}
+
+TEST(Combiner, TestStopEndsTheCombinationWhileAnInputIsStalled)
+{
+  std::vector<std::unique_ptr<NalUnitSource>> inputs;
+  inputs.push_back(std::make_unique<MemorySource>(getStream(5, true)));
+  inputs.push_back(std::make_unique<StalledSource>());
+
+  std::atomic<bool> stopRequested{};
+  std::thread       stopThread([&stopRequested]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    stopRequested = true;
+  });
+
+  MemorySink output;
+  Combiner(std::move(inputs), output, nullptr, nullptr, {}, {}, {}, &stopRequested);
+  stopThread.join();
+
+  EXPECT_TRUE(getPictures(output.getNalUnits()).empty());
+}
+
+TEST(Combiner, TestStalledReplacementDoesNotStallTheInputs)
+{
+  InputSwitcher inputSwitcher;
+  inputSwitcher.replaceInput(0, std::make_unique<StalledSource>());
+
+  MemorySink output;
+  Combiner(getInputs(2, 5), output, nullptr, &inputSwitcher);
+
+  EXPECT_EQ(getPictures(output.getNalUnits()).size(), 5u);
+}
+
+TEST(Combiner, TestPassedThroughSlicesAreTheSameAsRewrittenSlices)
+{
+  // The slices of a single input are passed through. The slice segment headers are not parsed.
+  const auto input = getStream(5, false);
+
+  MemorySink                                  output;
+  std::vector<std::unique_ptr<NalUnitSource>> inputs;
+  inputs.push_back(std::make_unique<MemorySource>(input));
+  Combiner(std::move(inputs), output);
+
+  // The slices written like the slices of more than one input (with a rewritten header)
+  ParserAnnexBHEVC inputParser;
+  ParserAnnexBHEVC outputParser;
+  const auto      &outputNalUnits = output.getNalUnits();
+  ASSERT_EQ(outputNalUnits.size(), input.size());
+  for (size_t i = 0; i < input.size(); ++i)
+  {
+    const auto nal       = inputParser.parseNalUnit(ByteVector(input.at(i)));
+    const auto outputNal = outputParser.parseNalUnit(ByteVector(outputNalUnits.at(i)));
+    if (!nal.header.isSlice())
+      continue;
+
+    const auto           &sliceHeader = getSliceHeader(nal);
+    parser::SubByteWriter writer;
+    nal.header.write(writer);
+    sliceHeader.write(writer, nal.header, outputParser.getActiveParameterSets());
+    auto rewritten = writer.finishWritingAndGetData();
+    rewritten.insert(rewritten.end(),
+                     nal.rawData.begin() + static_cast<long>(sliceHeader.nrBytesInHeader),
+                     nal.rawData.end());
+    EXPECT_EQ(outputNal.rawData, rewritten) << "NAL unit " << i;
+  }
+}
+
+TEST(ChunkedCombiner, TestChunkedOutputIsTheSameAsTheSequentialOne)
+{
+  // Three IDR periods with parameter sets, so that there are three chunks
+  std::vector<std::filesystem::path> inputFiles;
+  for (const uint8_t marker : {0x01, 0x02})
+  {
+    std::vector<ByteVector> nalUnits;
+    for (int i = 0; i < 3; ++i)
+    {
+      const auto period = writeStream(getIDRPeriod(4, false), false, marker);
+      nalUnits.insert(nalUnits.end(), period.begin(), period.end());
+    }
+    inputFiles.push_back(writeAnnexBFile(nalUnits));
+  }
+
+  const auto sequentialFile = getUniqueTemporaryPath("CombinerTestSequential.hevc");
+  {
+    std::vector<std::unique_ptr<NalUnitSource>> inputs;
+    for (const auto &file : inputFiles)
+      inputs.push_back(std::make_unique<FileSourceAnnexB>(file));
+    FileSinkAnnexB output(sequentialFile);
+    Combiner(std::move(inputs), output);
+    output.finish();
+  }
+
+  const auto chunkedFile = getUniqueTemporaryPath("CombinerTestChunked.hevc");
+  {
+    FileSinkAnnexB output(chunkedFile);
+    ChunkedCombiner(inputFiles, output, 3);
+    output.finish();
+  }
+
+  const auto sequentialData = readFile(sequentialFile);
+  const auto chunkedData    = readFile(chunkedFile);
+  EXPECT_FALSE(sequentialData.empty());
+  EXPECT_EQ(chunkedData, sequentialData);
+
+  std::vector<ByteVector> nalUnits;
+  FileSourceAnnexB        fileSource(sequentialFile);
+  for (auto nal = fileSource.getNextNALUnit(); !nal.empty(); nal = fileSource.getNextNALUnit())
+    nalUnits.push_back(std::move(nal));
+  EXPECT_EQ(getPictures(nalUnits).size(), 12u);
+
+  for (const auto &file : inputFiles)
+    std::filesystem::remove(file);
+  std::filesystem::remove(sequentialFile);
+  std::filesystem::remove(chunkedFile);
+}
+
+} // namespace combiner
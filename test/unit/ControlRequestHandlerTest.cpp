@@ -0,0 +1,149 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include <gtest/gtest.h>
+
+#include <Daemon/ControlRequestHandler.h>
+#include <common/JSONObject.h>
+
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+namespace combiner
+{
+
+namespace
+{
+
+void waitUntilStopped(PipelineStatistics &, const std::atomic<bool> &stopRequested)
+{
+  while (!stopRequested)
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
+
+bool waitUntilRunning(const JobManager &jobManager, const uint64_t id)
+{
+  for (int i = 0; i < 500; ++i)
+  {
+    if (jobManager.getJobState(id) == JobState::Running)
+      return true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  return false;
+}
+
+std::string getError(const std::string &response)
+{
+  const auto object = JSONObject::parse(response);
+  EXPECT_EQ(object.getBool("ok"), false);
+  return object.getString("error").value_or("");
+}
+
+} // namespace
+
+TEST(ControlRequestHandler, TestJobArgumentsAreTheOptionsOfACombination)
+{
+  const auto settings = parseJobArguments(
+      {"--threads", "2", "--also-output", "copy.hevc", "a.hevc", "b.hevc", "out.hevc"});
+
+  EXPECT_EQ(settings.inputFiles, std::vector<std::filesystem::path>({"a.hevc", "b.hevc"}));
+  EXPECT_EQ(settings.outputFile, std::filesystem::path("out.hevc"));
+  EXPECT_EQ(settings.additionalOutputFiles, std::vector<std::filesystem::path>({"copy.hevc"}));
+  EXPECT_EQ(settings.nrThreads, 2u);
+}
+
+TEST(ControlRequestHandler, TestJobArgumentsWithOptionsOfTheProcessAreRejected)
+{
+  for (const auto &option : std::vector<std::vector<std::string>>({{"--log-level", "debug"},
+                                                                   {"--stats", "stats.json"},
+                                                                   {"--trace", "trace.json"},
+                                                                   {"--daemon", "daemon.sock"},
+                                                                   {"--write-index"}}))
+  {
+    auto arguments = option;
+    arguments.insert(arguments.end(), {"a.hevc", "out.hevc"});
+    EXPECT_THROW(parseJobArguments(arguments), std::invalid_argument) << option.front();
+  }
+}
+
+TEST(ControlRequestHandler, TestJobArgumentsNeedInputsAndAnOutput)
+{
+  EXPECT_THROW(parseJobArguments({}), std::invalid_argument);
+  EXPECT_THROW(parseJobArguments({"out.hevc"}), std::invalid_argument);
+  EXPECT_THROW(parseJobArguments({"a.hevc", "b.hevc", "c.hevc", "out.hevc"}),
+               std::invalid_argument);
+  EXPECT_THROW(parseJobArguments({"--relayout", "2x1", "a.hevc", "b.hevc", "out.hevc"}),
+               std::invalid_argument);
+  EXPECT_THROW(parseJobArguments({"--threads", "0", "a.hevc", "out.hevc"}), std::invalid_argument);
+}
+
+TEST(ControlRequestHandler, TestInvalidRequestsAreAnsweredWithAnError)
+{
+  JobManager            jobManager(1);
+  ControlRequestHandler handler(jobManager, []() {});
+
+  EXPECT_FALSE(getError(handler.handleRequest("not json")).empty());
+  EXPECT_EQ(getError(handler.handleRequest(R"({"command": "restart"})")),
+            "Unknown command restart");
+  EXPECT_EQ(getError(handler.handleRequest(R"({"command": "stop"})")), "There is no such job");
+  EXPECT_EQ(getError(handler.handleRequest(R"({"command": "stop", "job": 7})")),
+            "There is no such job");
+  EXPECT_EQ(getError(handler.handleRequest(R"({"command": "switch", "job": 7})")),
+            "A switch needs a job, an input and a file");
+  EXPECT_EQ(getError(handler.handleRequest(R"({"command": "status", "job": 7})")),
+            "There is no job 7");
+  EXPECT_EQ(getError(handler.handleRequest(
+                R"({"command": "start", "arguments": ["--log-level", "debug", "a", "b"]})")),
+            "The log level can only be set for the whole daemon");
+  EXPECT_EQ(
+      getError(handler.handleRequest(R"({"command": "start", "arguments": ["a.hevc"]})")),
+      "A job needs 1, 2 or 4 inputs and an output");
+}
+
+TEST(ControlRequestHandler, TestResponsesToJobRequests)
+{
+  // The only worker is busy, so the started job stays queued
+  JobManager jobManager(1);
+  const auto busyID = jobManager.addJob("busy", 1, 1, waitUntilStopped);
+  ASSERT_TRUE(waitUntilRunning(jobManager, busyID));
+
+  ControlRequestHandler handler(jobManager, []() {});
+  EXPECT_EQ(
+      handler.handleRequest(R"({"command": "start", "arguments": ["a.hevc", "b.hevc", "o.hevc"]})"),
+      R"({"ok": true, "job": 2})");
+
+  const auto status = handler.handleRequest(R"({"command": "status", "job": 2})");
+  EXPECT_EQ(status.rfind(R"({"ok": true, "job": {"job": 2, "state": "queued", )", 0), 0u)
+      << status;
+  EXPECT_NE(status.find(R"("description": "a.hevc b.hevc o.hevc")"), std::string::npos);
+
+  const auto allJobs = handler.handleRequest(R"({"command": "status"})");
+  EXPECT_EQ(allJobs.rfind(R"({"ok": true, "jobs": [{"job": 1, )", 0), 0u) << allJobs;
+
+  EXPECT_EQ(getError(handler.handleRequest(
+                R"({"command": "switch", "job": 2, "input": 2, "file": "c.hevc"})")),
+            "The job has no such input");
+
+  EXPECT_EQ(handler.handleRequest(R"({"command": "stop", "job": 2})"), R"({"ok": true})");
+  EXPECT_EQ(getError(handler.handleRequest(
+                R"({"command": "switch", "job": 2, "input": 0, "file": "c.hevc"})")),
+            "There is no such running job that can switch inputs");
+
+  jobManager.stopJob(busyID);
+}
+
+TEST(ControlRequestHandler, TestShutdownRequest)
+{
+  JobManager            jobManager(1);
+  bool                  shutdown = false;
+  ControlRequestHandler handler(jobManager, [&shutdown]() { shutdown = true; });
+
+  EXPECT_EQ(handler.handleRequest(R"({"command": "shutdown"})"), R"({"ok": true})");
+  EXPECT_TRUE(shutdown);
+}
+
+} // namespace combiner
@@ -0,0 +1,298 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include <gtest/gtest.h>
+
+#include <File/FanOutSink.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <future>
+
+namespace combiner
+{
+
+namespace
+{
+
+const ByteVector vps      = {0x40, 0x01, 0x0C};
+const ByteVector sps      = {0x42, 0x01, 0x01};
+const ByteVector pps      = {0x44, 0x01, 0xC1};
+const ByteVector aud      = {0x46, 0x01, 0x50};
+const ByteVector idrSlice = {0x28, 0x01, 0xAF};
+const ByteVector slice    = {0x02, 0x01, 0xD0};
+const ByteVector craSlice = {0x2A, 0x01, 0xAF};
+const ByteVector rasl     = {0x10, 0x01, 0xD0};
+const ByteVector radl     = {0x0C, 0x01, 0xD0};
+const ByteVector suffix   = {0x50, 0x01, 0x05};
+
+// Records everything that is written. Optionally, the first write blocks until it is released.
+class RecordingSink : public NalUnitSink
+{
+public:
+  RecordingSink(std::shared_future<void> release = {}) : release(release) {}
+
+  void writeNALUnit(const ByteVector &nalData) override
+  {
+    if (this->release.valid())
+      this->release.wait();
+    this->nalUnits.push_back(nalData);
+  }
+  void setTimestampsOfNextNALUnits(const Timestamps &timestamps) override
+  {
+    this->timestamps.push_back(timestamps);
+  }
+  void finish() override { this->finished = true; }
+
+  std::vector<ByteVector> nalUnits;
+  std::vector<Timestamps> timestamps;
+  bool                    finished{};
+
+private:
+  std::shared_future<void> release;
+};
+
+// Records the writes of NAL units with a new header as they are given to the sink
+class NewHeaderRecordingSink : public NalUnitSink
+{
+public:
+  struct Write
+  {
+    ByteVector                           newHeader{};
+    ByteVector                           originalNalData{};
+    size_t                               nrReplacedBytes{};
+    std::optional<std::filesystem::path> filePath{};
+    uint64_t                             offset{};
+    size_t                               size{};
+  };
+
+  void writeNALUnit(const ByteVector &nalData) override { this->writes.push_back({{}, nalData}); }
+  void writeNALUnitWithNewHeader(const ByteVector               &newHeader,
+                                 const ByteVector               &originalNalData,
+                                 const size_t                    nrReplacedBytes,
+                                 const std::optional<FileRange> &originalInFile) override
+  {
+    Write write{newHeader, originalNalData, nrReplacedBytes};
+    if (originalInFile)
+    {
+      write.filePath = *originalInFile->filePath;
+      write.offset   = originalInFile->offset;
+      write.size     = originalInFile->size;
+    }
+    this->writes.push_back(write);
+  }
+
+  std::vector<Write> writes;
+};
+
+class FailingSink : public NalUnitSink
+{
+public:
+  void writeNALUnit(const ByteVector &) override { throw std::runtime_error("Write failed"); }
+};
+
+std::vector<ByteVector> getPicture(const bool isIRAP)
+{
+  if (isIRAP)
+    return {aud, vps, sps, pps, idrSlice};
+  return {aud, slice};
+}
+
+} // namespace
+
+TEST(FanOutSink, TestAllOutputsGetAllNalUnitsAndTimestamps)
+{
+  auto sink1  = std::make_unique<RecordingSink>();
+  auto sink2  = std::make_unique<RecordingSink>();
+  auto first  = sink1.get();
+  auto second = sink2.get();
+
+  FanOutSink fanOutSink(2);
+  fanOutSink.addSink(std::move(sink1), FanOutSink::OverflowPolicy::Wait);
+  fanOutSink.addSink(std::move(sink2), FanOutSink::OverflowPolicy::Wait);
+
+  std::vector<ByteVector> expectedNalUnits;
+  for (int picture = 0; picture < 10; ++picture)
+  {
+    const auto time = uint64_t(picture) * 3600;
+    fanOutSink.setTimestampsOfNextNALUnits(Timestamps{time, time});
+    for (const auto &nal : getPicture(picture % 5 == 0))
+    {
+      fanOutSink.writeNALUnit(nal);
+      expectedNalUnits.push_back(nal);
+    }
+  }
+  fanOutSink.finish();
+
+  for (const auto sink : {first, second})
+  {
+    EXPECT_EQ(sink->nalUnits, expectedNalUnits);
+    ASSERT_EQ(sink->timestamps.size(), 10u);
+    EXPECT_EQ(sink->timestamps.back().PTS, uint64_t(9 * 3600));
+    EXPECT_TRUE(sink->finished);
+  }
+}
+
+TEST(FanOutSink, TestSlowOutputDropsUntilIRAPWithoutStallingOthers)
+{
+  std::promise<void> release;
+  auto               fastSink = std::make_unique<RecordingSink>();
+  auto               slowSink = std::make_unique<RecordingSink>(release.get_future().share());
+  auto               fast     = fastSink.get();
+  auto               slow     = slowSink.get();
+
+  PipelineStatistics statistics(1, 2);
+  FanOutSink         fanOutSink(8);
+  fanOutSink.addSink(
+      std::move(fastSink), FanOutSink::OverflowPolicy::Wait, &statistics.getOutput(0));
+  fanOutSink.addSink(
+      std::move(slowSink), FanOutSink::OverflowPolicy::DropUntilIRAP, &statistics.getOutput(1));
+
+  // The slow output blocks in its first write. Its queue is full after a few pictures.
+  std::vector<ByteVector> expectedNalUnits;
+  for (int picture = 0; picture < 6; ++picture)
+    for (const auto &nal : getPicture(picture == 0))
+    {
+      fanOutSink.writeNALUnit(nal);
+      expectedNalUnits.push_back(nal);
+    }
+
+  release.set_value();
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+  // Without the AUD, the slow output continues at the IRAP slice with the parameter sets
+  for (const auto &nal : getPicture(true))
+  {
+    fanOutSink.writeNALUnit(nal);
+    expectedNalUnits.push_back(nal);
+  }
+  fanOutSink.finish();
+
+  EXPECT_EQ(fast->nalUnits, expectedNalUnits);
+
+  // The NAL units up to the full queue (and the one that was written first) and then the IRAP
+  const auto &written = slow->nalUnits;
+  ASSERT_GE(written.size(), 8u + 4u);
+  ASSERT_LE(written.size(), 9u + 4u);
+  const auto nrBeforeDropping = written.size() - 4;
+  EXPECT_EQ(std::vector<ByteVector>(written.begin(), written.begin() + nrBeforeDropping),
+            std::vector<ByteVector>(expectedNalUnits.begin(),
+                                    expectedNalUnits.begin() + nrBeforeDropping));
+  EXPECT_EQ(std::vector<ByteVector>(written.begin() + nrBeforeDropping, written.end()),
+            std::vector<ByteVector>({vps, sps, pps, idrSlice}));
+  EXPECT_TRUE(slow->finished);
+
+  // The parameter sets were written again. Each dropped picture has one slice.
+  const auto &fastStatistics = statistics.getOutput(0);
+  const auto &slowStatistics = statistics.getOutput(1);
+  EXPECT_EQ(fastStatistics.nrDroppedNalUnits, 0u);
+  EXPECT_EQ(fastStatistics.queueDepth, 0u);
+  EXPECT_EQ(slowStatistics.nrDroppedNalUnits, expectedNalUnits.size() + 3 - written.size());
+  const auto nrDroppedSlices =
+      std::count(expectedNalUnits.begin() + nrBeforeDropping, expectedNalUnits.end(), slice);
+  EXPECT_EQ(slowStatistics.nrDroppedPictures, static_cast<uint64_t>(nrDroppedSlices));
+  EXPECT_EQ(slowStatistics.queueDepth, 0u);
+}
+
+TEST(FanOutSink, TestRASLPicturesAreDroppedAfterContinuingAtACRA)
+{
+  std::promise<void> release;
+  auto               fastSink = std::make_unique<RecordingSink>();
+  auto               slowSink = std::make_unique<RecordingSink>(release.get_future().share());
+  auto               fast     = fastSink.get();
+  auto               slow     = slowSink.get();
+
+  FanOutSink fanOutSink(8);
+  fanOutSink.addSink(std::move(fastSink), FanOutSink::OverflowPolicy::Wait);
+  fanOutSink.addSink(std::move(slowSink), FanOutSink::OverflowPolicy::DropUntilIRAP);
+
+  std::vector<ByteVector> expectedNalUnits;
+  const auto              write = [&](const std::vector<ByteVector> &nalUnits) {
+    for (const auto &nal : nalUnits)
+    {
+      fanOutSink.writeNALUnit(nal);
+      expectedNalUnits.push_back(nal);
+    }
+  };
+
+  for (int picture = 0; picture < 6; ++picture)
+    write(getPicture(picture == 0));
+  release.set_value();
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+  // A CRA picture followed by a RASL picture (with a suffix SEI), a RADL picture and a trailing
+  // picture. The RASL picture references a picture that the slow output dropped.
+  write({aud, vps, sps, pps, craSlice});
+  write({aud, rasl, suffix});
+  write({aud, radl});
+  write({aud, slice});
+  fanOutSink.finish();
+
+  EXPECT_EQ(fast->nalUnits, expectedNalUnits);
+
+  const std::vector<ByteVector> expectedEnd = {vps, sps, pps, craSlice, aud, radl, aud, slice};
+  const auto                   &written     = slow->nalUnits;
+  ASSERT_GE(written.size(), expectedEnd.size());
+  EXPECT_EQ(std::vector<ByteVector>(written.end() - expectedEnd.size(), written.end()),
+            expectedEnd);
+  EXPECT_TRUE(slow->finished);
+}
+
+TEST(FanOutSink, TestNalUnitsWithNewHeaderArePassedOnWithTheirFileRange)
+{
+  auto sink1  = std::make_unique<NewHeaderRecordingSink>();
+  auto sink2  = std::make_unique<NewHeaderRecordingSink>();
+  auto first  = sink1.get();
+  auto second = sink2.get();
+
+  FanOutSink fanOutSink(4);
+  fanOutSink.addSink(std::move(sink1), FanOutSink::OverflowPolicy::Wait);
+  fanOutSink.addSink(std::move(sink2), FanOutSink::OverflowPolicy::DropUntilIRAP);
+
+  // The range points to a path that is gone before the outputs write the NAL unit
+  const ByteVector original  = {0x02, 0x01, 0x50, 0x11, 0x22, 0x33};
+  const ByteVector newHeader = {0x02, 0x01, 0xD0};
+  {
+    const std::filesystem::path inputPath("input.hevc");
+    fanOutSink.writeNALUnitWithNewHeader(newHeader, original, 3, FileRange{&inputPath, 100, 6});
+  }
+  fanOutSink.writeNALUnitWithNewHeader({}, original, 0, {});
+  fanOutSink.finish();
+
+  for (const auto sink : {first, second})
+  {
+    ASSERT_EQ(sink->writes.size(), 2u);
+    const auto &write = sink->writes.at(0);
+    EXPECT_EQ(write.newHeader, newHeader);
+    EXPECT_EQ(write.originalNalData, original);
+    EXPECT_EQ(write.nrReplacedBytes, 3u);
+    ASSERT_TRUE(write.filePath);
+    EXPECT_EQ(*write.filePath, std::filesystem::path("input.hevc"));
+    EXPECT_EQ(write.offset, 100u);
+    EXPECT_EQ(write.size, 6u);
+
+    EXPECT_TRUE(sink->writes.at(1).newHeader.empty());
+    EXPECT_EQ(sink->writes.at(1).originalNalData, original);
+    EXPECT_FALSE(sink->writes.at(1).filePath);
+  }
+}
+
+TEST(FanOutSink, TestErrorOfAnOutputIsThrown)
+{
+  FanOutSink fanOutSink(4);
+  fanOutSink.addSink(std::make_unique<RecordingSink>(), FanOutSink::OverflowPolicy::Wait);
+  fanOutSink.addSink(std::make_unique<FailingSink>(), FanOutSink::OverflowPolicy::Wait);
+  fanOutSink.writeNALUnit(aud);
+  EXPECT_THROW(
+      {
+        for (int i = 0; i < 100; ++i)
+          fanOutSink.writeNALUnit(aud);
+        fanOutSink.finish();
+      },
+      std::runtime_error);
+}
+
+} // namespace combiner
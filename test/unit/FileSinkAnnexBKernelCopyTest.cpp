@@ -0,0 +1,76 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include <gtest/gtest.h>
+
+#include <File/FileSinkAnnexBKernelCopy.h>
+
+#include "Functions.h"
+
+#include <fstream>
+
+namespace combiner
+{
+
+TEST(FileSinkAnnexBKernelCopy, TestSliceDataIsCopiedFromTheInputFile)
+{
+  const auto inputPath  = getUniqueTemporaryPath("FileSinkAnnexBKernelCopyTestInput.hevc");
+  const auto outputPath = getUniqueTemporaryPath("FileSinkAnnexBKernelCopyTestOutput.hevc");
+
+  // Two slices in the input file. The first one is large enough to be copied by the kernel.
+  ByteVector largeSlice = {0x02, 0x01, 0xAF, 0x12};
+  for (size_t i = 0; i < 20000; ++i)
+    largeSlice.push_back(uint8_t(i % 251 + 1));
+  const ByteVector smallSlice = {0x02, 0x01, 0xD0, 0x34, 0x56, 0x78};
+
+  ByteVector input = {0, 0, 0, 1};
+  append(input, largeSlice);
+  append(input, {0, 0, 1});
+  append(input, smallSlice);
+  {
+    std::ofstream file(inputPath, std::ios_base::binary);
+    file.write(reinterpret_cast<const char *>(input.data()), input.size());
+  }
+
+  const ByteVector aud       = {0x46, 0x01, 0x50};
+  const ByteVector newHeader = {0x02, 0x01, 0xAF, 0x99, 0x88};
+
+  PipelineStatistics statistics(1);
+  {
+    FileSinkAnnexBKernelCopy sink(outputPath);
+    sink.setStatistics(&statistics.getOutput());
+    sink.writeNALUnit(aud);
+    sink.writeNALUnitWithNewHeader(
+        newHeader, largeSlice, 4, FileRange{&inputPath, 4, largeSlice.size()});
+    sink.writeNALUnitWithNewHeader(
+        {}, smallSlice, 0, FileRange{&inputPath, 4 + largeSlice.size() + 3, smallSlice.size()});
+    sink.writeNALUnit(aud);
+    sink.finish();
+  }
+
+  ByteVector expected = {0, 0, 0, 1};
+  append(expected, aud);
+  append(expected, {0, 0, 0, 1});
+  append(expected, newHeader);
+  expected.insert(expected.end(), largeSlice.begin() + 4, largeSlice.end());
+  append(expected, {0, 0, 0, 1});
+  append(expected, smallSlice);
+  append(expected, {0, 0, 0, 1});
+  append(expected, aud);
+  EXPECT_EQ(readFile(outputPath), expected);
+
+  const auto &output = statistics.getOutput();
+  EXPECT_EQ(output.bytesWritten.load(), expected.size());
+  EXPECT_EQ(output.nrNalUnits.load(), 4u);
+#ifndef _WIN32
+  EXPECT_EQ(output.bytesCopiedFromInputs.load(), largeSlice.size() - 4);
+#endif
+
+  std::filesystem::remove(inputPath);
+  std::filesystem::remove(outputPath);
+}
+
+} // namespace combiner
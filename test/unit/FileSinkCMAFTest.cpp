@@ -0,0 +1,81 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include <gtest/gtest.h>
+
+#include <File/FileSinkCMAF.h>
+#include <File/FileSourceMP4.h>
+
+#include "Functions.h"
+
+#include <algorithm>
+
+namespace combiner
+{
+
+namespace
+{
+
+uint32_t readU32(const ByteVector &data, const size_t position)
+{
+  return (uint32_t(data.at(position)) << 24) | (uint32_t(data.at(position + 1)) << 16) |
+         (uint32_t(data.at(position + 2)) << 8) | uint32_t(data.at(position + 3));
+}
+
+} // namespace
+
+TEST(FileSinkCMAF, TestWrittenFileCanBeReadBackWithCompositionOffsetsFromPOC)
+{
+  const auto filePath = getUniqueTemporaryPath("FileSinkCMAFTest.mp4");
+  const auto nalUnits = getTestNalUnits();
+  {
+    FileSinkCMAF sink(filePath);
+    for (const auto &nal : nalUnits)
+      sink.writeNALUnit(nal);
+    sink.finish();
+  }
+
+  {
+    // The parameter sets are in the first sample, so they are not returned from the hvcC again
+    FileSourceMP4           source(filePath);
+    std::vector<ByteVector> readNalUnits;
+    while (true)
+    {
+      auto nal = source.getNextNALUnit();
+      if (nal.empty())
+        break;
+      readNalUnits.push_back(std::move(nal));
+    }
+    EXPECT_EQ(readNalUnits, nalUnits);
+  }
+
+  const auto data = readFile(filePath);
+
+  // One fragment with a version 1 trun: flags, sample_count, data_offset, then per sample the
+  // duration, size, flags and composition time offset.
+  const ByteVector trunType = {'t', 'r', 'u', 'n'};
+  const auto trunStart = std::search(data.begin(), data.end(), trunType.begin(), trunType.end());
+  ASSERT_NE(trunStart, data.end());
+  const auto position = static_cast<size_t>(std::distance(data.begin(), trunStart)) + 4;
+  EXPECT_EQ(data.at(position), 1);
+  ASSERT_EQ(readU32(data, position + 4), 3u);
+
+  const auto sampleDuration = static_cast<int32_t>(readU32(data, position + 12));
+  ASSERT_GT(sampleDuration, 0);
+  const std::vector<int32_t> expectedOffsets = {0, 3, -1};
+  for (size_t i = 0; i < expectedOffsets.size(); ++i)
+  {
+    const auto samplePosition = position + 12 + i * 16;
+    EXPECT_EQ(static_cast<int32_t>(readU32(data, samplePosition + 12)),
+              expectedOffsets.at(i) * sampleDuration);
+    const auto isSync = (readU32(data, samplePosition + 8) & 0x00010000) == 0;
+    EXPECT_EQ(isSync, i == 0);
+  }
+
+  std::filesystem::remove(filePath);
+}
+
+} // namespace combiner
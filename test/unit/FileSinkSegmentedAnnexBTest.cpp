@@ -0,0 +1,88 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include <gtest/gtest.h>
+
+#include <File/FileSinkSegmentedAnnexB.h>
+
+#include "Functions.h"
+
+#include <string>
+
+namespace combiner
+{
+
+namespace
+{
+
+ByteVector annexB(const std::vector<ByteVector> &nalUnits)
+{
+  ByteVector data;
+  for (const auto &nal : nalUnits)
+  {
+    data.insert(data.end(), {0, 0, 0, 1});
+    data.insert(data.end(), nal.begin(), nal.end());
+  }
+  return data;
+}
+
+std::string readTextFile(const std::filesystem::path &filePath)
+{
+  const auto data = readFile(filePath);
+  return std::string(data.begin(), data.end());
+}
+
+const auto vps    = withHeader({0x40, 0x01}, RAW_VPS_DATA);
+const auto sps    = withHeader({0x42, 0x01}, RAW_SPS_DATA);
+const auto pps    = withHeader({0x44, 0x01}, RAW_PPS_DATA);
+const auto aud    = ByteVector({0x46, 0x01, 0x50});
+const auto idr    = withHeader({0x28, 0x01}, RAW_SLICE_HEADER_DATA_SLICE_0);
+const auto trailR = withHeader({0x02, 0x01}, RAW_SLICE_HEADER_DATA_SLICE_1);
+const auto trailN = withHeader({0x00, 0x01}, RAW_SLICE_HEADER_DATA_SLICE_2);
+
+} // namespace
+
+TEST(FileSinkSegmentedAnnexB, TestSegmentsStartAtIRAPWithParameterSets)
+{
+  const auto directory = getUniqueTemporaryPath("FileSinkSegmentedAnnexBTest");
+  std::filesystem::create_directories(directory);
+  const auto filePath = directory / "output.hevc";
+
+  // 3 GOPs. Only the first IRAP carries the parameter sets.
+  {
+    FileSinkSegmentedAnnexB sink(filePath, SegmentLength{{}, 2});
+    for (const auto &nal : {aud, vps, sps, pps, idr, aud, trailR, aud, trailN,
+                            aud, idr, aud, trailR,
+                            aud, idr, aud, trailN})
+      sink.writeNALUnit(nal);
+    sink.finish();
+  }
+
+  EXPECT_EQ(readFile(FileSinkSegmentedAnnexB::getSegmentPath(filePath, 0)),
+            annexB({aud, vps, sps, pps, idr, aud, trailR, aud, trailN, aud, idr, aud, trailR}));
+  EXPECT_EQ(readFile(FileSinkSegmentedAnnexB::getSegmentPath(filePath, 1)),
+            annexB({aud, vps, sps, pps, idr, aud, trailN}));
+  EXPECT_FALSE(std::filesystem::exists(FileSinkSegmentedAnnexB::getSegmentPath(filePath, 2)));
+
+  const auto playlist = readTextFile(FileSinkSegmentedAnnexB::getPlaylistPath(filePath));
+  EXPECT_EQ(playlist.rfind("#EXTM3U\n", 0), 0u);
+  EXPECT_NE(playlist.find("\noutput_00000.hevc\n"), std::string::npos);
+  EXPECT_NE(playlist.find("\noutput_00001.hevc\n"), std::string::npos);
+  EXPECT_NE(playlist.find("\n#EXT-X-ENDLIST\n"), std::string::npos);
+
+  std::filesystem::remove_all(directory);
+}
+
+TEST(FileSinkSegmentedAnnexB, TestSegmentPaths)
+{
+  EXPECT_EQ(FileSinkSegmentedAnnexB::getSegmentPath("dir/out.hevc", 12),
+            std::filesystem::path("dir/out_00012.hevc"));
+  EXPECT_EQ(FileSinkSegmentedAnnexB::getPlaylistPath("dir/out.hevc"),
+            std::filesystem::path("dir/out.m3u8"));
+  EXPECT_THROW(FileSinkSegmentedAnnexB("out.hevc", SegmentLength{}), std::invalid_argument);
+}
+
+} // namespace combiner
@@ -0,0 +1,119 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include <gtest/gtest.h>
+
+#include <File/FileSinkTS.h>
+#include <File/FileSourceTS.h>
+
+#include "Functions.h"
+
+namespace combiner
+{
+
+namespace
+{
+
+struct ReadNalUnit
+{
+  ByteVector data;
+  Timestamps timestamps;
+};
+
+std::vector<ReadNalUnit> readTransportStream(const std::filesystem::path &filePath)
+{
+  FileSourceTS             source(filePath);
+  std::vector<ReadNalUnit> nalUnits;
+  while (true)
+  {
+    auto nal = source.getNextNALUnit();
+    if (nal.empty())
+      return nalUnits;
+    nalUnits.push_back({std::move(nal), source.getTimestampsOfLastNALUnit()});
+  }
+}
+
+} // namespace
+
+TEST(FileSinkTS, TestWrittenStreamCanBeReadBackWithTimestampsFromPOC)
+{
+  const auto filePath = getUniqueTemporaryPath("FileSinkTSTest.ts");
+  const auto nalUnits = getTestNalUnits();
+  {
+    FileSinkTS sink(filePath);
+    for (const auto &nal : nalUnits)
+      sink.writeNALUnit(nal);
+    sink.finish();
+  }
+
+  const auto data = readFile(filePath);
+  ASSERT_EQ(data.size() % 188, 0u);
+  for (size_t position = 0; position < data.size(); position += 188)
+    EXPECT_EQ(data.at(position), 0x47);
+
+  const auto readNalUnits = readTransportStream(filePath);
+  ASSERT_EQ(readNalUnits.size(), nalUnits.size());
+  for (size_t i = 0; i < nalUnits.size(); ++i)
+  {
+    EXPECT_EQ(readNalUnits.at(i).data, nalUnits.at(i));
+    EXPECT_TRUE(readNalUnits.at(i).timestamps.PTS);
+    EXPECT_TRUE(readNalUnits.at(i).timestamps.DTS);
+  }
+
+  // One PES packet per access unit. The pictures are decoded one picture duration apart and the
+  // picture with POC 4 is presented 4 picture durations after the IDR.
+  const auto &idr      = readNalUnits.at(3).timestamps;
+  const auto &trailR   = readNalUnits.at(4).timestamps;
+  const auto &trailN   = readNalUnits.at(5).timestamps;
+  const auto  duration = *trailR.DTS - *idr.DTS;
+  EXPECT_GT(duration, 0u);
+  EXPECT_EQ(*trailN.DTS - *trailR.DTS, duration);
+  EXPECT_EQ(*trailR.PTS - *idr.PTS, 4 * duration);
+  EXPECT_EQ(readNalUnits.at(0).timestamps.PTS, idr.PTS);
+  for (const auto &nal : readNalUnits)
+    EXPECT_GE(*nal.timestamps.PTS, *nal.timestamps.DTS);
+
+  std::filesystem::remove(filePath);
+}
+
+TEST(FileSinkTS, TestInputTimestampsAndConstantMuxRate)
+{
+  const auto filePath = getUniqueTemporaryPath("FileSinkTSTest.ts");
+  const auto nalUnits = getTestNalUnits();
+
+  // The access units are 1 second apart, so the constant rate is filled up with null packets
+  constexpr uint64_t            MUX_RATE = 1000000;
+  const std::vector<Timestamps> timestamps = {
+      {900000, 900000}, {1170000, 990000}, {1080000, 1080000}};
+  {
+    FileSinkTS sink(filePath, std::chrono::milliseconds(20), MUX_RATE);
+    for (size_t i = 0; i < nalUnits.size(); ++i)
+    {
+      sink.setTimestampsOfNextNALUnits(timestamps.at(i < 3 ? 0 : i - 3));
+      sink.writeNALUnit(nalUnits.at(i));
+    }
+    sink.finish();
+  }
+
+  const auto readNalUnits = readTransportStream(filePath);
+  ASSERT_EQ(readNalUnits.size(), nalUnits.size());
+  for (size_t i = 0; i < nalUnits.size(); ++i)
+  {
+    EXPECT_EQ(readNalUnits.at(i).data, nalUnits.at(i));
+    const auto &expected = timestamps.at(i < 3 ? 0 : i - 3);
+    EXPECT_EQ(readNalUnits.at(i).timestamps.PTS, expected.PTS);
+    EXPECT_EQ(readNalUnits.at(i).timestamps.DTS, expected.DTS);
+  }
+
+  // 2 seconds between the first and the last access unit at 1 Mbit/s
+  const auto nrPackets = readFile(filePath).size() / 188;
+  EXPECT_GE(nrPackets, 2 * MUX_RATE / (188 * 8));
+  EXPECT_LE(nrPackets, 2 * MUX_RATE / (188 * 8) + 10);
+
+  std::filesystem::remove(filePath);
+}
+
+} // namespace combiner
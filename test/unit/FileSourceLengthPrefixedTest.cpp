@@ -0,0 +1,136 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include <gtest/gtest.h>
+
+#include <File/FileSinkLengthPrefixed.h>
+#include <File/FileSourceLengthPrefixed.h>
+
+#include "Functions.h"
+
+#include <sys/stat.h>
+
+#include <fstream>
+#include <stdexcept>
+#include <thread>
+
+namespace combiner
+{
+
+namespace
+{
+
+const std::vector<ByteVector> testNalUnits = {
+    withHeader({0x40, 0x01}, RAW_VPS_DATA),
+    withHeader({0x42, 0x01}, RAW_SPS_DATA),
+    withHeader({0x44, 0x01}, RAW_PPS_DATA),
+    // A slice that contains a start code and is larger than 16 bit
+    withHeader(withHeader({0x28, 0x01}, RAW_SLICE_HEADER_DATA_SLICE_0),
+               withHeader({0x00, 0x00, 0x01}, ByteVector(70000, 0x55)))};
+
+std::vector<ByteVector> readNalUnits(FileSourceLengthPrefixed &source)
+{
+  std::vector<ByteVector> nalUnits;
+  while (true)
+  {
+    auto nal = source.getNextNALUnit();
+    if (nal.empty())
+      return nalUnits;
+    nalUnits.push_back(std::move(nal));
+  }
+}
+
+} // namespace
+
+TEST(FileSourceLengthPrefixed, TestWritingAndReadingOfNalUnits)
+{
+  const auto filePath = getUniqueTemporaryPath("FileSourceLengthPrefixedTest.hvcl");
+  EXPECT_TRUE(FileSourceLengthPrefixed::isLengthPrefixedFile(filePath));
+  EXPECT_FALSE(FileSourceLengthPrefixed::isLengthPrefixedFile("test.hevc"));
+
+  {
+    FileSinkLengthPrefixed sink(filePath);
+    for (const auto &nal : testNalUnits)
+      sink.writeNALUnit(nal);
+  }
+
+  uint64_t expectedFileSize = 0;
+  for (const auto &nal : testNalUnits)
+    expectedFileSize += 4 + nal.size();
+  EXPECT_EQ(std::filesystem::file_size(filePath), expectedFileSize);
+
+  FileSourceLengthPrefixed source(filePath);
+  EXPECT_EQ(source.getNextNALUnit(), testNalUnits.at(0));
+  EXPECT_EQ(source.getFileOffsetOfLastNALUnit(), 4u);
+  EXPECT_EQ(source.getNextNALUnit(), testNalUnits.at(1));
+  EXPECT_EQ(source.getFileOffsetOfLastNALUnit(), 4u + testNalUnits.at(0).size() + 4u);
+  const auto remaining = readNalUnits(source);
+  EXPECT_EQ(remaining, std::vector<ByteVector>(testNalUnits.begin() + 2, testNalUnits.end()));
+
+  std::filesystem::remove(filePath);
+}
+
+TEST(FileSourceLengthPrefixed, TestTruncatedNalUnitIsAnError)
+{
+  const auto filePath = getUniqueTemporaryPath("FileSourceLengthPrefixedTest.hvcl");
+  {
+    FileSinkLengthPrefixed sink(filePath);
+    for (const auto &nal : testNalUnits)
+      sink.writeNALUnit(nal);
+  }
+  std::filesystem::resize_file(filePath, std::filesystem::file_size(filePath) - 10);
+
+  FileSourceLengthPrefixed source(filePath);
+  for (size_t i = 0; i + 1 < testNalUnits.size(); ++i)
+    EXPECT_EQ(source.getNextNALUnit(), testNalUnits.at(i));
+  EXPECT_THROW(source.getNextNALUnit(), std::runtime_error);
+
+  std::filesystem::remove(filePath);
+}
+
+TEST(FileSourceLengthPrefixed, TestInvalidLengthPrefixIsAnError)
+{
+  const auto filePath = getUniqueTemporaryPath("FileSourceLengthPrefixedTest.hvcl");
+  for (const auto &invalidPrefix : {ByteVector({0, 0, 0, 0}), ByteVector({0, 0})})
+  {
+    {
+      FileSinkLengthPrefixed sink(filePath);
+      sink.writeNALUnit(testNalUnits.at(0));
+    }
+    {
+      std::ofstream file(filePath, std::ios_base::binary | std::ios_base::app);
+      file.write(reinterpret_cast<const char *>(invalidPrefix.data()), invalidPrefix.size());
+    }
+
+    FileSourceLengthPrefixed source(filePath);
+    EXPECT_EQ(source.getNextNALUnit(), testNalUnits.at(0));
+    EXPECT_THROW(source.getNextNALUnit(), std::runtime_error);
+  }
+
+  std::filesystem::remove(filePath);
+}
+
+TEST(FileSourceLengthPrefixed, TestReadingFromAPipe)
+{
+  const auto filePath = getUniqueTemporaryPath("FileSourceLengthPrefixedTest.hvcl");
+  ASSERT_EQ(mkfifo(filePath.c_str(), 0600), 0);
+
+  std::thread writer([&filePath]() {
+    FileSinkLengthPrefixed sink(filePath);
+    for (const auto &nal : testNalUnits)
+      sink.writeNALUnit(nal);
+  });
+
+  {
+    FileSourceLengthPrefixed source(filePath);
+    EXPECT_EQ(readNalUnits(source), testNalUnits);
+  }
+  writer.join();
+
+  std::filesystem::remove(filePath);
+}
+
+} // namespace combiner
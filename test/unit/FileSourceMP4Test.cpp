@@ -0,0 +1,216 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include <gtest/gtest.h>
+
+#include <File/FileSourceMP4.h>
+
+#include "Functions.h"
+
+#include <fstream>
+
+namespace combiner
+{
+
+namespace
+{
+
+void appendValue(ByteVector &data, const uint64_t value, const unsigned nrBytes)
+{
+  for (unsigned i = nrBytes; i > 0; --i)
+    data.push_back(static_cast<uint8_t>(value >> (8 * (i - 1))));
+}
+
+ByteVector box(const std::string &type, const ByteVector &payload)
+{
+  ByteVector data;
+  data.reserve(payload.size() + 8);
+  appendValue(data, payload.size() + 8, 4);
+  data.insert(data.end(), type.begin(), type.end());
+  append(data, payload);
+  return data;
+}
+
+ByteVector fullBox(const std::string &type, const uint32_t flags, const ByteVector &payload)
+{
+  ByteVector data;
+  appendValue(data, flags, 4);
+  append(data, payload);
+  return box(type, data);
+}
+
+ByteVector values(const std::vector<uint32_t> &values)
+{
+  ByteVector data;
+  for (const auto value : values)
+    appendValue(data, value, 4);
+  return data;
+}
+
+// A sample with 4 byte length prefixed NAL units
+ByteVector sample(const std::vector<ByteVector> &nalUnits)
+{
+  ByteVector data;
+  for (const auto &nal : nalUnits)
+  {
+    appendValue(data, nal.size(), 4);
+    append(data, nal);
+  }
+  return data;
+}
+
+ByteVector moov(const std::vector<ByteVector> &parameterSets,
+                const ByteVector              &sampleTables,
+                const ByteVector              &mvex)
+{
+  ByteVector hvcC(21);
+  hvcC.push_back(0x03);
+  hvcC.push_back(static_cast<uint8_t>(parameterSets.size()));
+  for (const auto &nal : parameterSets)
+  {
+    hvcC.push_back(0x80 | (nal.at(0) >> 1));
+    appendValue(hvcC, 1, 2);
+    appendValue(hvcC, nal.size(), 2);
+    append(hvcC, nal);
+  }
+
+  ByteVector sampleEntry(78);
+  append(sampleEntry, box("hvcC", hvcC));
+
+  auto stbl = fullBox("stsd", 0, withHeader(values({1}), box("hvc1", sampleEntry)));
+  append(stbl, sampleTables);
+
+  auto mdia = fullBox("hdlr", 0, withHeader(values({0}), {'v', 'i', 'd', 'e', 0, 0, 0, 0}));
+  append(mdia, box("minf", box("stbl", stbl)));
+
+  auto trak = fullBox("tkhd", 3, values({0, 0, 1, 0, 0, 0, 0}));
+  append(trak, box("mdia", mdia));
+
+  auto moovData = box("trak", trak);
+  append(moovData, mvex);
+  return box("moov", moovData);
+}
+
+std::filesystem::path writeTestFile(const ByteVector &data)
+{
+  const auto    filePath = getUniqueTemporaryPath("FileSourceMP4Test.mp4");
+  std::ofstream file(filePath, std::ios_base::binary);
+  file.write(reinterpret_cast<const char *>(data.data()), data.size());
+  return filePath;
+}
+
+std::vector<ByteVector> readAllNalUnits(FileSourceMP4 &fileSource)
+{
+  std::vector<ByteVector> nalUnits;
+  while (true)
+  {
+    auto nal = fileSource.getNextNALUnit();
+    if (nal.empty())
+      return nalUnits;
+    nalUnits.push_back(std::move(nal));
+  }
+}
+
+const auto ftyp = box("ftyp", {'i', 's', 'o', 'm', 0, 0, 0, 0, 'h', 'v', 'c', '1'});
+
+const std::vector<ByteVector> parameterSets = {withHeader({0x40, 0x01}, RAW_VPS_DATA),
+                                               withHeader({0x42, 0x01}, RAW_SPS_DATA),
+                                               withHeader({0x44, 0x01}, RAW_PPS_DATA)};
+
+// AUD + CRA, AUD + TRAIL_R, AUD + TRAIL_R (2 slices)
+const std::vector<std::vector<ByteVector>> samples = {
+    {{0x46, 0x01, 0x50}, {0x2A, 0x01, 0x80, 0x11}},
+    {{0x46, 0x01, 0x50}, {0x02, 0x01, 0x80, 0x22}},
+    {{0x46, 0x01, 0x50}, {0x02, 0x01, 0x80, 0x33}, {0x02, 0x01, 0x40, 0x44}}};
+
+std::vector<ByteVector> getExpectedNalUnits()
+{
+  auto nalUnits = parameterSets;
+  for (const auto &nalUnitsOfSample : samples)
+    nalUnits.insert(nalUnits.end(), nalUnitsOfSample.begin(), nalUnitsOfSample.end());
+  return nalUnits;
+}
+
+} // namespace
+
+TEST(FileSourceMP4, TestReadingOfSamplesFromTheSampleTable)
+{
+  // ftyp, mdat, moov. The first chunk contains two samples and the second chunk one.
+  ByteVector mdat;
+  for (const auto &nalUnitsOfSample : samples)
+    append(mdat, sample(nalUnitsOfSample));
+  const auto firstChunkOffset  = ftyp.size() + 8;
+  const auto secondChunkOffset = firstChunkOffset + sample(samples.at(0)).size() +
+                                 sample(samples.at(1)).size();
+
+  auto sampleTables = fullBox("stsz",
+                              0,
+                              values({0,
+                                      3,
+                                      uint32_t(sample(samples.at(0)).size()),
+                                      uint32_t(sample(samples.at(1)).size()),
+                                      uint32_t(sample(samples.at(2)).size())}));
+  append(sampleTables, fullBox("stsc", 0, values({2, 1, 2, 1, 2, 1, 1})));
+  append(sampleTables,
+         fullBox("stco", 0, values({2, uint32_t(firstChunkOffset), uint32_t(secondChunkOffset)})));
+
+  auto file = ftyp;
+  append(file, box("mdat", mdat));
+  append(file, moov(parameterSets, sampleTables, {}));
+  const auto filePath = writeTestFile(file);
+
+  EXPECT_TRUE(FileSourceMP4::isMP4File(filePath));
+
+  FileSourceMP4 fileSource(filePath);
+  EXPECT_EQ(readAllNalUnits(fileSource), getExpectedNalUnits());
+  EXPECT_EQ(fileSource.getFileOffsetOfLastNALUnit(), ftyp.size() + 8 + mdat.size() - 4);
+
+  std::filesystem::remove(filePath);
+}
+
+TEST(FileSourceMP4, TestReadingOfSamplesFromTrackFragments)
+{
+  // ftyp, moov (without samples), one moof + mdat per sample
+  auto sampleTables = fullBox("stsz", 0, values({0, 0}));
+  append(sampleTables, fullBox("stsc", 0, values({0})));
+  append(sampleTables, fullBox("stco", 0, values({0})));
+  const auto mvex = box("mvex", fullBox("trex", 0, values({1, 1, 0, 0, 0})));
+
+  auto file = ftyp;
+  append(file, moov(parameterSets, sampleTables, mvex));
+  for (const auto &nalUnitsOfSample : samples)
+  {
+    const auto sampleData = sample(nalUnitsOfSample);
+
+    // The data offset is relative to the start of the moof and the mdat follows the moof
+    const auto moofSize = 8 + 16 + 8 + 16 + 24;
+    auto       traf     = fullBox("tfhd", 0x020000, values({1}));
+    append(traf, fullBox("trun", 0x000201, values({1, moofSize + 8, uint32_t(sampleData.size())})));
+    auto moofData = fullBox("mfhd", 0, values({1}));
+    append(moofData, box("traf", traf));
+
+    const auto moof = box("moof", moofData);
+    ASSERT_EQ(moof.size(), moofSize);
+    append(file, moof);
+    append(file, box("mdat", sampleData));
+  }
+  const auto filePath = writeTestFile(file);
+
+  FileSourceMP4 fileSource(filePath);
+  EXPECT_EQ(readAllNalUnits(fileSource), getExpectedNalUnits());
+
+  std::filesystem::remove(filePath);
+}
+
+TEST(FileSourceMP4, TestAnnexBFileIsNoMP4File)
+{
+  const auto filePath = writeTestFile({0, 0, 0, 1, 0x40, 0x01});
+  EXPECT_FALSE(FileSourceMP4::isMP4File(filePath));
+  EXPECT_THROW(FileSourceMP4 fileSource(filePath), std::runtime_error);
+  std::filesystem::remove(filePath);
+}
+
+} // namespace combiner
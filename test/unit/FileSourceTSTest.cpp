@@ -0,0 +1,227 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include <gtest/gtest.h>
+
+#include <File/FileSourceTS.h>
+
+#include "Functions.h"
+
+#include <fstream>
+
+namespace combiner
+{
+
+namespace
+{
+
+constexpr uint16_t PMT_PID   = 0x100;
+constexpr uint16_t VIDEO_PID = 0x101;
+
+// A packet with the payload. Shorter payloads are filled up with adaptation field stuffing.
+ByteVector packet(const uint16_t     PID,
+                  const bool         payloadUnitStart,
+                  const uint8_t      continuityCounter,
+                  const ByteVector &payload)
+{
+  ByteVector data = {0x47,
+                     uint8_t((payloadUnitStart ? 0x40 : 0x00) | (PID >> 8)),
+                     uint8_t(PID & 0xff),
+                     uint8_t(0x10 | continuityCounter)};
+  if (payload.size() < 184)
+  {
+    data.at(3) |= 0x20;
+    const auto adaptationFieldLength = 183 - payload.size();
+    data.push_back(uint8_t(adaptationFieldLength));
+    if (adaptationFieldLength > 0)
+    {
+      data.push_back(0x00);
+      data.insert(data.end(), adaptationFieldLength - 1, 0xff);
+    }
+  }
+  append(data, payload);
+  return data;
+}
+
+// A section with the pointer field and a (not checked) CRC
+ByteVector section(const uint8_t tableID, const uint16_t tableIDExtension, const ByteVector &data)
+{
+  const auto sectionLength = data.size() + 5 + 4;
+  ByteVector payload;
+  payload.reserve(sectionLength + 4);
+  append(payload,
+         {0x00,
+          tableID,
+          uint8_t(0xB0 | (sectionLength >> 8)),
+          uint8_t(sectionLength & 0xff),
+          uint8_t(tableIDExtension >> 8),
+          uint8_t(tableIDExtension & 0xff),
+          0xC1,
+          0x00,
+          0x00});
+  append(payload, data);
+  append(payload, {0, 0, 0, 0});
+  return payload;
+}
+
+ByteVector timestamp(const uint8_t prefix, const uint64_t value)
+{
+  return {uint8_t((prefix << 4) | ((value >> 29) & 0x0e) | 1),
+          uint8_t(value >> 22),
+          uint8_t(((value >> 14) & 0xfe) | 1),
+          uint8_t(value >> 7),
+          uint8_t(((value << 1) & 0xfe) | 1)};
+}
+
+// The packets of a PES packet with PTS and DTS which carries the NAL units with start codes
+std::vector<ByteVector> pesPackets(const std::vector<ByteVector> &nalUnits,
+                                   const uint64_t                 PTS,
+                                   const uint64_t                 DTS,
+                                   uint8_t                       &continuityCounter)
+{
+  ByteVector pes = {0x00, 0x00, 0x01, 0xE0, 0x00, 0x00, 0x80, 0xC0, 10};
+  append(pes, timestamp(0x3, PTS));
+  append(pes, timestamp(0x1, DTS));
+  for (const auto &nal : nalUnits)
+  {
+    append(pes, {0x00, 0x00, 0x00, 0x01});
+    append(pes, nal);
+  }
+
+  std::vector<ByteVector> packets;
+  for (size_t position = 0; position < pes.size(); position += 184)
+  {
+    const auto end = std::min(position + 184, pes.size());
+    packets.push_back(packet(VIDEO_PID,
+                             position == 0,
+                             continuityCounter,
+                             ByteVector(pes.begin() + position, pes.begin() + end)));
+    continuityCounter = (continuityCounter + 1) & 0x0f;
+  }
+  return packets;
+}
+
+const ByteVector fillerNalUnit = withHeader({0x4E, 0x01}, ByteVector(400, 0x55));
+
+// The NAL units of the 3 PES packets and their timestamps
+const std::vector<std::vector<ByteVector>> pesNalUnits = {
+    {withHeader({0x40, 0x01}, RAW_VPS_DATA),
+     withHeader({0x42, 0x01}, RAW_SPS_DATA),
+     withHeader({0x44, 0x01}, RAW_PPS_DATA),
+     withHeader({0x28, 0x01}, RAW_SLICE_HEADER_DATA_SLICE_0)},
+    {fillerNalUnit, withHeader({0x02, 0x01}, RAW_SLICE_HEADER_DATA_SLICE_1)},
+    {withHeader({0x00, 0x01}, RAW_SLICE_HEADER_DATA_SLICE_2)}};
+const std::vector<uint64_t> pesPTS = {0x1FFFFFFFF, 0x100002EE0, 7200};
+const std::vector<uint64_t> pesDTS = {0x1FFFFF8F8, 0x100000BB8, 3600};
+
+std::vector<std::vector<ByteVector>> getTestPESPackets()
+{
+  std::vector<std::vector<ByteVector>> packets;
+  uint8_t                              continuityCounter = 0;
+  for (size_t i = 0; i < pesNalUnits.size(); ++i)
+    packets.push_back(pesPackets(pesNalUnits.at(i), pesPTS.at(i), pesDTS.at(i), continuityCounter));
+  return packets;
+}
+
+ByteVector programTables()
+{
+  const ByteVector programs = {0x00, 0x01, uint8_t(0xE0 | (PMT_PID >> 8)), uint8_t(PMT_PID & 0xff)};
+  auto             data     = packet(0, true, 0, section(0x00, 1, programs));
+  append(data,
+         packet(PMT_PID,
+                true,
+                0,
+                section(0x02,
+                        1,
+                        {0xE1, 0x01, 0xF0, 0x00, 0x24, uint8_t(0xE0 | (VIDEO_PID >> 8)), 0x01, 0xF0,
+                         0x00})));
+  return data;
+}
+
+std::filesystem::path writeTestFile(const ByteVector &data)
+{
+  const auto    filePath = getUniqueTemporaryPath("FileSourceTSTest.ts");
+  std::ofstream file(filePath, std::ios_base::binary);
+  file.write(reinterpret_cast<const char *>(data.data()), data.size());
+  return filePath;
+}
+
+} // namespace
+
+TEST(FileSourceTS, TestReadingOfNalUnitsAndTimestampsFromPESPackets)
+{
+  auto file = programTables();
+  for (const auto &packets : getTestPESPackets())
+  {
+    // The second PES packet spans 3 packets. Sending a packet twice must not duplicate data.
+    for (const auto &packet : packets)
+      append(file, packet);
+    append(file, packets.back());
+  }
+  const auto filePath = writeTestFile(file);
+
+  EXPECT_TRUE(FileSourceTS::isTSFile(filePath));
+
+  FileSourceTS fileSource(filePath);
+  for (size_t i = 0; i < pesNalUnits.size(); ++i)
+  {
+    for (const auto &expectedNalUnit : pesNalUnits.at(i))
+    {
+      EXPECT_EQ(fileSource.getNextNALUnit(), expectedNalUnit);
+      const auto timestamps = fileSource.getTimestampsOfLastNALUnit();
+      EXPECT_EQ(timestamps.PTS, pesPTS.at(i));
+      EXPECT_EQ(timestamps.DTS, pesDTS.at(i));
+    }
+  }
+  EXPECT_TRUE(fileSource.getNextNALUnit().empty());
+
+  std::filesystem::remove(filePath);
+}
+
+TEST(FileSourceTS, TestNalUnitWithLostPacketIsDropped)
+{
+  const auto packets = getTestPESPackets();
+  ASSERT_EQ(packets.at(1).size(), 3u);
+
+  // The second packet of the filler NAL unit is lost. The following NAL units are still read.
+  auto file = programTables();
+  for (const auto &pesPackets : packets)
+    for (const auto &packet : pesPackets)
+      if (&packet != &packets.at(1).at(1))
+        append(file, packet);
+  const auto filePath = writeTestFile(file);
+
+  std::vector<ByteVector> expectedNalUnits;
+  for (const auto &nalUnits : pesNalUnits)
+    for (const auto &nal : nalUnits)
+      if (nal != fillerNalUnit)
+        expectedNalUnits.push_back(nal);
+
+  FileSourceTS            fileSource(filePath);
+  std::vector<ByteVector> readNalUnits;
+  while (true)
+  {
+    auto nal = fileSource.getNextNALUnit();
+    if (nal.empty())
+      break;
+    readNalUnits.push_back(std::move(nal));
+  }
+  EXPECT_EQ(readNalUnits, expectedNalUnits);
+
+  std::filesystem::remove(filePath);
+}
+
+TEST(FileSourceTS, TestAnnexBFileIsNoTransportStream)
+{
+  auto data = ByteVector({0, 0, 0, 1, 0x40, 0x01});
+  data.resize(400, 0x55);
+  const auto filePath = writeTestFile(data);
+  EXPECT_FALSE(FileSourceTS::isTSFile(filePath));
+  EXPECT_THROW(FileSourceTS fileSource(filePath), std::runtime_error);
+  std::filesystem::remove(filePath);
+}
+
+} // namespace combiner
@@ -0,0 +1,173 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include <gtest/gtest.h>
+
+#include <Combiner/FrameRateAdaptation.h>
+#include <HEVC/slice_segment_layer_rbsp.h>
+
+namespace combiner
+{
+
+namespace
+{
+
+using namespace parser::hevc;
+
+seq_parameter_set_rbsp spsWithTiming(const uint64_t numUnitsInTick,
+                                     const uint64_t timeScale,
+                                     const uint64_t maxSubLayersMinus1)
+{
+  seq_parameter_set_rbsp sps;
+  sps.sps_max_sub_layers_minus1                  = maxSubLayersMinus1;
+  sps.sps_sub_layer_ordering_info_present_flag   = true;
+  sps.sps_max_dec_pic_buffering_minus1           = vector<uint64_t>(maxSubLayersMinus1 + 1, 3);
+  sps.sps_max_num_reorder_pics                   = vector<uint64_t>(maxSubLayersMinus1 + 1, 0);
+  sps.sps_max_latency_increase_plus1             = vector<uint64_t>(maxSubLayersMinus1 + 1, 0);
+  sps.vui_parameters_present_flag                = true;
+  sps.vuiParameters.vui_timing_info_present_flag = true;
+  sps.vuiParameters.vui_num_units_in_tick        = numUnitsInTick;
+  sps.vuiParameters.vui_time_scale               = timeScale;
+  return sps;
+}
+
+NalUnitHEVC sliceWithReferencePictures(const NalType             nalType,
+                                       const unsigned            temporalId,
+                                       const int                 POC,
+                                       const std::vector<int>  &deltaPocS0,
+                                       const std::vector<bool> &usedByCurrPicS0)
+{
+  NalUnitHEVC nal;
+  nal.header.nal_unit_type         = nalType;
+  nal.header.nalUnitTypeID         = static_cast<unsigned>(nalType);
+  nal.header.nuh_temporal_id_plus1 = temporalId + 1;
+
+  auto  slice  = std::make_unique<slice_segment_layer_rbsp>();
+  auto &header = slice->sliceSegmentHeader;
+
+  header.PicOrderCntVal                  = POC;
+  header.short_term_ref_pic_set_sps_flag = true;
+  header.stRefPicSet = st_ref_pic_set::fromDeltaPocs(deltaPocS0, usedByCurrPicS0, {}, {});
+
+  nal.rbsp = std::move(slice);
+  return nal;
+}
+
+const slice_segment_header &getSliceHeader(const NalUnitHEVC &nal)
+{
+  return dynamic_cast<slice_segment_layer_rbsp &>(*nal.rbsp).sliceSegmentHeader;
+}
+
+} // namespace
+
+TEST(FrameRateAdaptation, TestDecimationFactorsOfPowerOfTwoFrameRates)
+{
+  const auto sps25 = spsWithTiming(1, 25, 0);
+  const auto sps50 = spsWithTiming(1000, 50000, 1);
+
+  EXPECT_EQ(getDecimationFactors({&sps50, &sps25}), std::vector<unsigned>({2, 1}));
+  EXPECT_EQ(getDecimationFactors({&sps25, nullptr, &sps50}), std::vector<unsigned>({1, 1, 2}));
+  EXPECT_TRUE(getDecimationFactors({&sps25, &sps25}).empty());
+
+  auto spsWithoutTiming                                       = sps50;
+  spsWithoutTiming.vuiParameters.vui_timing_info_present_flag = false;
+  EXPECT_TRUE(getDecimationFactors({&spsWithoutTiming, &sps25}).empty());
+}
+
+TEST(FrameRateAdaptation, TestDecimationFactorsAfterRemovingSubLayers)
+{
+  const auto sps25  = spsWithTiming(1, 25, 0);
+  const auto sps50  = spsWithTiming(1, 50, 1);
+  const auto sps100 = spsWithTiming(1, 100, 2);
+
+  // The POCs of the faster inputs must still be scaled if their frame rates match afterwards
+  EXPECT_EQ(getDecimationFactors({&sps100, &sps25}, 1), std::vector<unsigned>({4, 1}));
+  EXPECT_EQ(getDecimationFactors({&sps100, &sps50}, 1), std::vector<unsigned>({2, 1}));
+  EXPECT_EQ(getDecimationFactors({&sps50, &sps25}, 0), std::vector<unsigned>({2, 1}));
+  // The POCs are divided even if all inputs lose the same sub-layers
+  EXPECT_EQ(getDecimationFactors({&sps50, &sps50}, 0), std::vector<unsigned>({2, 2}));
+  EXPECT_TRUE(getDecimationFactors({&sps50, &sps50}, 1).empty());
+}
+
+TEST(FrameRateAdaptation, TestDecimationFactorsThatCanNotBeAdapted)
+{
+  const auto sps25                 = spsWithTiming(1, 25, 1);
+  const auto sps30                 = spsWithTiming(1, 30, 1);
+  const auto sps75                 = spsWithTiming(1, 75, 2);
+  const auto sps50WithoutSubLayers = spsWithTiming(1, 50, 0);
+
+  EXPECT_THROW(getDecimationFactors({&sps25, &sps30}), std::runtime_error);
+  EXPECT_THROW(getDecimationFactors({&sps25, &sps75}), std::runtime_error);
+  EXPECT_THROW(getDecimationFactors({&sps25, &sps50WithoutSubLayers}), std::runtime_error);
+}
+
+TEST(FrameRateAdaptation, TestSliceIsScaledToLowestSubLayer)
+{
+  auto sps                              = spsWithTiming(1, 50, 1);
+  sps.log2_max_pic_order_cnt_lsb_minus4 = 0;
+
+  // The odd POCs are in the dropped sub-layer. They can only be kept for later pictures.
+  auto nal = sliceWithReferencePictures(NalType::TSA_R, 1, 36, {-1, -2, -4}, {false, true, true});
+  EXPECT_TRUE(adaptSliceToDecimation(nal, 2, sps));
+
+  const auto &header = getSliceHeader(nal);
+  EXPECT_EQ(nal.header.nal_unit_type, NalType::TRAIL_R);
+  EXPECT_EQ(nal.header.nalUnitTypeID, 1u);
+  EXPECT_EQ(nal.header.nuh_temporal_id_plus1, 1u);
+  EXPECT_EQ(header.PicOrderCntVal, 18);
+  EXPECT_EQ(header.slice_pic_order_cnt_lsb, 2u);
+  EXPECT_FALSE(header.short_term_ref_pic_set_sps_flag);
+  EXPECT_EQ(header.stRefPicSet.deltaPocS0, std::vector<int>({-1, -2}));
+  EXPECT_EQ(header.stRefPicSet.delta_poc_s0_minus1, std::vector<uint64_t>({0, 0}));
+  EXPECT_EQ(header.stRefPicSet.NumPicTotalCurr(&header), 2u);
+}
+
+TEST(FrameRateAdaptation, TestSliceThatCanNotBeScaled)
+{
+  const auto sps = spsWithTiming(1, 50, 1);
+
+  auto oddPOC = sliceWithReferencePictures(NalType::TRAIL_R, 0, 49, {-1}, {true});
+  EXPECT_FALSE(adaptSliceToDecimation(oddPOC, 2, sps));
+
+  auto usesDroppedPicture = sliceWithReferencePictures(NalType::TRAIL_R, 0, 4, {-1}, {true});
+  EXPECT_THROW(adaptSliceToDecimation(usesDroppedPicture, 2, sps), std::runtime_error);
+}
+
+TEST(FrameRateAdaptation, TestReferencePictureSetsAreMerged)
+{
+  NalUnitVector slices;
+  slices.push_back(sliceWithReferencePictures(NalType::TRAIL_R, 0, 8, {-1, -3}, {true, false}));
+  slices.push_back(sliceWithReferencePictures(NalType::TRAIL_R, 0, 8, {-1, -2}, {true, false}));
+  unifyReferencePictureSets(slices);
+
+  for (const auto &slice : slices)
+  {
+    const auto &rps = getSliceHeader(slice).stRefPicSet;
+    EXPECT_EQ(rps.deltaPocS0, std::vector<int>({-1, -2, -3}));
+    EXPECT_EQ(rps.usedByCurrPicS0, std::vector<bool>({true, false, false}));
+  }
+
+  slices.push_back(sliceWithReferencePictures(NalType::TRAIL_R, 0, 8, {-1, -2}, {true, true}));
+  EXPECT_THROW(unifyReferencePictureSets(slices), std::runtime_error);
+}
+
+TEST(FrameRateAdaptation, TestSPSGetsDecimatedTimingOfFirstInput)
+{
+  const auto sps25 = spsWithTiming(1, 25, 0);
+  auto       sps50 = spsWithTiming(1, 50, 1);
+
+  sps50.sps_max_dec_pic_buffering_minus1 = {4, 6};
+
+  auto combinedSPS = sps50;
+  adaptSPSToDecimation(combinedSPS, {&sps50, &sps25}, {2, 1});
+  EXPECT_EQ(combinedSPS.sps_max_sub_layers_minus1, 0u);
+  EXPECT_TRUE(combinedSPS.sps_temporal_id_nesting_flag);
+  EXPECT_EQ(combinedSPS.sps_max_dec_pic_buffering_minus1, std::vector<uint64_t>({4}));
+  EXPECT_EQ(combinedSPS.vuiParameters.vui_time_scale, 50u);
+  EXPECT_EQ(combinedSPS.vuiParameters.vui_num_units_in_tick, 2u);
+}
+
+} // namespace combiner
@@ -4,13 +4,27 @@
  * For a copy, see <https://opensource.org/licenses/MIT>.
  */
 
+#pragma once
+
 #include <common/Typedef.h>
 
+#include <File/NalUnitSource.h>
+#include <HEVC/ParserAnnexBHEVC.h>
 #include <HEVC/pic_parameter_set_rbsp.h>
 #include <HEVC/seq_parameter_set_rbsp.h>
 #include <HEVC/slice_segment_layer_rbsp.h>
 #include <HEVC/video_parameter_set_rbsp.h>
 
+#include "TestFileData.h"
+
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
 namespace combiner
 {
 
@@ -36,4 +50,79 @@ void writeParameterSetAndCompareToReference(const T &parameterSet, const ByteVec
   EXPECT_TRUE(std::equal(referenceData.begin(), referenceData.end(), writtenData.begin()));
 }
 
+inline ByteVector withHeader(const ByteVector &header, const ByteVector &payload)
+{
+  ByteVector data;
+  data.reserve(header.size() + payload.size());
+  data.insert(data.end(), header.begin(), header.end());
+  data.insert(data.end(), payload.begin(), payload.end());
+  return data;
+}
+
+inline void append(ByteVector &data, const ByteVector &other)
+{
+  data.insert(data.end(), other.begin(), other.end());
+}
+
+// VPS, SPS, PPS, IDR (POC 0), TRAIL_R (POC 4), TRAIL_N (POC 1)
+inline std::vector<ByteVector> getTestNalUnits()
+{
+  return {withHeader({0x40, 0x01}, RAW_VPS_DATA),
+          withHeader({0x42, 0x01}, RAW_SPS_DATA),
+          withHeader({0x44, 0x01}, RAW_PPS_DATA),
+          withHeader({0x28, 0x01}, RAW_SLICE_HEADER_DATA_SLICE_0),
+          withHeader({0x02, 0x01}, RAW_SLICE_HEADER_DATA_SLICE_1),
+          withHeader({0x00, 0x01}, RAW_SLICE_HEADER_DATA_SLICE_2)};
+}
+
+// Returns the given NAL units one after another
+class MemorySource : public NalUnitSource
+{
+public:
+  MemorySource(std::vector<ByteVector> nalUnits) : nalUnits(std::move(nalUnits)) {}
+
+  ByteVector getNextNALUnit() override
+  {
+    if (this->nextNalUnit == this->nalUnits.size())
+      return {};
+    return this->nalUnits.at(this->nextNalUnit++);
+  }
+  uint64_t getFileOffsetOfLastNALUnit() const override { return 0; }
+
+private:
+  std::vector<ByteVector> nalUnits;
+  size_t                  nextNalUnit{};
+};
+
+// A parser that has the parameter sets of the test data
+inline parser::hevc::ParserAnnexBHEVC parserWithParameterSets()
+{
+  parser::hevc::ParserAnnexBHEVC parser;
+  parser.parseNalUnit(withHeader({0x40, 0x01}, RAW_VPS_DATA));
+  parser.parseNalUnit(withHeader({0x42, 0x01}, RAW_SPS_DATA));
+  parser.parseNalUnit(withHeader({0x44, 0x01}, RAW_PPS_DATA));
+  return parser;
+}
+
+inline parser::hevc::ActiveParameterSets parseParameterSetsOfTestData()
+{
+  return parserWithParameterSets().getActiveParameterSets();
+}
+
+inline ByteVector readFile(const std::filesystem::path &filePath)
+{
+  std::ifstream file(filePath, std::ios_base::binary);
+  return ByteVector((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+}
+
+// A path in the temporary directory that no other test (or parallel test run) uses. The name and
+// extension are taken from the given file name.
+inline std::filesystem::path getUniqueTemporaryPath(const std::filesystem::path &fileName)
+{
+  static std::atomic<unsigned> counter{};
+  const auto uniqueName = fileName.stem().string() + "_" + std::to_string(std::random_device{}()) +
+                          "_" + std::to_string(counter++) + fileName.extension().string();
+  return std::filesystem::temp_directory_path() / uniqueName;
+}
+
 } // namespace combiner
@@ -0,0 +1,100 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include <gtest/gtest.h>
+
+#include <Combiner/InputSwitcher.h>
+#include <Combiner/ParameterSetsModifiers.h>
+
+#include "Functions.h"
+#include "TestFileData.h"
+
+namespace combiner
+{
+
+using namespace parser::hevc;
+
+namespace
+{
+
+class EmptySource : public NalUnitSource
+{
+public:
+  ByteVector getNextNALUnit() override { return {}; }
+  uint64_t   getFileOffsetOfLastNALUnit() const override { return 0; }
+};
+
+ActiveParameterSets getTestParameterSets()
+{
+  ActiveParameterSets parameterSets;
+  parameterSets.spsMap[0] = parserParameterSetFromData<seq_parameter_set_rbsp>(RAW_SPS_DATA);
+  parameterSets.ppsMap[0] = parserParameterSetFromData<pic_parameter_set_rbsp>(RAW_PPS_DATA);
+  return parameterSets;
+}
+
+} // namespace
+
+TEST(InputSwitcher, TestReplacementIsTakenOnce)
+{
+  InputSwitcher inputSwitcher;
+  EXPECT_FALSE(inputSwitcher.takeReplacement(1));
+
+  auto       source        = std::make_unique<EmptySource>();
+  const auto sourcePointer = source.get();
+  inputSwitcher.replaceInput(1, std::make_unique<EmptySource>());
+  inputSwitcher.replaceInput(1, std::move(source));
+
+  EXPECT_FALSE(inputSwitcher.takeReplacement(0));
+  EXPECT_EQ(inputSwitcher.takeReplacement(1).get(), sourcePointer);
+  EXPECT_FALSE(inputSwitcher.takeReplacement(1));
+}
+
+TEST(InputSwitcher, TestCompatibleReplacementParameterSets)
+{
+  const auto currentParameterSets = getTestParameterSets();
+  EXPECT_NO_THROW(checkForCompatibleReplacement(currentParameterSets, currentParameterSets));
+
+  // The VUI (e.g. the timing) may differ
+  auto otherVUI = currentParameterSets;
+  otherVUI.spsMap[0].vui_parameters_present_flag = !otherVUI.spsMap[0].vui_parameters_present_flag;
+  EXPECT_NO_THROW(checkForCompatibleReplacement(currentParameterSets, otherVUI));
+}
+
+TEST(InputSwitcher, TestIncompatibleReplacementParameterSetsThrow)
+{
+  const auto currentParameterSets = getTestParameterSets();
+
+  auto otherSize = currentParameterSets;
+  otherSize.spsMap[0].pic_width_in_luma_samples += otherSize.spsMap[0].CtbSizeY;
+  otherSize.spsMap[0].updateCalculatedValues();
+  EXPECT_THROW(checkForCompatibleReplacement(currentParameterSets, otherSize), std::runtime_error);
+
+  auto otherCtbSize = currentParameterSets;
+  otherCtbSize.spsMap[0].log2_diff_max_min_luma_coding_block_size -= 1;
+  otherCtbSize.spsMap[0].updateCalculatedValues();
+  EXPECT_THROW(checkForCompatibleReplacement(currentParameterSets, otherCtbSize),
+               std::runtime_error);
+
+  auto otherPOCLength = currentParameterSets;
+  otherPOCLength.spsMap[0].log2_max_pic_order_cnt_lsb_minus4 += 1;
+  EXPECT_THROW(checkForCompatibleReplacement(currentParameterSets, otherPOCLength),
+               std::runtime_error);
+
+  auto withTiles = currentParameterSets;
+  withTiles.ppsMap[0].tiles_enabled_flag = true;
+  EXPECT_THROW(checkForCompatibleReplacement(currentParameterSets, withTiles), std::runtime_error);
+
+  auto otherPPS = currentParameterSets;
+  otherPPS.ppsMap[0].init_qp_minus26 += 1;
+  EXPECT_THROW(checkForCompatibleReplacement(currentParameterSets, otherPPS), std::runtime_error);
+
+  auto otherID = currentParameterSets;
+  otherID.ppsMap[1] = otherID.ppsMap[0];
+  otherID.ppsMap[1].pps_pic_parameter_set_id = 1;
+  EXPECT_THROW(checkForCompatibleReplacement(currentParameterSets, otherID), std::runtime_error);
+}
+
+} // namespace combiner
@@ -0,0 +1,70 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include <gtest/gtest.h>
+
+#include <common/JSONObject.h>
+
+namespace combiner
+{
+
+TEST(JSONObject, TestParsingOfStringsNumbersAndArrays)
+{
+  const auto object = JSONObject::parse(
+      R"( {"command": "start", "job": 12, "inputs": ["a.hevc", "b \"c\".hevc"], "empty": []} )");
+
+  EXPECT_EQ(object.getString("command"), "start");
+  EXPECT_EQ(object.getNumber("job"), 12.0);
+  EXPECT_EQ(object.getStringArray("inputs"),
+            std::vector<std::string>({"a.hevc", "b \"c\".hevc"}));
+  EXPECT_TRUE(object.getStringArray("empty").empty());
+  EXPECT_FALSE(object.getString("job"));
+  EXPECT_FALSE(object.getNumber("missing"));
+  EXPECT_TRUE(object.getStringArray("missing").empty());
+}
+
+TEST(JSONObject, TestInvalidTextThrows)
+{
+  EXPECT_THROW(JSONObject::parse(""), std::invalid_argument);
+  EXPECT_THROW(JSONObject::parse("[1, 2]"), std::invalid_argument);
+  EXPECT_THROW(JSONObject::parse(R"({"command": "start")"), std::invalid_argument);
+  EXPECT_THROW(JSONObject::parse(R"({"command" "start"})"), std::invalid_argument);
+  EXPECT_THROW(JSONObject::parse(R"({"command": "start"} x)"), std::invalid_argument);
+}
+
+TEST(JSONObject, TestWrittenObjectKeepsTheOrderOfItsMembers)
+{
+  JSONObject object;
+  object.setBool("ok", true)
+      .setNumber("job", 12)
+      .setString("file", "a \"b\".hevc")
+      .setStringArray("arguments", {"x", "y"})
+      .setJSON("statistics", R"({"inputs": []})")
+      .setNumber("rate", 0.5)
+      .setNumber("job", 13);
+
+  EXPECT_EQ(
+      object.toString(),
+      R"({"ok": true, "job": 13, "file": "a \"b\".hevc", "arguments": ["x", "y"], )"
+      R"("statistics": {"inputs": []}, "rate": 0.5})");
+  EXPECT_EQ(object.getBool("ok"), true);
+  EXPECT_EQ(object.getNumber("job"), 13.0);
+
+  const auto parsed = JSONObject::parse(R"({"ok": false, "error": "x", "job": 1})");
+  EXPECT_EQ(parsed.getBool("ok"), false);
+  EXPECT_EQ(parsed.toString(), R"({"ok": false, "error": "x", "job": 1})");
+  EXPECT_THROW(JSONObject::parse(R"({"ok": tru})"), std::invalid_argument);
+}
+
+TEST(JSONObject, TestEscapingOfStrings)
+{
+  EXPECT_EQ(toJSONString("a\"b\\c\nd"), R"("a\"b\\c\nd")");
+
+  const auto object = JSONObject::parse("{\"text\": " + toJSONString("line1\nline2\t\"x\"") + "}");
+  EXPECT_EQ(object.getString("text"), "line1\nline2\t\"x\"");
+}
+
+} // namespace combiner
@@ -0,0 +1,135 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include <gtest/gtest.h>
+
+#include <Daemon/ControlSocket.h>
+#include <Daemon/JobManager.h>
+
+#include "Functions.h"
+
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+namespace combiner
+{
+
+namespace
+{
+
+bool waitForState(const JobManager &jobManager, const uint64_t id, const JobState state)
+{
+  for (int i = 0; i < 500; ++i)
+  {
+    if (jobManager.getJobState(id) == state)
+      return true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  return false;
+}
+
+void waitUntilStopped(PipelineStatistics &, const std::atomic<bool> &stopRequested)
+{
+  while (!stopRequested)
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  throw std::runtime_error("The job was stopped");
+}
+
+void finishImmediately(PipelineStatistics &, const std::atomic<bool> &) {}
+
+} // namespace
+
+TEST(JobManager, TestJobIsRunAndReported)
+{
+  JobManager jobManager(2);
+  const auto id = jobManager.addJob("test job", 2, 1, finishImmediately);
+
+  EXPECT_TRUE(waitForState(jobManager, id, JobState::Finished));
+  const auto status = jobManager.getStatusJSON(id);
+  EXPECT_NE(status.find("\"finished\""), std::string::npos);
+  EXPECT_NE(status.find("\"test job\""), std::string::npos);
+  EXPECT_NE(status.find("\"statistics\""), std::string::npos);
+
+  EXPECT_FALSE(jobManager.getJobState(id + 1));
+  EXPECT_THROW(jobManager.getStatusJSON(id + 1), std::invalid_argument);
+}
+
+TEST(JobManager, TestFailingJobKeepsTheError)
+{
+  JobManager jobManager(1);
+  const auto id = jobManager.addJob("failing", 1, 1, [](PipelineStatistics &, const auto &) {
+    throw std::runtime_error("no input");
+  });
+
+  EXPECT_TRUE(waitForState(jobManager, id, JobState::Failed));
+  EXPECT_NE(jobManager.getStatusJSON(id).find("no input"), std::string::npos);
+}
+
+TEST(JobManager, TestStoppingOfRunningAndQueuedJobs)
+{
+  JobManager jobManager(1);
+  const auto runningID = jobManager.addJob("running", 1, 1, waitUntilStopped);
+  const auto queuedID  = jobManager.addJob("queued", 1, 1, waitUntilStopped);
+
+  EXPECT_TRUE(waitForState(jobManager, runningID, JobState::Running));
+  EXPECT_EQ(jobManager.getJobState(queuedID), JobState::Queued);
+
+  EXPECT_TRUE(jobManager.stopJob(queuedID));
+  EXPECT_EQ(jobManager.getJobState(queuedID), JobState::Stopped);
+
+  EXPECT_TRUE(jobManager.stopJob(runningID));
+  EXPECT_TRUE(waitForState(jobManager, runningID, JobState::Stopped));
+
+  EXPECT_FALSE(jobManager.stopJob(queuedID + 1));
+}
+
+TEST(JobManager, TestOnlyTheLastEndedJobsAreKept)
+{
+  JobManager jobManager(1, 2);
+  const auto firstID   = jobManager.addJob("first", 1, 1, finishImmediately);
+  const auto secondID  = jobManager.addJob("second", 1, 1, finishImmediately);
+  const auto runningID = jobManager.addJob("running", 1, 1, waitUntilStopped);
+  const auto queuedID  = jobManager.addJob("queued", 1, 1, waitUntilStopped);
+
+  EXPECT_TRUE(waitForState(jobManager, runningID, JobState::Running));
+  EXPECT_EQ(jobManager.getJobState(firstID), JobState::Finished);
+
+  // The queued job is the third one that ended
+  EXPECT_TRUE(jobManager.stopJob(queuedID));
+  EXPECT_FALSE(jobManager.getJobState(firstID));
+  EXPECT_EQ(jobManager.getJobState(secondID), JobState::Finished);
+  EXPECT_EQ(jobManager.getJobState(queuedID), JobState::Stopped);
+  EXPECT_EQ(jobManager.getStatusJSON().find("\"first\""), std::string::npos);
+
+  EXPECT_TRUE(jobManager.stopJob(runningID));
+  EXPECT_TRUE(waitForState(jobManager, runningID, JobState::Stopped));
+  EXPECT_FALSE(jobManager.getJobState(secondID));
+}
+
+#ifndef _WIN32
+
+TEST(ControlServer, TestRequestAndResponse)
+{
+  const auto socketPath = getUniqueTemporaryPath("JobManagerTest.sock");
+
+  ControlServer server(socketPath);
+  std::thread   serverThread([&server]() {
+    server.run([&server](const std::string &request) {
+      if (request == "shutdown")
+        server.stop();
+      return "echo " + request;
+    });
+  });
+
+  EXPECT_EQ(sendControlRequest(socketPath, "status"), "echo status");
+  EXPECT_EQ(sendControlRequest(socketPath, "shutdown"), "echo shutdown");
+  serverThread.join();
+}
+
+#endif
+
+} // namespace combiner
@@ -0,0 +1,88 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include <gtest/gtest.h>
+
+#include <common/Logger.h>
+
+#include <sstream>
+
+namespace combiner
+{
+
+TEST(Logger, TestMessagesAreWrittenInOrderAndFilteredByLevel)
+{
+  std::ostringstream output;
+  {
+    Logger logger(output, LogLevel::Info);
+    logger.debug("Not written");
+    logger.info("First");
+    logger.warning("Second");
+    logger.setLevel(LogLevel::Error);
+    logger.info("Not written either");
+    logger.error("Third");
+    logger.flush();
+  }
+
+  const auto text = output.str();
+  EXPECT_EQ(text.find("Not written"), std::string::npos);
+
+  const auto firstPosition  = text.find("INFO First");
+  const auto secondPosition = text.find("WARNING Second");
+  const auto thirdPosition  = text.find("ERROR Third");
+  ASSERT_NE(firstPosition, std::string::npos);
+  ASSERT_NE(secondPosition, std::string::npos);
+  ASSERT_NE(thirdPosition, std::string::npos);
+  EXPECT_LT(firstPosition, secondPosition);
+  EXPECT_LT(secondPosition, thirdPosition);
+}
+
+TEST(Logger, TestMessagesFromMultipleThreadsAreAllWritten)
+{
+  std::ostringstream output;
+  {
+    Logger logger(output, LogLevel::Info);
+
+    std::vector<std::thread> threads;
+    for (int threadIndex = 0; threadIndex < 4; ++threadIndex)
+      threads.emplace_back([&logger, threadIndex]() {
+        for (int i = 0; i < 100; ++i)
+        {
+          logger.info("Thread " + std::to_string(threadIndex));
+          std::this_thread::yield();
+        }
+      });
+    for (auto &thread : threads)
+      thread.join();
+  }
+
+  std::istringstream lines(output.str());
+  std::string        line;
+  int                nrMessages = 0;
+  while (std::getline(lines, line))
+    if (line.find("INFO Thread") != std::string::npos)
+      ++nrMessages;
+  EXPECT_EQ(nrMessages, 400);
+}
+
+TEST(Logger, TestLongMessagesAreWrittenCompletely)
+{
+  const auto longMessage = std::string(1000, 'a') + "end";
+
+  std::ostringstream output;
+  {
+    Logger logger(output, LogLevel::Info);
+    logger.info(longMessage);
+    logger.info("Short");
+    logger.flush();
+  }
+
+  const auto text = output.str();
+  EXPECT_NE(text.find("INFO " + longMessage + "\n"), std::string::npos);
+  EXPECT_NE(text.find("INFO Short\n"), std::string::npos);
+}
+
+} // namespace combiner
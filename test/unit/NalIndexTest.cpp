@@ -0,0 +1,85 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include <gtest/gtest.h>
+
+#include <File/FileSourceAnnexB.h>
+#include <File/NalIndex.h>
+
+#include "Functions.h"
+
+#include <fstream>
+
+namespace combiner
+{
+
+namespace
+{
+
+const std::vector<ByteVector> TEST_NAL_UNITS = {
+    {0x40, 0x01, 0x0C}, {0x42, 0x01, 0x01, 0x60, 0x00}, {0x26, 0x01, 0xAF, 0x12, 0x34, 0x00, 0x80}};
+
+std::filesystem::path writeTestFile()
+{
+  const auto    filePath = getUniqueTemporaryPath("NalIndexTest.hevc");
+  std::ofstream file(filePath, std::ios_base::binary);
+  for (const auto &nal : TEST_NAL_UNITS)
+  {
+    file.write("\0\0\0\1", 4);
+    file.write(reinterpret_cast<const char *>(nal.data()), nal.size());
+  }
+  return filePath;
+}
+
+} // namespace
+
+TEST(NalIndex, TestIndexedReadingReturnsTheSameNalUnitsAsScanning)
+{
+  const auto filePath = writeTestFile();
+
+  NalIndex         index;
+  FileSourceAnnexB scanningSource(filePath);
+  for (const auto &expectedNal : TEST_NAL_UNITS)
+  {
+    const auto nal = scanningSource.getNextNALUnit();
+    EXPECT_EQ(nal, expectedNal);
+
+    NalIndexEntry entry;
+    entry.offset      = scanningSource.getFileOffsetOfLastNALUnit();
+    entry.size        = static_cast<uint32_t>(nal.size());
+    entry.nalUnitType = nal.at(0) >> 1;
+    index.entries.push_back(entry);
+  }
+  EXPECT_EQ(index.entries.at(1).offset, 11u);
+  index.entries.at(2).isIRAP = true;
+  index.entries.at(2).POC    = -3;
+
+  index.writeSidecar(filePath);
+  auto loadedIndex = NalIndex::loadIfUpToDate(filePath);
+  ASSERT_TRUE(loadedIndex);
+  ASSERT_EQ(loadedIndex->entries.size(), 3u);
+  EXPECT_EQ(loadedIndex->entries.at(2).offset, index.entries.at(2).offset);
+  EXPECT_TRUE(loadedIndex->entries.at(2).isIRAP);
+  EXPECT_EQ(loadedIndex->entries.at(2).POC, -3);
+  EXPECT_FALSE(loadedIndex->entries.at(1).POC);
+
+  FileSourceAnnexB indexedSource(filePath,
+                                 std::make_shared<const NalIndex>(std::move(*loadedIndex)));
+  for (const auto &expectedNal : TEST_NAL_UNITS)
+    EXPECT_EQ(indexedSource.getNextNALUnit(), expectedNal);
+  EXPECT_TRUE(indexedSource.getNextNALUnit().empty());
+
+  {
+    std::ofstream file(filePath, std::ios_base::binary | std::ios_base::app);
+    file.put(0);
+  }
+  EXPECT_FALSE(NalIndex::loadIfUpToDate(filePath));
+
+  std::filesystem::remove(NalIndex::getSidecarPath(filePath));
+  std::filesystem::remove(filePath);
+}
+
+} // namespace combiner
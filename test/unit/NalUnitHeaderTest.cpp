@@ -0,0 +1,60 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include <gtest/gtest.h>
+
+#include <HEVC/AccessUnitDetector.h>
+#include <HEVC/nal_unit_header.h>
+
+namespace combiner
+{
+
+using namespace parser::hevc;
+
+TEST(NalUnitHeader, TestHeaderFromNalUnitTypeID)
+{
+  // The reserved VCL types are not in the order of their values in NalType
+  EXPECT_EQ(nal_unit_header::fromNalUnitTypeID(11).nal_unit_type, NalType::RSV_VCL_R11);
+  EXPECT_EQ(nal_unit_header::fromNalUnitTypeID(12).nal_unit_type, NalType::RSV_VCL_N12);
+  EXPECT_EQ(nal_unit_header::fromNalUnitTypeID(34).nal_unit_type, NalType::PPS_NUT);
+  EXPECT_EQ(nal_unit_header(NalType::RSV_VCL_R13).nalUnitTypeID, 13u);
+  EXPECT_EQ(nal_unit_header(NalType::CRA_NUT).nalUnitTypeID, 21u);
+
+  const auto header = nal_unit_header::fromNalData({0x00, 0x00, 0x26, 0x01, 0xaf}, 2);
+  EXPECT_EQ(header.nal_unit_type, NalType::IDR_W_RADL);
+  EXPECT_EQ(header.nuh_temporal_id_plus1, 1u);
+}
+
+TEST(NalUnitHeader, TestPredicates)
+{
+  EXPECT_TRUE(nal_unit_header(NalType::RSV_VCL31).isVCL());
+  EXPECT_FALSE(nal_unit_header(NalType::VPS_NUT).isVCL());
+  EXPECT_TRUE(nal_unit_header(NalType::SPS_NUT).isParameterSet());
+  EXPECT_FALSE(nal_unit_header(NalType::AUD_NUT).isParameterSet());
+  EXPECT_TRUE(nal_unit_header(NalType::IDR_N_LP).isIDR());
+  EXPECT_TRUE(nal_unit_header(NalType::BLA_N_LP).isBLA());
+  EXPECT_FALSE(nal_unit_header(NalType::CRA_NUT).isBLA());
+
+  EXPECT_TRUE(nal_unit_header(NalType::PREFIX_SEI_NUT).startsAccessUnitAfterVCL());
+  EXPECT_FALSE(nal_unit_header(NalType::SUFFIX_SEI_NUT).startsAccessUnitAfterVCL());
+  EXPECT_FALSE(nal_unit_header(NalType::EOS_NUT).startsAccessUnitAfterVCL());
+  EXPECT_TRUE(nal_unit_header(NalType::UNSPEC55).startsAccessUnitAfterVCL());
+  EXPECT_FALSE(nal_unit_header(NalType::UNSPEC56).startsAccessUnitAfterVCL());
+}
+
+TEST(NalUnitHeader, TestAccessUnitDetector)
+{
+  AccessUnitDetector detector;
+  EXPECT_FALSE(detector.update(nal_unit_header(NalType::VPS_NUT), false));
+  EXPECT_FALSE(detector.update(nal_unit_header(NalType::IDR_W_RADL), true));
+  EXPECT_FALSE(detector.update(nal_unit_header(NalType::IDR_W_RADL), false));
+  EXPECT_FALSE(detector.update(nal_unit_header(NalType::SUFFIX_SEI_NUT), false));
+  EXPECT_TRUE(detector.update(nal_unit_header(NalType::AUD_NUT), false));
+  EXPECT_FALSE(detector.update(nal_unit_header(NalType::TRAIL_R), true));
+  EXPECT_TRUE(detector.update(nal_unit_header(NalType::TRAIL_R), true));
+}
+
+} // namespace combiner
@@ -0,0 +1,81 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include <gtest/gtest.h>
+
+#include <Combiner/ParameterSetsModifiers.h>
+#include <HEVC/seq_parameter_set_rbsp.h>
+#include <HEVC/video_parameter_set_rbsp.h>
+
+namespace combiner
+{
+
+using namespace parser::hevc;
+
+TEST(ParameterSetsModifiers, TestSubLayersAreRemovedFromSPS)
+{
+  seq_parameter_set_rbsp sps;
+  sps.sps_max_sub_layers_minus1                  = 2;
+  sps.sps_sub_layer_ordering_info_present_flag   = true;
+  sps.sps_max_dec_pic_buffering_minus1           = {1, 2, 4};
+  sps.sps_max_num_reorder_pics                   = {0, 0, 0};
+  sps.sps_max_latency_increase_plus1             = {0, 0, 0};
+  sps.vui_parameters_present_flag                = true;
+  sps.vuiParameters.vui_timing_info_present_flag = true;
+  sps.vuiParameters.vui_num_units_in_tick        = 1;
+  sps.vuiParameters.vui_time_scale               = 100;
+
+  sps.profileTierLevel.sub_layer_level_present_flag = {true, false};
+  sps.profileTierLevel.sub_layer_level_idc          = {90, 0};
+
+  removeSubLayersAbove(sps, 1);
+  EXPECT_EQ(sps.sps_max_sub_layers_minus1, 1u);
+  EXPECT_EQ(sps.sps_max_dec_pic_buffering_minus1, std::vector<uint64_t>({1, 2}));
+  EXPECT_EQ(sps.profileTierLevel.general_level_idc, 0u);
+
+  removeSubLayersAbove(sps, 0);
+  EXPECT_EQ(sps.sps_max_sub_layers_minus1, 0u);
+  EXPECT_TRUE(sps.sps_temporal_id_nesting_flag);
+  EXPECT_EQ(sps.sps_max_dec_pic_buffering_minus1, std::vector<uint64_t>({1}));
+  EXPECT_EQ(sps.profileTierLevel.general_level_idc, 90u);
+  EXPECT_EQ(sps.vuiParameters.vui_time_scale, 100u);
+  EXPECT_EQ(sps.vuiParameters.vui_num_units_in_tick, 4u);
+}
+
+TEST(ParameterSetsModifiers, TestSubLayersAreRemovedFromVPS)
+{
+  video_parameter_set_rbsp vps;
+  vps.vps_max_sub_layers_minus1           = 2;
+  vps.vps_max_dec_pic_buffering_minus1[2] = 4;
+  vps.vps_max_num_reorder_pics[2]         = 2;
+  vps.vps_timing_info_present_flag        = true;
+  vps.vps_num_units_in_tick               = 1;
+  vps.vps_time_scale                      = 100;
+  vps.vps_poc_proportional_to_timing_flag = true;
+  vps.vps_num_ticks_poc_diff_one_minus1   = 1;
+  vps.vps_num_hrd_parameters              = 1;
+
+  // Without the ordering info, the values of the highest sub-layer move to the new highest one
+  removeSubLayersAbove(vps, 1);
+  EXPECT_EQ(vps.vps_max_sub_layers_minus1, 1u);
+  EXPECT_FALSE(vps.vps_temporal_id_nesting_flag);
+  EXPECT_EQ(vps.vps_max_dec_pic_buffering_minus1[1], 4u);
+  EXPECT_EQ(vps.vps_max_num_reorder_pics[1], 2u);
+  EXPECT_EQ(vps.vps_num_units_in_tick, 2u);
+  EXPECT_TRUE(vps.vps_poc_proportional_to_timing_flag);
+  EXPECT_EQ(vps.vps_num_ticks_poc_diff_one_minus1, 0u);
+  EXPECT_EQ(vps.vps_num_hrd_parameters, 0u);
+
+  // A POC difference of one is half of the new clock tick
+  removeSubLayersAbove(vps, 0);
+  EXPECT_EQ(vps.vps_max_sub_layers_minus1, 0u);
+  EXPECT_TRUE(vps.vps_temporal_id_nesting_flag);
+  EXPECT_EQ(vps.vps_max_dec_pic_buffering_minus1[0], 4u);
+  EXPECT_EQ(vps.vps_num_units_in_tick, 4u);
+  EXPECT_FALSE(vps.vps_poc_proportional_to_timing_flag);
+}
+
+} // namespace combiner
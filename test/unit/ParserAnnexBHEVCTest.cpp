@@ -0,0 +1,97 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include <gtest/gtest.h>
+
+#include <HEVC/ParserAnnexBHEVC.h>
+#include <common/PipelineStatistics.h>
+#include <common/SubByteWriter.h>
+
+#include "Functions.h"
+
+namespace combiner
+{
+
+using namespace parser::hevc;
+
+namespace
+{
+
+template <typename ParameterSet> ByteVector writeParameterSet(const ParameterSet &parameterSet)
+{
+  parser::SubByteWriter writer;
+  parameterSet.write(writer);
+  return writer.finishWritingAndGetData();
+}
+
+} // namespace
+
+TEST(ParserAnnexBHEVC, TestNalUnitsAboveHighestTemporalIdAreDropped)
+{
+  // The TRAIL_N slice of the test data moved to the sub-layer with TemporalId 1
+  auto nalUnits = getTestNalUnits();
+  nalUnits.at(5).at(1) = 0x02;
+
+  PipelineStatistics statistics(1);
+  ParserAnnexBHEVC   parser(std::make_unique<MemorySource>(nalUnits));
+  parser.setStatistics(&statistics.getInput(0));
+  parser.setHighestTemporalId(0);
+
+  std::vector<NalType> nalTypes;
+  while (true)
+  {
+    const auto nal = parser.parseNextNalFromFile();
+    if (nal.rawData.empty())
+      break;
+    nalTypes.push_back(nal.header.nal_unit_type);
+  }
+
+  EXPECT_EQ(nalTypes,
+            std::vector<NalType>(
+                {NalType::VPS_NUT, NalType::SPS_NUT, NalType::PPS_NUT, NalType::IDR_N_LP,
+                 NalType::TRAIL_R}));
+  EXPECT_EQ(statistics.getInput(0).nrDroppedNalUnits, 1u);
+  EXPECT_EQ(statistics.getInput(0).nrNalUnits, 5u);
+}
+
+TEST(ParserAnnexBHEVC, TestHeaderOnlyParsingGivesTheSameNalUnitsAsParsingSliceHeaders)
+{
+  ParserAnnexBHEVC headerOnlyParser(SliceParsingMode::NalUnitHeaderOnly);
+  ParserAnnexBHEVC sliceHeaderParser(SliceParsingMode::SliceSegmentHeader);
+
+  for (const auto &nalData : getTestNalUnits())
+  {
+    const auto headerOnlyNal  = headerOnlyParser.parseNalUnit(ByteVector(nalData));
+    const auto sliceHeaderNal = sliceHeaderParser.parseNalUnit(ByteVector(nalData));
+
+    EXPECT_EQ(headerOnlyNal.rawData, nalData);
+    EXPECT_EQ(headerOnlyNal.rawData, sliceHeaderNal.rawData);
+    EXPECT_EQ(headerOnlyNal.header.nal_unit_type, sliceHeaderNal.header.nal_unit_type);
+    EXPECT_EQ(headerOnlyNal.header.nuh_layer_id, sliceHeaderNal.header.nuh_layer_id);
+    EXPECT_EQ(headerOnlyNal.header.nuh_temporal_id_plus1,
+              sliceHeaderNal.header.nuh_temporal_id_plus1);
+
+    // Only the slice segment header is skipped. Parameter sets are always parsed.
+    if (headerOnlyNal.header.isSlice())
+    {
+      EXPECT_EQ(headerOnlyNal.rbsp, nullptr);
+      EXPECT_TRUE(dynamic_cast<slice_segment_layer_rbsp *>(sliceHeaderNal.rbsp.get()));
+    }
+    else
+      EXPECT_NE(headerOnlyNal.rbsp, nullptr);
+  }
+
+  const auto &headerOnlySets  = headerOnlyParser.getActiveParameterSets();
+  const auto &sliceHeaderSets = sliceHeaderParser.getActiveParameterSets();
+  EXPECT_EQ(writeParameterSet(headerOnlySets.vpsMap.at(0)),
+            writeParameterSet(sliceHeaderSets.vpsMap.at(0)));
+  EXPECT_EQ(writeParameterSet(headerOnlySets.spsMap.at(0)),
+            writeParameterSet(sliceHeaderSets.spsMap.at(0)));
+  EXPECT_EQ(writeParameterSet(headerOnlySets.ppsMap.at(0)),
+            writeParameterSet(sliceHeaderSets.ppsMap.at(0)));
+}
+
+} // namespace combiner
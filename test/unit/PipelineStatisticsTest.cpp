@@ -0,0 +1,87 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include <gtest/gtest.h>
+
+#include <File/FileSinkAnnexB.h>
+#include <File/MemorySink.h>
+#include <common/PipelineStatistics.h>
+
+#include "Functions.h"
+
+#include <filesystem>
+
+namespace combiner
+{
+
+TEST(PipelineStatistics, TestCountersAreOnlyUpdatedIfStatisticsAreEnabled)
+{
+  InputStatistics *disabledStatistics{};
+  addToCounter(getCounter(disabledStatistics, &InputStatistics::bytesRead), 10);
+  {
+    ScopedTimer timer(getCounter(disabledStatistics, &InputStatistics::headerParseTime));
+  }
+
+  PipelineStatistics statistics(2);
+  auto              &input = statistics.getInput(1);
+  addToCounter(getCounter(&input, &InputStatistics::bytesRead), 10);
+  addToCounter(getCounter(&input, &InputStatistics::bytesRead), 5);
+  {
+    ScopedTimer timer(getCounter(&input, &InputStatistics::headerParseTime));
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  EXPECT_EQ(statistics.getInput(0).bytesRead, 0u);
+  EXPECT_EQ(input.bytesRead, 15u);
+  EXPECT_GE(input.headerParseTime, 1000000u);
+}
+
+TEST(PipelineStatistics, TestJSONContainsAllInputsAndOutputs)
+{
+  PipelineStatistics statistics(2, 2);
+  addToCounter(&statistics.getInput(0).nrNalUnits, 3);
+  addToCounter(&statistics.getOutput().bytesWritten, 1234);
+  addToCounter(&statistics.getOutput(1).nrDroppedPictures, 5);
+
+  const auto json = statistics.toJSON();
+  EXPECT_NE(json.find("\"index\": 0"), std::string::npos);
+  EXPECT_NE(json.find("\"index\": 1"), std::string::npos);
+  EXPECT_NE(json.find("\"nalUnits\": 3"), std::string::npos);
+  EXPECT_NE(json.find("\"bytesWritten\": 1234"), std::string::npos);
+  EXPECT_NE(json.find("\"readSeconds\""), std::string::npos);
+  EXPECT_NE(json.find("\"lockstepWaitSeconds\""), std::string::npos);
+  EXPECT_NE(json.find("\"outputs\""), std::string::npos);
+  EXPECT_NE(json.find("\"droppedPictures\": 5"), std::string::npos);
+  EXPECT_NE(json.find("\"queueDepth\""), std::string::npos);
+}
+
+TEST(PipelineStatistics, TestMemorySinkCountsBytesLikeAnnexBFile)
+{
+  const std::vector<ByteVector> nalUnits = {{0x40, 0x01, 0x0c}, {0x26, 0x01, 0xaf, 0x10, 0x20}};
+
+  PipelineStatistics memoryStatistics(1);
+  MemorySink         memorySink;
+  memorySink.setStatistics(&memoryStatistics.getOutput());
+
+  const auto         filePath = getUniqueTemporaryPath("PipelineStatisticsTest.hevc");
+  PipelineStatistics fileStatistics(1);
+  {
+    FileSinkAnnexB fileSink(filePath);
+    fileSink.setStatistics(&fileStatistics.getOutput());
+    for (const auto &nalUnit : nalUnits)
+    {
+      memorySink.writeNALUnit(nalUnit);
+      fileSink.writeNALUnit(nalUnit);
+    }
+  }
+
+  EXPECT_EQ(memoryStatistics.getOutput().bytesWritten, std::filesystem::file_size(filePath));
+  EXPECT_EQ(fileStatistics.getOutput().bytesWritten, std::filesystem::file_size(filePath));
+  EXPECT_EQ(memoryStatistics.getOutput().nrNalUnits, 2u);
+  std::filesystem::remove(filePath);
+}
+
+} // namespace combiner
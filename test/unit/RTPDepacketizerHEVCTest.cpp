@@ -0,0 +1,214 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include <gtest/gtest.h>
+
+#include <Network/RTPDepacketizerHEVC.h>
+#include <Network/RTPPacketizerHEVC.h>
+
+#include "Functions.h"
+
+namespace combiner
+{
+
+namespace
+{
+
+ByteVector
+rtpPacket(const uint16_t sequenceNumber, const uint32_t timestamp, const ByteVector &payload)
+{
+  ByteVector packet;
+  packet.reserve(12 + payload.size());
+  for (const auto byte : {uint8_t(0x80),
+                          uint8_t(96),
+                          uint8_t(sequenceNumber >> 8),
+                          uint8_t(sequenceNumber & 0xff),
+                          uint8_t(timestamp >> 24),
+                          uint8_t(timestamp >> 16),
+                          uint8_t(timestamp >> 8),
+                          uint8_t(timestamp),
+                          uint8_t(0x12),
+                          uint8_t(0x34),
+                          uint8_t(0x56),
+                          uint8_t(0x78)})
+    packet.push_back(byte);
+  packet.insert(packet.end(), payload.begin(), payload.end());
+  return packet;
+}
+
+void addPacket(RTPDepacketizerHEVC &depacketizer, ByteVector packet)
+{
+  const auto size = packet.size();
+  depacketizer.addPacket(std::move(packet), size);
+}
+
+// Copy the gathered packets into separate buffers
+std::vector<ByteVector> toPackets(const GatherDatagrams &datagrams)
+{
+  std::vector<ByteVector> packets;
+  auto                    range = datagrams.ranges.begin();
+  for (const auto nrRanges : datagrams.nrRangesPerDatagram)
+  {
+    ByteVector packet;
+    for (size_t i = 0; i < nrRanges; ++i, ++range)
+      packet.insert(packet.end(), range->data, range->data + range->size);
+    packets.push_back(std::move(packet));
+  }
+  return packets;
+}
+
+std::vector<RTPNalUnit> getNalUnits(RTPDepacketizerHEVC &depacketizer)
+{
+  std::vector<RTPNalUnit> nalUnits;
+  while (auto nal = depacketizer.getNextNalUnit())
+    nalUnits.push_back(std::move(*nal));
+  return nalUnits;
+}
+
+const auto vps    = withHeader({0x40, 0x01}, RAW_VPS_DATA);
+const auto sps    = withHeader({0x42, 0x01}, RAW_SPS_DATA);
+const auto pps    = withHeader({0x44, 0x01}, RAW_PPS_DATA);
+const auto slice0 = withHeader({0x28, 0x01}, RAW_SLICE_HEADER_DATA_SLICE_0);
+const auto slice1 = withHeader({0x02, 0x01}, RAW_SLICE_HEADER_DATA_SLICE_1);
+const auto slice2 = withHeader({0x00, 0x01}, RAW_SLICE_HEADER_DATA_SLICE_2);
+
+} // namespace
+
+TEST(RTPDepacketizerHEVC, TestReorderingOfSingleNalUnitPacketsOverSequenceNumberWrap)
+{
+  BufferPool          bufferPool(1500);
+  RTPDepacketizerHEVC depacketizer(bufferPool);
+
+  addPacket(depacketizer, rtpPacket(65534, 0xFFFFF000, slice0));
+  addPacket(depacketizer, rtpPacket(0, 0xFFFFF000 + 7200, slice2));
+  auto nalUnits = getNalUnits(depacketizer);
+  ASSERT_EQ(nalUnits.size(), 1u);
+
+  // The out of order packet is held back until the missing one arrives. Duplicates are dropped.
+  addPacket(depacketizer, rtpPacket(65535, 0xFFFFF000 + 3600, slice1));
+  addPacket(depacketizer, rtpPacket(0, 0xFFFFF000 + 7200, slice2));
+  addPacket(depacketizer, rtpPacket(1, 0xFFFFF000 + 10800, slice1));
+
+  for (auto &nal : getNalUnits(depacketizer))
+    nalUnits.push_back(std::move(nal));
+  ASSERT_EQ(nalUnits.size(), 4u);
+  const std::vector<ByteVector> expectedData = {slice0, slice1, slice2, slice1};
+  for (size_t i = 0; i < nalUnits.size(); ++i)
+  {
+    EXPECT_EQ(nalUnits.at(i).data, expectedData.at(i));
+    EXPECT_EQ(nalUnits.at(i).sequenceNumber, 65534u + i);
+    EXPECT_EQ(nalUnits.at(i).timestamp, 0xFFFFF000u + 3600u * i);
+  }
+  EXPECT_EQ(depacketizer.getNrLostPackets(), 0u);
+}
+
+TEST(RTPDepacketizerHEVC, TestAggregationPacket)
+{
+  BufferPool          bufferPool(1500);
+  RTPDepacketizerHEVC depacketizer(bufferPool);
+
+  ByteVector payload = {0x60, 0x01};
+  for (const auto &nal : {vps, sps, pps})
+  {
+    payload.push_back(uint8_t(nal.size() >> 8));
+    payload.push_back(uint8_t(nal.size() & 0xff));
+    payload.insert(payload.end(), nal.begin(), nal.end());
+  }
+  addPacket(depacketizer, rtpPacket(10, 3600, payload));
+  addPacket(depacketizer, rtpPacket(11, 3600, slice0));
+
+  const auto nalUnits = getNalUnits(depacketizer);
+  ASSERT_EQ(nalUnits.size(), 4u);
+  EXPECT_EQ(nalUnits.at(0).data, vps);
+  EXPECT_EQ(nalUnits.at(1).data, sps);
+  EXPECT_EQ(nalUnits.at(2).data, pps);
+  EXPECT_EQ(nalUnits.at(3).data, slice0);
+  for (const auto &nal : nalUnits)
+    EXPECT_EQ(nal.timestamp, 3600u);
+}
+
+TEST(RTPDepacketizerHEVC, TestAggregationAndFragmentationUnitsFromPacketizer)
+{
+  const auto largeSlice = withHeader(slice0, ByteVector(1000, 0x55));
+
+  // The parameter sets are aggregated into one packet. The slice is split into 6 fragments.
+  RTPPacketizerHEVC packetizer(0x12345678, 200);
+  auto packets = toPackets(packetizer.packetizeAccessUnit({vps, sps, pps, largeSlice}, 3600));
+  ASSERT_EQ(packets.size(), 1u + 6u);
+  EXPECT_EQ(packets.at(0).at(12), 48 << 1);
+  EXPECT_EQ(packets.at(1).at(12), 49 << 1);
+
+  // Only the last packet of the access unit has the marker bit
+  for (size_t i = 0; i < packets.size(); ++i)
+  {
+    EXPECT_LE(packets.at(i).size(), 12u + 200u);
+    EXPECT_EQ((packets.at(i).at(1) & 0x80) != 0, i + 1 == packets.size());
+  }
+
+  BufferPool          bufferPool(1500);
+  RTPDepacketizerHEVC depacketizer(bufferPool);
+  for (auto &packet : packets)
+    addPacket(depacketizer, std::move(packet));
+
+  const auto nalUnits = getNalUnits(depacketizer);
+  ASSERT_EQ(nalUnits.size(), 4u);
+  EXPECT_EQ(nalUnits.at(0).data, vps);
+  EXPECT_EQ(nalUnits.at(1).data, sps);
+  EXPECT_EQ(nalUnits.at(2).data, pps);
+  EXPECT_EQ(nalUnits.at(3).data, largeSlice);
+  EXPECT_EQ(nalUnits.at(3).sequenceNumber, 1u);
+}
+
+TEST(RTPDepacketizerHEVC, TestFragmentedNalUnitWithLostPacketIsDropped)
+{
+  const auto largeSlice = withHeader(slice0, ByteVector(300, 0x55));
+
+  RTPPacketizerHEVC packetizer(0x12345678, 100);
+  auto              packets = toPackets(packetizer.packetizeAccessUnit({largeSlice}, 0));
+  packets.push_back(toPackets(packetizer.packetizeAccessUnit({slice1}, 3600)).front());
+  ASSERT_EQ(packets.size(), 5u);
+
+  // The reorder buffer waits for the lost second packet until it overflows
+  BufferPool          bufferPool(1500);
+  RTPDepacketizerHEVC depacketizer(bufferPool, 2);
+  for (size_t i = 0; i < packets.size(); ++i)
+    if (i != 1)
+      addPacket(depacketizer, std::move(packets.at(i)));
+
+  const auto nalUnits = getNalUnits(depacketizer);
+  ASSERT_EQ(nalUnits.size(), 1u);
+  EXPECT_EQ(nalUnits.at(0).data, slice1);
+  EXPECT_EQ(nalUnits.at(0).timestamp, 3600u);
+  EXPECT_EQ(depacketizer.getNrLostPackets(), 1u);
+}
+
+TEST(RTPDepacketizerHEVC, TestHeaderExtensionIsSkippedOrThePacketIsDropped)
+{
+  BufferPool          bufferPool(1500);
+  RTPDepacketizerHEVC depacketizer(bufferPool);
+
+  auto withExtension = [](ByteVector packet) {
+    packet.at(0) |= 0x10;
+    return packet;
+  };
+
+  // An extension of one 32 bit word in front of the NAL unit
+  const auto extension = ByteVector({0xBE, 0xDE, 0x00, 0x01, 1, 2, 3, 4});
+  addPacket(depacketizer, withExtension(rtpPacket(1, 0, withHeader(extension, slice0))));
+  // The extension header (4 bytes) does not fit
+  addPacket(depacketizer, withExtension(rtpPacket(2, 0, {0x02, 0x01})));
+  // The extension (two 32 bit words) does not fit
+  addPacket(depacketizer, withExtension(rtpPacket(3, 0, {0xBE, 0xDE, 0x00, 0x02, 0x02, 0x01})));
+  addPacket(depacketizer, rtpPacket(4, 3600, slice2));
+
+  const auto nalUnits = getNalUnits(depacketizer);
+  ASSERT_EQ(nalUnits.size(), 2u);
+  EXPECT_EQ(nalUnits.at(0).data, slice0);
+  EXPECT_EQ(nalUnits.at(1).data, slice2);
+  EXPECT_EQ(depacketizer.getNrLostPackets(), 0u);
+}
+
+} // namespace combiner
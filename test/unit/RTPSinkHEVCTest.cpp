@@ -0,0 +1,101 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include <gtest/gtest.h>
+
+#include <File/FileSinkAnnexB.h>
+#include <Network/RTPSinkHEVC.h>
+#include <Network/RTPSourceHEVC.h>
+
+#include "Functions.h"
+
+#include <functional>
+
+namespace combiner
+{
+
+#ifndef _WIN32
+
+namespace
+{
+
+// Parameter sets and SEI (aggregated), a slice that is fragmented and two small slices
+const auto largeSliceHeader = withHeader({0x28, 0x01}, RAW_SLICE_HEADER_DATA_SLICE_0);
+const auto largeSlice       = withHeader(largeSliceHeader, ByteVector(4000, 0x55));
+
+const std::vector<ByteVector> nalUnits = {withHeader({0x40, 0x01}, RAW_VPS_DATA),
+                                          withHeader({0x42, 0x01}, RAW_SPS_DATA),
+                                          withHeader({0x44, 0x01}, RAW_PPS_DATA),
+                                          withHeader({0x4E, 0x01}, {0x05, 0x02, 0x12, 0x34, 0x80}),
+                                          largeSlice,
+                                          withHeader({0x02, 0x01}, RAW_SLICE_HEADER_DATA_SLICE_1),
+                                          withHeader({0x00, 0x01}, RAW_SLICE_HEADER_DATA_SLICE_2)};
+
+// Send the NAL units with the write function and write what is received back into an Annex B file
+void expectLoopbackIsBitExact(const NetworkAddress                    &address,
+                              std::function<void(RTPSinkHEVC &sink)> writeNalUnits)
+{
+  // The packets wait in the socket buffer until they are read
+  RTPSourceHEVC source(address, std::chrono::milliseconds(200));
+  {
+    RTPSinkHEVC sink(address, false);
+    writeNalUnits(sink);
+    sink.finish();
+  }
+
+  const auto expectedFilePath = getUniqueTemporaryPath("RTPSinkHEVCTest_in.hevc");
+  const auto receivedFilePath = getUniqueTemporaryPath("RTPSinkHEVCTest_out.hevc");
+  {
+    FileSinkAnnexB expectedFile(expectedFilePath);
+    for (const auto &nal : nalUnits)
+      expectedFile.writeNALUnit(nal);
+
+    FileSinkAnnexB receivedFile(receivedFilePath);
+    while (true)
+    {
+      const auto nal = source.getNextNALUnit();
+      if (nal.empty())
+        break;
+      receivedFile.writeNALUnit(nal);
+    }
+  }
+
+  const auto received = readFile(receivedFilePath);
+  EXPECT_FALSE(received.empty());
+  EXPECT_EQ(received, readFile(expectedFilePath));
+
+  std::filesystem::remove(expectedFilePath);
+  std::filesystem::remove(receivedFilePath);
+}
+
+} // namespace
+
+TEST(RTPSinkHEVC, TestLoopbackToAnnexBIsBitExact)
+{
+  expectLoopbackIsBitExact(NetworkAddress::fromString("127.0.0.1:50438"), [](RTPSinkHEVC &sink) {
+    for (const auto &nal : nalUnits)
+      sink.writeNALUnit(nal);
+  });
+}
+
+TEST(RTPSinkHEVC, TestNalUnitWithNewHeaderIsSentWithTheNewHeader)
+{
+  // The large slice is written as a new header in front of a slice with another header
+  const auto originalSlice = withHeader({0x28, 0x01, 0xFF, 0xFF, 0xFF}, ByteVector(4000, 0x55));
+
+  expectLoopbackIsBitExact(
+      NetworkAddress::fromString("127.0.0.1:50439"), [&originalSlice](RTPSinkHEVC &sink) {
+        for (const auto &nal : nalUnits)
+          if (nal == largeSlice)
+            sink.writeNALUnitWithNewHeader(largeSliceHeader, originalSlice, 5, {});
+          else
+            sink.writeNALUnitWithNewHeader({}, nal, 0, {});
+      });
+}
+
+#endif
+
+} // namespace combiner
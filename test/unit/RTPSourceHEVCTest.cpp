@@ -0,0 +1,76 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include <gtest/gtest.h>
+
+#include <File/FileSourceAnnexB.h>
+#include <Network/RTPReplaySender.h>
+#include <Network/RTPSourceHEVC.h>
+
+#include "Functions.h"
+
+#include <fstream>
+
+namespace combiner
+{
+
+#ifndef _WIN32
+
+namespace
+{
+
+std::vector<ByteVector> readNalUnits(NalUnitSource &source)
+{
+  std::vector<ByteVector> nalUnits;
+  while (true)
+  {
+    auto nal = source.getNextNALUnit();
+    if (nal.empty())
+      return nalUnits;
+    nalUnits.push_back(std::move(nal));
+  }
+}
+
+} // namespace
+
+TEST(RTPSourceHEVC, TestLoopbackReplayOfAnnexBFile)
+{
+  // Two pictures with a slice that is too large for one RTP packet
+  const std::vector<ByteVector> nalUnits = {
+      withHeader({0x40, 0x01}, RAW_VPS_DATA),
+      withHeader({0x42, 0x01}, RAW_SPS_DATA),
+      withHeader({0x44, 0x01}, RAW_PPS_DATA),
+      withHeader(withHeader({0x28, 0x01}, RAW_SLICE_HEADER_DATA_SLICE_0), ByteVector(5000, 0x55)),
+      withHeader({0x02, 0x01}, RAW_SLICE_HEADER_DATA_SLICE_1)};
+
+  const auto filePath = getUniqueTemporaryPath("RTPSourceHEVCTest.hevc");
+  {
+    std::ofstream file(filePath, std::ios_base::binary);
+    for (const auto &nal : nalUnits)
+    {
+      file.write("\0\0\0\1", 4);
+      file.write(reinterpret_cast<const char *>(nal.data()), nal.size());
+    }
+  }
+
+  const auto address = NetworkAddress::fromString("127.0.0.1:50437");
+
+  // The packets wait in the socket buffer until they are read
+  RTPSourceHEVC source(address, std::chrono::milliseconds(200));
+  replayAnnexBFileAsRTP(filePath, address, false);
+
+  FileSourceAnnexB fileSource(filePath);
+  const auto       nalUnitsFromFile = readNalUnits(fileSource);
+  EXPECT_EQ(nalUnitsFromFile, nalUnits);
+  EXPECT_EQ(readNalUnits(source), nalUnitsFromFile);
+  EXPECT_GT(source.getTimestampsOfLastNALUnit().PTS.value(), 0u);
+
+  std::filesystem::remove(filePath);
+}
+
+#endif
+
+} // namespace combiner
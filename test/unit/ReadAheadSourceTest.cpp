@@ -0,0 +1,109 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include <gtest/gtest.h>
+
+#include <File/ReadAheadSource.h>
+
+#include "Functions.h"
+
+#include <future>
+#include <stdexcept>
+
+namespace combiner
+{
+
+namespace
+{
+
+const std::vector<ByteVector> testNalUnits = {{0x40, 0x01, 0x0C}, {0x42, 0x01, 0x01}, {0x28, 0x01}};
+
+// Like a live input, nothing can be read before it is released
+class GatedSource : public NalUnitSource
+{
+public:
+  GatedSource(std::shared_future<void> release) : release(release) {}
+
+  ByteVector getNextNALUnit() override
+  {
+    this->release.wait();
+    if (this->nextNalUnit == testNalUnits.size())
+      return {};
+    return testNalUnits.at(this->nextNalUnit++);
+  }
+  bool waitForNALUnit(const std::chrono::milliseconds timeout) override
+  {
+    return this->release.wait_for(timeout) == std::future_status::ready;
+  }
+  uint64_t getFileOffsetOfLastNALUnit() const override { return this->nextNalUnit * 100; }
+
+private:
+  std::shared_future<void> release;
+  size_t                   nextNalUnit{};
+};
+
+class FailingSource : public MemorySource
+{
+public:
+  FailingSource() : MemorySource({testNalUnits.at(0)}) {}
+
+  ByteVector getNextNALUnit() override
+  {
+    auto nalData = MemorySource::getNextNALUnit();
+    if (nalData.empty())
+      throw std::runtime_error("Broken input");
+    return nalData;
+  }
+};
+
+} // namespace
+
+TEST(ReadAheadSource, TestNalUnitsAreReadInOrder)
+{
+  ReadAheadSource source(std::make_unique<MemorySource>(testNalUnits), 1);
+
+  for (const auto &nalData : testNalUnits)
+  {
+    // Without waiting for a source that never stalls
+    EXPECT_TRUE(source.waitForNALUnit(std::chrono::milliseconds(0)));
+    EXPECT_EQ(source.getNextNALUnit(), nalData);
+  }
+  EXPECT_TRUE(source.waitForNALUnit(std::chrono::milliseconds(0)));
+  EXPECT_TRUE(source.getNextNALUnit().empty());
+}
+
+TEST(ReadAheadSource, TestStalledSourceDoesNotBlock)
+{
+  std::promise<void> release;
+  ReadAheadSource    source(std::make_unique<GatedSource>(release.get_future().share()));
+
+  EXPECT_FALSE(source.waitForNALUnit(std::chrono::milliseconds(0)));
+  EXPECT_FALSE(source.waitForNALUnit(std::chrono::milliseconds(10)));
+
+  release.set_value();
+  EXPECT_TRUE(source.waitForNALUnit(std::chrono::seconds(10)));
+  EXPECT_EQ(source.getNextNALUnit(), testNalUnits.at(0));
+  EXPECT_EQ(source.getFileOffsetOfLastNALUnit(), 100u);
+}
+
+TEST(ReadAheadSource, TestStalledSourceIsStoppedOnDestruction)
+{
+  std::promise<void> release;
+  {
+    ReadAheadSource source(std::make_unique<GatedSource>(release.get_future().share()));
+    EXPECT_FALSE(source.waitForNALUnit(std::chrono::milliseconds(0)));
+  }
+  release.set_value();
+}
+
+TEST(ReadAheadSource, TestErrorIsThrownAfterTheNalUnitsBeforeIt)
+{
+  ReadAheadSource source(std::make_unique<FailingSource>());
+  EXPECT_EQ(source.getNextNALUnit(), testNalUnits.at(0));
+  EXPECT_THROW(source.getNextNALUnit(), std::runtime_error);
+}
+
+} // namespace combiner
@@ -0,0 +1,197 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include <gtest/gtest.h>
+
+#include <File/FileSourceAnnexB.h>
+#include <HEVC/NalIndexHEVC.h>
+#include <HEVC/ReadPlanHEVC.h>
+
+#include "Functions.h"
+
+#include <fstream>
+
+namespace combiner
+{
+
+namespace
+{
+
+// VPS, SPS, PPS, CRA, TRAIL_R, CRA, RASL_N, TRAIL_R
+std::vector<ByteVector> getTestNalUnitsWithCRA()
+{
+  return {withHeader({0x40, 0x01}, RAW_VPS_DATA),
+          withHeader({0x42, 0x01}, RAW_SPS_DATA),
+          withHeader({0x44, 0x01}, RAW_PPS_DATA),
+          {0x2A, 0x01, 0x80, 0x11},
+          {0x02, 0x01, 0x80, 0x22},
+          {0x2A, 0x01, 0x80, 0x33},
+          {0x10, 0x01, 0x80, 0x44},
+          {0x02, 0x01, 0x80, 0x55}};
+}
+
+std::filesystem::path writeTestFile(const std::vector<ByteVector> &nalUnits)
+{
+  const auto    filePath = getUniqueTemporaryPath("ReadPlanTest.hevc");
+  std::ofstream file(filePath, std::ios_base::binary);
+  for (const auto &nal : nalUnits)
+  {
+    file.write("\0\0\0\1", 4);
+    file.write(reinterpret_cast<const char *>(nal.data()), nal.size());
+  }
+  return filePath;
+}
+
+std::vector<ByteVector> readAllNalUnits(FileSourceAnnexB &fileSource)
+{
+  std::vector<ByteVector> nalUnits;
+  while (true)
+  {
+    auto nal = fileSource.getNextNALUnit();
+    if (nal.empty())
+      return nalUnits;
+    nalUnits.push_back(std::move(nal));
+  }
+}
+
+} // namespace
+
+TEST(ReadPlan, TestParsingOfRangePositions)
+{
+  using parser::hevc::RangePosition;
+
+  EXPECT_EQ(RangePosition::fromString("poc:-4").type, RangePosition::Type::POC);
+  EXPECT_EQ(RangePosition::fromString("poc:-4").value, -4.0);
+  EXPECT_EQ(RangePosition::fromString("12").type, RangePosition::Type::POC);
+  EXPECT_EQ(RangePosition::fromString("irap:3").type, RangePosition::Type::IRAP);
+  EXPECT_EQ(RangePosition::fromString("time:2.5").type, RangePosition::Type::Time);
+  EXPECT_EQ(RangePosition::fromString("time:2.5").value, 2.5);
+  EXPECT_THROW(RangePosition::fromString("frame:2"), std::invalid_argument);
+  EXPECT_THROW(RangePosition::fromString("irap:x"), std::invalid_argument);
+  EXPECT_THROW(RangePosition::fromString("irap:-1"), std::invalid_argument);
+
+  const auto pocAfterIRAP = RangePosition::fromString("poc:4@irap:1");
+  EXPECT_EQ(pocAfterIRAP.type, RangePosition::Type::POC);
+  EXPECT_EQ(pocAfterIRAP.value, 4.0);
+  EXPECT_EQ(pocAfterIRAP.afterIRAP, 1);
+  EXPECT_FALSE(RangePosition::fromString("poc:4").afterIRAP);
+  EXPECT_THROW(RangePosition::fromString("poc:4@2"), std::invalid_argument);
+  EXPECT_THROW(RangePosition::fromString("irap:1@irap:0"), std::invalid_argument);
+  EXPECT_THROW(RangePosition::fromString("poc:4@irap:1@irap:2"), std::invalid_argument);
+}
+
+TEST(ReadPlan, TestRepeatedPOCIsFoundAfterTheIRAP)
+{
+  // VPS, SPS, PPS, IDR (POC 0), TRAIL_R (POC 4), TRAIL_N (POC 1) and the pictures once more
+  auto       nalUnits   = getTestNalUnits();
+  const auto nrNalUnits = nalUnits.size();
+  for (size_t i = 3; i < nrNalUnits; ++i)
+    nalUnits.push_back(nalUnits.at(i));
+  const auto filePath = writeTestFile(nalUnits);
+
+  parser::hevc::ReadRange range;
+  range.start = parser::hevc::RangePosition::fromString("poc:4");
+  {
+    FileSourceAnnexB fileSource(filePath);
+    fileSource.setReadPlan(parser::hevc::createReadPlan(filePath, nullptr, range));
+    EXPECT_EQ(readAllNalUnits(fileSource), nalUnits);
+  }
+
+  range.start = parser::hevc::RangePosition::fromString("poc:4@irap:1");
+  {
+    const std::vector<ByteVector> expectedNalUnits = {nalUnits.at(0),
+                                                      nalUnits.at(1),
+                                                      nalUnits.at(2),
+                                                      nalUnits.at(6),
+                                                      nalUnits.at(7),
+                                                      nalUnits.at(8)};
+
+    FileSourceAnnexB fileSource(filePath);
+    fileSource.setReadPlan(parser::hevc::createReadPlan(filePath, nullptr, range));
+    EXPECT_EQ(readAllNalUnits(fileSource), expectedNalUnits);
+  }
+
+  std::filesystem::remove(filePath);
+}
+
+TEST(ReadPlan, TestStartAtCRACarriesParameterSetsForwardAndSkipsRASL)
+{
+  const auto nalUnits = getTestNalUnitsWithCRA();
+  const auto filePath = writeTestFile(nalUnits);
+
+  parser::hevc::ReadRange range;
+  range.start = parser::hevc::RangePosition::fromString("irap:1");
+
+  const std::vector<ByteVector> expectedNalUnits = {
+      nalUnits.at(0), nalUnits.at(1), nalUnits.at(2), nalUnits.at(5), nalUnits.at(7)};
+
+  {
+    FileSourceAnnexB scanningSource(filePath);
+    scanningSource.setReadPlan(parser::hevc::createReadPlan(filePath, nullptr, range));
+    EXPECT_EQ(readAllNalUnits(scanningSource), expectedNalUnits);
+  }
+
+  {
+    auto index =
+        parser::hevc::createNalIndex(filePath, parser::hevc::SliceParsingMode::NalUnitHeaderOnly);
+    auto plan = parser::hevc::createReadPlan(filePath, &index, range);
+
+    FileSourceAnnexB indexedSource(filePath, std::make_shared<const NalIndex>(std::move(index)));
+    indexedSource.setReadPlan(std::move(plan));
+    EXPECT_EQ(readAllNalUnits(indexedSource), expectedNalUnits);
+  }
+
+  range.start = parser::hevc::RangePosition::fromString("irap:0");
+  range.end   = parser::hevc::RangePosition::fromString("irap:1");
+  {
+    FileSourceAnnexB scanningSource(filePath);
+    scanningSource.setReadPlan(parser::hevc::createReadPlan(filePath, nullptr, range));
+    EXPECT_EQ(readAllNalUnits(scanningSource),
+              std::vector<ByteVector>(nalUnits.begin(), nalUnits.begin() + 5));
+  }
+
+  range.start = parser::hevc::RangePosition::fromString("irap:2");
+  EXPECT_THROW(parser::hevc::createReadPlan(filePath, nullptr, range), std::runtime_error);
+
+  std::filesystem::remove(filePath);
+}
+
+TEST(ReadPlan, TestChunksBetweenIRAPAccessUnitsCoverTheFile)
+{
+  const auto nalUnits = getTestNalUnitsWithCRA();
+  const auto filePath = writeTestFile(nalUnits);
+
+  auto index = std::make_shared<const NalIndex>(
+      parser::hevc::createNalIndex(filePath, parser::hevc::SliceParsingMode::NalUnitHeaderOnly));
+
+  // The parameter sets belong to the access unit of the first CRA
+  const auto irapAccessUnits = parser::hevc::findIRAPAccessUnits(*index);
+  EXPECT_EQ(irapAccessUnits, std::vector<size_t>({0, 5}));
+
+  {
+    FileSourceAnnexB fileSource(filePath, index);
+    fileSource.setReadPlan(parser::hevc::createReadPlanForEntries(filePath, *index, 0, 5));
+    EXPECT_EQ(readAllNalUnits(fileSource),
+              std::vector<ByteVector>(nalUnits.begin(), nalUnits.begin() + 5));
+  }
+
+  {
+    const std::vector<ByteVector> expectedNalUnits = {nalUnits.at(0),
+                                                      nalUnits.at(1),
+                                                      nalUnits.at(2),
+                                                      nalUnits.at(5),
+                                                      nalUnits.at(6),
+                                                      nalUnits.at(7)};
+
+    FileSourceAnnexB fileSource(filePath, index);
+    fileSource.setReadPlan(parser::hevc::createReadPlanForEntries(filePath, *index, 5, {}));
+    EXPECT_EQ(readAllNalUnits(fileSource), expectedNalUnits);
+  }
+
+  std::filesystem::remove(filePath);
+}
+
+} // namespace combiner
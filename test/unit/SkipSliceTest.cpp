@@ -0,0 +1,303 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include <gtest/gtest.h>
+
+#include <HEVC/ParserAnnexBHEVC.h>
+#include <HEVC/SkipSlice.h>
+#include <common/SubByteWriter.h>
+
+#include "CabacDecoder.h"
+#include "Functions.h"
+
+namespace combiner
+{
+
+namespace
+{
+
+using namespace parser::hevc;
+
+const ByteVector idrSliceData   = withHeader({0x28, 0x01}, RAW_SLICE_HEADER_DATA_SLICE_0);
+const ByteVector trailSliceData = withHeader({0x02, 0x01}, RAW_SLICE_HEADER_DATA_SLICE_1);
+
+const slice_segment_header &getSliceHeader(const NalUnitHEVC &nal)
+{
+  return dynamic_cast<slice_segment_layer_rbsp &>(*nal.rbsp).sliceSegmentHeader;
+}
+
+// A parser that has the parameter sets of the test data with temporal motion vector prediction
+ParserAnnexBHEVC parserWithTemporalMVP()
+{
+  auto sps                          = parseParameterSetsOfTestData().spsMap.at(0);
+  sps.sps_temporal_mvp_enabled_flag = true;
+
+  parser::SubByteWriter writer;
+  nal_unit_header(NalType::SPS_NUT).write(writer);
+  sps.write(writer);
+
+  ParserAnnexBHEVC parser;
+  parser.parseNalUnit(withHeader({0x40, 0x01}, RAW_VPS_DATA));
+  parser.parseNalUnit(writer.finishWritingAndGetData());
+  parser.parseNalUnit(withHeader({0x44, 0x01}, RAW_PPS_DATA));
+  parser.parseNalUnit(ByteVector(idrSliceData));
+  return parser;
+}
+
+// The B slice of the test data (POC 1 between the IDR and POC 4) with temporal motion vector
+// prediction from the first picture of list 1 (POC 4)
+NalUnitHEVC bSliceWithTemporalMVPFromList1()
+{
+  auto testNalUnits = getTestNalUnits();
+  auto parser       = parserWithParameterSets();
+  parser.parseNalUnit(std::move(testNalUnits.at(3)));
+  parser.parseNalUnit(std::move(testNalUnits.at(4)));
+  const auto bSlice = parser.parseNalUnit(std::move(testNalUnits.at(5)));
+
+  auto  slice  = std::make_unique<slice_segment_layer_rbsp>();
+  auto &header = slice->sliceSegmentHeader;
+  header       = getSliceHeader(bSlice);
+
+  header.slice_temporal_mvp_enabled_flag = true;
+  header.collocated_from_l0_flag         = false;
+  header.collocated_ref_idx              = 0;
+
+  NalUnitHEVC nal;
+  nal.header = bSlice.header;
+  nal.rbsp   = std::move(slice);
+  return nal;
+}
+
+// The POCs of the initial reference picture list (T-REC-H.265-201410 - 8.3.4) without long term
+// pictures. List 1 starts with the pictures after the current one.
+std::vector<int> getReferencePOCs(const slice_segment_header &header, const bool list0)
+{
+  const auto &rps = header.stRefPicSet;
+
+  std::vector<int> before;
+  for (size_t i = 0; i < rps.deltaPocS0.size(); ++i)
+    if (rps.usedByCurrPicS0.at(i))
+      before.push_back(header.PicOrderCntVal + rps.deltaPocS0.at(i));
+  std::vector<int> after;
+  for (size_t i = 0; i < rps.deltaPocS1.size(); ++i)
+    if (rps.usedByCurrPicS1.at(i))
+      after.push_back(header.PicOrderCntVal + rps.deltaPocS1.at(i));
+
+  auto pocs = list0 ? before : after;
+  for (const auto poc : list0 ? after : before)
+    pocs.push_back(poc);
+  return pocs;
+}
+
+struct CodingUnit
+{
+  bool     cuSkipFlag{};
+  unsigned mergeIdx{};
+  bool     mvpL0Flag{};
+};
+
+// Decode the coding units of the first row of CTBs of a skip slice of the test data. These are
+// not split. The values that the skip slice always writes are checked.
+std::vector<CodingUnit> decodeFirstRowOfCodingUnits(const NalUnitHEVC         &skipSlice,
+                                                    const ActiveParameterSets &parameterSets)
+{
+  const auto &header              = getSliceHeader(skipSlice);
+  const auto &sps                 = parameterSets.spsMap.at(0);
+  const auto  nrReferencePictures = header.num_ref_idx_l0_active_minus1 + 1;
+  const auto &pps                 = parameterSets.ppsMap.at(0);
+  const auto  SliceQpY = static_cast<int>(26 + pps.init_qp_minus26 + header.slice_qp_delta);
+
+  // The initial values of the contexts with ctxInc 0 of a P slice (cabac_init_flag 0)
+  auto splitCuFlag        = initCabacContext(107, SliceQpY);
+  auto cuSkipFlag = std::array{initCabacContext(197, SliceQpY), initCabacContext(185, SliceQpY)};
+  auto mergeIdx           = initCabacContext(122, SliceQpY);
+  auto predModeFlag       = initCabacContext(149, SliceQpY);
+  auto partMode           = initCabacContext(154, SliceQpY);
+  auto mergeFlag          = initCabacContext(110, SliceQpY);
+  auto refIdx             = initCabacContext(153, SliceQpY);
+  auto absMvdGreater0Flag = initCabacContext(140, SliceQpY);
+  auto mvpFlag            = initCabacContext(168, SliceQpY);
+  auto rqtRootCbf         = initCabacContext(79, SliceQpY);
+
+  const ByteVector sliceData(skipSlice.rawData.begin() + header.nrBytesInHeader,
+                             skipSlice.rawData.end());
+  CabacDecoder     decoder(sliceData);
+
+  std::vector<CodingUnit> codingUnits;
+  for (unsigned ctb = 0; ctb < sps.PicWidthInCtbsY; ++ctb)
+  {
+    EXPECT_FALSE(decoder.decodeDecision(splitCuFlag));
+
+    const auto leftIsSkipped = !codingUnits.empty() && codingUnits.back().cuSkipFlag;
+    CodingUnit codingUnit;
+    codingUnit.cuSkipFlag = decoder.decodeDecision(cuSkipFlag.at(leftIsSkipped));
+    if (codingUnit.cuSkipFlag)
+    {
+      // Truncated rice with cMax 4. Only the first bin has a context.
+      if (decoder.decodeDecision(mergeIdx))
+      {
+        codingUnit.mergeIdx = 1;
+        while (codingUnit.mergeIdx < 4 && decoder.decodeBypass())
+          ++codingUnit.mergeIdx;
+      }
+    }
+    else
+    {
+      EXPECT_FALSE(decoder.decodeDecision(predModeFlag)); // MODE_INTER
+      EXPECT_TRUE(decoder.decodeDecision(partMode));      // PART_2Nx2N
+      EXPECT_FALSE(decoder.decodeDecision(mergeFlag));
+      if (nrReferencePictures > 1)
+      {
+        EXPECT_FALSE(decoder.decodeDecision(refIdx));
+      }
+      EXPECT_FALSE(decoder.decodeDecision(absMvdGreater0Flag));
+      EXPECT_FALSE(decoder.decodeDecision(absMvdGreater0Flag));
+      codingUnit.mvpL0Flag = decoder.decodeDecision(mvpFlag);
+      EXPECT_FALSE(decoder.decodeDecision(rqtRootCbf));
+    }
+    codingUnits.push_back(codingUnit);
+
+    EXPECT_FALSE(decoder.decodeTerminate()); // end_of_slice_segment_flag
+  }
+  return codingUnits;
+}
+
+} // namespace
+
+TEST(SkipSlice, TestSkipSliceForPictureWithReferencesIsPSliceThatParsesBack)
+{
+  auto parser = parserWithParameterSets();
+  parser.parseNalUnit(ByteVector(idrSliceData));
+  const auto reference = parser.parseNalUnit(ByteVector(trailSliceData));
+
+  const auto skipSlice = generateSkipSlice(reference, parser.getActiveParameterSets());
+  EXPECT_EQ(skipSlice.header.nal_unit_type, NalType::TRAIL_R);
+  EXPECT_GT(skipSlice.rawData.size(), getSliceHeader(skipSlice).nrBytesInHeader);
+  EXPECT_NE(skipSlice.rawData.back(), 0);
+
+  auto reparser = parserWithParameterSets();
+  reparser.parseNalUnit(ByteVector(idrSliceData));
+  const auto parsed = reparser.parseNalUnit(ByteVector(skipSlice.rawData));
+
+  const auto &header          = getSliceHeader(parsed);
+  const auto &referenceHeader = getSliceHeader(reference);
+  EXPECT_TRUE(header.first_slice_segment_in_pic_flag);
+  EXPECT_EQ(header.slice_segment_address, 0u);
+  EXPECT_EQ(header.slice_type, SliceType::P);
+  EXPECT_EQ(header.num_ref_idx_l0_active_minus1, 0u);
+  EXPECT_EQ(header.five_minus_max_num_merge_cand, 0u);
+  EXPECT_EQ(header.PicOrderCntVal, referenceHeader.PicOrderCntVal);
+  EXPECT_EQ(header.slice_pic_order_cnt_lsb, referenceHeader.slice_pic_order_cnt_lsb);
+  EXPECT_EQ(header.nrBytesInHeader, getSliceHeader(skipSlice).nrBytesInHeader);
+}
+
+TEST(SkipSlice, TestSkipSliceDataSkipsCodingUnitsWithZeroMotionToTheFirstReferencePicture)
+{
+  auto parser = parserWithParameterSets();
+  parser.parseNalUnit(ByteVector(idrSliceData));
+  const auto reference = parser.parseNalUnit(ByteVector(trailSliceData));
+
+  const auto skipSlice   = generateSkipSlice(reference, parser.getActiveParameterSets());
+  const auto codingUnits = decodeFirstRowOfCodingUnits(skipSlice, parser.getActiveParameterSets());
+
+  // The first coding unit has no spatial merge candidate. Its second candidate is the zero one.
+  ASSERT_EQ(codingUnits.size(), 15u);
+  for (size_t i = 0; i < codingUnits.size(); ++i)
+  {
+    EXPECT_TRUE(codingUnits.at(i).cuSkipFlag);
+    EXPECT_EQ(codingUnits.at(i).mergeIdx, i == 0 ? 1u : 0u);
+  }
+}
+
+TEST(SkipSlice, TestSkipSliceKeepsTheCollocatedPictureOfABSliceReference)
+{
+  auto       parser    = parserWithTemporalMVP();
+  const auto reference = bSliceWithTemporalMVPFromList1();
+
+  const auto skipSlice = generateSkipSlice(reference, parser.getActiveParameterSets());
+  const auto parsed    = parser.parseNalUnit(ByteVector(skipSlice.rawData));
+
+  const auto &header          = getSliceHeader(parsed);
+  const auto &referenceHeader = getSliceHeader(reference);
+  EXPECT_EQ(header.slice_type, SliceType::P);
+  EXPECT_TRUE(header.slice_temporal_mvp_enabled_flag);
+  EXPECT_TRUE(header.collocated_from_l0_flag);
+  EXPECT_EQ(header.num_ref_idx_l0_active_minus1, 1u);
+  EXPECT_EQ(header.collocated_ref_idx, 1u);
+  EXPECT_EQ(header.PicOrderCntVal, referenceHeader.PicOrderCntVal);
+
+  const auto referenceCollocatedPOC = getReferencePOCs(referenceHeader, false).at(0);
+  EXPECT_EQ(referenceCollocatedPOC, 4);
+  EXPECT_EQ(getReferencePOCs(header, true).at(header.collocated_ref_idx), referenceCollocatedPOC);
+  EXPECT_EQ(getReferencePOCs(header, true).at(0), 0);
+
+  // With two reference pictures, the second merge candidate of the first coding unit could be the
+  // zero candidate to the second reference picture. Its zero motion vector is coded instead.
+  const auto codingUnits = decodeFirstRowOfCodingUnits(skipSlice, parser.getActiveParameterSets());
+  ASSERT_EQ(codingUnits.size(), 15u);
+  EXPECT_FALSE(codingUnits.at(0).cuSkipFlag);
+  EXPECT_TRUE(codingUnits.at(0).mvpL0Flag);
+  for (size_t i = 1; i < codingUnits.size(); ++i)
+  {
+    EXPECT_TRUE(codingUnits.at(i).cuSkipFlag);
+    EXPECT_EQ(codingUnits.at(i).mergeIdx, 0u);
+  }
+}
+
+TEST(SkipSlice, TestSkipSliceForIRAPPictureIsISlice)
+{
+  auto       parser    = parserWithParameterSets();
+  const auto reference = parser.parseNalUnit(ByteVector(idrSliceData));
+
+  const auto skipSlice = generateSkipSlice(reference, parser.getActiveParameterSets());
+  EXPECT_EQ(skipSlice.header.nal_unit_type, NalType::IDR_N_LP);
+  EXPECT_EQ(getSliceHeader(skipSlice).slice_type, SliceType::I);
+  EXPECT_FALSE(getSliceHeader(skipSlice).slice_sao_luma_flag);
+}
+
+TEST(SkipSlice, TestSkipSliceIsNotGeneratedWithTiles)
+{
+  auto       parser    = parserWithParameterSets();
+  const auto reference = parser.parseNalUnit(ByteVector(idrSliceData));
+
+  auto parameterSets                            = parser.getActiveParameterSets();
+  parameterSets.ppsMap.at(0).tiles_enabled_flag = true;
+  EXPECT_THROW(generateSkipSlice(reference, parameterSets), std::runtime_error);
+}
+
+TEST(SkipSlice, TestSlateSliceKeepsSliceDataAndGetsHeaderOfReference)
+{
+  auto       parser = parserWithParameterSets();
+  const auto slate  = parser.parseNalUnit(ByteVector(idrSliceData));
+
+  auto referenceData  = idrSliceData;
+  referenceData.at(0) = 0x26; // IDR_W_RADL
+
+  auto       referenceParser = parserWithParameterSets();
+  const auto reference       = referenceParser.parseNalUnit(std::move(referenceData));
+
+  const auto slateSlice = generateSlateSlice(slate, reference);
+  EXPECT_EQ(slateSlice.header.nal_unit_type, NalType::IDR_W_RADL);
+  EXPECT_EQ(slateSlice.rawData, slate.rawData);
+
+  const auto &header      = getSliceHeader(slateSlice);
+  const auto &slateHeader = getSliceHeader(slate);
+  EXPECT_EQ(header.slice_type, SliceType::I);
+  EXPECT_EQ(header.nrBytesInHeader, slateHeader.nrBytesInHeader);
+  EXPECT_EQ(header.slice_qp_delta, slateHeader.slice_qp_delta);
+  EXPECT_EQ(header.PicOrderCntVal, getSliceHeader(reference).PicOrderCntVal);
+}
+
+TEST(SkipSlice, TestSlateSliceMustBeISlice)
+{
+  auto parser = parserWithParameterSets();
+  parser.parseNalUnit(ByteVector(idrSliceData));
+  const auto trailSlice = parser.parseNalUnit(ByteVector(trailSliceData));
+
+  EXPECT_THROW(generateSlateSlice(trailSlice, trailSlice), std::runtime_error);
+}
+
+} // namespace combiner
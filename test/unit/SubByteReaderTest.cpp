@@ -0,0 +1,101 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include <gtest/gtest.h>
+
+#include <common/SubByteReader.h>
+#include <common/SubByteWriter.h>
+
+#include <algorithm>
+
+namespace combiner::parser
+{
+
+namespace
+{
+
+struct Values
+{
+  bool     flag{};
+  uint64_t bits{};
+  uint64_t uev{};
+  int64_t  sev{};
+  uint64_t zeros{};
+  uint64_t lastBits{};
+};
+
+// The zeros are written so that the writer has to insert an emulation prevention byte
+ByteVector writeValues()
+{
+  SubByteWriter writer;
+  writer.writeFlag(true);
+  writer.writeBits(0x2a5, 10);
+  writer.writeUEV(1234);
+  writer.writeSEV(-77);
+  writer.writeBits(0, 32);
+  writer.writeBits(0x1f, 5);
+  return writer.finishWritingAndGetData();
+}
+
+Values readValues(SubByteReader &reader)
+{
+  Values values;
+  values.flag     = reader.readFlag();
+  values.bits     = reader.readBits(10);
+  values.uev      = reader.readUEV();
+  values.sev      = reader.readSEV();
+  values.zeros    = reader.readBits(32);
+  values.lastBits = reader.readBits(5);
+  return values;
+}
+
+void expectSameValues(const Values &values, const Values &expected)
+{
+  EXPECT_EQ(values.flag, expected.flag);
+  EXPECT_EQ(values.bits, expected.bits);
+  EXPECT_EQ(values.uev, expected.uev);
+  EXPECT_EQ(values.sev, expected.sev);
+  EXPECT_EQ(values.zeros, expected.zeros);
+  EXPECT_EQ(values.lastBits, expected.lastBits);
+}
+
+} // namespace
+
+TEST(SubByteReader, TestReadingAtAnOffsetIsTheSameAsReadingACopyOfTheData)
+{
+  const auto values = writeValues();
+  ASSERT_NE(std::find(values.begin(), values.end(), 3), values.end());
+
+  // A NAL unit header in front of the payload, like the slice data of a NAL unit
+  ByteVector nalData(2 + values.size());
+  nalData.at(0) = 0x26;
+  nalData.at(1) = 0x01;
+  std::copy(values.begin(), values.end(), nalData.begin() + 2);
+
+  SubByteReader copyReader(values);
+  const auto    expected = readValues(copyReader);
+  EXPECT_EQ(expected.bits, 0x2a5u);
+  EXPECT_EQ(expected.uev, 1234u);
+  EXPECT_EQ(expected.sev, -77);
+
+  SubByteReader offsetReader(nalData, 2);
+  expectSameValues(readValues(offsetReader), expected);
+  EXPECT_EQ(offsetReader.nrBitsRead(), copyReader.nrBitsRead());
+  EXPECT_EQ(offsetReader.nrBytesRead(), copyReader.nrBytesRead());
+  EXPECT_EQ(offsetReader.nrBytesLeft(), copyReader.nrBytesLeft());
+  EXPECT_EQ(offsetReader.more_rbsp_data(), copyReader.more_rbsp_data());
+}
+
+TEST(SubByteReader, TestReaderDoesNotCopyTheData)
+{
+  ByteVector data = {0x00, 0x00};
+
+  SubByteReader reader(data);
+  data.at(0) = 0xa5;
+  EXPECT_EQ(reader.readBits(8), 0xa5u);
+}
+
+} // namespace combiner::parser
@@ -4,6 +4,8 @@
  * For a copy, see <https://opensource.org/licenses/MIT>.
  */
 
+#pragma once
+
 #include <common/Typedef.h>
 
 namespace combiner
@@ -0,0 +1,134 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include <gtest/gtest.h>
+
+#include <Combiner/ParameterSetsModifiers.h>
+#include <Combiner/TileGrid.h>
+#include <HEVC/ParserAnnexBHEVC.h>
+
+#include "Functions.h"
+
+namespace combiner
+{
+
+namespace
+{
+
+using namespace parser::hevc;
+
+// A picture of 7x4 CTBs
+seq_parameter_set_rbsp spsWithSizeInCtbs()
+{
+  auto sps                       = parseParameterSetsOfTestData().spsMap.at(0);
+  sps.pic_width_in_luma_samples  = 7 * sps.CtbSizeY - sps.MinCbSizeY;
+  sps.pic_height_in_luma_samples = 4 * sps.CtbSizeY;
+  sps.conformance_window_flag    = true;
+  sps.conf_win_right_offset      = 2;
+  sps.conf_win_bottom_offset     = 4;
+  sps.updateCalculatedValues();
+  return sps;
+}
+
+pic_parameter_set_rbsp ppsWithUniformTiles(const uint64_t nrColumns, const uint64_t nrRows)
+{
+  auto pps                    = parseParameterSetsOfTestData().ppsMap.at(0);
+  pps.tiles_enabled_flag      = true;
+  pps.num_tile_columns_minus1 = nrColumns - 1;
+  pps.num_tile_rows_minus1    = nrRows - 1;
+  pps.uniform_spacing_flag    = true;
+  return pps;
+}
+
+} // namespace
+
+TEST(TileExtraction, TestTileGridOfUniformAndSignaledSpacing)
+{
+  const auto sps = spsWithSizeInCtbs();
+  ASSERT_EQ(sps.PicWidthInCtbsY, 7u);
+  ASSERT_EQ(sps.PicHeightInCtbsY, 4u);
+
+  const auto uniformGrid = getTileGrid(sps, ppsWithUniformTiles(3, 2));
+  EXPECT_EQ(uniformGrid.columnBoundaries, std::vector<uint64_t>({0, 2, 4, 7}));
+  EXPECT_EQ(uniformGrid.rowBoundaries, std::vector<uint64_t>({0, 2, 4}));
+  EXPECT_EQ(uniformGrid.findColumn(3), 1u);
+  EXPECT_EQ(uniformGrid.findColumn(6), 2u);
+  EXPECT_EQ(uniformGrid.findRow(2), 1u);
+
+  auto pps                 = ppsWithUniformTiles(2, 2);
+  pps.uniform_spacing_flag = false;
+  pps.column_width_minus1  = {4};
+  pps.row_height_minus1    = {0};
+  const auto grid          = getTileGrid(sps, pps);
+  EXPECT_EQ(grid.columnBoundaries, std::vector<uint64_t>({0, 5, 7}));
+  EXPECT_EQ(grid.rowBoundaries, std::vector<uint64_t>({0, 1, 4}));
+
+  const auto gridWithoutTiles = getTileGrid(sps, parseParameterSetsOfTestData().ppsMap.at(0));
+  EXPECT_EQ(gridWithoutTiles.nrColumns(), 1u);
+  EXPECT_EQ(gridWithoutTiles.nrRows(), 1u);
+}
+
+TEST(TileExtraction, TestTileRegionFromString)
+{
+  const auto tile = TileRegion::fromString("1,0");
+  EXPECT_EQ(tile.firstColumn, 1u);
+  EXPECT_EQ(tile.firstRow, 0u);
+  EXPECT_EQ(tile.nrColumns, 1u);
+  EXPECT_EQ(tile.nrRows, 1u);
+
+  const auto region = TileRegion::fromString("0,1,2,3");
+  EXPECT_EQ(region.nrColumns, 2u);
+  EXPECT_EQ(region.nrRows, 3u);
+
+  EXPECT_THROW(TileRegion::fromString("1"), std::invalid_argument);
+  EXPECT_THROW(TileRegion::fromString("1,-1"), std::invalid_argument);
+  EXPECT_THROW(TileRegion::fromString("0,0,0,1"), std::invalid_argument);
+  EXPECT_THROW(TileRegion::fromString("0,0x"), std::invalid_argument);
+}
+
+TEST(TileExtraction, TestParameterSetsOfInnerRegion)
+{
+  const auto sps  = spsWithSizeInCtbs();
+  const auto pps  = ppsWithUniformTiles(3, 2);
+  const auto grid = getTileGrid(sps, pps);
+
+  const auto mapping = getTileMapping(TileRegion::fromString("0,0,2,1"), grid);
+  const auto newSPS  = generateSPSForTileMapping(sps, grid, mapping);
+  EXPECT_EQ(newSPS.pic_width_in_luma_samples, 4 * sps.CtbSizeY);
+  EXPECT_EQ(newSPS.pic_height_in_luma_samples, 2 * sps.CtbSizeY);
+  EXPECT_FALSE(newSPS.conformance_window_flag);
+  EXPECT_EQ(newSPS.PicSizeInCtbsY, 8u);
+
+  const auto newPPS = generatePPSForTileMapping(pps, grid, mapping);
+  EXPECT_TRUE(newPPS.tiles_enabled_flag);
+  EXPECT_FALSE(newPPS.uniform_spacing_flag);
+  EXPECT_EQ(newPPS.num_tile_columns_minus1, 1u);
+  EXPECT_EQ(newPPS.num_tile_rows_minus1, 0u);
+  EXPECT_EQ(newPPS.column_width_minus1, vector<uint64_t>({1}));
+  EXPECT_EQ(getTileGrid(newSPS, newPPS).columnBoundaries, std::vector<uint64_t>({0, 2, 4}));
+}
+
+TEST(TileExtraction, TestParameterSetsOfTileAtPictureEdge)
+{
+  const auto sps  = spsWithSizeInCtbs();
+  const auto pps  = ppsWithUniformTiles(3, 2);
+  const auto grid = getTileGrid(sps, pps);
+
+  const auto mapping = getTileMapping(TileRegion::fromString("2,1"), grid);
+  const auto newSPS  = generateSPSForTileMapping(sps, grid, mapping);
+  EXPECT_EQ(newSPS.pic_width_in_luma_samples, 3 * sps.CtbSizeY - sps.MinCbSizeY);
+  EXPECT_EQ(newSPS.pic_height_in_luma_samples, 2 * sps.CtbSizeY);
+  EXPECT_TRUE(newSPS.conformance_window_flag);
+  EXPECT_EQ(newSPS.conf_win_right_offset, 2u);
+  EXPECT_EQ(newSPS.conf_win_bottom_offset, 4u);
+
+  const auto newPPS = generatePPSForTileMapping(pps, grid, mapping);
+  EXPECT_FALSE(newPPS.tiles_enabled_flag);
+
+  EXPECT_THROW(getTileMapping(TileRegion::fromString("2,1,2,1"), grid), std::runtime_error);
+}
+
+} // namespace combiner
@@ -0,0 +1,142 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include <gtest/gtest.h>
+
+#include <Combiner/ParameterSetsModifiers.h>
+#include <Combiner/TileGrid.h>
+#include <HEVC/ParserAnnexBHEVC.h>
+
+#include "Functions.h"
+
+namespace combiner
+{
+
+namespace
+{
+
+using namespace parser::hevc;
+
+// A picture of 8x4 CTBs. If endsWithinCtb, the last CTB column is only partly in the picture.
+seq_parameter_set_rbsp spsWithSizeInCtbs(const bool endsWithinCtb)
+{
+  auto sps                       = parseParameterSetsOfTestData().spsMap.at(0);
+  sps.pic_width_in_luma_samples  = 8 * sps.CtbSizeY - (endsWithinCtb ? sps.MinCbSizeY : 0);
+  sps.pic_height_in_luma_samples = 4 * sps.CtbSizeY;
+  sps.conformance_window_flag    = true;
+  sps.conf_win_right_offset      = 2;
+  sps.conf_win_bottom_offset     = 4;
+  sps.updateCalculatedValues();
+  return sps;
+}
+
+// 2x2 tiles of 4x2 CTBs
+pic_parameter_set_rbsp ppsWith2x2Tiles()
+{
+  auto pps                    = parseParameterSetsOfTestData().ppsMap.at(0);
+  pps.tiles_enabled_flag      = true;
+  pps.num_tile_columns_minus1 = 1;
+  pps.num_tile_rows_minus1    = 1;
+  pps.uniform_spacing_flag    = true;
+  return pps;
+}
+
+} // namespace
+
+TEST(TileLayout, TestTileLayoutFromString)
+{
+  const auto layout = TileLayout::fromString("4x1");
+  EXPECT_EQ(layout.nrColumns, 4u);
+  EXPECT_EQ(layout.nrRows, 1u);
+  EXPECT_EQ(layout.tilePerPosition, std::vector<unsigned>({0, 1, 2, 3}));
+
+  const auto reordered = TileLayout::fromString("2x2:3,2,1,0");
+  EXPECT_EQ(reordered.nrColumns, 2u);
+  EXPECT_EQ(reordered.nrRows, 2u);
+  EXPECT_EQ(reordered.tilePerPosition, std::vector<unsigned>({3, 2, 1, 0}));
+
+  EXPECT_THROW(TileLayout::fromString("4"), std::invalid_argument);
+  EXPECT_THROW(TileLayout::fromString("0x1"), std::invalid_argument);
+  EXPECT_THROW(TileLayout::fromString("2x1:1"), std::invalid_argument);
+  EXPECT_THROW(TileLayout::fromString("2x1:1,1"), std::invalid_argument);
+  EXPECT_THROW(TileLayout::fromString("2x1:1,2"), std::invalid_argument);
+}
+
+TEST(TileLayout, TestTileMappingOfLayout)
+{
+  const auto grid = getTileGrid(spsWithSizeInCtbs(false), ppsWith2x2Tiles());
+
+  const auto mapping = getTileMapping(TileLayout::fromString("2x2:3,2,1,0"), grid);
+  EXPECT_EQ(mapping.nrColumns, 2u);
+  EXPECT_EQ(mapping.nrRows, 2u);
+  EXPECT_EQ(mapping.newPositionPerTile,
+            std::vector<std::optional<size_t>>({size_t(3), size_t(2), size_t(1), size_t(0)}));
+
+  EXPECT_THROW(getTileMapping(TileLayout::fromString("3x1"), grid), std::runtime_error);
+}
+
+TEST(TileLayout, TestMappedTileGrid)
+{
+  const auto sps  = spsWithSizeInCtbs(false);
+  const auto grid = getTileGrid(sps, ppsWith2x2Tiles());
+
+  const auto newGrid = getMappedTileGrid(grid, getTileMapping(TileLayout::fromString("4x1"), grid));
+  EXPECT_EQ(newGrid.columnBoundaries, std::vector<uint64_t>({0, 4, 8, 12, 16}));
+  EXPECT_EQ(newGrid.rowBoundaries, std::vector<uint64_t>({0, 2}));
+  EXPECT_EQ(newGrid.width, 16 * sps.CtbSizeY);
+  EXPECT_EQ(newGrid.height, 2 * sps.CtbSizeY);
+
+  // The tiles of the first column are not as wide as the ones of the second column
+  auto pps                 = ppsWith2x2Tiles();
+  pps.uniform_spacing_flag = false;
+  pps.column_width_minus1  = {2};
+  pps.row_height_minus1    = {1};
+  const auto unevenGrid    = getTileGrid(sps, pps);
+  EXPECT_THROW(getMappedTileGrid(unevenGrid,
+                                 getTileMapping(TileLayout::fromString("1x4"), unevenGrid)),
+               std::runtime_error);
+}
+
+TEST(TileLayout, TestTileEndingWithinCtbMustStayAtEdge)
+{
+  const auto grid = getTileGrid(spsWithSizeInCtbs(true), ppsWith2x2Tiles());
+
+  // Swapping the rows keeps the partial CTB column at the right edge
+  EXPECT_NO_THROW(
+      getMappedTileGrid(grid, getTileMapping(TileLayout::fromString("2x2:2,3,0,1"), grid)));
+  EXPECT_THROW(getMappedTileGrid(grid, getTileMapping(TileLayout::fromString("2x2:1,0,3,2"), grid)),
+               std::runtime_error);
+  EXPECT_THROW(getMappedTileGrid(grid, getTileMapping(TileLayout::fromString("4x1"), grid)),
+               std::runtime_error);
+}
+
+TEST(TileLayout, TestParameterSetsOfLayout)
+{
+  const auto sps  = spsWithSizeInCtbs(false);
+  const auto pps  = ppsWith2x2Tiles();
+  const auto grid = getTileGrid(sps, pps);
+
+  const auto mapping = getTileMapping(TileLayout::fromString("4x1"), grid);
+  const auto newSPS  = generateSPSForTileMapping(sps, grid, mapping);
+  EXPECT_EQ(newSPS.pic_width_in_luma_samples, 16 * sps.CtbSizeY);
+  EXPECT_EQ(newSPS.pic_height_in_luma_samples, 2 * sps.CtbSizeY);
+  EXPECT_EQ(newSPS.PicSizeInCtbsY, 32u);
+  // The last tile comes from the bottom right of the picture. The first one from the top.
+  EXPECT_TRUE(newSPS.conformance_window_flag);
+  EXPECT_EQ(newSPS.conf_win_right_offset, 2u);
+  EXPECT_EQ(newSPS.conf_win_bottom_offset, 0u);
+
+  const auto newPPS = generatePPSForTileMapping(pps, grid, mapping);
+  EXPECT_TRUE(newPPS.tiles_enabled_flag);
+  EXPECT_FALSE(newPPS.uniform_spacing_flag);
+  EXPECT_EQ(newPPS.num_tile_columns_minus1, 3u);
+  EXPECT_EQ(newPPS.num_tile_rows_minus1, 0u);
+  EXPECT_EQ(newPPS.column_width_minus1, vector<uint64_t>({3, 3, 3}));
+  EXPECT_EQ(getTileGrid(newSPS, newPPS).columnBoundaries,
+            std::vector<uint64_t>({0, 4, 8, 12, 16}));
+}
+
+} // namespace combiner
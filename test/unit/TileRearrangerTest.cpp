@@ -0,0 +1,200 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include <gtest/gtest.h>
+
+#include <Combiner/TileRearranger.h>
+#include <File/MemorySink.h>
+#include <common/SubByteWriter.h>
+
+#include "Functions.h"
+
+#include <stdexcept>
+
+namespace combiner
+{
+
+namespace
+{
+
+using namespace parser::hevc;
+
+// A picture of 4x4 CTBs with 2x2 tiles of 2x2 CTBs. Tile 0 starts at CTB 0, tile 1 at CTB 2, tile
+// 2 at CTB 8 and tile 3 at CTB 10.
+const std::vector<uint64_t> TILE_ADDRESSES = {0, 2, 8, 10};
+
+ActiveParameterSets getTiledParameterSets()
+{
+  auto  parameterSets = parseParameterSetsOfTestData();
+  auto &sps           = parameterSets.spsMap.at(0);
+  auto &pps           = parameterSets.ppsMap.at(0);
+
+  sps.pic_width_in_luma_samples  = 4 * sps.CtbSizeY;
+  sps.pic_height_in_luma_samples = 4 * sps.CtbSizeY;
+  sps.conformance_window_flag    = false;
+  sps.updateCalculatedValues();
+
+  pps.tiles_enabled_flag                    = true;
+  pps.num_tile_columns_minus1               = 1;
+  pps.num_tile_rows_minus1                  = 1;
+  pps.uniform_spacing_flag                  = true;
+  pps.loop_filter_across_tiles_enabled_flag = true;
+  return parameterSets;
+}
+
+template <typename ParameterSet>
+ByteVector writeNalUnit(const nal_unit_header &header, const ParameterSet &parameterSet)
+{
+  parser::SubByteWriter writer;
+  header.write(writer);
+  parameterSet.write(writer);
+  return writer.finishWritingAndGetData();
+}
+
+const slice_segment_header &getSliceHeader(const NalUnitHEVC &nal)
+{
+  return dynamic_cast<slice_segment_layer_rbsp &>(*nal.rbsp).sliceSegmentHeader;
+}
+
+// An IDR slice segment with the header of the test data at the CTB address. The slice data is not
+// valid. It is never decoded. It is the marker which tells the tile that the slice came from.
+ByteVector writeSlice(const ActiveParameterSets &parameterSets,
+                      const uint64_t             address,
+                      const uint8_t              marker)
+{
+  auto       testNalUnits = getTestNalUnits();
+  auto       parser       = parserWithParameterSets();
+  const auto idrSlice     = parser.parseNalUnit(std::move(testNalUnits.at(3)));
+  auto       header       = getSliceHeader(idrSlice);
+
+  header.first_slice_segment_in_pic_flag = (address == 0);
+  header.slice_segment_address           = address;
+  header.dependent_slice_segment_flag    = false;
+
+  parser::SubByteWriter writer;
+  idrSlice.header.write(writer);
+  header.write(writer, idrSlice.header, parameterSets);
+  auto data = writer.finishWritingAndGetData();
+  append(data, {marker});
+  return data;
+}
+
+// Pictures with one slice per tile. The marker of a slice is its tile index in the picture.
+std::vector<ByteVector> writeTiledStream(const size_t nrPictures)
+{
+  const auto parameterSets = getTiledParameterSets();
+
+  std::vector<ByteVector> nalUnits;
+  nalUnits.push_back(writeNalUnit(nal_unit_header(NalType::VPS_NUT), parameterSets.vpsMap.at(0)));
+  nalUnits.push_back(writeNalUnit(nal_unit_header(NalType::SPS_NUT), parameterSets.spsMap.at(0)));
+  nalUnits.push_back(writeNalUnit(nal_unit_header(NalType::PPS_NUT), parameterSets.ppsMap.at(0)));
+  for (size_t picture = 0; picture < nrPictures; ++picture)
+    for (size_t tile = 0; tile < TILE_ADDRESSES.size(); ++tile)
+      nalUnits.push_back(
+          writeSlice(parameterSets, TILE_ADDRESSES.at(tile), static_cast<uint8_t>(tile)));
+  return nalUnits;
+}
+
+struct RearrangedStream
+{
+  pic_parameter_set_rbsp pps;
+  seq_parameter_set_rbsp sps;
+
+  struct Slice
+  {
+    bool     firstSliceSegmentInPic{};
+    uint64_t address{};
+    uint8_t  marker{};
+  };
+  std::vector<Slice> slices;
+};
+
+RearrangedStream rearrange(const TileArrangement &arrangement)
+{
+  MemorySink sink;
+  TileRearranger(std::make_unique<MemorySource>(writeTiledStream(2)), sink, arrangement);
+
+  RearrangedStream stream;
+  ParserAnnexBHEVC parser;
+  for (auto &nalData : sink.getNalUnits())
+  {
+    const auto marker = nalData.back();
+    const auto nal    = parser.parseNalUnit(std::move(nalData));
+    if (const auto sps = dynamic_cast<seq_parameter_set_rbsp *>(nal.rbsp.get()))
+      stream.sps = *sps;
+    else if (const auto pps = dynamic_cast<pic_parameter_set_rbsp *>(nal.rbsp.get()))
+      stream.pps = *pps;
+    else if (const auto slice = dynamic_cast<slice_segment_layer_rbsp *>(nal.rbsp.get()))
+    {
+      const auto &header  = slice->sliceSegmentHeader;
+      const auto  isFirst = header.first_slice_segment_in_pic_flag;
+      stream.slices.push_back({isFirst, isFirst ? 0 : header.slice_segment_address, marker});
+    }
+  }
+  return stream;
+}
+
+} // namespace
+
+TEST(TileRearranger, TestSlicesAreMovedToTheNewPositionOfTheirTile)
+{
+  const auto stream = rearrange(TileLayout::fromString("2x2:3,2,1,0"));
+
+  EXPECT_EQ(stream.sps.PicWidthInCtbsY, 4u);
+  EXPECT_EQ(stream.sps.PicHeightInCtbsY, 4u);
+  EXPECT_TRUE(stream.pps.tiles_enabled_flag);
+  EXPECT_FALSE(stream.pps.loop_filter_across_tiles_enabled_flag);
+
+  ASSERT_EQ(stream.slices.size(), 8u);
+  for (size_t i = 0; i < stream.slices.size(); ++i)
+  {
+    const auto &slice    = stream.slices.at(i);
+    const auto  position = i % TILE_ADDRESSES.size();
+    EXPECT_EQ(slice.firstSliceSegmentInPic, position == 0);
+    EXPECT_EQ(slice.address, TILE_ADDRESSES.at(position));
+    EXPECT_EQ(slice.marker, 3 - position);
+  }
+}
+
+TEST(TileRearranger, TestTilesWithoutNewPositionAreDropped)
+{
+  // The right column of tiles (tiles 1 and 3) as a picture of 2x4 CTBs
+  const auto stream = rearrange(TileRegion::fromString("1,0,1,2"));
+
+  EXPECT_EQ(stream.sps.PicWidthInCtbsY, 2u);
+  EXPECT_EQ(stream.sps.PicHeightInCtbsY, 4u);
+  EXPECT_EQ(stream.pps.num_tile_columns_minus1, 0u);
+  EXPECT_EQ(stream.pps.num_tile_rows_minus1, 1u);
+  EXPECT_FALSE(stream.pps.loop_filter_across_tiles_enabled_flag);
+
+  ASSERT_EQ(stream.slices.size(), 4u);
+  for (size_t i = 0; i < stream.slices.size(); ++i)
+  {
+    const auto &slice    = stream.slices.at(i);
+    const auto  position = i % 2;
+    EXPECT_EQ(slice.firstSliceSegmentInPic, position == 0);
+    EXPECT_EQ(slice.address, position * 4);
+    EXPECT_EQ(slice.marker, position == 0 ? 1 : 3);
+  }
+}
+
+TEST(TileRearranger, TestSliceOverMultipleTilesIsRejected)
+{
+  // The first slice spans tiles 0 and 1. The next slice starts tile 2.
+  const auto parameterSets = getTiledParameterSets();
+
+  auto nalUnits = writeTiledStream(0);
+  nalUnits.push_back(writeSlice(parameterSets, TILE_ADDRESSES.at(0), 0));
+  nalUnits.push_back(writeSlice(parameterSets, TILE_ADDRESSES.at(2), 2));
+
+  MemorySink sink;
+  EXPECT_THROW(TileRearranger(std::make_unique<MemorySource>(nalUnits),
+                              sink,
+                              TileLayout::fromString("2x2")),
+               std::runtime_error);
+}
+
+} // namespace combiner
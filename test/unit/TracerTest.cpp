@@ -0,0 +1,38 @@
+/* Copyright (c) 2023 Christian Feldmann [christian.feldmann@gmx.de].
+ * All rights reserved.
+ * This work is licensed under the terms of the MIT license.
+ * For a copy, see <https://opensource.org/licenses/MIT>.
+ */
+
+#include <gtest/gtest.h>
+
+#include <common/Tracer.h>
+
+#include <thread>
+
+namespace combiner
+{
+
+TEST(Tracer, TestEventsOfAllThreadsAreWrittenWithArguments)
+{
+  Tracer     localTracer;
+  const auto now = Tracer::Clock::now();
+
+  std::vector<std::thread> threads;
+  for (size_t threadIndex = 0; threadIndex < 2; ++threadIndex)
+    threads.emplace_back([&localTracer, now, threadIndex]() {
+      localTracer.addEvent("parse", now, now + std::chrono::microseconds(10), {threadIndex, 8, 1});
+    });
+  for (auto &thread : threads)
+    thread.join();
+
+  const auto json = localTracer.toJSON();
+  EXPECT_NE(json.find("\"traceEvents\""), std::string::npos);
+  EXPECT_NE(json.find("\"tid\": 0"), std::string::npos);
+  EXPECT_NE(json.find("\"tid\": 1"), std::string::npos);
+  EXPECT_NE(json.find("\"input\": 0, \"POC\": 8, \"nalUnitType\": 1"), std::string::npos);
+  EXPECT_NE(json.find("\"input\": 1, \"POC\": 8, \"nalUnitType\": 1"), std::string::npos);
+  EXPECT_NE(json.find("\"dur\": 10.000"), std::string::npos);
+}
+
+} // namespace combiner